@@ -24,73 +24,83 @@ static char addrbuf[INET6_ADDRSTRLEN];
 static struct nlattr *attrs[NDA_MAX + 1];
 static struct nlmsghdr *m = (struct nlmsghdr *)(void *)buf;
 
-int main(void)
+/* The request is resent if the dump restarts */
+static union {
+	struct nlmsghdr m;
+	char buf[NLMSG_SPACE(sizeof(struct ndmsg))];
+} req;
+
+/**
+ * Print a neighbor table entry
+ */
+static int print_neighbor(struct nlmsghdr *e, void *arg)
 {
-	__u32 len;
-	ssize_t br;
-	struct nlmsghdr *e;
 	struct ndmsg *ndm;
 	char state[9];
 	unsigned long i;
 	const unsigned char *lladdr;
-	__u8 family = AF_INET;
 
-	memset(buf, 0, sizeof buf);
-	if ((fd = nl_open(NETLINK_ROUTE, (__u32)getpid())) < 0) {
-		perror("Unable to open netlink socket");
-		goto ret;
+	(void)arg;
+	if (!e) {
+		fputs("Neighbor table changed, restarting\n", stderr);
+		return 0;
 	}
 
-dump_addrs:
-	nl_nd_get_neighbors(m, family);
-	if ((__u32)nl_send(fd, 0, m) != m->nlmsg_len) {
-		fputs("Failed to send neighbor request\n", stderr);
-		goto ret;
+	if (e->nlmsg_type != RTM_NEWNEIGH) return 0;
+	ndm = NLMSG_DATA(e);
+
+	state[8] = 0;
+	memset(state, '-', 8);
+	if (ndm->ndm_state & NUD_INCOMPLETE) state[0] = 'i';
+	if (ndm->ndm_state & NUD_REACHABLE)  state[1] = 'r';
+	if (ndm->ndm_state & NUD_STALE)      state[2] = 's';
+	if (ndm->ndm_state & NUD_DELAY)      state[3] = 'd';
+	if (ndm->ndm_state & NUD_PROBE)      state[4] = 'p';
+	if (ndm->ndm_state & NUD_FAILED)     state[5] = 'f';
+	if (ndm->ndm_state & NUD_NOARP)      state[6] = 'N';
+	if (ndm->ndm_state & NUD_PERMANENT)  state[7] = 'P';
+
+	memset(attrs, 0, sizeof attrs);
+	nl_nd_get_attrv(e, attrs);
+	if (attrs[NDA_DST] && attrs[NDA_LLADDR]) {
+		inet_ntop(ndm->ndm_family,
+		          NLA_DATA(attrs[NDA_DST]),
+		          addrbuf, sizeof addrbuf);
+		printf("%s %-46s @ ", state, addrbuf);
+		lladdr = (const unsigned char *)(NLA_DATA(attrs[NDA_LLADDR]));
+		for (i = 0; i < attrs[NDA_LLADDR]->nla_len - NLA_HDRLEN; ++i)
+			printf(i ? ":%02x" : "%02x", lladdr[i]);
+		putchar('\n');
 	}
 
-read:
-	if ((br = nl_recv(fd, m, NLMSG_GOODSIZE, NULL)) <= 0) {
-		fputs("Failed to read neighbors\n", stderr);
-		goto ret;
-	} else len = (__u32)br;
+	return 0;
+}
 
-	for (e = m; NLMSG_OK(e, len); e = NLMSG_NEXT(e, len)) {
-		if (e->nlmsg_type == NLMSG_DONE) {
-			if (family == AF_INET) {
-				family = AF_INET6;
-				goto dump_addrs;
-			} else goto ret;
-		} else if (e->nlmsg_type != RTM_NEWNEIGH) continue;
-		ndm = NLMSG_DATA(e);
+int main(void)
+{
+	int i;
+	static const __u8 family[2] = { AF_INET, AF_INET6 };
 
-		state[8] = 0;
-		memset(state, '-', 8);
-		if (ndm->ndm_state & NUD_INCOMPLETE) state[0] = 'i';
-		if (ndm->ndm_state & NUD_REACHABLE)  state[1] = 'r';
-		if (ndm->ndm_state & NUD_STALE)      state[2] = 's';
-		if (ndm->ndm_state & NUD_DELAY)      state[3] = 'd';
-		if (ndm->ndm_state & NUD_PROBE)      state[4] = 'p';
-		if (ndm->ndm_state & NUD_FAILED)     state[5] = 'f';
-		if (ndm->ndm_state & NUD_NOARP)      state[6] = 'N';
-		if (ndm->ndm_state & NUD_PERMANENT)  state[7] = 'P';
+	memset(buf, 0, sizeof buf);
+	if ((fd = nl_open(NETLINK_ROUTE, (__u32)getpid())) < 0) {
+		perror("Unable to open netlink socket");
+		goto ret;
+	}
 
-		memset(attrs, 0, sizeof attrs);
-		nl_nd_get_attrv(e, attrs);
-		if (attrs[NDA_DST] && attrs[NDA_LLADDR]) {
-			inet_ntop(ndm->ndm_family,
-			          NLA_DATA(attrs[NDA_DST]),
-			          addrbuf, sizeof addrbuf);
-			printf("%s %-46s @ ", state, addrbuf);
-			lladdr = (const unsigned char *)(NLA_DATA(attrs[NDA_LLADDR]));
-			for (i = 0; i < attrs[NDA_LLADDR]->nla_len - NLA_HDRLEN; ++i)
-				printf(i ? ":%02x" : "%02x", lladdr[i]);
-			putchar('\n');
+	for (i = 0; i < 2; i++) {
+		nl_nd_get_neighbors(&req.m, family[i]);
+		switch (nl_dump(fd, &req.m, m, sizeof buf, 3,
+		                print_neighbor, NULL)) {
+		case 1:
+			fputs("Neighbor table kept changing\n", stderr);
+			break;
+		case -1:
+			fputs("Failed to read neighbors\n", stderr);
+			goto ret;
 		}
 	}
-	goto read;
 
 ret:
 	if (fd >= 0) close(fd);
 	return EXIT_SUCCESS;
 }
-
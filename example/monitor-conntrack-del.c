@@ -11,7 +11,6 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
-#include <endian.h>
 #include <inttypes.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -24,20 +23,20 @@
 static int fd = -1;
 static char buf[NLMSG_GOODSIZE];
 static char addrbuf[INET6_ADDRSTRLEN];
-static struct nlattr *attrs[CTA_MAX + 1];
-static struct nlattr *tattrs[CTA_TUPLE_MAX + 1];
-static struct nlattr *ipattrs[CTA_IP_MAX + 1];
-static struct nlattr *pattrs[CTA_PROTO_MAX + 1];
-static struct nlattr *o[CTA_COUNTERS_MAX + 1];
-static struct nlattr *r[CTA_COUNTERS_MAX + 1];
 static struct nlmsghdr *m = (struct nlmsghdr *)(void *)buf;
 
+static const char *addr(const struct nl_nfct_tuple *t, const __u32 *a)
+{
+	return inet_ntop(t->l3proto == NFPROTO_IPV6 ? AF_INET6 : AF_INET,
+	                 a, addrbuf, sizeof addrbuf);
+}
+
 int main(void)
 {
-	__u32 pid = 0, mark;
+	__u32 pid = 0;
 	struct nlmsghdr *e;
+	struct nl_nfct_flow f;
 	size_t len;
-	unsigned short port;
 
 	memset(buf, 0, sizeof buf);
 	if ((fd = nl_open(NETLINK_NETFILTER, (__u32)getpid())) < 0) {
@@ -69,76 +68,20 @@ loop:
 		if ((e->nlmsg_type & 0xff) != IPCTNL_MSG_CT_DELETE)
 			continue;
 
-		mark = 0;
-		memset(attrs, 0, sizeof attrs);
-		memset(tattrs, 0, sizeof tattrs);
-		memset(pattrs, 0, sizeof pattrs);
-		memset(o, 0, sizeof o);
-		memset(r, 0, sizeof r);
-
-		nl_nf_get_attrv(e, attrs);
-		if (attrs[CTA_MARK])
-			mark = ntohl(*(__u32 *)NLA_DATA(attrs[CTA_MARK]));
-
-		/* Parse the origin tuple */
-		nla_get_attrv(attrs[CTA_TUPLE_ORIG], tattrs, CTA_TUPLE_MAX);
-		nla_get_attrv(tattrs[CTA_TUPLE_IP], ipattrs, CTA_IP_MAX);
-		nla_get_attrv(tattrs[CTA_TUPLE_PROTO], pattrs, CTA_PROTO_MAX);
-
-		/* Print the source address / port */
-		memset(addrbuf, 0, sizeof addrbuf);
-		if (ipattrs[CTA_IP_V6_SRC]) {
-			inet_ntop(AF_INET6,
-			          NLA_DATA(ipattrs[CTA_IP_V6_SRC]),
-			          addrbuf, sizeof addrbuf);
-		} else {
-			inet_ntop(AF_INET,
-			          NLA_DATA(ipattrs[CTA_IP_V4_SRC]),
-			          addrbuf, sizeof addrbuf);
-		}
-
-		port = 0;
-		if (pattrs[CTA_PROTO_SRC_PORT]) {
-			port = ntohs(*(unsigned short *)NLA_DATA(
-			             pattrs[CTA_PROTO_SRC_PORT]));
-		}
-
-		if (mark) printf("[mark=0x%08x] ", mark);
-		printf("%s (%u) -> ", addrbuf, port);
-
-		/* Print the destination address / port */
-		memset(addrbuf, 0, sizeof addrbuf);
-		if (ipattrs[CTA_IP_V6_DST]) {
-			inet_ntop(AF_INET6,
-			          NLA_DATA(ipattrs[CTA_IP_V6_DST]),
-			          addrbuf, sizeof addrbuf);
-		} else {
-			inet_ntop(AF_INET,
-			          NLA_DATA(ipattrs[CTA_IP_V4_DST]),
-			          addrbuf, sizeof addrbuf);
-		}
+		if (nl_nfct_parse(e, &f))
+			continue;
 
-		port = 0;
-		if (pattrs[CTA_PROTO_DST_PORT]) {
-			port = ntohs(*(unsigned short *)NLA_DATA(
-			             pattrs[CTA_PROTO_DST_PORT]));
-		}
-		printf("%s (%u) ", addrbuf, port);
+		if (f.mark) printf("[mark=0x%08x] ", f.mark);
+		printf("%s (%u) -> ", addr(&f.orig, f.orig.src), f.orig.sport);
+		printf("%s (%u) ", addr(&f.orig, f.orig.dst), f.orig.dport);
 
 		/* Print the counters if we have them */
-		nla_get_attrv(attrs[CTA_COUNTERS_ORIG],  o, CTA_COUNTERS_MAX);
-		nla_get_attrv(attrs[CTA_COUNTERS_REPLY], r, CTA_COUNTERS_MAX);
-		if (o[CTA_COUNTERS_BYTES]) {
+		if (f.orig_bytes)
 			printf("%" PRIu64 " bytes (orig) ",
-			       be64toh(*(uint64_t *)NLA_DATA(o[CTA_COUNTERS_BYTES]))
-			);
-		}
-
-		if (r[CTA_COUNTERS_BYTES]) {
+			       (uint64_t)f.orig_bytes);
+		if (f.reply_bytes)
 			printf("%" PRIu64 " bytes (reply) ",
-			       be64toh(*(uint64_t *)NLA_DATA(r[CTA_COUNTERS_BYTES]))
-			);
-		}
+			       (uint64_t)f.reply_bytes);
 
 		putchar('\n');
 	}
@@ -0,0 +1,290 @@
+/**
+ * nanonl: nfqueue-balance: Multithreaded NFQUEUE example
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * This example services a range of queues, as given to iptables via
+ * --queue-balance first:last, with one socket per queue, and one worker
+ * thread per queue pinned to its own CPU. Each worker drains as many
+ * packets as are pending (up to BATCH_MAX) before deciding them, and
+ * consecutive accepted packets are adjudicated with a single
+ * NFQNL_MSG_VERDICT_BATCH message via a verdict accumulator.
+ *
+ * The queues are bound with NFQA_CFG_F_GSO, so that the kernel needn't
+ * segment GSO packets before queueing them, and NFQA_CFG_F_FAIL_OPEN, so
+ * that packets are accepted rather than dropped if a queue overflows.
+ *
+ * Usage: nfqueue-balance [first [last]]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "../src/nl.h"
+#include "../src/nl_nfqueue.h"
+
+#define BATCH_MAX   64
+#define COPY_RANGE  0xffff
+#define RECV_BUFSZ  (COPY_RANGE + NLMSG_GOODSIZE)
+#define SOCK_BUFSZ  (8 << 20)
+
+#ifndef NETLINK_NO_ENOBUFS
+#define NETLINK_NO_ENOBUFS 5
+#endif
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif
+
+/**
+ * Verdict callback: return the verdict (NF_*) for the packet \a p.
+ */
+typedef __u32 (*verdict_cb)(__u16 qn, struct nl_nfqueue_pkt *p, void *arg);
+
+struct queue {
+	pthread_t thread;
+	int fd;
+	int cpu;
+	__u16 qn;
+	verdict_cb cb;
+	void *arg;
+	struct nl_nfqueue_vbatch vb;
+
+	/* Statistics */
+	unsigned long packets;
+	unsigned long accepted;
+	unsigned long other;
+	unsigned long verdict_msgs;
+	unsigned long overruns;
+	unsigned long errors;
+
+	char rbuf[RECV_BUFSZ];
+	char sbuf[NLMSG_GOODSIZE];
+};
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static __u32 accept_all(__u16 qn, struct nl_nfqueue_pkt *p, void *arg)
+{
+	(void)qn;
+	(void)p;
+	(void)arg;
+	return NF_ACCEPT;
+}
+
+static int send_msg(struct queue *q, struct nlmsghdr *m)
+{
+	if ((__u32)nl_send(q->fd, 0, m) != m->nlmsg_len) {
+		++q->errors;
+		return -1;
+	}
+
+	++q->verdict_msgs;
+	return 0;
+}
+
+static int open_queue(struct queue *q)
+{
+	int sz = SOCK_BUFSZ, on = 1;
+	struct nl_nfqueue_opts o;
+	struct nlmsghdr *m = (struct nlmsghdr *)(void *)q->sbuf;
+
+	if ((q->fd = nl_open(NETLINK_NETFILTER, 0)) < 0) {
+		perror("Unable to open netlink socket");
+		return -1;
+	}
+
+	nl_nfqueue_vbatch_init(&q->vb, q->qn, BATCH_MAX, 0);
+	setsockopt(q->fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof sz);
+	setsockopt(q->fd, SOL_NETLINK, NETLINK_NO_ENOBUFS, &on, sizeof on);
+	o.cmode  = NFQNL_COPY_PACKET;
+	o.crange = COPY_RANGE;
+	o.maxlen = 0;
+	o.flags  = NFQA_CFG_F_GSO | NFQA_CFG_F_FAIL_OPEN;
+	o.mask   = 0;
+	nl_nfqueue_bind_opts(m, PF_INET, q->qn, &o);
+	if ((__u32)nl_send(q->fd, 0, m) != m->nlmsg_len) {
+		fprintf(stderr, "Failed to bind queue %u\n", q->qn);
+		return -1;
+	}
+
+	if (fcntl(q->fd, F_SETFL, fcntl(q->fd, F_GETFL) | O_NONBLOCK)) {
+		perror("Unable to make the socket non-blocking");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void close_queue(struct queue *q)
+{
+	struct nlmsghdr *m = (struct nlmsghdr *)(void *)q->sbuf;
+
+	if (q->fd < 0) return;
+	nl_nfqueue_unbind(m, PF_INET, q->qn);
+	if ((__u32)nl_send(q->fd, 0, m) != m->nlmsg_len)
+		fprintf(stderr, "Failed to unbind queue %u\n", q->qn);
+	close(q->fd);
+	q->fd = -1;
+}
+
+/**
+ * Read up to BATCH_MAX pending packets, and adjudicate them. Packets
+ * are given to the kernel in order, so as long as every packet we've
+ * seen so far was accepted, one batch verdict covers all of them.
+ */
+static void drain(struct queue *q)
+{
+	unsigned int n;
+	__u32 verdict;
+	struct nl_nfqueue_pkt pkt;
+	struct nlmsghdr *m = (struct nlmsghdr *)(void *)q->rbuf;
+	struct nlmsghdr *v = (struct nlmsghdr *)(void *)q->sbuf;
+
+	for (n = 0; n < BATCH_MAX; n++) {
+		errno = 0;
+		if (nl_recv(q->fd, m, sizeof q->rbuf, NULL) <= 0) {
+			if (errno == ENOBUFS) {
+				++q->overruns;
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				++q->errors;
+			break;
+		}
+
+		if ((m->nlmsg_type & 0xff) != NFQNL_MSG_PACKET ||
+		    nl_nfqueue_parse(m, &pkt))
+			continue;
+
+		++q->packets;
+		if ((verdict = q->cb(q->qn, &pkt, q->arg)) == NF_ACCEPT) {
+			++q->accepted;
+			if (nl_nfqueue_vbatch_accept(&q->vb, v, pkt.id, 0))
+				send_msg(q, v);
+			continue;
+		}
+
+		/* Flush the run of accepted packets before this one */
+		if (nl_nfqueue_vbatch_flush(&q->vb, v))
+			send_msg(q, v);
+
+		++q->other;
+		nl_nfqueue_verdict(v, q->qn, pkt.id, verdict);
+		send_msg(q, v);
+	}
+
+	if (nl_nfqueue_vbatch_flush(&q->vb, v))
+		send_msg(q, v);
+}
+
+static void *worker(void *arg)
+{
+	struct pollfd pfd;
+	struct queue *q = arg;
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET((size_t)q->cpu, &cpus);
+	if (pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus))
+		fprintf(stderr, "Unable to pin queue %u to CPU %d\n",
+		        q->qn, q->cpu);
+
+	pfd.fd     = q->fd;
+	pfd.events = POLLIN;
+	while (!stop) {
+		/* Wake up periodically to check for shutdown */
+		if (poll(&pfd, 1, 250) <= 0)
+			continue;
+		drain(q);
+	}
+
+	return NULL;
+}
+
+int main(int argc, const char *argv[])
+{
+	struct sigaction sa;
+	struct queue *queues;
+	long ncpu;
+	unsigned int i, n, started = 0;
+	__u16 first = 0, last = 0;
+
+	if (argc > 1) first = last = (__u16)atoi(argv[1]);
+	if (argc > 2) last = (__u16)atoi(argv[2]);
+	if (last < first) {
+		fputs("Usage: nfqueue-balance [first [last]]\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) < 1) ncpu = 1;
+	n = (unsigned int)(last - first) + 1;
+	if (!(queues = calloc(n, sizeof *queues))) {
+		perror("Unable to allocate queues");
+		return EXIT_FAILURE;
+	}
+
+	memset(&sa, 0, sizeof sa);
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT,  &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	for (i = 0; i < n; i++)
+		queues[i].fd = -1;
+
+	for (i = 0; i < n; i++) {
+		queues[i].qn  = (__u16)(first + i);
+		queues[i].cpu = (int)(i % (unsigned long)ncpu);
+		queues[i].cb  = accept_all;
+		if (open_queue(&queues[i]))
+			goto shutdown;
+	}
+
+	for (i = 0; i < n; i++, started++) {
+		if (pthread_create(&queues[i].thread, NULL, worker,
+		                   &queues[i])) {
+			perror("Unable to start worker");
+			stop = 1;
+			break;
+		}
+	}
+
+	printf("Serving queues %u-%u on %ld CPUs...\n", first, last, ncpu);
+	fflush(stdout);
+
+shutdown:
+	for (i = 0; i < started; i++)
+		pthread_join(queues[i].thread, NULL);
+
+	for (i = 0; i < n; i++) {
+		close_queue(&queues[i]);
+		printf("queue %5u: %lu packets, %lu accepted, %lu other, "
+		       "%lu verdict msgs, %lu overruns, %lu errors\n",
+		       queues[i].qn, queues[i].packets, queues[i].accepted,
+		       queues[i].other, queues[i].verdict_msgs,
+		       queues[i].overruns, queues[i].errors);
+	}
+
+	free(queues);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,461 @@
+/**
+ * nanonl: nfqueue-dispatch: Flow-affine NFQUEUE dispatch example
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * This example reads packets from a single queue, and spreads them
+ * across a number of worker threads for inspection, while keeping the
+ * packets of each flow in order. The main thread owns the socket: it
+ * hashes each packet's addresses, ports and protocol, and hands the
+ * packet to the worker chosen by the hash over a single-producer /
+ * single-consumer ring. Workers return decided packets over a second
+ * ring, and the main thread sends the verdicts, coalescing accepted
+ * packets into batch verdicts.
+ *
+ * The main thread never waits on a worker: if a worker's ring is full,
+ * the packet is accepted without inspection. If too many packets are
+ * awaiting a verdict behind a slow one, it simply stops reading from
+ * the socket until the slow packet is decided.
+ *
+ * Usage: nfqueue-dispatch [queue [workers]]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "../src/nl.h"
+#include "../src/nl_nfqueue.h"
+
+#define MAX_WORKERS 64
+#define BATCH_MAX   64
+#define COPY_RANGE  4096
+#define PKT_BUFSZ   (COPY_RANGE + 512)
+#define NBUF        4096            /* Packet buffers (power of 2) */
+#define RING_SIZE   1024            /* Ring slots (power of 2) */
+#define FIFO_SIZE   (NBUF << 2)     /* Undecided packets (power of 2) */
+#define CACHELINE   64
+
+/* Packet states */
+#define PKT_PENDING 0
+#define PKT_ACCEPT  1
+#define PKT_DONE    2
+
+/**
+ * Verdict callback: return the verdict (NF_*) for the packet \a p.
+ * This is called from the worker threads.
+ */
+typedef __u32 (*verdict_cb)(struct nl_nfqueue_pkt *p, void *arg);
+
+struct pkt {
+	struct nl_nfqueue_pkt p;
+	unsigned long pos;      /* Position in the FIFO */
+	__u32 verdict;
+	char buf[PKT_BUFSZ];
+};
+
+/**
+ * Single-producer / single-consumer ring. The producer only writes
+ * \a head, and the consumer only writes \a tail.
+ */
+struct ring {
+	unsigned long head;
+	char pad0[CACHELINE - sizeof(unsigned long)];
+	unsigned long tail;
+	char pad1[CACHELINE - sizeof(unsigned long)];
+	struct pkt *slot[RING_SIZE];
+};
+
+struct worker {
+	pthread_t thread;
+	int cpu;
+	struct ring in;         /* Main thread -> worker */
+	struct ring done;       /* Worker -> main thread */
+	unsigned long packets;
+};
+
+/* Packets awaiting a verdict, in the order they were received */
+struct fifo_ent {
+	__u32 id;
+	int state;
+};
+
+static int fd = -1;
+static __u16 qn = 0;
+static unsigned int nworkers;
+static struct worker *workers;
+static struct pkt *pkts;
+static struct pkt *freelist[NBUF];
+static unsigned int nfree;
+static struct fifo_ent fifo[FIFO_SIZE];
+static unsigned long fifo_head, fifo_tail;
+static struct nl_nfqueue_vbatch vb;
+static char sbuf[NLMSG_GOODSIZE];
+static struct nlmsghdr *v = (struct nlmsghdr *)(void *)sbuf;
+static verdict_cb cb;
+static void *cb_arg;
+
+static volatile sig_atomic_t stop = 0;
+static int workers_stop = 0;
+
+/* Statistics */
+static unsigned long received, bypassed, verdict_msgs, errors;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static __u32 accept_all(struct nl_nfqueue_pkt *p, void *arg)
+{
+	(void)p;
+	(void)arg;
+	return NF_ACCEPT;
+}
+
+static int ring_push(struct ring *r, struct pkt *p)
+{
+	unsigned long head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == RING_SIZE)
+		return -1;
+	r->slot[head & (RING_SIZE - 1)] = p;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static struct pkt *ring_pop(struct ring *r)
+{
+	struct pkt *p;
+	unsigned long tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+	if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+		return NULL;
+	p = r->slot[tail & (RING_SIZE - 1)];
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+	return p;
+}
+
+static void idle(void)
+{
+	struct timespec ts;
+	ts.tv_sec  = 0;
+	ts.tv_nsec = 20000;
+	nanosleep(&ts, NULL);
+}
+
+/**
+ * Hash the addresses, ports and protocol of a packet. The hash is
+ * symmetric, so both directions of a flow go to the same worker. Only
+ * the addresses are used for fragments, since only the first fragment
+ * carries the ports. IPv6 extension headers aren't followed.
+ */
+static __u32 flow_hash(const struct nl_nfqueue_pkt *p)
+{
+	unsigned int i;
+	const __u8 *b = p->payload;
+	__u32 h = 0, w, ports = 0, hl = 0;
+	__u8 proto = 0;
+
+	if (!b || p->payload_len < 20)
+		return 0;
+
+	switch (b[0] >> 4) {
+	case 4:
+		proto = b[9];
+		hl    = (__u32)(b[0] & 0x0f) << 2;
+		for (i = 12; i < 20; i += 4) {
+			memcpy(&w, b + i, sizeof w);
+			h ^= w;
+		}
+
+		/* Skip the ports if this is a fragment */
+		if ((b[6] & 0x3f) || b[7])
+			hl = 0;
+		break;
+	case 6:
+		if (p->payload_len < 40) return 0;
+		proto = b[6];
+		hl    = 40;
+		for (i = 8; i < 40; i += 4) {
+			memcpy(&w, b + i, sizeof w);
+			h ^= w;
+		}
+		break;
+	default: return 0;
+	}
+
+	if (hl && p->payload_len >= hl + 4 &&
+	    (proto == IPPROTO_TCP || proto == IPPROTO_UDP ||
+	     proto == IPPROTO_UDPLITE || proto == IPPROTO_SCTP)) {
+		memcpy(&ports, b + hl, sizeof ports);
+		h ^= (ports >> 16) ^ (ports & 0xffff);
+	}
+
+	h ^= proto;
+	h *= 0x9e3779b1U;
+	return h ^ (h >> 16);
+}
+
+static void send_msg(struct nlmsghdr *m)
+{
+	if ((__u32)nl_send(fd, 0, m) != m->nlmsg_len)
+		++errors;
+	else ++verdict_msgs;
+}
+
+/**
+ * Accept every packet at the head of the FIFO which has been decided.
+ * Since a batch verdict applies to every queued packet with a lower ID,
+ * we can't go past a packet that's still being inspected.
+ */
+static void advance(void)
+{
+	struct fifo_ent *e;
+
+	while (fifo_tail != fifo_head) {
+		e = &fifo[fifo_tail & (FIFO_SIZE - 1)];
+		if (e->state == PKT_PENDING) break;
+		if (e->state == PKT_ACCEPT &&
+		    nl_nfqueue_vbatch_accept(&vb, v, e->id, 0))
+			send_msg(v);
+		++fifo_tail;
+	}
+}
+
+static void decide(unsigned long pos, __u32 id, __u32 verdict)
+{
+	struct fifo_ent *e = &fifo[pos & (FIFO_SIZE - 1)];
+
+	if (verdict == NF_ACCEPT) {
+		e->state = PKT_ACCEPT;
+	} else {
+		nl_nfqueue_verdict(v, qn, id, verdict);
+		send_msg(v);
+		e->state = PKT_DONE;
+	}
+}
+
+static void complete(struct pkt *p)
+{
+	decide(p->pos, p->p.id, p->verdict);
+	freelist[nfree++] = p;
+}
+
+/**
+ * Read up to BATCH_MAX packets, and hand each to a worker.
+ */
+static int receive(void)
+{
+	int n;
+	struct pkt *p;
+	struct worker *w;
+	struct nlmsghdr *m;
+
+	for (n = 0; n < BATCH_MAX && nfree &&
+	            fifo_head - fifo_tail < FIFO_SIZE; n++) {
+		p = freelist[nfree - 1];
+		m = (struct nlmsghdr *)(void *)p->buf;
+
+		errno = 0;
+		if (nl_recv(fd, m, sizeof p->buf, NULL) <= 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK &&
+			    errno != ENOBUFS)
+				++errors;
+			break;
+		}
+
+		if ((m->nlmsg_type & 0xff) != NFQNL_MSG_PACKET ||
+		    nl_nfqueue_parse(m, &p->p))
+			continue;
+
+		++received;
+		p->pos = fifo_head++;
+		fifo[p->pos & (FIFO_SIZE - 1)].id    = p->p.id;
+		fifo[p->pos & (FIFO_SIZE - 1)].state = PKT_PENDING;
+
+		w = &workers[flow_hash(&p->p) % nworkers];
+		if (ring_push(&w->in, p)) {
+			++bypassed;
+			decide(p->pos, p->p.id, NF_ACCEPT);
+			continue;
+		}
+
+		--nfree;
+	}
+
+	return n;
+}
+
+static void *worker(void *arg)
+{
+	struct pkt *p;
+	struct worker *w = arg;
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET((size_t)w->cpu, &cpus);
+	if (pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus))
+		fprintf(stderr, "Unable to pin worker to CPU %d\n", w->cpu);
+
+	for (;;) {
+		if ((p = ring_pop(&w->in))) {
+			p->verdict = cb(&p->p, cb_arg);
+			while (ring_push(&w->done, p))
+				idle();
+			++w->packets;
+			continue;
+		}
+
+		if (__atomic_load_n(&workers_stop, __ATOMIC_ACQUIRE))
+			break;
+		idle();
+	}
+
+	return NULL;
+}
+
+static int open_queue(void)
+{
+	int sz = 8 << 20;
+	struct nl_nfqueue_opts o;
+
+	if ((fd = nl_open(NETLINK_NETFILTER, 0)) < 0) {
+		perror("Unable to open netlink socket");
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof sz);
+	o.cmode  = NFQNL_COPY_PACKET;
+	o.crange = COPY_RANGE;
+	o.maxlen = 0;
+	o.flags  = NFQA_CFG_F_FAIL_OPEN;
+	o.mask   = 0;
+	nl_nfqueue_bind_opts(v, PF_INET, qn, &o);
+	if ((__u32)nl_send(fd, 0, v) != v->nlmsg_len) {
+		fprintf(stderr, "Failed to bind queue %u\n", qn);
+		return -1;
+	}
+
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)) {
+		perror("Unable to make the socket non-blocking");
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+	int busy;
+	long ncpu;
+	unsigned int i, started = 0;
+	struct sigaction sa;
+	struct pollfd pfd;
+	struct pkt *p;
+
+	if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) < 2) ncpu = 2;
+	nworkers = (unsigned int)(ncpu - 1);
+	if (argc > 1) qn = (__u16)atoi(argv[1]);
+	if (argc > 2) nworkers = (unsigned int)atoi(argv[2]);
+	if (!nworkers || nworkers > MAX_WORKERS) {
+		fputs("Usage: nfqueue-dispatch [queue [workers]]\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	workers = calloc(nworkers, sizeof *workers);
+	pkts    = calloc(NBUF, sizeof *pkts);
+	if (!workers || !pkts) {
+		perror("Unable to allocate buffers");
+		goto ret;
+	}
+
+	for (nfree = 0; nfree < NBUF; nfree++)
+		freelist[nfree] = &pkts[nfree];
+
+	memset(&sa, 0, sizeof sa);
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT,  &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	cb = accept_all;
+	nl_nfqueue_vbatch_init(&vb, qn, BATCH_MAX, 0);
+	if (open_queue()) goto unbind;
+
+	/* The main thread keeps CPU 0 to itself */
+	for (i = 0; i < nworkers; i++, started++) {
+		workers[i].cpu = (int)(1 + i % (unsigned long)(ncpu - 1));
+		if (pthread_create(&workers[i].thread, NULL, worker,
+		                   &workers[i])) {
+			perror("Unable to start worker");
+			stop = 1;
+			break;
+		}
+	}
+
+	printf("Dispatching queue %u to %u workers...\n", qn, started);
+	fflush(stdout);
+
+	pfd.fd     = fd;
+	pfd.events = POLLIN;
+	while (!stop || nfree < NBUF) {
+		busy = 0;
+		for (i = 0; i < started; i++) {
+			while ((p = ring_pop(&workers[i].done))) {
+				complete(p);
+				busy = 1;
+			}
+		}
+
+		advance();
+		if (!stop && receive() > 0) busy = 1;
+		if (busy) continue;
+
+		/* Nothing to do: send what we have, and wait */
+		if (nl_nfqueue_vbatch_flush(&vb, v))
+			send_msg(v);
+		if (nfree < NBUF) idle();
+		else poll(&pfd, 1, 250);
+	}
+
+	advance();
+	if (nl_nfqueue_vbatch_flush(&vb, v))
+		send_msg(v);
+
+	__atomic_store_n(&workers_stop, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+		printf("worker %2u: %lu packets\n", i, workers[i].packets);
+	}
+
+	printf("%lu packets, %lu bypassed, %lu verdict msgs, %lu errors\n",
+	       received, bypassed, verdict_msgs, errors);
+
+unbind:
+	if (fd >= 0) {
+		nl_nfqueue_unbind(v, PF_INET, qn);
+		if ((__u32)nl_send(fd, 0, v) != v->nlmsg_len)
+			fputs("Failed to send unbind message\n", stderr);
+		close(fd);
+	}
+
+ret:
+	free(workers);
+	free(pkts);
+	return EXIT_SUCCESS;
+}
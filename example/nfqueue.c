@@ -25,7 +25,7 @@ static struct nlmsghdr *m = (struct nlmsghdr *)(void *)buf;
 int main(int argc, const char *argv[])
 {
 	__u32 pid;
-	struct nfqnl_msg_packet_hdr *phdr;
+	struct nl_nfqueue_pkt pkt;
 	size_t len;
 
 	if (argc > 1) qn = (__u16)atoi(argv[1]);
@@ -71,10 +71,12 @@ int main(int argc, const char *argv[])
 			break;
 		}
 
-		phdr = NLA_DATA(nl_nf_get_attr(m, NFQA_PACKET_HDR));
-		phdr->packet_id = ntohl(phdr->packet_id);
-		printf("Accepting packet #%u\n", phdr->packet_id);
-		nl_nfqueue_verdict(m, qn, phdr->packet_id, NF_ACCEPT);
+		if (nl_nfqueue_parse(m, &pkt))
+			continue;
+
+		printf("Accepting packet #%u (%u bytes, in=%u out=%u)\n",
+		       pkt.id, pkt.payload_len, pkt.indev, pkt.outdev);
+		nl_nfqueue_verdict(m, qn, pkt.id, NF_ACCEPT);
 		if ((__u32)nl_send(fd, 0, m) != m->nlmsg_len) {
 			fputs("Failed to send verdict message\n", stderr);
 			break;
@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 
 #include "nl.h"
 
@@ -36,6 +37,22 @@ static void nl_set_sa(struct sockaddr_nl *sa, __u32 port)
 	sa->nl_groups = 0;
 }
 
+static ssize_t nl_sendmsg(int fd, __u32 port, struct iovec *iov, size_t n)
+{
+	struct msghdr hdr;
+	struct sockaddr_nl sa;
+	nl_set_sa(&sa, port);
+
+	hdr.msg_name       = &sa;
+	hdr.msg_namelen    = (socklen_t)sizeof(struct sockaddr_nl);
+	hdr.msg_iov        = iov;
+	hdr.msg_iovlen     = n;
+	hdr.msg_control    = NULL;
+	hdr.msg_controllen = 0;
+	hdr.msg_flags      = 0;
+	return sendmsg(fd, &hdr, 0);
+}
+
 /**
  * \brief Open a netlink socket.
  * \param[in] protocol Netlink protocol to use (e.g. \a NETLINK_ROUTE).
@@ -104,30 +121,63 @@ ssize_t nl_send(int fd, __u32 port, struct nlmsghdr *msg)
 {
 	ssize_t i = -1;
 	struct iovec iov;
-	struct msghdr hdr;
-	struct sockaddr_nl sa;
-	nl_set_sa(&sa, port);
 
 	if (!msg || !NLMSG_OK(msg, msg->nlmsg_len)) {
 		errno = EINVAL;
 		goto ret;
 	}
 
-	iov.iov_base       = msg;
-	iov.iov_len        = msg->nlmsg_len;
-	hdr.msg_name       = &sa;
-	hdr.msg_namelen    = (socklen_t)sizeof(struct sockaddr_nl);
-	hdr.msg_iov        = &iov;
-	hdr.msg_iovlen     = 1;
-	hdr.msg_control    = NULL;
-	hdr.msg_controllen = 0;
-	hdr.msg_flags      = 0;
-	i = sendmsg(fd, &hdr, 0);
+	iov.iov_base = msg;
+	iov.iov_len  = msg->nlmsg_len;
+	i = nl_sendv(fd, port, &iov, 1);
 
 ret:
 	return i;
 }
 
+/**
+ * \brief Send a netlink message from a scatter / gather array.
+ * \param[in] fd   Netlink socket file descriptor.
+ * \param[in] port Destination netlink port.
+ * \param[in] iov  Array of buffers, which together make up the message.
+ * \param[in] n    Number of elements in \a iov.
+ * \return Number of bytes sent, or -1 on error (with \a errno set.)
+ *
+ * This allows large attributes (i.e. packet payloads) to be sent by
+ * reference, rather than copied into the message buffer. The first
+ * buffer must start with the netlink header, whose \a nlmsg_len must
+ * cover all of the buffers.
+ *
+ * In addition to the \a errno values set by \a sendmsg(2)
+ * this function will set the following:
+ *
+ * \a EINVAL - \a iov is NULL or empty, or \a nlmsg_len doesn't match
+ *            the total length of the buffers.
+ */
+ssize_t nl_sendv(int fd, __u32 port, struct iovec *iov, size_t n)
+{
+	ssize_t ret = -1;
+	size_t i, len = 0;
+
+	if (!iov || !n || !iov->iov_base ||
+	    iov->iov_len < sizeof(struct nlmsghdr))
+		goto inval;
+
+	for (i = 0; i < n; i++)
+		len += iov[i].iov_len;
+	if (len != ((struct nlmsghdr *)iov->iov_base)->nlmsg_len)
+		goto inval;
+
+	ret = nl_sendmsg(fd, port, iov, n);
+	goto ret;
+
+inval:
+	errno = EINVAL;
+
+ret:
+	return ret;
+}
+
 /**
  * \brief Receive a netlink message.
  * \param[in]     fd   Netlink socket file descriptor.
@@ -252,6 +302,261 @@ err:
 	return ret;
 }
 
+#define DUMP_INTR 1
+#define DUMP_STOP 2
+
+/**
+ * Pass the dumped messages in \a m to the callback, and set \a stop to
+ * the error the callback stopped the dump with.
+ * \return 1 at the end of the dump, 0 if more messages are expected,
+ *         or -1 on error (with \a errno set.)
+ */
+static int dump_msgs(struct nlmsghdr *m, size_t len, __u32 seq,
+                     int *state, int *stop, nl_dump_cb cb, void *arg)
+{
+	int e;
+	const size_t elen = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+
+	for (; NLMSG_OK(m, len); m = NLMSG_NEXT(m, len)) {
+		if (m->nlmsg_seq != seq) continue;
+		if (m->nlmsg_flags & NLM_F_DUMP_INTR) *state |= DUMP_INTR;
+		if (m->nlmsg_type == NLMSG_DONE) return 1;
+		if (m->nlmsg_type == NLMSG_ERROR) {
+			if (m->nlmsg_len < elen) continue;
+			if (!(e = ((struct nlmsgerr *)NLMSG_DATA(m))->error))
+				continue;
+			errno = e;
+			return -1;
+		}
+
+		if (*state & DUMP_STOP) continue;
+		errno = 0;
+		if (cb(m, arg)) {
+			*state |= DUMP_STOP;
+			*stop   = errno ? errno : ECANCELED;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Perform a dump request
+ * \param[in] fd      Netlink socket file descriptor (blocking.)
+ * \param[in] req     Dump request
+ * \param[in] buf     Buffer to receive the reply into
+ * \param[in] len     Length (in bytes) of \a buf.
+ * \param[in] retries Maximum number of times to restart the dump
+ * \param[in] cb      Callback for each dumped message
+ * \param[in] arg     User data for \a cb
+ * \return 0 if the dump was consistent, 1 if it was interrupted too
+ *         many times, or -1 on error (with \a errno set.)
+ *
+ * If the dumped table changes during the dump, the kernel flags the
+ * remaining messages with NLM_F_DUMP_INTR. The dump is then read to
+ * the end, and restarted (with the next sequence number) until it
+ * completes without being interrupted, or \a retries is exhausted.
+ * Messages with other sequence numbers are ignored.
+ *
+ * With \a retries set to 0, an interrupted dump is simply reported.
+ * The caller may then reconcile the affected entries by other means.
+ *
+ * In addition to the \a errno values set by nl_send() and nl_recv(),
+ * this function will set the following:
+ *
+ * \a EINVAL    - An invalid parameter was passed to this function.
+ * \a ECANCELED - The callback stopped the dump (without setting
+ *                \a errno.) The rest of the dump has been read (and
+ *                discarded.)
+ *
+ * If the callback sets \a errno when stopping the dump, that value is
+ * kept instead of ECANCELED.
+ */
+int nl_dump(int fd, struct nlmsghdr *req, void *buf, size_t len,
+            unsigned int retries, nl_dump_cb cb, void *arg)
+{
+	ssize_t n;
+	int ret, state, stop = 0;
+
+	if (!req || !buf || !cb || len < sizeof(struct nlmsghdr)) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	req->nlmsg_flags |= NLM_F_DUMP;
+
+restart:
+	state = 0;
+	if ((size_t)nl_send(fd, 0, req) != req->nlmsg_len)
+		goto err;
+
+	do {
+		if ((n = nl_recv(fd, buf, len, NULL)) <= 0) {
+			if (!n) errno = EIO;
+			goto err;
+		}
+
+		ret = dump_msgs(buf, (size_t)n, req->nlmsg_seq, &state,
+		                &stop, cb, arg);
+	} while (!ret);
+
+	if (ret < 0) goto err;
+	if (state & DUMP_STOP) {
+		errno = stop;
+		goto err;
+	}
+
+	if (!(state & DUMP_INTR)) return 0;
+	if (!retries-- || cb(NULL, arg)) return 1;
+	++req->nlmsg_seq;
+	goto restart;
+
+err:
+	return -1;
+}
+
+/**
+ * \brief Initialize a message batch
+ * \param[in] b    Batch
+ * \param[in] buf  Buffer to hold the messages
+ * \param[in] size Size of \a buf (in bytes)
+ * \param[in] seq  Sequence number of the first message
+ */
+void nl_batch_init(struct nl_batch *b, void *buf, size_t size, __u32 seq)
+{
+	if (!b) return;
+	b->buf   = buf;
+	b->size  = buf ? size : 0;
+	b->len   = 0;
+	b->seq   = seq;
+	b->count = 0;
+}
+
+/**
+ * \brief Get the buffer for the next message in a batch
+ * \param[in] b   Batch
+ * \param[in] len Maximum length of the message (in bytes)
+ * \return Buffer for the message, or NULL if fewer than \a len bytes
+ *         remain (the batch should be sent first.)
+ */
+struct nlmsghdr *nl_batch_next(struct nl_batch *b, size_t len)
+{
+	if (!b || !b->buf || len < sizeof(struct nlmsghdr) ||
+	    b->size - b->len < len)
+		return NULL;
+	return BYTE_OFF(b->buf, b->len);
+}
+
+/**
+ * \brief Add the next message to a batch
+ * \param[in] b Batch
+ * \return The index of the message in the batch, or -1 on error (with
+ *         \a errno set.)
+ *
+ * The message (built in the buffer returned by nl_batch_next()) is
+ * given the next sequence number, and NLM_F_ACK is set so that the
+ * kernel acknowledges it, or replies with an error.
+ *
+ * \a EINVAL - The message is invalid.
+ * \a E2BIG  - The message overruns the buffer.
+ */
+long nl_batch_add(struct nl_batch *b)
+{
+	struct nlmsghdr *m;
+
+	if (!b || !b->buf || b->size - b->len < sizeof *m) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	m = BYTE_OFF(b->buf, b->len);
+	if (m->nlmsg_len < NLMSG_HDRLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (NLMSG_ALIGN(m->nlmsg_len) > b->size - b->len) {
+		errno = E2BIG;
+		return -1;
+	}
+
+	m->nlmsg_seq    = b->seq + b->count;
+	m->nlmsg_flags |= NLM_F_ACK;
+	b->len += NLMSG_ALIGN(m->nlmsg_len);
+	return (long)b->count++;
+}
+
+/**
+ * \brief Send a batch of messages
+ * \param[in] fd   Netlink socket file descriptor.
+ * \param[in] port Destination netlink port.
+ * \param[in] b    Batch
+ * \return Number of bytes sent, or -1 on error (with \a errno set.)
+ *
+ * All of the messages are sent with a single \a sendmsg(2) call. The
+ * batch is left as-is, so that the replies may be matched with
+ * nl_batch_ack(). Use nl_batch_reset() to start the next batch.
+ *
+ * \a EINVAL - The batch is empty.
+ */
+ssize_t nl_batch_send(int fd, __u32 port, struct nl_batch *b)
+{
+	struct iovec iov;
+
+	if (!b || !b->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	iov.iov_base = b->buf;
+	iov.iov_len  = b->len;
+	return nl_sendmsg(fd, port, &iov, 1);
+}
+
+/**
+ * \brief Match a reply to a message in a batch
+ * \param[in]  b   Batch
+ * \param[in]  m   Received message
+ * \param[out] err The error (0 for an ACK, or a negative \a errno value)
+ * \return The index of the message in the batch, or -1 if \a m isn't
+ *         an ACK / error for a message in the batch.
+ *
+ * Note that nl_recv() returns -1 for errors, with \a errno set to the
+ * (negative) error, but \a m still holds the error message.
+ */
+long nl_batch_ack(const struct nl_batch *b, const struct nlmsghdr *m,
+                  int *err)
+{
+	__u32 i;
+	const struct nlmsgerr *e;
+
+	if (!b || !m || m->nlmsg_type != NLMSG_ERROR ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *e))
+		return -1;
+
+	e = NLMSG_DATA(m);
+	if ((i = e->msg.nlmsg_seq - b->seq) >= b->count)
+		return -1;
+
+	if (err) *err = e->error;
+	return (long)i;
+}
+
+/**
+ * \brief Start the next batch
+ * \param[in] b Batch
+ *
+ * The buffer is emptied, and the sequence numbers continue on from
+ * the messages in the previous batch.
+ */
+void nl_batch_reset(struct nl_batch *b)
+{
+	if (!b) return;
+	b->seq  += b->count;
+	b->len   = 0;
+	b->count = 0;
+}
+
 /**
  * \brief Initialize a netlink message.
  * \param[in] m     Netlink message buffer.
@@ -353,6 +658,37 @@ void nla_end(struct nlmsghdr *m, const struct nlattr *nla)
 	m->nlmsg_len += NLMSG_ALIGN(nla->nla_len);
 }
 
+/**
+ * \brief Add a nested netlink attribute to a nested NLA
+ * \param[in] nla  Netlink nested attribute.
+ * \param[in] type Attribute type.
+ * \return the nested attribute.
+ *
+ * Only one nested attribute may be open within \a nla at a time.
+ */
+struct nlattr *nla_nest_start(struct nlattr *nla, __u16 type)
+{
+	struct nlattr *attr;
+	if (!nla) return NULL;
+
+	attr = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	attr->nla_type = type | NLA_F_NESTED;
+	attr->nla_len  = NLA_HDRLEN;
+	return attr;
+}
+
+/**
+ * \brief Finalize a nested netlink attribute within a nested NLA
+ * \param[in] nla  Netlink nested attribute.
+ * \param[in] nest Nested attribute (from nla_nest_start())
+ */
+void nla_nest_end(struct nlattr *nla, const struct nlattr *nest)
+{
+	if (!nla || !nest) return;
+	nla->nla_len = (__u16)NLA_ALIGN(NLA_ALIGN(nla->nla_len) +
+	                                nest->nla_len);
+}
+
 /**
  * \brief Get a netlink attribute (NLA) by its type.
  * \param[in] m         Netlink message buffer.
@@ -529,3 +865,116 @@ ret:
 	return found;
 }
 
+/**
+ * \brief Convert a 64-bit value from network to host byte order
+ * \param[in] p The value (which needn't be aligned)
+ * \return The value, in host byte order.
+ */
+__u64 nl_be64_to_host(const void *p)
+{
+	__u32 w[2];
+
+	memcpy(w, p, sizeof w);
+	return ((__u64)ntohl(w[0]) << 32) | ntohl(w[1]);
+}
+
+/**
+ * \brief Read a __u8 attribute
+ * \param[in] nla Attribute (or NULL)
+ * \return The value, or 0 if \a nla is NULL or too short.
+ */
+__u8 nla_u8(struct nlattr *nla)
+{
+	__u8 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return v;
+}
+
+/**
+ * \brief Read a __u16 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u16 nla_u16(struct nlattr *nla)
+{
+	__u16 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return v;
+}
+
+/**
+ * \brief Read a __u32 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u32 nla_u32(struct nlattr *nla)
+{
+	__u32 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return v;
+}
+
+/**
+ * \brief Read a __u64 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u64 nla_u64(struct nlattr *nla)
+{
+	__u64 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return v;
+}
+
+/**
+ * \brief Read a __u16 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u16 nla_u16_be(struct nlattr *nla)
+{
+	__u16 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return ntohs(v);
+}
+
+/**
+ * \brief Read a __u32 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u32 nla_u32_be(struct nlattr *nla)
+{
+	__u32 v;
+
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof v) return 0;
+	memcpy(&v, NLA_DATA(nla), sizeof v);
+	return ntohl(v);
+}
+
+/**
+ * \brief Read a __u64 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u64 nla_u64_be(struct nlattr *nla)
+{
+	if (!nla || nla->nla_len < NLA_HDRLEN + sizeof(__u64)) return 0;
+	return nl_be64_to_host(NLA_DATA(nla));
+}
@@ -109,6 +109,27 @@ int nl_multicast(int fd, int join, int group, ...);
  */
 ssize_t nl_send(int fd, __u32 port, struct nlmsghdr *msg);
 
+/**
+ * \brief Send a netlink message from a scatter / gather array.
+ * \param[in] fd   Netlink socket file descriptor.
+ * \param[in] port Destination netlink port.
+ * \param[in] iov  Array of buffers, which together make up the message.
+ * \param[in] n    Number of elements in \a iov.
+ * \return Number of bytes sent, or -1 on error (with \a errno set.)
+ *
+ * This allows large attributes (i.e. packet payloads) to be sent by
+ * reference, rather than copied into the message buffer. The first
+ * buffer must start with the netlink header, whose \a nlmsg_len must
+ * cover all of the buffers.
+ *
+ * In addition to the \a errno values set by \a sendmsg(2)
+ * this function will set the following:
+ *
+ * \a EINVAL - \a iov is NULL or empty, or \a nlmsg_len doesn't match
+ *            the total length of the buffers.
+ */
+ssize_t nl_sendv(int fd, __u32 port, struct iovec *iov, size_t n);
+
 /**
  * \brief Receive a netlink message.
  * \param[in]     fd   Netlink socket file descriptor.
@@ -143,6 +164,156 @@ ssize_t nl_recv(int fd, struct nlmsghdr *msg, size_t len, __u32 *port);
  */
 ssize_t nl_transact(int fd, struct nlmsghdr *m, size_t len, __u32 *port);
 
+/**
+ * \brief Dump callback
+ * \param[in] m   Dumped message, or NULL if the dump is about to restart
+ * \param[in] arg User data
+ * \return 0 to continue, or non-zero to stop (optionally with \a errno
+ *         set, to be returned by nl_dump().)
+ *
+ * Messages dumped before a restart may be inconsistent with the rest,
+ * so they should be discarded when \a m is NULL. Returning non-zero
+ * here instead prevents the restart.
+ */
+typedef int (*nl_dump_cb)(struct nlmsghdr *m, void *arg);
+
+/**
+ * \brief Perform a dump request
+ * \param[in] fd      Netlink socket file descriptor (blocking.)
+ * \param[in] req     Dump request
+ * \param[in] buf     Buffer to receive the reply into
+ * \param[in] len     Length (in bytes) of \a buf.
+ * \param[in] retries Maximum number of times to restart the dump
+ * \param[in] cb      Callback for each dumped message
+ * \param[in] arg     User data for \a cb
+ * \return 0 if the dump was consistent, 1 if it was interrupted too
+ *         many times, or -1 on error (with \a errno set.)
+ *
+ * If the dumped table changes during the dump, the kernel flags the
+ * remaining messages with NLM_F_DUMP_INTR. The dump is then read to
+ * the end, and restarted (with the next sequence number) until it
+ * completes without being interrupted, or \a retries is exhausted.
+ * Messages with other sequence numbers are ignored.
+ *
+ * With \a retries set to 0, an interrupted dump is simply reported.
+ * The caller may then reconcile the affected entries by other means.
+ *
+ * In addition to the \a errno values set by nl_send() and nl_recv(),
+ * this function will set the following:
+ *
+ * \a EINVAL    - An invalid parameter was passed to this function.
+ * \a ECANCELED - The callback stopped the dump (without setting
+ *                \a errno.) The rest of the dump has been read (and
+ *                discarded.)
+ *
+ * If the callback sets \a errno when stopping the dump, that value is
+ * kept instead of ECANCELED.
+ */
+int nl_dump(int fd, struct nlmsghdr *req, void *buf, size_t len,
+            unsigned int retries, nl_dump_cb cb, void *arg);
+
+/**
+ * \brief Message batch
+ *
+ * Packs many requests into one buffer, so that they can be sent with
+ * a single system call. Each message is assigned a sequence number,
+ * so that its ACK (or error) can be matched to it.
+ *
+ * \code{.c}
+ * struct nl_batch b;
+ * struct nlmsghdr *m;
+ *
+ * nl_batch_init(&b, buf, sizeof buf, seq);
+ * while ((m = nl_batch_next(&b, NLMSG_GOODSIZE))) {
+ * 	build_request(m);
+ * 	nl_batch_add(&b);
+ * }
+ *
+ * nl_batch_send(fd, 0, &b);
+ * \endcode
+ *
+ * The kernel replies to each message separately, so the socket's
+ * receive buffer should be large enough to hold all of the replies.
+ */
+struct nl_batch {
+	void *buf;   /**< Message buffer */
+	size_t size; /**< Size of \a buf (in bytes) */
+	size_t len;  /**< Length of the batched messages (in bytes) */
+	__u32 seq;   /**< Sequence number of the first message */
+	__u32 count; /**< Number of batched messages */
+};
+
+/**
+ * \brief Initialize a message batch
+ * \param[in] b    Batch
+ * \param[in] buf  Buffer to hold the messages
+ * \param[in] size Size of \a buf (in bytes)
+ * \param[in] seq  Sequence number of the first message
+ */
+void nl_batch_init(struct nl_batch *b, void *buf, size_t size, __u32 seq);
+
+/**
+ * \brief Get the buffer for the next message in a batch
+ * \param[in] b   Batch
+ * \param[in] len Maximum length of the message (in bytes)
+ * \return Buffer for the message, or NULL if fewer than \a len bytes
+ *         remain (the batch should be sent first.)
+ */
+struct nlmsghdr *nl_batch_next(struct nl_batch *b, size_t len);
+
+/**
+ * \brief Add the next message to a batch
+ * \param[in] b Batch
+ * \return The index of the message in the batch, or -1 on error (with
+ *         \a errno set.)
+ *
+ * The message (built in the buffer returned by nl_batch_next()) is
+ * given the next sequence number, and NLM_F_ACK is set so that the
+ * kernel acknowledges it, or replies with an error.
+ *
+ * \a EINVAL - The message is invalid.
+ * \a E2BIG  - The message overruns the buffer.
+ */
+long nl_batch_add(struct nl_batch *b);
+
+/**
+ * \brief Send a batch of messages
+ * \param[in] fd   Netlink socket file descriptor.
+ * \param[in] port Destination netlink port.
+ * \param[in] b    Batch
+ * \return Number of bytes sent, or -1 on error (with \a errno set.)
+ *
+ * All of the messages are sent with a single \a sendmsg(2) call. The
+ * batch is left as-is, so that the replies may be matched with
+ * nl_batch_ack(). Use nl_batch_reset() to start the next batch.
+ *
+ * \a EINVAL - The batch is empty.
+ */
+ssize_t nl_batch_send(int fd, __u32 port, struct nl_batch *b);
+
+/**
+ * \brief Match a reply to a message in a batch
+ * \param[in]  b   Batch
+ * \param[in]  m   Received message
+ * \param[out] err The error (0 for an ACK, or a negative \a errno value)
+ * \return The index of the message in the batch, or -1 if \a m isn't
+ *         an ACK / error for a message in the batch.
+ *
+ * Note that nl_recv() returns -1 for errors, with \a errno set to the
+ * (negative) error, but \a m still holds the error message.
+ */
+long nl_batch_ack(const struct nl_batch *b, const struct nlmsghdr *m,
+                  int *err);
+
+/**
+ * \brief Start the next batch
+ * \param[in] b Batch
+ *
+ * The buffer is emptied, and the sequence numbers continue on from
+ * the messages in the previous batch.
+ */
+void nl_batch_reset(struct nl_batch *b);
+
 /**
  * \brief Initialize a netlink message.
  * \param[in] m     Netlink message buffer.
@@ -189,6 +360,33 @@ void nla_add_attr(struct nlattr *nla, __u16 type, const void *data,
  */
 void nla_end(struct nlmsghdr *m, const struct nlattr *nla);
 
+/**
+ * \brief Add a nested netlink attribute to a nested NLA
+ * \param[in] nla  Netlink nested attribute.
+ * \param[in] type Attribute type.
+ * \return the nested attribute.
+ *
+ * Only one nested attribute may be open within \a nla at a time.
+ *
+ * \code{.c}
+ * struct nlattr *tuple, *ip;
+ *
+ * tuple = nla_start(m, CTA_TUPLE_ORIG);
+ * ip = nla_nest_start(tuple, CTA_TUPLE_IP);
+ * nla_add_attr(ip, CTA_IP_V4_SRC, &addr, sizeof addr);
+ * nla_nest_end(tuple, ip);
+ * nla_end(m, tuple);
+ * \endcode
+ */
+struct nlattr *nla_nest_start(struct nlattr *nla, __u16 type);
+
+/**
+ * \brief Finalize a nested netlink attribute within a nested NLA
+ * \param[in] nla  Netlink nested attribute.
+ * \param[in] nest Nested attribute (from nla_nest_start())
+ */
+void nla_nest_end(struct nlattr *nla, const struct nlattr *nest);
+
 /**
  * \brief Get a netlink attribute (NLA) by its type.
  * \param[in] m         Netlink message buffer.
@@ -279,5 +477,67 @@ __u16 nl_get_attrv(struct nlmsghdr *m, size_t extra_len,
  */
 __u16 nla_get_attrv(struct nlattr *nla, struct nlattr *attrs[], __u16 n);
 
+/**
+ * \brief Convert a 64-bit value from network to host byte order
+ * \param[in] p The value (which needn't be aligned)
+ * \return The value, in host byte order.
+ */
+__u64 nl_be64_to_host(const void *p);
+
+/**
+ * \brief Read a __u8 attribute
+ * \param[in] nla Attribute (or NULL)
+ * \return The value, or 0 if \a nla is NULL or too short.
+ */
+__u8 nla_u8(struct nlattr *nla);
+
+/**
+ * \brief Read a __u16 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u16 nla_u16(struct nlattr *nla);
+
+/**
+ * \brief Read a __u32 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u32 nla_u32(struct nlattr *nla);
+
+/**
+ * \brief Read a __u64 attribute (in host byte order)
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u64 nla_u64(struct nlattr *nla);
+
+/**
+ * \brief Read a __u16 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u16 nla_u16_be(struct nlattr *nla);
+
+/**
+ * \brief Read a __u32 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u32 nla_u32_be(struct nlattr *nla);
+
+/**
+ * \brief Read a __u64 attribute in network byte order
+ * \param[in] nla Attribute (or NULL)
+ * \return The value (in host byte order), or 0 if \a nla is NULL or
+ *         too short.
+ */
+__u64 nla_u64_be(struct nlattr *nla);
+
 #endif /* NL_H */
 
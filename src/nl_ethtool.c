@@ -0,0 +1,386 @@
+/**
+ * nanonl: Netlink ethtool Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "nl.h"
+#include "nl_ethtool.h"
+
+/**
+ * Make a request, with the header as attribute \a hdr
+ *
+ * The kernel requires the header, even if it's empty.
+ */
+static void request(struct nlmsghdr *m, __u16 family, __u8 cmd, __u16 hdr,
+                    __u32 ifindex)
+{
+	struct nlattr *nla;
+
+	nl_gen_request(m, 0, family, cmd, ETHTOOL_GENL_VERSION);
+	nla = nla_start(m, hdr);
+	if (!ifindex) m->nlmsg_flags |= NLM_F_DUMP;
+	else nla_add_attr(nla, ETHTOOL_A_HEADER_DEV_INDEX, &ifindex,
+	                  sizeof ifindex);
+	nla_end(m, nla);
+}
+
+/**
+ * Check that \a m is a reply to \a cmd
+ */
+static int is_reply(struct nlmsghdr *m, __u8 cmd)
+{
+	return NLMSG_OK(m, m->nlmsg_len) &&
+	       m->nlmsg_len >= NLMSG_LENGTH(GENL_HDRLEN) &&
+	       ((struct genlmsghdr *)NLMSG_DATA(m))->cmd == cmd;
+}
+
+/**
+ * Get the interface index from a reply header (ETHTOOL_A_*_HEADER)
+ */
+static __u32 dev_index(struct nlattr *hdr)
+{
+	if (!hdr) return 0;
+	return nla_u32(nla_get_attr(hdr, ETHTOOL_A_HEADER_DEV_INDEX));
+}
+
+/**
+ * \brief Create an ethtool request
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID (i.e. from nl_gen_cache_find())
+ * \param[in] cmd     Command (ETHTOOL_MSG_*_GET)
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ *
+ * This works for any command whose header is attribute 1 (i.e.
+ * ETHTOOL_A_CHANNELS_HEADER.)
+ */
+void nl_ethtool_request(struct nlmsghdr *m, __u16 family, __u8 cmd,
+                        __u32 ifindex)
+{
+	if (!m) return;
+	request(m, family, cmd, ETHTOOL_A_CHANNELS_HEADER, ifindex);
+}
+
+/**
+ * \brief Get string sets
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, for global string sets.)
+ * \param[in] ids     String set IDs (ETH_SS_*)
+ * \param[in] n       Number of IDs
+ *
+ * The names of the standard statistics (i.e. ETH_SS_STATS_ETH_MAC)
+ * are global, and only need to be fetched once.
+ */
+void nl_ethtool_strset_get(struct nlmsghdr *m, __u16 family, __u32 ifindex,
+                           const __u32 *ids, size_t n)
+{
+	size_t i;
+	struct nlattr *sets, *set;
+
+	if (!m || (n && !ids)) return;
+	request(m, family, ETHTOOL_MSG_STRSET_GET, ETHTOOL_A_STRSET_HEADER,
+	        ifindex);
+	m->nlmsg_flags &= (__u16)~NLM_F_DUMP;
+	if (!n) return;
+
+	sets = nla_start(m, ETHTOOL_A_STRSET_STRINGSETS);
+	for (i = 0; i < n; i++) {
+		set = nla_nest_start(sets, ETHTOOL_A_STRINGSETS_STRINGSET);
+		nla_add_attr(set, ETHTOOL_A_STRINGSET_ID, &ids[i], sizeof *ids);
+		nla_nest_end(sets, set);
+	}
+
+	nla_end(m, sets);
+}
+
+/**
+ * Decode the strings of a string set (ETHTOOL_A_STRINGSET_STRINGS)
+ */
+static void parse_strings(struct nlattr *strings, struct nl_ethtool_strset *s)
+{
+	size_t len;
+	__u32 idx;
+	struct nlattr *nla, *a[ETHTOOL_A_STRING_MAX + 1];
+
+	nla_each(nla, strings) {
+		memset(a, 0, sizeof a);
+		nla_get_attrv(nla, a, ETHTOOL_A_STRING_MAX);
+		if (!a[ETHTOOL_A_STRING_INDEX] || !a[ETHTOOL_A_STRING_VALUE])
+			continue;
+		if ((idx = nla_u32(a[ETHTOOL_A_STRING_INDEX])) >= s->size)
+			continue;
+
+		len = (size_t)(a[ETHTOOL_A_STRING_VALUE]->nla_len - NLA_HDRLEN);
+		if (len > ETH_GSTRING_LEN - 1) len = ETH_GSTRING_LEN - 1;
+		memset(s->str[idx], 0, ETH_GSTRING_LEN);
+		memcpy(s->str[idx], NLA_DATA(a[ETHTOOL_A_STRING_VALUE]), len);
+	}
+}
+
+/**
+ * \brief Decode string sets
+ * \param[in]     m  Netlink message buffer.
+ * \param[in,out] ss String sets to fill (with \a id and \a str set)
+ * \param[in]     n  Number of string sets
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * String sets in \a m that aren't in \a ss are ignored.
+ */
+int nl_ethtool_parse_strsets(struct nlmsghdr *m, struct nl_ethtool_strset *ss,
+                             size_t n)
+{
+	size_t i;
+	__u32 id;
+	struct nlattr *sets, *nla, *a[ETHTOOL_A_STRINGSET_MAX + 1];
+
+	if (!m || (n && !ss) || !is_reply(m, ETHTOOL_MSG_STRSET_GET_REPLY) ||
+	    !(sets = nl_gen_get_attr(m, ETHTOOL_A_STRSET_STRINGSETS)))
+		goto inval;
+
+	nla_each(nla, sets) {
+		memset(a, 0, sizeof a);
+		nla_get_attrv(nla, a, ETHTOOL_A_STRINGSET_MAX);
+		if (!a[ETHTOOL_A_STRINGSET_ID]) continue;
+
+		id = nla_u32(a[ETHTOOL_A_STRINGSET_ID]);
+		for (i = 0; i < n && ss[i].id != id; i++);
+		if (i == n) continue;
+
+		ss[i].count = nla_u32(a[ETHTOOL_A_STRINGSET_COUNT]);
+		if (ss[i].str && a[ETHTOOL_A_STRINGSET_STRINGS])
+			parse_strings(a[ETHTOOL_A_STRINGSET_STRINGS], &ss[i]);
+	}
+
+	return 0;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Decode channel counts
+ * \param[in]  m Netlink message buffer.
+ * \param[out] c Channel counts
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_channels(struct nlmsghdr *m,
+                              struct nl_ethtool_channels *c)
+{
+	struct nlattr *a[ETHTOOL_A_CHANNELS_MAX + 1];
+
+	if (!m || !c || !is_reply(m, ETHTOOL_MSG_CHANNELS_GET_REPLY)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(a, 0, sizeof a);
+	nl_gen_get_attrv(m, a);
+	c->ifindex        = dev_index(a[ETHTOOL_A_CHANNELS_HEADER]);
+	c->rx_max         = nla_u32(a[ETHTOOL_A_CHANNELS_RX_MAX]);
+	c->tx_max         = nla_u32(a[ETHTOOL_A_CHANNELS_TX_MAX]);
+	c->other_max      = nla_u32(a[ETHTOOL_A_CHANNELS_OTHER_MAX]);
+	c->combined_max   = nla_u32(a[ETHTOOL_A_CHANNELS_COMBINED_MAX]);
+	c->rx_count       = nla_u32(a[ETHTOOL_A_CHANNELS_RX_COUNT]);
+	c->tx_count       = nla_u32(a[ETHTOOL_A_CHANNELS_TX_COUNT]);
+	c->other_count    = nla_u32(a[ETHTOOL_A_CHANNELS_OTHER_COUNT]);
+	c->combined_count = nla_u32(a[ETHTOOL_A_CHANNELS_COMBINED_COUNT]);
+	return 0;
+}
+
+/**
+ * \brief Decode ring sizes
+ * \param[in]  m Netlink message buffer.
+ * \param[out] r Ring sizes
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_rings(struct nlmsghdr *m, struct nl_ethtool_rings *r)
+{
+	struct nlattr *a[ETHTOOL_A_RINGS_MAX + 1];
+
+	if (!m || !r || !is_reply(m, ETHTOOL_MSG_RINGS_GET_REPLY)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(a, 0, sizeof a);
+	nl_gen_get_attrv(m, a);
+	r->ifindex      = dev_index(a[ETHTOOL_A_RINGS_HEADER]);
+	r->rx_max       = nla_u32(a[ETHTOOL_A_RINGS_RX_MAX]);
+	r->rx_mini_max  = nla_u32(a[ETHTOOL_A_RINGS_RX_MINI_MAX]);
+	r->rx_jumbo_max = nla_u32(a[ETHTOOL_A_RINGS_RX_JUMBO_MAX]);
+	r->tx_max       = nla_u32(a[ETHTOOL_A_RINGS_TX_MAX]);
+	r->rx           = nla_u32(a[ETHTOOL_A_RINGS_RX]);
+	r->rx_mini      = nla_u32(a[ETHTOOL_A_RINGS_RX_MINI]);
+	r->rx_jumbo     = nla_u32(a[ETHTOOL_A_RINGS_RX_JUMBO]);
+	r->tx           = nla_u32(a[ETHTOOL_A_RINGS_TX]);
+	return 0;
+}
+
+/**
+ * \brief Decode a link mode
+ * \param[in]  m Netlink message buffer.
+ * \param[out] l Link mode
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_linkmode(struct nlmsghdr *m,
+                              struct nl_ethtool_linkmode *l)
+{
+	struct nlattr *a[ETHTOOL_A_LINKMODES_MAX + 1];
+
+	if (!m || !l || !is_reply(m, ETHTOOL_MSG_LINKMODES_GET_REPLY)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(a, 0, sizeof a);
+	nl_gen_get_attrv(m, a);
+	l->ifindex = dev_index(a[ETHTOOL_A_LINKMODES_HEADER]);
+	l->speed   = nla_u32(a[ETHTOOL_A_LINKMODES_SPEED]);
+	l->duplex  = nla_u8(a[ETHTOOL_A_LINKMODES_DUPLEX]);
+	l->autoneg = nla_u8(a[ETHTOOL_A_LINKMODES_AUTONEG]);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,11,0)
+	l->lanes   = nla_u32(a[ETHTOOL_A_LINKMODES_LANES]);
+#else
+	l->lanes   = 0;
+#endif
+	return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+/*
+ * Offset of the counters of each group (ETHTOOL_STATS_ETH_PHY to
+ * ETHTOOL_STATS_RMON), and the end. Newer groups aren't decoded.
+ */
+static const __u32 grp_off[] = {
+	NL_ETHTOOL_STATS_PHY, NL_ETHTOOL_STATS_MAC, NL_ETHTOOL_STATS_CTRL,
+	NL_ETHTOOL_STATS_RMON, NL_ETHTOOL_STATS_CNT
+};
+
+/* grp_off is indexed by group ID: fails to build if the IDs are reordered */
+typedef char grp_off_check[ETHTOOL_STATS_ETH_PHY == 0 &&
+                           ETHTOOL_STATS_ETH_MAC == 1 &&
+                           ETHTOOL_STATS_ETH_CTRL == 2 &&
+                           ETHTOOL_STATS_RMON == 3 ? 1 : -1];
+
+/**
+ * \brief Get a device's standard statistics (or every device's.)
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ * \param[in] groups  Groups to get (1 << ETHTOOL_STATS_*)
+ */
+void nl_ethtool_stats_get(struct nlmsghdr *m, __u16 family, __u32 ifindex,
+                          __u32 groups)
+{
+	__u32 size = __ETHTOOL_STATS_CNT;
+	struct nlattr *nla;
+
+	if (!m) return;
+	request(m, family, ETHTOOL_MSG_STATS_GET, ETHTOOL_A_STATS_HEADER,
+	        ifindex);
+
+	/* A compact bitset (just the bits to set) */
+	nla = nla_start(m, ETHTOOL_A_STATS_GROUPS);
+	nla_add_attr(nla, ETHTOOL_A_BITSET_NOMASK, NULL, 0);
+	nla_add_attr(nla, ETHTOOL_A_BITSET_SIZE, &size, sizeof size);
+	nla_add_attr(nla, ETHTOOL_A_BITSET_VALUE, &groups, sizeof groups);
+	nla_end(m, nla);
+}
+
+/**
+ * Decode a group of counters (ETHTOOL_A_STATS_GRP) into \a s
+ */
+static void parse_grp(struct nlattr *grp, struct nl_ethtool_stats *s)
+{
+	__u32 id, i, n;
+	struct nlattr *nla, *stat;
+
+	if (!(nla = nla_get_attr(grp, ETHTOOL_A_STATS_GRP_ID))) return;
+	if ((id = nla_u32(nla)) > ETHTOOL_STATS_RMON) return;
+	s->groups |= 1U << id;
+	n = grp_off[id + 1] - grp_off[id];
+
+	/* Each counter is a u64, typed by its index, in its own nest */
+	nla_each(nla, grp) {
+		if ((nla->nla_type & NLA_TYPE_MASK) != ETHTOOL_A_STATS_GRP_STAT)
+			continue;
+
+		stat = NLA_DATA(nla);
+		if (nla->nla_len < NLA_HDRLEN + NLA_HDRLEN + sizeof(__u64) ||
+		    stat->nla_len < NLA_HDRLEN + sizeof(__u64) ||
+		    (i = (__u32)(stat->nla_type & NLA_TYPE_MASK)) >= n)
+			continue;
+		memcpy(&s->ctr[grp_off[id] + i], NLA_DATA(stat), sizeof(__u64));
+	}
+}
+
+/**
+ * \brief Decode a device's standard statistics
+ * \param[in]  m Netlink message buffer.
+ * \param[out] s Statistics
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_stats(struct nlmsghdr *m, struct nl_ethtool_stats *s)
+{
+	struct nlattr *nla;
+
+	if (!m || !s || !is_reply(m, ETHTOOL_MSG_STATS_GET_REPLY)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(s, 0, sizeof *s);
+	nla = BYTE_OFF(NLMSG_DATA(m), NLMSG_ALIGN(GENL_HDRLEN));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case ETHTOOL_A_STATS_HEADER: s->ifindex = dev_index(nla); break;
+		case ETHTOOL_A_STATS_GRP: parse_grp(nla, s); break;
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Collect dumped statistics (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg List to collect the statistics into
+ *                (nl_ethtool_stats_list.)
+ * \return 0
+ *
+ * With the string sets fetched (and cached) once, each scrape of every
+ * device is a single dump:
+ *
+ * \code{.c}
+ * struct nl_ethtool_stats s[64];
+ * struct nl_ethtool_stats_list l = { s, 64, 0 };
+ *
+ * nl_ethtool_stats_get(req, family, 0, (1 << __ETHTOOL_STATS_CNT) - 1);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_ethtool_stats_collect,
+ *             &l) < 0)
+ * 	goto err;
+ * \endcode
+ */
+int nl_ethtool_stats_collect(struct nlmsghdr *m, void *arg)
+{
+	struct nl_ethtool_stats_list *l = arg;
+
+	if (!l) return 0;
+	if (!m) l->count = 0;
+	else if (l->count >= l->n) ++l->count;
+	else if (!nl_ethtool_parse_stats(m, l->s + l->count)) ++l->count;
+	return 0;
+}
+#endif /* Linux >= 5.13.0 */
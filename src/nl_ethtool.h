@@ -0,0 +1,253 @@
+/**
+ * \file nl_ethtool.h
+ *
+ * nanonl: Netlink ethtool functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_ETHTOOL_H
+#define NL_ETHTOOL_H
+
+#include <sys/types.h>
+#include <linux/version.h>
+#include <linux/netlink.h>
+#include <linux/ethtool.h>
+#include <linux/ethtool_netlink.h>
+
+#include "nl_gen.h"
+
+/**
+ * \brief String set
+ *
+ * The names are stored in caller-supplied storage, for \a size
+ * strings. Strings past \a size aren't stored, but are counted in
+ * \a count.
+ */
+struct nl_ethtool_strset {
+	__u32 id;                     /**< String set ID (ETH_SS_*) */
+	__u32 count;                  /**< Number of strings */
+	__u32 size;                   /**< Number of strings \a str holds */
+	char (*str)[ETH_GSTRING_LEN]; /**< Strings */
+};
+
+/**
+ * \brief Channel counts
+ */
+struct nl_ethtool_channels {
+	__u32 ifindex;        /**< Interface index */
+	__u32 rx_max;         /**< Maximum RX channels */
+	__u32 tx_max;         /**< Maximum TX channels */
+	__u32 other_max;      /**< Maximum other channels */
+	__u32 combined_max;   /**< Maximum combined channels */
+	__u32 rx_count;       /**< RX channels */
+	__u32 tx_count;       /**< TX channels */
+	__u32 other_count;    /**< Other channels */
+	__u32 combined_count; /**< Combined channels */
+};
+
+/**
+ * \brief Ring sizes
+ */
+struct nl_ethtool_rings {
+	__u32 ifindex;      /**< Interface index */
+	__u32 rx_max;       /**< Maximum RX ring size */
+	__u32 rx_mini_max;  /**< Maximum RX mini ring size */
+	__u32 rx_jumbo_max; /**< Maximum RX jumbo ring size */
+	__u32 tx_max;       /**< Maximum TX ring size */
+	__u32 rx;           /**< RX ring size */
+	__u32 rx_mini;      /**< RX mini ring size */
+	__u32 rx_jumbo;     /**< RX jumbo ring size */
+	__u32 tx;           /**< TX ring size */
+};
+
+/**
+ * \brief Link mode
+ */
+struct nl_ethtool_linkmode {
+	__u32 ifindex; /**< Interface index */
+	__u32 speed;   /**< Speed (in Mb/s, or SPEED_UNKNOWN) */
+	__u32 lanes;   /**< Number of lanes (0 if unknown) */
+	__u8 duplex;   /**< Duplex (DUPLEX_*) */
+	__u8 autoneg;  /**< Autonegotiation (AUTONEG_*) */
+};
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+/**
+ * \brief Offsets of each statistics group in nl_ethtool_stats.ctr
+ *
+ * The counter \a i of a group (i.e. ETHTOOL_A_STATS_ETH_MAC_*) is at
+ * ctr[NL_ETHTOOL_STATS_MAC + i], and its name is string \a i of the
+ * group's string set (i.e. ETH_SS_STATS_ETH_MAC.)
+ */
+#define NL_ETHTOOL_STATS_PHY  0
+#define NL_ETHTOOL_STATS_MAC  (NL_ETHTOOL_STATS_PHY + \
+                               __ETHTOOL_A_STATS_ETH_PHY_CNT)
+#define NL_ETHTOOL_STATS_CTRL (NL_ETHTOOL_STATS_MAC + \
+                               __ETHTOOL_A_STATS_ETH_MAC_CNT)
+#define NL_ETHTOOL_STATS_RMON (NL_ETHTOOL_STATS_CTRL + \
+                               __ETHTOOL_A_STATS_ETH_CTRL_CNT)
+#define NL_ETHTOOL_STATS_CNT  (NL_ETHTOOL_STATS_RMON + \
+                               __ETHTOOL_A_STATS_RMON_CNT)
+
+/**
+ * \brief Standard statistics of a device
+ *
+ * Counters the device doesn't report are left as zero.
+ */
+struct nl_ethtool_stats {
+	__u32 ifindex;                   /**< Interface index */
+	__u32 groups;                    /**< Groups (1 << ETHTOOL_STATS_*) */
+	__u64 ctr[NL_ETHTOOL_STATS_CNT]; /**< Counters */
+};
+
+/**
+ * \brief Statistics collected from a dump
+ *
+ * The statistics of the first \a n devices dumped are stored in \a s.
+ * \a count is the number of devices dumped, which may be more than
+ * \a n, if \a s was too small to hold them all.
+ */
+struct nl_ethtool_stats_list {
+	struct nl_ethtool_stats *s; /**< Array of \a n devices */
+	size_t n;                   /**< Size of \a s */
+	size_t count;               /**< Number of devices dumped */
+};
+#endif /* Linux >= 5.13.0 */
+
+/**
+ * \brief Create an ethtool request
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID (i.e. from nl_gen_cache_find())
+ * \param[in] cmd     Command (ETHTOOL_MSG_*_GET)
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ *
+ * This works for any command whose header is attribute 1 (i.e.
+ * ETHTOOL_A_CHANNELS_HEADER.)
+ */
+void nl_ethtool_request(struct nlmsghdr *m, __u16 family, __u8 cmd,
+                        __u32 ifindex);
+
+/**
+ * \brief Get a device's channel counts (or every device's.)
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ */
+#define nl_ethtool_channels_get(m, family, ifindex) \
+	nl_ethtool_request((m), (family), ETHTOOL_MSG_CHANNELS_GET, (ifindex))
+
+/**
+ * \brief Get a device's ring sizes (or every device's.)
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ */
+#define nl_ethtool_rings_get(m, family, ifindex) \
+	nl_ethtool_request((m), (family), ETHTOOL_MSG_RINGS_GET, (ifindex))
+
+/**
+ * \brief Get a device's link mode (or every device's.)
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ */
+#define nl_ethtool_linkmodes_get(m, family, ifindex) \
+	nl_ethtool_request((m), (family), ETHTOOL_MSG_LINKMODES_GET, (ifindex))
+
+/**
+ * \brief Get string sets
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, for global string sets.)
+ * \param[in] ids     String set IDs (ETH_SS_*)
+ * \param[in] n       Number of IDs
+ *
+ * The names of the standard statistics (i.e. ETH_SS_STATS_ETH_MAC)
+ * are global, and only need to be fetched once.
+ */
+void nl_ethtool_strset_get(struct nlmsghdr *m, __u16 family, __u32 ifindex,
+                           const __u32 *ids, size_t n);
+
+/**
+ * \brief Decode string sets
+ * \param[in]     m  Netlink message buffer.
+ * \param[in,out] ss String sets to fill (with \a id and \a str set)
+ * \param[in]     n  Number of string sets
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * String sets in \a m that aren't in \a ss are ignored.
+ */
+int nl_ethtool_parse_strsets(struct nlmsghdr *m, struct nl_ethtool_strset *ss,
+                             size_t n);
+
+/**
+ * \brief Decode channel counts
+ * \param[in]  m Netlink message buffer.
+ * \param[out] c Channel counts
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_channels(struct nlmsghdr *m,
+                              struct nl_ethtool_channels *c);
+
+/**
+ * \brief Decode ring sizes
+ * \param[in]  m Netlink message buffer.
+ * \param[out] r Ring sizes
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_rings(struct nlmsghdr *m, struct nl_ethtool_rings *r);
+
+/**
+ * \brief Decode a link mode
+ * \param[in]  m Netlink message buffer.
+ * \param[out] l Link mode
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_linkmode(struct nlmsghdr *m,
+                              struct nl_ethtool_linkmode *l);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+/**
+ * \brief Get a device's standard statistics (or every device's.)
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  ethtool family ID
+ * \param[in] ifindex Interface index (or 0, to dump every device.)
+ * \param[in] groups  Groups to get (1 << ETHTOOL_STATS_*)
+ */
+void nl_ethtool_stats_get(struct nlmsghdr *m, __u16 family, __u32 ifindex,
+                          __u32 groups);
+
+/**
+ * \brief Decode a device's standard statistics
+ * \param[in]  m Netlink message buffer.
+ * \param[out] s Statistics
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ethtool_parse_stats(struct nlmsghdr *m, struct nl_ethtool_stats *s);
+
+/**
+ * \brief Collect dumped statistics (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg List to collect the statistics into
+ *                (nl_ethtool_stats_list.)
+ * \return 0
+ *
+ * With the string sets fetched (and cached) once, each scrape of every
+ * device is a single dump:
+ *
+ * \code{.c}
+ * struct nl_ethtool_stats s[64];
+ * struct nl_ethtool_stats_list l = { s, 64, 0 };
+ *
+ * nl_ethtool_stats_get(req, family, 0, (1 << __ETHTOOL_STATS_CNT) - 1);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_ethtool_stats_collect,
+ *             &l) < 0)
+ * 	goto err;
+ * \endcode
+ */
+int nl_ethtool_stats_collect(struct nlmsghdr *m, void *arg);
+#endif /* Linux >= 5.13.0 */
+
+#endif /* NL_ETHTOOL_H */
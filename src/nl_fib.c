@@ -0,0 +1,545 @@
+/**
+ * nanonl: Routing Table Mirror
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "nl.h"
+#include "nl_fib.h"
+
+/* Length of an address (in bits) */
+#define ADDR_BITS(family) ((family) == AF_INET6 ? 128U : 32U)
+
+/* Maximum depth of the trie (a node for each prefix length) */
+#define MAX_DEPTH 129
+
+/* Bit \a i of \a key (0 being the most significant) */
+#define BIT(key, i) (((key)[(i) >> 5] >> (31 - ((i) & 31))) & 1)
+
+/* Sequence counter / fence primitives */
+#define SEQ_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SEQ_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SEQ_RMB()       __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define SEQ_WMB()       __atomic_thread_fence(__ATOMIC_RELEASE)
+
+/**
+ * Copy the first \a len bits of \a src to \a dst (zeroing the rest)
+ */
+static void mask(__u32 dst[4], const __u32 *src, unsigned len)
+{
+	unsigned i;
+
+	for (i = 0; i < 4; i++) {
+		if (len >= (i + 1) * 32) dst[i] = src[i];
+		else if (len <= i * 32) dst[i] = 0;
+		else dst[i] = src[i] & (0xffffffffU << (32 - (len & 31)));
+	}
+}
+
+/**
+ * Convert an address (in network byte order) to a key of \a len bits
+ */
+static void to_key(__u32 key[4], const void *addr, __u8 family, unsigned len)
+{
+	unsigned i;
+	__u32 a[4];
+
+	memset(a, 0, sizeof a);
+	memcpy(a, addr, ADDR_BITS(family) / 8);
+	for (i = 0; i < 4; i++) a[i] = ntohl(a[i]);
+	mask(key, a, len);
+}
+
+/**
+ * Check whether the first \a len bits of \a a and \a key are the same
+ */
+static int match(const __u32 *a, const __u32 *key, unsigned len)
+{
+	unsigned i;
+
+	for (i = 0; len >= 32; i++, len -= 32) {
+		if (a[i] != key[i]) return 0;
+	}
+
+	return !len || !((a[i] ^ key[i]) >> (32 - len));
+}
+
+/**
+ * Get the number of leading bits (up to \a len) \a a and \a b share
+ */
+static unsigned common(const __u32 *a, const __u32 *b, unsigned len)
+{
+	unsigned i = 0;
+
+	while (i + 32 <= len && a[i >> 5] == b[i >> 5]) i += 32;
+	while (i < len && BIT(a, i) == BIT(b, i)) i++;
+	return i;
+}
+
+static void write_begin(struct nl_fib *f)
+{
+	SEQ_STORE(&f->seq, f->seq + 1);
+	SEQ_WMB();
+}
+
+static void write_end(struct nl_fib *f)
+{
+	SEQ_STORE(&f->seq, f->seq + 1);
+}
+
+static __u32 node_alloc(struct nl_fib *f, const __u32 *key, unsigned len)
+{
+	__u32 n = f->free_node;
+	struct nl_fib_node *node;
+
+	if (!n) return 0;
+	node         = &f->nodes[n];
+	f->free_node = node->child[0];
+	mask(node->key, key, len);
+	node->child[0] = node->child[1] = 0;
+	node->route    = NL_FIB_NONE;
+	node->len      = (__u8)len;
+	return n;
+}
+
+static void node_free(struct nl_fib *f, __u32 n)
+{
+	f->nodes[n].child[0] = f->free_node;
+	f->free_node = n;
+}
+
+/**
+ * Find the node for a prefix, and the path to it
+ * \return The node, or NL_FIB_NONE if there's none.
+ */
+static __u32 find(const struct nl_fib *f, const __u32 *key, unsigned len,
+                  __u32 *path, int *depth)
+{
+	__u32 c, n = 0;
+	const struct nl_fib_node *nodes = f->nodes;
+
+	for (*depth = 0; ; n = c) {
+		path[(*depth)++] = n;
+		if (nodes[n].len == len) return n;
+		c = nodes[n].child[BIT(key, nodes[n].len)];
+		if (!c || nodes[c].len > len || !match(key, nodes[c].key,
+		                                       nodes[c].len))
+			return NL_FIB_NONE;
+	}
+}
+
+/**
+ * Find where a route with priority \a prio belongs in the routes of
+ * the node \a n
+ */
+static __u32 *find_route(struct nl_fib *f, __u32 n, __u32 prio)
+{
+	__u32 *pi = &f->nodes[n].route;
+
+	while (*pi != NL_FIB_NONE && f->routes[*pi].priority < prio)
+		pi = &f->routes[*pi].next;
+	return pi;
+}
+
+/**
+ * Add a node for a prefix, and set \a lo to the length of the shortest
+ * node added
+ * \return The node, or NL_FIB_NONE if there are no free nodes.
+ */
+static __u32 insert(struct nl_fib *f, const __u32 *key, unsigned len,
+                    unsigned *lo)
+{
+	unsigned cl;
+	__u32 c, br, leaf = 0, n = 0;
+	struct nl_fib_node *nodes = f->nodes;
+
+	while (nodes[n].len != len) {
+		c = nodes[n].child[BIT(key, nodes[n].len)];
+		if (!c) {
+			if (!(leaf = node_alloc(f, key, len))) goto nospc;
+			nodes[n].child[BIT(key, nodes[n].len)] = leaf;
+			return leaf;
+		}
+
+		cl = common(key, nodes[c].key,
+		            len < nodes[c].len ? len : nodes[c].len);
+		if (cl == nodes[c].len) {
+			n = c;
+			continue;
+		}
+
+		/* Split the edge to c, with a node for the shared bits */
+		if (!(br = node_alloc(f, key, cl))) goto nospc;
+		if (cl != len && !(leaf = node_alloc(f, key, len))) {
+			node_free(f, br);
+			goto nospc;
+		}
+
+		nodes[br].child[BIT(nodes[c].key, cl)] = c;
+		nodes[n].child[BIT(key, nodes[n].len)] = br;
+		*lo = cl;
+		if (cl == len) return br;
+		nodes[br].child[BIT(key, cl)] = leaf;
+		return leaf;
+	}
+
+	return n;
+
+nospc:
+	return NL_FIB_NONE;
+}
+
+/**
+ * Remove the nodes at the end of \a path that are no longer needed
+ * \return The length of the shortest node removed (or 255.)
+ */
+static unsigned prune(struct nl_fib *f, const __u32 *path, int depth)
+{
+	unsigned lo = 255;
+	__u32 n, p, *side;
+	struct nl_fib_node *nodes = f->nodes;
+
+	for (; depth > 1; depth--) {
+		n = path[depth - 1];
+		p = path[depth - 2];
+		if (nodes[n].route != NL_FIB_NONE ||
+		    (nodes[n].child[0] && nodes[n].child[1]))
+			break;
+
+		side  = &nodes[p].child[nodes[p].child[1] == n];
+		*side = nodes[n].child[0] ? nodes[n].child[0]
+		                          : nodes[n].child[1];
+		node_free(f, n);
+		lo = nodes[n].len;
+		if (*side) break;
+	}
+
+	return lo;
+}
+
+/**
+ * Find where the lookups of addresses starting with \a t (the index
+ * of a directory entry) should start
+ */
+static void dir_fill(struct nl_fib *f, __u32 t)
+{
+	__u32 c, n = 0, best = NL_FIB_NONE, key[4];
+	const struct nl_fib_node *nodes = f->nodes;
+
+	memset(key, 0, sizeof key);
+	key[0] = t << (32 - f->dir_bits);
+	for (;;) {
+		if (nodes[n].route != NL_FIB_NONE) best = nodes[n].route;
+		c = nodes[n].child[BIT(key, nodes[n].len)];
+		if (!c || nodes[c].len > f->dir_bits ||
+		    !match(key, nodes[c].key, nodes[c].len))
+			break;
+		n = c;
+	}
+
+	f->dir[t].node  = n;
+	f->dir[t].route = best;
+}
+
+/**
+ * Update the directory entries for the prefix \a key / \a len, after
+ * a change to a node at least that long
+ */
+static void dir_update(struct nl_fib *f, const __u32 *key, unsigned len)
+{
+	__u32 t, n;
+	unsigned shift;
+
+	if (!f->dir || len > f->dir_bits) return;
+	shift = f->dir_bits - len;
+	t     = (key[0] >> (32 - f->dir_bits)) >> shift << shift;
+	for (n = (__u32)1 << shift; n; n--, t++)
+		dir_fill(f, t);
+}
+
+/**
+ * \brief Initialize a routing table mirror
+ * \param[in] f       Mirror
+ * \param[in] family  Address family (AF_INET[6])
+ * \param[in] table   Table (RT_TABLE_*)
+ * \param[in] nodes   Node storage
+ * \param[in] nnodes  Number of nodes
+ * \param[in] routes  Route storage
+ * \param[in] nroutes Number of routes
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Each route needs up to two nodes, plus one for the root.
+ */
+int nl_fib_init(struct nl_fib *f, __u8 family, __u32 table,
+                struct nl_fib_node *nodes, __u32 nnodes,
+                struct nl_fib_route *routes, __u32 nroutes)
+{
+	if (!f || !nodes || !nnodes || !routes || !nroutes ||
+	    nroutes == NL_FIB_NONE ||
+	    (family != AF_INET && family != AF_INET6)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	f->nodes   = nodes;
+	f->nnodes  = nnodes;
+	f->routes  = routes;
+	f->nroutes = nroutes;
+	f->family  = family;
+	f->table   = table;
+	f->dir     = NULL;
+	f->seq     = 0;
+	nl_fib_clear(f);
+	return 0;
+}
+
+/**
+ * \brief Remove every route from a mirror
+ * \param[in] f Mirror
+ */
+void nl_fib_clear(struct nl_fib *f)
+{
+	__u32 i;
+
+	if (!f) return;
+	write_begin(f);
+	memset(f->nodes, 0, f->nnodes * sizeof *f->nodes);
+	f->nodes[0].route = NL_FIB_NONE;
+	for (i = 1; i < f->nnodes - 1; i++)
+		f->nodes[i].child[0] = i + 1;
+
+	for (i = 0; i < f->nroutes; i++)
+		f->routes[i].next = i + 1;
+	f->routes[f->nroutes - 1].next = NL_FIB_NONE;
+
+	f->free_node  = f->nnodes > 1 ? 1 : 0;
+	f->free_route = 0;
+	f->count      = 0;
+	if (f->dir) {
+		memset(f->dir, 0, ((size_t)1 << f->dir_bits) * sizeof *f->dir);
+		for (i = 0; i < (__u32)1 << f->dir_bits; i++)
+			f->dir[i].route = NL_FIB_NONE;
+	}
+	write_end(f);
+}
+
+/**
+ * Add, replace or delete the route \a r (as per the message \a m)
+ * \return 0 on success, or -1 if the mirror is full.
+ */
+static int change(struct nl_fib *f, const struct nlmsghdr *m,
+                  const struct nl_rt_route *r,
+                  const struct nl_rt_nexthop *nh)
+{
+	unsigned lo, p;
+	int depth, same;
+	struct nl_fib_route *rt;
+	__u32 i, n, head, *pi, key[4], path[MAX_DEPTH];
+
+	/* Find the route to the same destination, with the same priority */
+	to_key(key, r->dst, f->family, r->dst_len);
+	n  = find(f, key, r->dst_len, path, &depth);
+	pi = n == NL_FIB_NONE ? NULL : find_route(f, n, r->priority);
+	same = pi && *pi != NL_FIB_NONE &&
+	       f->routes[*pi].priority == r->priority;
+
+	if (m->nlmsg_type == RTM_DELROUTE) {
+		if (!same) return 0;
+		head = f->nodes[n].route;
+		i    = *pi;
+		*pi = f->routes[i].next;
+		f->routes[i].next = f->free_route;
+		f->free_route     = i;
+		--f->count;
+		lo = r->dst_len;
+		if (f->nodes[n].route == NL_FIB_NONE &&
+		    (p = prune(f, path, depth)) < lo)
+			lo = p;
+		if (i == head || lo < r->dst_len) dir_update(f, key, lo);
+		return 0;
+	}
+
+	if (same) {
+		/* Appended next hops don't change the first one */
+		if (m->nlmsg_flags & NLM_F_APPEND) return 0;
+		i = *pi;
+	} else {
+		lo = r->dst_len;
+		if (f->free_route == NL_FIB_NONE) return -1;
+		if (!pi) {
+			n = insert(f, key, r->dst_len, &lo);
+			if (n == NL_FIB_NONE) return -1;
+			pi = &f->nodes[n].route;
+		}
+
+		i = f->free_route;
+		f->free_route     = f->routes[i].next;
+		f->routes[i].next = *pi;
+		*pi = i;
+		++f->count;
+		if (pi == &f->nodes[n].route || lo < r->dst_len)
+			dir_update(f, key, lo);
+	}
+
+	rt = &f->routes[i];
+	memcpy(rt->dst, r->dst, sizeof rt->dst);
+	memset(rt->gw, 0, sizeof rt->gw);
+	if (r->nnh) memcpy(rt->gw, nh->gw, sizeof rt->gw);
+	rt->ifindex  = r->nnh ? nh->ifindex : 0;
+	rt->priority = r->priority;
+	rt->nh_id    = r->nh_id;
+	rt->dst_len  = r->dst_len;
+	rt->protocol = r->protocol;
+	rt->scope    = r->scope;
+	rt->type     = r->type;
+	return 0;
+}
+
+/**
+ * \brief Apply a route message to a mirror
+ * \param[in] f Mirror
+ * \param[in] m Netlink message buffer (dump reply or notification)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * RTM_NEWROUTE messages add a route, or replace the route to the same
+ * destination with the same priority. RTM_DELROUTE messages delete
+ * it. Other messages, and routes in other tables, are ignored.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or ENOSPC if the mirror is full.
+ */
+int nl_fib_apply(struct nl_fib *f, struct nlmsghdr *m)
+{
+	int ret;
+	struct nl_rt_route r;
+	struct nl_rt_nexthop nh;
+
+	if (!f || !m) goto inval;
+	if (m->nlmsg_type != RTM_NEWROUTE && m->nlmsg_type != RTM_DELROUTE)
+		return 0;
+	if (nl_rt_parse(m, &r, &nh, 1)) return -1;
+	if (r.family != f->family || r.table != f->table ||
+	    (((struct rtmsg *)NLMSG_DATA(m))->rtm_flags & RTM_F_CLONED))
+		return 0;
+	if (r.dst_len > ADDR_BITS(f->family)) goto inval;
+
+	write_begin(f);
+	ret = change(f, m, &r, &nh);
+	write_end(f);
+	if (ret) errno = ENOSPC;
+	return ret;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Index the first bits of the prefixes in a mirror
+ * \param[in] f    Mirror
+ * \param[in] dir  Directory storage (2 ^ \a bits entries, or NULL to
+ *                 remove the directory)
+ * \param[in] bits Number of bits indexed (1 to 24)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The directory maps the first \a bits bits of an address directly to
+ * the node where its lookup continues (and the best route so far), so
+ * that the first levels of the trie are skipped. It's kept current as
+ * routes are added and deleted.
+ *
+ * Unlike the other changes to a mirror, this may not be done while
+ * other threads look up routes in it.
+ */
+int nl_fib_index(struct nl_fib *f, struct nl_fib_dir *dir, __u8 bits)
+{
+	__u32 t;
+
+	if (!f || (dir && (!bits || bits > 24))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	f->dir      = dir;
+	f->dir_bits = dir ? bits : 0;
+	for (t = 0; dir && t < (__u32)1 << bits; t++)
+		dir_fill(f, t);
+	return 0;
+}
+
+/**
+ * \brief Fill a mirror from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Mirror
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_fib_collect(struct nlmsghdr *m, void *arg)
+{
+	struct nl_fib *f = arg;
+
+	if (!f) return 0;
+	if (m) return !!nl_fib_apply(f, m);
+	nl_fib_clear(f);
+	return 0;
+}
+
+/**
+ * \brief Look up the route to an address
+ * \param[in]  f    Mirror
+ * \param[in]  addr Address (network byte order)
+ * \param[out] r    Copy of the route (if found)
+ * \return 0 if found, or -1 otherwise (with \a errno set to ENOENT.)
+ *
+ * The route found is the one with the longest matching prefix (and
+ * the lowest priority.) It may be of any type, i.e. RTN_BLACKHOLE or
+ * RTN_UNREACHABLE.
+ *
+ * This may be called concurrently with nl_fib_apply(), nl_fib_clear()
+ * and nl_fib_collect().
+ */
+int nl_fib_lookup(const struct nl_fib *f, const void *addr,
+                  struct nl_fib_route *r)
+{
+	int depth;
+	unsigned bits;
+	__u32 c, n, best, seq, key[4];
+	const struct nl_fib_node *nodes;
+
+	if (!f || !addr || !r) goto noent;
+	bits  = ADDR_BITS(f->family);
+	nodes = f->nodes;
+	to_key(key, addr, f->family, bits);
+
+retry:
+	if ((seq = SEQ_LOAD(&f->seq)) & 1) goto retry;
+	n    = 0;
+	best = NL_FIB_NONE;
+	if (f->dir) {
+		n    = f->dir[key[0] >> (32 - f->dir_bits)].node;
+		best = f->dir[key[0] >> (32 - f->dir_bits)].route;
+	}
+
+	/* The walk is bounded, as the trie may change under it */
+	for (depth = 0; depth < MAX_DEPTH; depth++) {
+		if (nodes[n].route != NL_FIB_NONE) best = nodes[n].route;
+		if (nodes[n].len >= bits) break;
+		c = nodes[n].child[BIT(key, nodes[n].len)];
+		if (!c || !match(key, nodes[c].key, nodes[c].len)) break;
+		n = c;
+	}
+
+	if (best != NL_FIB_NONE) memcpy(r, &f->routes[best], sizeof *r);
+	SEQ_RMB();
+	if (__atomic_load_n(&f->seq, __ATOMIC_RELAXED) != seq) goto retry;
+	if (best != NL_FIB_NONE) return 0;
+
+noent:
+	errno = ENOENT;
+	return -1;
+}
@@ -0,0 +1,202 @@
+/**
+ * \file nl_fib.h
+ *
+ * nanonl: Routing table mirror
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_FIB_H
+#define NL_FIB_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "nl_route.h"
+
+/**
+ * \brief No route (or node)
+ */
+#define NL_FIB_NONE 0xffffffffU
+
+/**
+ * \brief Mirrored route
+ *
+ * Addresses are in network byte order, everything else is in host
+ * byte order. Only the first next hop of a multipath route is kept.
+ */
+struct nl_fib_route {
+	__u32 dst[4];   /**< Destination */
+	__u32 gw[4];    /**< Gateway of the first next hop (or zero) */
+	__u32 priority; /**< Priority (metric) */
+	__u32 nh_id;    /**< Nexthop object ID (or 0) */
+	__s32 ifindex;  /**< Output interface of the first next hop */
+	__u32 next;     /**< Next route to the same destination */
+	__u8 dst_len;   /**< Destination prefix length */
+	__u8 protocol;  /**< Protocol (RTPROT_*) */
+	__u8 scope;     /**< Scope (RT_SCOPE_*) */
+	__u8 type;      /**< Type (RTN_*) */
+};
+
+/**
+ * \brief Trie node
+ *
+ * The key is in host byte order, and its bits past \a len are zero.
+ */
+struct nl_fib_node {
+	__u32 key[4];   /**< Prefix */
+	__u32 child[2]; /**< Children (0 = none) */
+	__u32 route;    /**< First route (or NL_FIB_NONE) */
+	__u8 len;       /**< Prefix length */
+};
+
+/**
+ * \brief Directory entry
+ */
+struct nl_fib_dir {
+	__u32 node;  /**< Node to continue the lookup from */
+	__u32 route; /**< Best route before that node (or NL_FIB_NONE) */
+};
+
+/**
+ * \brief Routing table mirror
+ *
+ * A mirror of one routing table (of one address family) for longest
+ * prefix match lookups, without a round trip to the kernel for each.
+ * The prefixes are kept in a path-compressed binary trie, and the
+ * routes to each prefix in a list ordered by priority, both in
+ * caller-supplied storage. It's filled by a dump of the table, and
+ * kept current by the notifications sent to RTNLGRP_IPV4_ROUTE (or
+ * RTNLGRP_IPV6_ROUTE):
+ *
+ * \code{.c}
+ * struct nl_fib_node n[2 * 4096];
+ * struct nl_fib_route r[4096];
+ * struct nl_fib f;
+ *
+ * nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, n, 2 * 4096, r, 4096);
+ * if (nl_multicast(ev_fd, NL_MULTICAST_JOIN, RTNLGRP_IPV4_ROUTE, 0))
+ * 	goto err;
+ * nl_rt_get_routes(req, AF_INET);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_fib_collect, &f))
+ * 	goto err;
+ * \endcode
+ *
+ * Each message received on \a ev_fd is then passed to nl_fib_apply().
+ * Joining the group before the dump ensures that no change is missed.
+ * Lookups in large tables are faster with a directory of the first
+ * bits of each prefix (see nl_fib_index().)
+ *
+ * The kernel doesn't notify the removal of IPv4 routes when their
+ * interface or address goes away, so the mirror should be refilled
+ * when receiving RTM_DELADDR or RTM_DELLINK (or when a notification
+ * is lost, with ENOBUFS.)
+ *
+ * The mirror may be changed by one thread at a time, while any number
+ * of threads look up routes in it without locking. It's guarded by a
+ * sequence counter, which is odd while it's being changed, and readers
+ * retry a lookup if the counter changes while they're reading.
+ */
+struct nl_fib {
+	struct nl_fib_node *nodes;   /**< Nodes (the first is the root) */
+	struct nl_fib_route *routes; /**< Routes */
+	__u32 nnodes;                /**< Number of nodes */
+	__u32 nroutes;               /**< Number of routes */
+	__u32 free_node;             /**< First free node (or 0) */
+	__u32 free_route;            /**< First free route */
+	__u32 count;                 /**< Number of routes mirrored */
+	__u32 table;                 /**< Table (RT_TABLE_*) */
+	__u32 seq;                   /**< Sequence counter */
+	struct nl_fib_dir *dir;      /**< Directory (or NULL) */
+	__u8 dir_bits;               /**< Number of bits indexed */
+	__u8 family;                 /**< Address family (AF_INET[6]) */
+};
+
+/**
+ * \brief Initialize a routing table mirror
+ * \param[in] f       Mirror
+ * \param[in] family  Address family (AF_INET[6])
+ * \param[in] table   Table (RT_TABLE_*)
+ * \param[in] nodes   Node storage
+ * \param[in] nnodes  Number of nodes
+ * \param[in] routes  Route storage
+ * \param[in] nroutes Number of routes
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Each route needs up to two nodes, plus one for the root.
+ */
+int nl_fib_init(struct nl_fib *f, __u8 family, __u32 table,
+                struct nl_fib_node *nodes, __u32 nnodes,
+                struct nl_fib_route *routes, __u32 nroutes);
+
+/**
+ * \brief Remove every route from a mirror
+ * \param[in] f Mirror
+ */
+void nl_fib_clear(struct nl_fib *f);
+
+/**
+ * \brief Apply a route message to a mirror
+ * \param[in] f Mirror
+ * \param[in] m Netlink message buffer (dump reply or notification)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * RTM_NEWROUTE messages add a route, or replace the route to the same
+ * destination with the same priority. RTM_DELROUTE messages delete
+ * it. Other messages, and routes in other tables, are ignored.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or ENOSPC if the mirror is full.
+ */
+int nl_fib_apply(struct nl_fib *f, struct nlmsghdr *m);
+
+/**
+ * \brief Index the first bits of the prefixes in a mirror
+ * \param[in] f    Mirror
+ * \param[in] dir  Directory storage (2 ^ \a bits entries, or NULL to
+ *                 remove the directory)
+ * \param[in] bits Number of bits indexed (1 to 24)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The directory maps the first \a bits bits of an address directly to
+ * the node where its lookup continues (and the best route so far), so
+ * that the first levels of the trie are skipped. It's kept current as
+ * routes are added and deleted.
+ *
+ * Changing a route with a prefix of \a n bits (where \a n is at most
+ * \a bits) updates 2 ^ (\a bits - \a n) entries. 16 bits suit an IPv4
+ * table with many routes.
+ *
+ * Unlike the other changes to a mirror, this may not be done while
+ * other threads look up routes in it.
+ */
+int nl_fib_index(struct nl_fib *f, struct nl_fib_dir *dir, __u8 bits);
+
+/**
+ * \brief Fill a mirror from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Mirror
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_fib_collect(struct nlmsghdr *m, void *arg);
+
+/**
+ * \brief Look up the route to an address
+ * \param[in]  f    Mirror
+ * \param[in]  addr Address (network byte order)
+ * \param[out] r    Copy of the route (if found)
+ * \return 0 if found, or -1 otherwise (with \a errno set to ENOENT.)
+ *
+ * The route found is the one with the longest matching prefix (and
+ * the lowest priority.) It may be of any type, i.e. RTN_BLACKHOLE or
+ * RTN_UNREACHABLE.
+ *
+ * This may be called concurrently with nl_fib_apply(), nl_fib_clear()
+ * and nl_fib_collect().
+ */
+int nl_fib_lookup(const struct nl_fib *f, const void *addr,
+                  struct nl_fib_route *r);
+
+#endif /* NL_FIB_H */
@@ -68,3 +68,380 @@ ret:
 	return ret;
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+/* Length of each integer type (NL_ATTR_TYPE_U8 ... NL_ATTR_TYPE_S64) */
+static const size_t int_len[] = { 1, 2, 4, 8, 1, 2, 4, 8 };
+
+static __u64 policy_u64(struct nlattr *nla)
+{
+	__u64 v = 0;
+
+	if (nla->nla_len >= NLA_HDRLEN + sizeof v)
+		memcpy(&v, NLA_DATA(nla), sizeof v);
+	return v;
+}
+
+/**
+ * Decode the policy of an attribute (a nest of NL_POLICY_TYPE_ATTR_*)
+ */
+static void parse_policy(struct nl_gen_policy *p, struct nlattr *attr)
+{
+	struct nlattr *nla;
+
+	memset(p, 0, sizeof *p);
+	nla_each(nla, attr) {
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case NL_POLICY_TYPE_ATTR_TYPE:
+			p->type = (__u16)nla_u32(nla);
+			break;
+		case NL_POLICY_TYPE_ATTR_MIN_VALUE_S:
+			p->smin   = (__s64)policy_u64(nla);
+			p->flags |= NL_GEN_POLICY_F_SRANGE;
+			break;
+		case NL_POLICY_TYPE_ATTR_MAX_VALUE_S:
+			p->smax   = (__s64)policy_u64(nla);
+			p->flags |= NL_GEN_POLICY_F_SRANGE;
+			break;
+		case NL_POLICY_TYPE_ATTR_MIN_VALUE_U:
+			p->umin   = policy_u64(nla);
+			p->flags |= NL_GEN_POLICY_F_URANGE;
+			break;
+		case NL_POLICY_TYPE_ATTR_MAX_VALUE_U:
+			p->umax   = policy_u64(nla);
+			p->flags |= NL_GEN_POLICY_F_URANGE;
+			break;
+		case NL_POLICY_TYPE_ATTR_MIN_LENGTH:
+			p->min_len = nla_u32(nla);
+			p->flags  |= NL_GEN_POLICY_F_MINLEN;
+			break;
+		case NL_POLICY_TYPE_ATTR_MAX_LENGTH:
+			p->max_len = nla_u32(nla);
+			p->flags  |= NL_GEN_POLICY_F_MAXLEN;
+			break;
+		case NL_POLICY_TYPE_ATTR_POLICY_IDX:
+			p->nested = nla_u32(nla);
+			p->flags |= NL_GEN_POLICY_F_NESTED;
+			break;
+		case NL_POLICY_TYPE_ATTR_POLICY_MAXTYPE:
+			p->maxtype = nla_u32(nla);
+			break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * \brief Initialize a policy table
+ * \param[in] ps     Policies
+ * \param[in] p      Policy storage (\a npol * \a nattr elements)
+ * \param[in] npol   Number of policies
+ * \param[in] nattr  Attributes per policy
+ * \param[in] family Family ID
+ * \param[in] cmd    Command
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_gen_policy_init(struct nl_gen_policies *ps, struct nl_gen_policy *p,
+                       __u32 npol, __u16 nattr, __u16 family, __u8 cmd)
+{
+	if (!ps || !p || !npol || !nattr) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(p, 0, (size_t)npol * nattr * sizeof *p);
+	ps->p        = p;
+	ps->npol     = npol;
+	ps->nattr    = nattr;
+	ps->family   = family;
+	ps->cmd      = cmd;
+	ps->do_idx   = (__u32)-1;
+	ps->dump_idx = (__u32)-1;
+	return 0;
+}
+
+/**
+ * \brief Create a request to dump the policies of a command
+ * \param[in] m      Netlink message buffer.
+ * \param[in] family Family ID
+ * \param[in] cmd    Command
+ */
+void nl_gen_get_policy(struct nlmsghdr *m, __u16 family, __u8 cmd)
+{
+	__u32 op = cmd;
+	struct nlattr *nla;
+
+	if (!m) return;
+	nl_gen_request(m, 0, GENL_ID_CTRL, CTRL_CMD_GETPOLICY, 1);
+	m->nlmsg_flags |= NLM_F_DUMP;
+
+	/* This request is strictly validated, so the length must be exact */
+	nla = BYTE_OFF(m, NLMSG_ALIGN(m->nlmsg_len));
+	nl_add_attr(m, CTRL_ATTR_FAMILY_ID, &family, sizeof family);
+	nla->nla_len = NLA_HDRLEN + sizeof family;
+	nl_add_attr(m, CTRL_ATTR_OP, &op, sizeof op);
+}
+
+/**
+ * \brief Apply a CTRL_CMD_GETPOLICY reply to a policy table
+ * \param[in] ps Policies
+ * \param[in] m  Netlink message buffer.
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * Messages for other families or commands are ignored.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if a policy index or attribute type doesn't fit in
+ * the table.
+ */
+int nl_gen_policy_apply(struct nl_gen_policies *ps, struct nlmsghdr *m)
+{
+	__u16 type;
+	__u32 idx;
+	struct genlmsghdr *g;
+	struct nlattr *nla, *n, *a[CTRL_ATTR_MAX + 1];
+	struct nlattr *o[CTRL_ATTR_POLICY_DUMP_MAX + 1];
+
+	if (!ps || !m || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	g = NLMSG_DATA(m);
+	if (m->nlmsg_type != GENL_ID_CTRL || g->cmd != CTRL_CMD_GETPOLICY)
+		return 0;
+
+	memset(a, 0, sizeof a);
+	nl_gen_get_attrv(m, a);
+	if (!a[CTRL_ATTR_FAMILY_ID] ||
+	    *(__u16 *)NLA_DATA(a[CTRL_ATTR_FAMILY_ID]) != ps->family)
+		return 0;
+
+	if (a[CTRL_ATTR_OP_POLICY]) {
+		nla_each(nla, a[CTRL_ATTR_OP_POLICY]) {
+			if ((nla->nla_type & NLA_TYPE_MASK) != ps->cmd)
+				continue;
+			memset(o, 0, sizeof o);
+			nla_get_attrv(nla, o, CTRL_ATTR_POLICY_DUMP_MAX);
+			if ((n = o[CTRL_ATTR_POLICY_DO]))
+				ps->do_idx = nla_u32(n);
+			if ((n = o[CTRL_ATTR_POLICY_DUMP]))
+				ps->dump_idx = nla_u32(n);
+		}
+	}
+
+	if (!a[CTRL_ATTR_POLICY]) return 0;
+	nla_each(nla, a[CTRL_ATTR_POLICY]) {
+		idx = (__u32)(nla->nla_type & NLA_TYPE_MASK);
+		nla_each(n, nla) {
+			type = (__u16)(n->nla_type & NLA_TYPE_MASK);
+			if (idx >= ps->npol || type >= ps->nattr) {
+				errno = E2BIG;
+				return -1;
+			}
+
+			parse_policy(nl_gen_policy(ps, idx, type), n);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Fill a policy table from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Policies
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_gen_policy_collect(struct nlmsghdr *m, void *arg)
+{
+	struct nl_gen_policies *ps = arg;
+
+	if (!ps) return 0;
+	if (m) return !!nl_gen_policy_apply(ps, m);
+	nl_gen_policy_init(ps, ps->p, ps->npol, ps->nattr, ps->family,
+	                   ps->cmd);
+	return 0;
+}
+
+/**
+ * \brief Get the highest attribute type accepted by a policy
+ * \param[in] ps  Policies
+ * \param[in] idx Policy index
+ * \return The highest type, or 0 if the policy accepts none.
+ */
+__u16 nl_gen_policy_maxtype(const struct nl_gen_policies *ps, __u32 idx)
+{
+	__u16 type;
+
+	if (!ps || idx >= ps->npol) return 0;
+	for (type = ps->nattr; type > 0; type--) {
+		if (nl_gen_policy(ps, idx, type - 1)->type)
+			return (__u16)(type - 1);
+	}
+
+	return 0;
+}
+
+static int validate(const struct nl_gen_policies *ps, __u32 idx,
+                    struct nlattr *nla, size_t len, struct nlattr **bad);
+
+/**
+ * Check the attribute \a nla against the policy \a p
+ * \return 0 if valid, an errno value if \a nla is invalid, or -1 if a
+ *         nested attribute is (with \a errno and \a bad set.)
+ */
+static int check(const struct nl_gen_policies *ps,
+                 const struct nl_gen_policy *p, struct nlattr *nla,
+                 struct nlattr **bad)
+{
+	__u8 u8;
+	__u16 u16;
+	__u32 u32;
+	__u64 u = 0;
+	__s64 s = 0;
+	struct nlattr *n;
+	const __u8 *d = NLA_DATA(nla);
+	size_t i, len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+	switch (p->type) {
+	case NL_ATTR_TYPE_FLAG:
+		return len ? EINVAL : 0;
+	case NL_ATTR_TYPE_U8: case NL_ATTR_TYPE_U16:
+	case NL_ATTR_TYPE_U32: case NL_ATTR_TYPE_U64:
+	case NL_ATTR_TYPE_S8: case NL_ATTR_TYPE_S16:
+	case NL_ATTR_TYPE_S32: case NL_ATTR_TYPE_S64:
+		i = int_len[p->type - NL_ATTR_TYPE_U8];
+		if (len < i) return EINVAL;
+		switch (i) {
+		case 1:
+			memcpy(&u8, d, i);
+			u = u8, s = (__s8)u8;
+			break;
+		case 2:
+			memcpy(&u16, d, i);
+			u = u16, s = (__s16)u16;
+			break;
+		case 4:
+			memcpy(&u32, d, i);
+			u = u32, s = (__s32)u32;
+			break;
+		default:
+			memcpy(&u, d, i);
+			s = (__s64)u;
+		}
+
+		if (p->type >= NL_ATTR_TYPE_S8) {
+			if ((p->flags & NL_GEN_POLICY_F_SRANGE) &&
+			    (s < p->smin || s > p->smax))
+				return ERANGE;
+		} else if ((p->flags & NL_GEN_POLICY_F_URANGE) &&
+		           (u < p->umin || u > p->umax))
+			return ERANGE;
+		break;
+	case NL_ATTR_TYPE_NUL_STRING:
+		if (!len || d[len - 1]) return EINVAL;
+		--len;
+		/* fall through */
+	case NL_ATTR_TYPE_STRING:
+	case NL_ATTR_TYPE_BINARY:
+		if (p->type == NL_ATTR_TYPE_STRING && len && !d[len - 1])
+			--len;
+		if ((p->flags & NL_GEN_POLICY_F_MINLEN) && len < p->min_len)
+			return EINVAL;
+		if ((p->flags & NL_GEN_POLICY_F_MAXLEN) && len > p->max_len)
+			return EINVAL;
+		break;
+	case NL_ATTR_TYPE_NESTED:
+		if (len && len < NLA_HDRLEN) return EINVAL;
+		if (!(p->flags & NL_GEN_POLICY_F_NESTED)) break;
+		return validate(ps, p->nested, NLA_DATA(nla), len, bad);
+	case NL_ATTR_TYPE_NESTED_ARRAY:
+		if (len && len < NLA_HDRLEN) return EINVAL;
+		if (validate(ps, (__u32)-1, NLA_DATA(nla), len, bad))
+			return -1;
+		if (!(p->flags & NL_GEN_POLICY_F_NESTED)) break;
+		nla_each(n, nla) {
+			if (validate(ps, p->nested, NLA_DATA(n),
+			             (size_t)(n->nla_len - NLA_HDRLEN), bad))
+				return -1;
+		}
+		break;
+	case NL_ATTR_TYPE_BITFIELD32:
+		return len == 2 * sizeof(__u32) ? 0 : EINVAL;
+	default: break;
+	}
+
+	return 0;
+}
+
+/**
+ * Validate the \a len bytes of attributes at \a nla against the
+ * policy \a idx (or just their lengths, if there's no such policy.)
+ */
+static int validate(const struct nl_gen_policies *ps, __u32 idx,
+                    struct nlattr *nla, size_t len, struct nlattr **bad)
+{
+	int e;
+	__u16 type;
+	size_t alen;
+
+	while (len >= NLA_HDRLEN) {
+		if (nla->nla_len < NLA_HDRLEN || nla->nla_len > len) {
+			e = EINVAL;
+			goto err;
+		}
+
+		type = (__u16)(nla->nla_type & NLA_TYPE_MASK);
+		if (idx < ps->npol && type < ps->nattr &&
+		    (e = check(ps, nl_gen_policy(ps, idx, type), nla, bad))) {
+			if (e > 0) goto err;
+			return -1;
+		}
+
+		if ((alen = NLA_ALIGN(nla->nla_len)) >= len) break;
+		len -= alen;
+		nla  = BYTE_OFF(nla, alen);
+	}
+
+	return 0;
+
+err:
+	if (bad) *bad = nla;
+	errno = e;
+	return -1;
+}
+
+/**
+ * \brief Validate the attributes of a message against a policy
+ * \param[in]  ps  Policies
+ * \param[in]  idx Policy index (i.e. \a ps->do_idx)
+ * \param[in]  m   Netlink message buffer.
+ * \param[out] bad The offending attribute (if not NULL)
+ * \return 0 if the attributes are valid, or -1 otherwise (with \a errno
+ *         set.)
+ *
+ * This checks every attribute (and nested attribute) in a single pass,
+ * as the kernel would. Attributes the kernel doesn't report a policy
+ * for aren't checked. Families with their own header (i.e. a non-zero
+ * hdrsize) aren't supported.
+ *
+ * A message built (or received) according to the kernel's policy needs
+ * no further validation when it's parsed.
+ *
+ * This function will set \a errno to EINVAL if an attribute is
+ * malformed, or ERANGE if an integer attribute is out of range.
+ */
+int nl_gen_validate(const struct nl_gen_policies *ps, __u32 idx,
+                    struct nlmsghdr *m, struct nlattr **bad)
+{
+	if (!ps || !m || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return validate(ps, idx, BYTE_OFF(NLMSG_DATA(m), GENL_HDRLEN),
+	                m->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN), bad);
+}
+#endif /* Linux >= 5.10.0 */
@@ -11,6 +11,7 @@
 #define NL_GEN_H
 
 #include <sys/types.h>
+#include <linux/version.h>
 #include <linux/netlink.h>
 #include <linux/genetlink.h>
 
@@ -69,4 +70,136 @@ void nl_gen_request(struct nlmsghdr *m, __u32 pid, __u16 family,
  */
 int nl_gen_find_family(struct nlmsghdr *m, const char *family);
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+#define NL_GEN_POLICY_F_SRANGE (1 << 0) /**< smin and smax are set */
+#define NL_GEN_POLICY_F_URANGE (1 << 1) /**< umin and umax are set */
+#define NL_GEN_POLICY_F_MINLEN (1 << 2) /**< min_len is set */
+#define NL_GEN_POLICY_F_MAXLEN (1 << 3) /**< max_len is set */
+#define NL_GEN_POLICY_F_NESTED (1 << 4) /**< nested and maxtype are set */
+
+/**
+ * \brief Attribute policy
+ *
+ * Describes what the kernel accepts for one attribute type. Lengths
+ * are those of the payload.
+ */
+struct nl_gen_policy {
+	__u16 type;    /**< Type (NL_ATTR_TYPE_*, 0 if unknown) */
+	__u16 flags;   /**< Limits that are set (NL_GEN_POLICY_F_*) */
+	__u32 nested;  /**< Index of the policy for nested attributes */
+	__u32 maxtype; /**< Highest type of nested attributes */
+	__u32 min_len; /**< Minimum length (binary / string) */
+	__u32 max_len; /**< Maximum length (binary / string) */
+	__s64 smin;    /**< Minimum value (signed integers) */
+	__s64 smax;    /**< Maximum value (signed integers) */
+	__u64 umin;    /**< Minimum value (unsigned integers) */
+	__u64 umax;    /**< Maximum value (unsigned integers) */
+};
+
+/**
+ * \brief Policies of a generic netlink command
+ *
+ * Filled from the dump requested by nl_gen_get_policy(), which holds
+ * the top-level policies of the command (\a do_idx and \a dump_idx,)
+ * and those of every nested attribute they refer to.
+ *
+ * The policies are stored in a caller-supplied array of \a npol *
+ * \a nattr elements. nl_gen_policy() gets the policy of an attribute,
+ * and nl_gen_policy_maxtype() gives the exact size of the attribute
+ * arrays to pass to nl_get_attrv() / nla_get_attrv().
+ */
+struct nl_gen_policies {
+	struct nl_gen_policy *p; /**< Policies (\a npol * \a nattr) */
+	__u32 npol;              /**< Number of policies \a p can hold */
+	__u16 nattr;             /**< Attributes per policy */
+	__u16 family;            /**< Family ID */
+	__u8  cmd;               /**< Command */
+	__u32 do_idx;            /**< Policy for requests ((__u32)-1 if none) */
+	__u32 dump_idx;          /**< Policy for dumps ((__u32)-1 if none) */
+};
+
+/**
+ * \brief Get the policy for an attribute type
+ * \param[in] ps   Policies
+ * \param[in] idx  Policy index
+ * \param[in] type Attribute type (less than \a ps->nattr)
+ */
+#define nl_gen_policy(ps, idx, type) \
+	(&(ps)->p[(size_t)(idx) * (ps)->nattr + (type)])
+
+/**
+ * \brief Initialize a policy table
+ * \param[in] ps     Policies
+ * \param[in] p      Policy storage (\a npol * \a nattr elements)
+ * \param[in] npol   Number of policies
+ * \param[in] nattr  Attributes per policy
+ * \param[in] family Family ID
+ * \param[in] cmd    Command
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_gen_policy_init(struct nl_gen_policies *ps, struct nl_gen_policy *p,
+                       __u32 npol, __u16 nattr, __u16 family, __u8 cmd);
+
+/**
+ * \brief Create a request to dump the policies of a command
+ * \param[in] m      Netlink message buffer.
+ * \param[in] family Family ID
+ * \param[in] cmd    Command
+ */
+void nl_gen_get_policy(struct nlmsghdr *m, __u16 family, __u8 cmd);
+
+/**
+ * \brief Apply a CTRL_CMD_GETPOLICY reply to a policy table
+ * \param[in] ps Policies
+ * \param[in] m  Netlink message buffer.
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * Messages for other families or commands are ignored.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if a policy index or attribute type doesn't fit in
+ * the table.
+ */
+int nl_gen_policy_apply(struct nl_gen_policies *ps, struct nlmsghdr *m);
+
+/**
+ * \brief Fill a policy table from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Policies
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_gen_policy_collect(struct nlmsghdr *m, void *arg);
+
+/**
+ * \brief Get the highest attribute type accepted by a policy
+ * \param[in] ps  Policies
+ * \param[in] idx Policy index
+ * \return The highest type, or 0 if the policy accepts none.
+ */
+__u16 nl_gen_policy_maxtype(const struct nl_gen_policies *ps, __u32 idx);
+
+/**
+ * \brief Validate the attributes of a message against a policy
+ * \param[in]  ps  Policies
+ * \param[in]  idx Policy index (i.e. \a ps->do_idx)
+ * \param[in]  m   Netlink message buffer.
+ * \param[out] bad The offending attribute (if not NULL)
+ * \return 0 if the attributes are valid, or -1 otherwise (with \a errno
+ *         set.)
+ *
+ * This checks every attribute (and nested attribute) in a single pass,
+ * as the kernel would. Attributes the kernel doesn't report a policy
+ * for aren't checked. Families with their own header (i.e. a non-zero
+ * hdrsize) aren't supported.
+ *
+ * A message built (or received) according to the kernel's policy needs
+ * no further validation when it's parsed.
+ *
+ * This function will set \a errno to EINVAL if an attribute is
+ * malformed, or ERANGE if an integer attribute is out of range.
+ */
+int nl_gen_validate(const struct nl_gen_policies *ps, __u32 idx,
+                    struct nlmsghdr *m, struct nlattr **bad);
+#endif /* Linux >= 5.10.0 */
+
 #endif /* NL_GEN_H */
@@ -0,0 +1,319 @@
+/**
+ * nanonl: Netlink_Generic Family Cache
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "nl.h"
+#include "nl_gen_cache.h"
+
+#define SLOT_EMPTY   0
+#define SLOT_DELETED 1
+
+static __u32 hash_name(const char *name)
+{
+	size_t i;
+	__u32 h = 0x811c9dc5U;
+
+	for (i = 0; i < GENL_NAMSIZ && name[i]; i++)
+		h = (h ^ (__u8)name[i]) * 0x01000193U;
+
+	/* 0 and 1 mark empty and deleted slots */
+	return h < 2 ? h + 2 : h;
+}
+
+/**
+ * Copy the (NUL-terminated) name in \a nla into \a name
+ */
+static void copy_name(char name[GENL_NAMSIZ], struct nlattr *nla)
+{
+	size_t len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+	if (len > GENL_NAMSIZ - 1) len = GENL_NAMSIZ - 1;
+	memset(name, 0, GENL_NAMSIZ);
+	memcpy(name, NLA_DATA(nla), len);
+}
+
+/**
+ * Find the slot holding the family \a name (or NULL.)
+ */
+static struct nl_gen_family *find(const struct nl_gen_cache *c,
+                                  const char *name, __u32 h)
+{
+	__u32 i, n, mask = c->size - 1;
+	struct nl_gen_family *s;
+
+	for (n = 0, i = h & mask; n < c->size; n++, i = (i + 1) & mask) {
+		s = &c->slots[i];
+		if (s->hash == SLOT_EMPTY) break;
+		if (s->hash == h && !strncmp(s->name, name, GENL_NAMSIZ))
+			return s;
+	}
+
+	return NULL;
+}
+
+/**
+ * Get the name and ID of a multicast group
+ * \return 0 on success, or -1 if the group is missing either.
+ */
+static int parse_grp(struct nlattr *grp, char name[GENL_NAMSIZ], __u32 *id)
+{
+	struct nlattr *a[CTRL_ATTR_MCAST_GRP_MAX + 1];
+
+	memset(a, 0, sizeof a);
+	nla_get_attrv(grp, a, CTRL_ATTR_MCAST_GRP_MAX);
+	if (!a[CTRL_ATTR_MCAST_GRP_NAME] || !a[CTRL_ATTR_MCAST_GRP_ID])
+		return -1;
+
+	copy_name(name, a[CTRL_ATTR_MCAST_GRP_NAME]);
+	*id = nla_u32(a[CTRL_ATTR_MCAST_GRP_ID]);
+	return 0;
+}
+
+static void add_grp(struct nl_gen_family *f, struct nlattr *grp)
+{
+	__u8 i;
+	__u32 id;
+	char name[GENL_NAMSIZ];
+
+	if (parse_grp(grp, name, &id)) return;
+	for (i = 0; i < f->ngrps; i++) {
+		if (!strcmp(f->grps[i].name, name))
+			break;
+	}
+
+	if (i == NL_GEN_CACHE_GRPS) return;
+	if (i == f->ngrps) ++f->ngrps;
+	memcpy(f->grps[i].name, name, GENL_NAMSIZ);
+	f->grps[i].id = id;
+}
+
+static void del_grp(struct nl_gen_family *f, struct nlattr *grp)
+{
+	__u8 i;
+	__u32 id;
+	char name[GENL_NAMSIZ];
+
+	if (parse_grp(grp, name, &id)) return;
+	for (i = 0; i < f->ngrps; i++) {
+		if (strcmp(f->grps[i].name, name)) continue;
+		memmove(&f->grps[i], &f->grps[i + 1],
+		        (size_t)(f->ngrps - i - 1) * sizeof *f->grps);
+		--f->ngrps;
+		break;
+	}
+}
+
+/**
+ * Add or replace the family \a name, from the attributes in \a a
+ */
+static int update(struct nl_gen_cache *c, struct nl_gen_family *f,
+                  const char *name, __u32 h, struct nlattr **a)
+{
+	__u32 i, n, id, mask = c->size - 1;
+	struct nlattr *nla, *op[CTRL_ATTR_OP_MAX + 1];
+
+	/* Take the first free slot in the probe sequence */
+	for (n = 0, i = h & mask; !f && n < c->size;
+	     n++, i = (i + 1) & mask) {
+		if (c->slots[i].hash < 2) {
+			f = &c->slots[i];
+			++c->count;
+		}
+	}
+
+	if (!f) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	memset(f, 0, sizeof *f);
+	memcpy(f->name, name, GENL_NAMSIZ);
+	if (a[CTRL_ATTR_FAMILY_ID])
+		f->id = nla_u16(a[CTRL_ATTR_FAMILY_ID]);
+	if (a[CTRL_ATTR_VERSION])
+		f->version = (__u8)nla_u32(a[CTRL_ATTR_VERSION]);
+	if (a[CTRL_ATTR_HDRSIZE])
+		f->hdrsize = nla_u32(a[CTRL_ATTR_HDRSIZE]);
+	if (a[CTRL_ATTR_MAXATTR])
+		f->maxattr = nla_u32(a[CTRL_ATTR_MAXATTR]);
+
+	if (a[CTRL_ATTR_OPS]) {
+		nla_each(nla, a[CTRL_ATTR_OPS]) {
+			memset(op, 0, sizeof op);
+			nla_get_attrv(nla, op, CTRL_ATTR_OP_MAX);
+			if (!op[CTRL_ATTR_OP_ID]) continue;
+			if ((id = nla_u32(op[CTRL_ATTR_OP_ID])) > 0xff)
+				continue;
+			f->ops[id >> 3] |= (__u8)(1 << (id & 7));
+		}
+	}
+
+	if (a[CTRL_ATTR_MCAST_GROUPS]) {
+		nla_each(nla, a[CTRL_ATTR_MCAST_GROUPS])
+			add_grp(f, nla);
+	}
+
+	f->hash = h;
+	return 0;
+}
+
+/**
+ * \brief Initialize a family cache
+ * \param[in] c     Cache
+ * \param[in] slots Slot storage
+ * \param[in] n     Number of slots (must be a power of 2)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_gen_cache_init(struct nl_gen_cache *c, struct nl_gen_family *slots,
+                      __u32 n)
+{
+	if (!c || !slots || !n || (n & (n - 1))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(slots, 0, n * sizeof *slots);
+	c->slots = slots;
+	c->size  = n;
+	c->count = 0;
+	return 0;
+}
+
+/**
+ * \brief Create a request to dump every family
+ * \param[in] m Netlink message buffer.
+ */
+void nl_gen_cache_dump(struct nlmsghdr *m)
+{
+	if (!m) return;
+	nl_gen_request(m, 0, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1);
+	m->nlmsg_flags |= NLM_F_DUMP;
+}
+
+/**
+ * \brief Apply a nlctrl message to the cache
+ * \param[in] c Cache
+ * \param[in] m Netlink message buffer (dump reply or notification)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * CTRL_CMD_NEWFAMILY messages add or replace a family, and
+ * CTRL_CMD_DELFAMILY messages delete it. CTRL_CMD_NEWMCAST_GRP and
+ * CTRL_CMD_DELMCAST_GRP messages add or delete a multicast group.
+ * Other messages are ignored.
+ *
+ * Only the first NL_GEN_CACHE_GRPS multicast groups of a family are
+ * cached.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or ENOSPC if the cache is full.
+ */
+int nl_gen_cache_apply(struct nl_gen_cache *c, struct nlmsghdr *m)
+{
+	__u32 h;
+	char name[GENL_NAMSIZ];
+	struct genlmsghdr *g;
+	struct nl_gen_family *f;
+	struct nlattr *nla, *a[CTRL_ATTR_MAX + 1];
+
+	if (!c || !m || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN))
+		goto inval;
+
+	g = NLMSG_DATA(m);
+	if (m->nlmsg_type != GENL_ID_CTRL ||
+	    (g->cmd != CTRL_CMD_NEWFAMILY && g->cmd != CTRL_CMD_DELFAMILY &&
+	     g->cmd != CTRL_CMD_NEWMCAST_GRP &&
+	     g->cmd != CTRL_CMD_DELMCAST_GRP))
+		return 0;
+
+	memset(a, 0, sizeof a);
+	nl_gen_get_attrv(m, a);
+	if (!a[CTRL_ATTR_FAMILY_NAME]) goto inval;
+	copy_name(name, a[CTRL_ATTR_FAMILY_NAME]);
+	f = find(c, name, (h = hash_name(name)));
+
+	switch (g->cmd) {
+	case CTRL_CMD_NEWFAMILY: return update(c, f, name, h, a);
+	case CTRL_CMD_DELFAMILY:
+		if (!f) break;
+		f->hash = SLOT_DELETED;
+		--c->count;
+		break;
+	default:
+		if (!f || !a[CTRL_ATTR_MCAST_GROUPS]) break;
+		nla_each(nla, a[CTRL_ATTR_MCAST_GROUPS]) {
+			if (g->cmd == CTRL_CMD_NEWMCAST_GRP) add_grp(f, nla);
+			else del_grp(f, nla);
+		}
+	}
+
+	return 0;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Fill a cache from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Cache
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_gen_cache_collect(struct nlmsghdr *m, void *arg)
+{
+	struct nl_gen_cache *c = arg;
+
+	if (!c) return 0;
+	if (m) return !!nl_gen_cache_apply(c, m);
+	memset(c->slots, 0, c->size * sizeof *c->slots);
+	c->count = 0;
+	return 0;
+}
+
+/**
+ * \brief Look up a family
+ * \param[in] c    Cache
+ * \param[in] name Family name
+ * \return The family, or NULL if not found (with \a errno set to ENOENT.)
+ */
+const struct nl_gen_family *nl_gen_cache_find(const struct nl_gen_cache *c,
+                                              const char *name)
+{
+	struct nl_gen_family *f = NULL;
+
+	if (c && name) f = find(c, name, hash_name(name));
+	if (!f) errno = ENOENT;
+	return f;
+}
+
+/**
+ * \brief Look up a multicast group
+ * \param[in] c      Cache
+ * \param[in] family Family name
+ * \param[in] group  Group name
+ * \return The group ID, or -1 if not found (with \a errno set to ENOENT.)
+ */
+long nl_gen_cache_group(const struct nl_gen_cache *c, const char *family,
+                        const char *group)
+{
+	__u8 i;
+	const struct nl_gen_family *f;
+
+	if (!(f = nl_gen_cache_find(c, family)) || !group) goto noent;
+	for (i = 0; i < f->ngrps; i++) {
+		if (!strncmp(f->grps[i].name, group, GENL_NAMSIZ))
+			return (long)f->grps[i].id;
+	}
+
+noent:
+	errno = ENOENT;
+	return -1;
+}
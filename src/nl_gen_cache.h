@@ -0,0 +1,147 @@
+/**
+ * \file nl_gen_cache.h
+ *
+ * nanonl: Netlink_Generic family cache
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_GEN_CACHE_H
+#define NL_GEN_CACHE_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+
+#include "nl_gen.h"
+
+/**
+ * \brief Maximum number of multicast groups cached per family
+ */
+#define NL_GEN_CACHE_GRPS 8
+
+/**
+ * \brief Multicast group
+ */
+struct nl_gen_grp {
+	char  name[GENL_NAMSIZ]; /**< Name */
+	__u32 id;                /**< ID (to join, with nl_multicast()) */
+};
+
+/**
+ * \brief Cached family
+ */
+struct nl_gen_family {
+	__u32 hash;              /**< Hash (0 = empty, 1 = deleted) */
+	__u16 id;                /**< Family ID */
+	__u8  version;           /**< Version */
+	__u8  ngrps;             /**< Number of multicast groups */
+	__u32 hdrsize;           /**< Length of the family's header */
+	__u32 maxattr;           /**< Highest attribute type */
+	__u8  ops[32];           /**< Supported commands (a bitmap) */
+	char  name[GENL_NAMSIZ]; /**< Name */
+	struct nl_gen_grp grps[NL_GEN_CACHE_GRPS]; /**< Multicast groups */
+};
+
+/**
+ * \brief Family cache
+ *
+ * An open-addressing (linear probing) hash table of families, keyed
+ * by name, in caller-supplied storage. It's filled by a single dump of
+ * every family, and kept current by the notifications sent to the
+ * "notify" group of the "nlctrl" family:
+ *
+ * \code{.c}
+ * struct nl_gen_family f[64];
+ * struct nl_gen_cache c;
+ *
+ * nl_gen_cache_init(&c, f, 64);
+ * nl_gen_cache_dump(req);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_gen_cache_collect, &c))
+ * 	goto err;
+ * grp = nl_gen_cache_group(&c, "nlctrl", "notify");
+ * if (grp < 0 || nl_multicast(ev_fd, NL_MULTICAST_JOIN, (int)grp, 0))
+ * 	goto err;
+ * \endcode
+ *
+ * Each message received on \a ev_fd is then passed to
+ * nl_gen_cache_apply().
+ */
+struct nl_gen_cache {
+	struct nl_gen_family *slots; /**< Slots */
+	__u32 size;                  /**< Number of slots (a power of 2) */
+	__u32 count;                 /**< Number of families */
+};
+
+/**
+ * \brief Check whether a family supports a command
+ * \param[in] f   Family
+ * \param[in] cmd Command
+ */
+#define nl_gen_family_has_op(f, cmd) \
+	(!!((f)->ops[(__u8)(cmd) >> 3] & (1 << ((cmd) & 7))))
+
+/**
+ * \brief Initialize a family cache
+ * \param[in] c     Cache
+ * \param[in] slots Slot storage
+ * \param[in] n     Number of slots (must be a power of 2)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_gen_cache_init(struct nl_gen_cache *c, struct nl_gen_family *slots,
+                      __u32 n);
+
+/**
+ * \brief Create a request to dump every family
+ * \param[in] m Netlink message buffer.
+ */
+void nl_gen_cache_dump(struct nlmsghdr *m);
+
+/**
+ * \brief Apply a nlctrl message to the cache
+ * \param[in] c Cache
+ * \param[in] m Netlink message buffer (dump reply or notification)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * CTRL_CMD_NEWFAMILY messages add or replace a family, and
+ * CTRL_CMD_DELFAMILY messages delete it. CTRL_CMD_NEWMCAST_GRP and
+ * CTRL_CMD_DELMCAST_GRP messages add or delete a multicast group.
+ * Other messages are ignored.
+ *
+ * Only the first NL_GEN_CACHE_GRPS multicast groups of a family are
+ * cached.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or ENOSPC if the cache is full.
+ */
+int nl_gen_cache_apply(struct nl_gen_cache *c, struct nlmsghdr *m);
+
+/**
+ * \brief Fill a cache from a dump (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg Cache
+ * \return 0 to continue, or non-zero on error (with \a errno set.)
+ */
+int nl_gen_cache_collect(struct nlmsghdr *m, void *arg);
+
+/**
+ * \brief Look up a family
+ * \param[in] c    Cache
+ * \param[in] name Family name
+ * \return The family, or NULL if not found (with \a errno set to ENOENT.)
+ */
+const struct nl_gen_family *nl_gen_cache_find(const struct nl_gen_cache *c,
+                                              const char *name);
+
+/**
+ * \brief Look up a multicast group
+ * \param[in] c      Cache
+ * \param[in] family Family name
+ * \param[in] group  Group name
+ * \return The group ID, or -1 if not found (with \a errno set to ENOENT.)
+ */
+long nl_gen_cache_group(const struct nl_gen_cache *c, const char *family,
+                        const char *group);
+
+#endif /* NL_GEN_CACHE_H */
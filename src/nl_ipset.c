@@ -0,0 +1,292 @@
+/**
+ * nanonl: Netlink ipset Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "nl.h"
+#include "nl_ipset.h"
+
+/* Length of an IPv6 entry, with a prefix length and timeout */
+#define ENTRY_MAXLEN (3 * NLA_HDRLEN + 16 + 2 * NLA_HDRLEN + 8)
+
+/**
+ * The kernel requires integers (and IPv4 addresses) to be flagged as
+ * being in network byte order.
+ */
+static void nla_add_net32(struct nlattr *nla, __u16 type, __u32 v)
+{
+	v = htonl(v);
+	nla_add_attr(nla, type | NLA_F_NET_BYTEORDER, &v, sizeof v);
+}
+
+/**
+ * Add the attributes of \a e to the data attribute \a data
+ */
+static void add_entry(struct nlattr *data, const struct nl_ipset_entry *e)
+{
+	struct nlattr *ip;
+
+	ip = nla_nest_start(data, IPSET_ATTR_IP);
+	if (e->family == NFPROTO_IPV6) {
+		nla_add_attr(ip, IPSET_ATTR_IPADDR_IPV6 | NLA_F_NET_BYTEORDER,
+		             e->addr, sizeof e->addr);
+	} else {
+		nla_add_attr(ip, IPSET_ATTR_IPADDR_IPV4 | NLA_F_NET_BYTEORDER,
+		             e->addr, sizeof *e->addr);
+	}
+
+	nla_nest_end(data, ip);
+	if (e->cidr)
+		nla_add_attr(data, IPSET_ATTR_CIDR, &e->cidr, sizeof e->cidr);
+	if (e->timeout)
+		nla_add_net32(data, IPSET_ATTR_TIMEOUT, e->timeout);
+}
+
+/**
+ * Flag an add / delete request with NLM_F_EXCL, unless \a flags has
+ * IPSET_FLAG_EXIST
+ *
+ * The kernel takes "exist" semantics from the absence of NLM_F_EXCL,
+ * and ignores IPSET_ATTR_FLAGS at the top level of these requests.
+ */
+static void excl(struct nlmsghdr *m, __u8 cmd, __u32 flags)
+{
+	if ((cmd == IPSET_CMD_ADD || cmd == IPSET_CMD_DEL) &&
+	    !(flags & IPSET_FLAG_EXIST))
+		m->nlmsg_flags |= NLM_F_EXCL;
+}
+
+/**
+ * \brief Make an ipset command message
+ * \param[in] m      Netlink message buffer.
+ * \param[in] cmd    Command (IPSET_CMD_*).
+ * \param[in] family Address family (NFPROTO_*).
+ * \param[in] name   Set name (or NULL, for commands acting on all sets.)
+ */
+void nl_ipset_cmd(struct nlmsghdr *m, __u8 cmd, __u8 family,
+                  const char *name)
+{
+	__u8 proto = IPSET_PROTOCOL;
+
+	if (!m) return;
+	nl_nf_request(m, 0, NFNL_SUBSYS_IPSET, cmd, family, 0);
+	nl_add_attr(m, IPSET_ATTR_PROTOCOL, &proto, sizeof proto);
+	if (name) nl_add_attr(m, IPSET_ATTR_SETNAME, name, strlen(name) + 1);
+}
+
+/**
+ * \brief Create a set
+ * \param[in] m        Netlink message buffer.
+ * \param[in] name     Set name.
+ * \param[in] type     Set type (i.e. "hash:ip")
+ * \param[in] revision Set type revision.
+ * \param[in] family   Address family (NFPROTO_IPV4 or NFPROTO_IPV6)
+ * \param[in] o        Creation options (or NULL)
+ */
+void nl_ipset_create(struct nlmsghdr *m, const char *name, const char *type,
+                     __u8 revision, __u8 family,
+                     const struct nl_ipset_opts *o)
+{
+	struct nlattr *data;
+
+	if (!m || !name || !type) return;
+	nl_ipset_cmd(m, IPSET_CMD_CREATE, family, name);
+	m->nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+	nl_add_attr(m, IPSET_ATTR_TYPENAME, type, strlen(type) + 1);
+	nl_add_attr(m, IPSET_ATTR_REVISION, &revision, sizeof revision);
+	nl_add_attr(m, IPSET_ATTR_FAMILY, &family, sizeof family);
+
+	data = nla_start(m, IPSET_ATTR_DATA);
+	if (o && o->timeout)
+		nla_add_net32(data, IPSET_ATTR_TIMEOUT, o->timeout);
+	if (o && o->hashsize)
+		nla_add_net32(data, IPSET_ATTR_HASHSIZE, o->hashsize);
+	if (o && o->maxelem)
+		nla_add_net32(data, IPSET_ATTR_MAXELEM, o->maxelem);
+	nla_end(m, data);
+}
+
+/**
+ * \brief Swap the contents of two sets
+ * \param[in] m     Netlink message buffer.
+ * \param[in] name  Set name.
+ * \param[in] name2 Name of the set to swap with.
+ *
+ * This swaps the sets atomically, so that a set may be rebuilt under
+ * a temporary name, and then swapped in at once. Both sets must be of
+ * the same type and family.
+ */
+void nl_ipset_swap(struct nlmsghdr *m, const char *name, const char *name2)
+{
+	if (!m || !name || !name2) return;
+	nl_ipset_cmd(m, IPSET_CMD_SWAP, NFPROTO_UNSPEC, name);
+	nl_add_attr(m, IPSET_ATTR_SETNAME2, name2, strlen(name2) + 1);
+}
+
+/**
+ * \brief List a set (or every set, if \a name is NULL.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Set name.
+ *
+ * The entries are returned (in IPSET_ATTR_ADT) by a dump, and may be
+ * decoded with nl_ipset_parse_entry().
+ */
+void nl_ipset_list(struct nlmsghdr *m, const char *name)
+{
+	if (!m) return;
+	nl_ipset_cmd(m, IPSET_CMD_LIST, NFPROTO_UNSPEC, name);
+	m->nlmsg_flags |= NLM_F_DUMP;
+}
+
+/**
+ * \brief Add, delete or test an entry
+ * \param[in] m     Netlink message buffer.
+ * \param[in] cmd   IPSET_CMD_ADD, IPSET_CMD_DEL or IPSET_CMD_TEST.
+ * \param[in] name  Set name.
+ * \param[in] e     Entry.
+ * \param[in] flags Flags (i.e. IPSET_FLAG_EXIST)
+ *
+ * With IPSET_FLAG_EXIST, adding an entry that's already in the set,
+ * or deleting one that isn't, isn't an error. Otherwise, the request
+ * is flagged with NLM_F_EXCL, and the kernel reports IPSET_ERR_EXIST.
+ *
+ * The kernel replies to IPSET_CMD_TEST with an ACK if the entry is in
+ * the set, or with the error IPSET_ERR_EXIST otherwise.
+ */
+void nl_ipset_entry(struct nlmsghdr *m, __u8 cmd, const char *name,
+                    const struct nl_ipset_entry *e, __u32 flags)
+{
+	struct nlattr *data;
+
+	if (!m || !name || !e) return;
+	nl_ipset_cmd(m, cmd, e->family, name);
+	excl(m, cmd, flags);
+	data = nla_start(m, IPSET_ATTR_DATA);
+	add_entry(data, e);
+	nla_end(m, data);
+}
+
+/**
+ * \brief Begin adding or deleting entries in bulk
+ * \param[in] m      Netlink message buffer.
+ * \param[in] cmd    IPSET_CMD_ADD or IPSET_CMD_DEL.
+ * \param[in] family Address family (NFPROTO_IPV4 or NFPROTO_IPV6)
+ * \param[in] name   Set name.
+ * \param[in] flags  Flags (i.e. IPSET_FLAG_EXIST)
+ * \return The entry list, to pass to nl_ipset_adt_add() and
+ *         nl_ipset_adt_end(), or NULL on error.
+ *
+ * With IPSET_FLAG_EXIST, adding entries that are already in the set,
+ * or deleting entries that aren't, isn't an error. Otherwise, the
+ * request is flagged with NLM_F_EXCL, and the kernel stops at the
+ * first entry that fails, and reports the error, leaving the entries
+ * before it in place.
+ */
+struct nlattr *nl_ipset_adt_begin(struct nlmsghdr *m, __u8 cmd, __u8 family,
+                                  const char *name, __u32 flags)
+{
+	if (!m || !name) return NULL;
+	nl_ipset_cmd(m, cmd, family, name);
+	excl(m, cmd, flags);
+	return nla_start(m, IPSET_ATTR_ADT);
+}
+
+/**
+ * \brief Add an entry to a bulk add / delete message
+ * \param[in] m    Netlink message buffer.
+ * \param[in] adt  Entry list (from nl_ipset_adt_begin())
+ * \param[in] e    Entry.
+ * \param[in] size Size of the buffer holding \a m (in bytes.)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if the entry doesn't fit in \a size bytes, or in
+ * the entry list.
+ */
+int nl_ipset_adt_add(struct nlmsghdr *m, struct nlattr *adt,
+                     const struct nl_ipset_entry *e, size_t size)
+{
+	struct nlattr *data;
+
+	if (!m || !adt || !e) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((size_t)adt->nla_len + ENTRY_MAXLEN > 0xffff ||
+	    (size_t)m->nlmsg_len + adt->nla_len + ENTRY_MAXLEN > size) {
+		errno = E2BIG;
+		return -1;
+	}
+
+	data = nla_nest_start(adt, IPSET_ATTR_DATA);
+	add_entry(data, e);
+	nla_nest_end(adt, data);
+	return 0;
+}
+
+/**
+ * Decode an address (IPSET_ATTR_IP)
+ */
+static void parse_ip(struct nlattr *ip, struct nl_ipset_entry *e)
+{
+	size_t len;
+	struct nlattr *nla;
+
+	nla_each(nla, ip) {
+		len = (size_t)(nla->nla_len - NLA_HDRLEN);
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case IPSET_ATTR_IPADDR_IPV4:
+			if (len < sizeof *e->addr) break;
+			memcpy(e->addr, NLA_DATA(nla), sizeof *e->addr);
+			e->family = NFPROTO_IPV4;
+			break;
+		case IPSET_ATTR_IPADDR_IPV6:
+			if (len < sizeof e->addr) break;
+			memcpy(e->addr, NLA_DATA(nla), sizeof e->addr);
+			e->family = NFPROTO_IPV6;
+			break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * \brief Decode an entry
+ * \param[in]  data Entry (IPSET_ATTR_DATA)
+ * \param[out] e    Decoded entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ipset_parse_entry(struct nlattr *data, struct nl_ipset_entry *e)
+{
+	struct nlattr *nla;
+
+	if (!data || !e || !(data->nla_type & NLA_F_NESTED)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(e, 0, sizeof *e);
+	nla_each(nla, data) {
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case IPSET_ATTR_IP: parse_ip(nla, e); break;
+		case IPSET_ATTR_CIDR:
+			if (nla->nla_len > NLA_HDRLEN)
+				e->cidr = *(__u8 *)NLA_DATA(nla);
+			break;
+		case IPSET_ATTR_TIMEOUT: e->timeout = nla_u32_be(nla); break;
+		default: break;
+		}
+	}
+
+	if (e->family) return 0;
+	errno = EINVAL;
+	return -1;
+}
@@ -0,0 +1,172 @@
+/**
+ * \file nl_ipset.h
+ *
+ * nanonl: Netlink ipset functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_IPSET_H
+#define NL_IPSET_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/ip_set.h>
+
+#include "nl_nf.h"
+
+/**
+ * \brief Set entry (i.e. for a hash:ip or hash:net set)
+ *
+ * The address is in network byte order, everything else is in host
+ * byte order.
+ */
+struct nl_ipset_entry {
+	__u32 addr[4]; /**< Address (IPv4 uses only the first word) */
+	__u32 timeout; /**< Timeout (in seconds, 0 = the set's default) */
+	__u8 family;   /**< Address family (NFPROTO_IPV4 or NFPROTO_IPV6) */
+	__u8 cidr;     /**< Prefix length (0 = the whole address) */
+};
+
+/**
+ * \brief Set creation options
+ *
+ * Options left as zero aren't sent, and keep the kernel's defaults.
+ */
+struct nl_ipset_opts {
+	__u32 timeout;  /**< Default timeout (in seconds, 0 = no timeouts) */
+	__u32 hashsize; /**< Initial hash size */
+	__u32 maxelem;  /**< Maximum number of entries */
+};
+
+/**
+ * \brief Make an ipset command message
+ * \param[in] m      Netlink message buffer.
+ * \param[in] cmd    Command (IPSET_CMD_*).
+ * \param[in] family Address family (NFPROTO_*).
+ * \param[in] name   Set name (or NULL, for commands acting on all sets.)
+ */
+void nl_ipset_cmd(struct nlmsghdr *m, __u8 cmd, __u8 family,
+                  const char *name);
+
+/**
+ * \brief Destroy a set (or every set, if \a name is NULL.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Set name.
+ */
+#define nl_ipset_destroy(m, name) \
+	nl_ipset_cmd((m), IPSET_CMD_DESTROY, NFPROTO_UNSPEC, (name))
+
+/**
+ * \brief Remove every entry from a set (or every set, if \a name is NULL.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Set name.
+ */
+#define nl_ipset_flush(m, name) \
+	nl_ipset_cmd((m), IPSET_CMD_FLUSH, NFPROTO_UNSPEC, (name))
+
+/**
+ * \brief Create a set
+ * \param[in] m        Netlink message buffer.
+ * \param[in] name     Set name.
+ * \param[in] type     Set type (i.e. "hash:ip")
+ * \param[in] revision Set type revision.
+ * \param[in] family   Address family (NFPROTO_IPV4 or NFPROTO_IPV6)
+ * \param[in] o        Creation options (or NULL)
+ */
+void nl_ipset_create(struct nlmsghdr *m, const char *name, const char *type,
+                     __u8 revision, __u8 family,
+                     const struct nl_ipset_opts *o);
+
+/**
+ * \brief Swap the contents of two sets
+ * \param[in] m     Netlink message buffer.
+ * \param[in] name  Set name.
+ * \param[in] name2 Name of the set to swap with.
+ *
+ * This swaps the sets atomically, so that a set may be rebuilt under
+ * a temporary name, and then swapped in at once. Both sets must be of
+ * the same type and family.
+ */
+void nl_ipset_swap(struct nlmsghdr *m, const char *name, const char *name2);
+
+/**
+ * \brief List a set (or every set, if \a name is NULL.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Set name.
+ *
+ * The entries are returned (in IPSET_ATTR_ADT) by a dump, and may be
+ * decoded with nl_ipset_parse_entry().
+ */
+void nl_ipset_list(struct nlmsghdr *m, const char *name);
+
+/**
+ * \brief Add, delete or test an entry
+ * \param[in] m     Netlink message buffer.
+ * \param[in] cmd   IPSET_CMD_ADD, IPSET_CMD_DEL or IPSET_CMD_TEST.
+ * \param[in] name  Set name.
+ * \param[in] e     Entry.
+ * \param[in] flags Flags (i.e. IPSET_FLAG_EXIST)
+ *
+ * With IPSET_FLAG_EXIST, adding an entry that's already in the set,
+ * or deleting one that isn't, isn't an error. Otherwise, the request
+ * is flagged with NLM_F_EXCL, and the kernel reports IPSET_ERR_EXIST.
+ *
+ * The kernel replies to IPSET_CMD_TEST with an ACK if the entry is in
+ * the set, or with the error IPSET_ERR_EXIST otherwise.
+ */
+void nl_ipset_entry(struct nlmsghdr *m, __u8 cmd, const char *name,
+                    const struct nl_ipset_entry *e, __u32 flags);
+
+/**
+ * \brief Begin adding or deleting entries in bulk
+ * \param[in] m      Netlink message buffer.
+ * \param[in] cmd    IPSET_CMD_ADD or IPSET_CMD_DEL.
+ * \param[in] family Address family (NFPROTO_IPV4 or NFPROTO_IPV6)
+ * \param[in] name   Set name.
+ * \param[in] flags  Flags (i.e. IPSET_FLAG_EXIST)
+ * \return The entry list, to pass to nl_ipset_adt_add() and
+ *         nl_ipset_adt_end(), or NULL on error.
+ *
+ * With IPSET_FLAG_EXIST, adding entries that are already in the set,
+ * or deleting entries that aren't, isn't an error. Otherwise, the
+ * request is flagged with NLM_F_EXCL, and the kernel stops at the
+ * first entry that fails, and reports the error, leaving the entries
+ * before it in place.
+ */
+struct nlattr *nl_ipset_adt_begin(struct nlmsghdr *m, __u8 cmd, __u8 family,
+                                  const char *name, __u32 flags);
+
+/**
+ * \brief Add an entry to a bulk add / delete message
+ * \param[in] m    Netlink message buffer.
+ * \param[in] adt  Entry list (from nl_ipset_adt_begin())
+ * \param[in] e    Entry.
+ * \param[in] size Size of the buffer holding \a m (in bytes.)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if the entry doesn't fit in \a size bytes, or in
+ * the entry list.
+ */
+int nl_ipset_adt_add(struct nlmsghdr *m, struct nlattr *adt,
+                     const struct nl_ipset_entry *e, size_t size);
+
+/**
+ * \brief Finish a bulk add / delete message
+ * \param[in] m   Netlink message buffer.
+ * \param[in] adt Entry list (from nl_ipset_adt_begin())
+ */
+#define nl_ipset_adt_end(m, adt) nla_end((m), (adt))
+
+/**
+ * \brief Decode an entry
+ * \param[in]  data Entry (IPSET_ATTR_DATA)
+ * \param[out] e    Decoded entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_ipset_parse_entry(struct nlattr *data, struct nl_ipset_entry *e);
+
+#endif /* NL_IPSET_H */
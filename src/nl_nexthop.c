@@ -0,0 +1,252 @@
+/**
+ * nanonl: Netlink Nexthop Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include "nl.h"
+#include "nl_nexthop.h"
+
+/**
+ * Add a __u16 attribute with its exact length
+ *
+ * Nexthop requests are validated strictly, and nl_add_attr() includes
+ * the padding in the length.
+ */
+static void add_u16(struct nlmsghdr *m, __u16 type, __u16 v)
+{
+	struct nlattr *nla = BYTE_OFF(m, NLMSG_ALIGN(m->nlmsg_len));
+
+	nl_add_attr(m, type, &v, sizeof v);
+	nla->nla_len = NLA_HDRLEN + sizeof v;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+/**
+ * Add a nested __u16 attribute with its exact length
+ */
+static void nest_u16(struct nlattr *nest, __u16 type, __u16 v)
+{
+	struct nlattr *nla = BYTE_OFF(nest, nest->nla_len);
+
+	nla_add_attr(nest, type, &v, sizeof v);
+	nla->nla_len = NLA_HDRLEN + sizeof v;
+}
+#endif
+
+/**
+ * Make a request for the nexthop \a id
+ */
+static void by_id(struct nlmsghdr *m, __u8 type, __u32 id)
+{
+	nl_nh_request(m, 0, type, AF_UNSPEC, 0, 0);
+	nl_add_attr(m, NHA_ID, &id, sizeof id);
+}
+
+/**
+ * \brief Create a netlink nexthop request
+ * \param[in] m        Netlink message buffer
+ * \param[in] pid      Destination netlink port
+ * \param[in] type     One of: RTM_GETNEXTHOP, RTM_NEWNEXTHOP,
+ *                     RTM_DELNEXTHOP
+ * \param[in] family   Address family (AF_INET[6], or AF_UNSPEC)
+ * \param[in] protocol Protocol (RTPROT_*)
+ * \param[in] flags    Flags (RTNH_F_*)
+ * \relates nl_request
+ *
+ * RTM_NEWNEXTHOP requests are flagged with NLM_F_CREATE.
+ */
+void nl_nh_request(struct nlmsghdr *m, __u32 pid, __u8 type, __u8 family,
+                   __u8 protocol, unsigned int flags)
+{
+	struct nhmsg *nhm = BYTE_OFF(m, sizeof *m);
+	if (!m) return;
+	nl_request(m, type, pid, sizeof *nhm);
+	nhm->nh_family   = family;
+	nhm->nh_scope    = 0;
+	nhm->nh_protocol = protocol;
+	nhm->resvd       = 0;
+	nhm->nh_flags    = flags;
+	if (type == RTM_NEWNEXTHOP) m->nlmsg_flags |= NLM_F_CREATE;
+}
+
+/**
+ * \brief Get a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] id Nexthop ID
+ */
+void nl_nh_get(struct nlmsghdr *m, __u32 id)
+{
+	if (!m) return;
+	by_id(m, RTM_GETNEXTHOP, id);
+}
+
+/**
+ * \brief Delete a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] id Nexthop ID
+ *
+ * Routes using the nexthop are deleted along with it, and it's
+ * removed from any group it's a member of.
+ */
+void nl_nh_del(struct nlmsghdr *m, __u32 id)
+{
+	if (!m) return;
+	by_id(m, RTM_DELNEXTHOP, id);
+}
+
+/**
+ * \brief Dump nexthops
+ * \param[in] m       Netlink message buffer
+ * \param[in] family  Address family (or AF_UNSPEC for all)
+ * \param[in] ifindex Only nexthops using this interface (or 0)
+ * \param[in] master  Only nexthops whose interface has this master
+ *                    (or 0)
+ * \param[in] groups  Non-zero to only dump groups
+ */
+void nl_nh_dump(struct nlmsghdr *m, __u8 family, __u32 ifindex,
+                __u32 master, int groups)
+{
+	if (!m) return;
+	nl_nh_request(m, 0, RTM_GETNEXTHOP, family, 0, 0);
+	m->nlmsg_flags |= NLM_F_DUMP;
+	if (ifindex) nl_add_attr(m, NHA_OIF, &ifindex, sizeof ifindex);
+	if (master) nl_add_attr(m, NHA_MASTER, &master, sizeof master);
+	if (groups) nl_add_attr(m, NHA_GROUPS, NULL, 0);
+}
+
+/**
+ * \brief Create a request to add (or replace) a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] nh Nexthop
+ *
+ * If \a nh->id is set, the request is flagged with NLM_F_REPLACE, so
+ * that an existing nexthop with the same ID is replaced. (The kernel
+ * refuses to replace a nexthop without its ID.) Replacing a group (or a
+ * member of it) moves every route using it at once, without touching
+ * the routes.
+ */
+void nl_nh_new(struct nlmsghdr *m, const struct nl_nh *nh)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+	struct nlattr *res;
+#endif
+
+	if (!m || !nh) return;
+	nl_nh_request(m, 0, RTM_NEWNEXTHOP,
+	              nh->ngrp ? AF_UNSPEC : nh->family, nh->protocol,
+	              nh->ngrp ? 0 : nh->flags);
+	if (nh->id) {
+		m->nlmsg_flags |= NLM_F_REPLACE;
+		nl_add_attr(m, NHA_ID, &nh->id, sizeof nh->id);
+	}
+
+	if (nh->ngrp && nh->grp) {
+		nl_add_attr(m, NHA_GROUP, nh->grp,
+		            (size_t)nh->ngrp * sizeof *nh->grp);
+		if (nh->grp_type)
+			add_u16(m, NHA_GROUP_TYPE, nh->grp_type);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+		if (nh->grp_type != NEXTHOP_GRP_TYPE_RES) return;
+		res = nla_start(m, NHA_RES_GROUP);
+		if (nh->buckets)
+			nest_u16(res, NHA_RES_GROUP_BUCKETS, nh->buckets);
+
+		if (nh->idle_timer) {
+			nla_add_attr(res, NHA_RES_GROUP_IDLE_TIMER,
+			             &nh->idle_timer, sizeof nh->idle_timer);
+		}
+
+		if (nh->unbalanced_timer) {
+			nla_add_attr(res, NHA_RES_GROUP_UNBALANCED_TIMER,
+			             &nh->unbalanced_timer,
+			             sizeof nh->unbalanced_timer);
+		}
+
+		nla_end(m, res);
+#endif
+		return;
+	}
+
+	if (nh->blackhole) {
+		nl_add_attr(m, NHA_BLACKHOLE, NULL, 0);
+		return;
+	}
+
+	if (nh->ifindex)
+		nl_add_attr(m, NHA_OIF, &nh->ifindex, sizeof nh->ifindex);
+	if (nh->gw[0] || nh->gw[1] || nh->gw[2] || nh->gw[3]) {
+		nl_add_attr(m, NHA_GATEWAY, nh->gw,
+		            nh->family == AF_INET6 ? 16 : 4);
+	}
+}
+
+/**
+ * \brief Decode a nexthop
+ * \param[in]  m  Netlink message buffer (RTM_NEWNEXTHOP / RTM_DELNEXTHOP)
+ * \param[out] nh Nexthop
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The group members aren't copied: \a nh->grp points into \a m.
+ */
+int nl_nh_parse(struct nlmsghdr *m, struct nl_nh *nh)
+{
+	size_t len;
+	struct nhmsg *nhm;
+	struct nlattr *a[NHA_MAX + 1];
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+	struct nlattr *r[NHA_RES_GROUP_MAX + 1];
+#endif
+
+	if (!m || !nh || !NLMSG_OK(m, m->nlmsg_len) ||
+	    (m->nlmsg_type != RTM_NEWNEXTHOP &&
+	     m->nlmsg_type != RTM_DELNEXTHOP) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *nhm))
+		goto inval;
+
+	nhm = NLMSG_DATA(m);
+	memset(nh, 0, sizeof *nh);
+	memset(a, 0, sizeof a);
+	nl_nh_get_attrv(m, a);
+	nh->family    = nhm->nh_family;
+	nh->protocol  = nhm->nh_protocol;
+	nh->flags     = nhm->nh_flags;
+	nh->id        = nla_u32(a[NHA_ID]);
+	nh->ifindex   = nla_u32(a[NHA_OIF]);
+	nh->grp_type  = nla_u16(a[NHA_GROUP_TYPE]);
+	nh->blackhole = !!a[NHA_BLACKHOLE];
+
+	len = nh->family == AF_INET6 ? 16 : 4;
+	if (a[NHA_GATEWAY] && a[NHA_GATEWAY]->nla_len >= NLA_HDRLEN + len)
+		memcpy(nh->gw, NLA_DATA(a[NHA_GATEWAY]), len);
+
+	if (a[NHA_GROUP]) {
+		len = (size_t)(a[NHA_GROUP]->nla_len - NLA_HDRLEN);
+		nh->grp  = NLA_DATA(a[NHA_GROUP]);
+		nh->ngrp = (__u16)(len / sizeof *nh->grp);
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+	if (a[NHA_RES_GROUP]) {
+		memset(r, 0, sizeof r);
+		nla_get_attrv(a[NHA_RES_GROUP], r, NHA_RES_GROUP_MAX);
+		nh->buckets          = nla_u16(r[NHA_RES_GROUP_BUCKETS]);
+		nh->idle_timer       = nla_u32(r[NHA_RES_GROUP_IDLE_TIMER]);
+		nh->unbalanced_timer =
+			nla_u32(r[NHA_RES_GROUP_UNBALANCED_TIMER]);
+	}
+#endif
+
+	return 0;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
@@ -0,0 +1,151 @@
+/**
+ * \file nl_nexthop.h
+ *
+ * nanonl: Netlink Nexthop functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NEXTHOP_H
+#define NL_NEXTHOP_H
+
+#include <sys/types.h>
+#include <linux/version.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/nexthop.h>
+
+#include "nl.h"
+
+/**
+ * \brief Nexthop object
+ *
+ * A nexthop is either a group (with \a ngrp members), a blackhole,
+ * or a gateway and / or output interface. Groups have no address
+ * family (AF_UNSPEC.) Addresses are in network byte order, everything
+ * else is in host byte order.
+ *
+ * As with the kernel, the weight of a group member is one less than
+ * \a nexthop_grp.weight. The resilient group settings only apply to
+ * groups of type NEXTHOP_GRP_TYPE_RES, and are left to the kernel's
+ * defaults if zero. Their timers are in clock ticks (1 / USER_HZ s.)
+ */
+struct nl_nh {
+	__u32 id;                      /**< ID (0 = assigned by the kernel) */
+	__u32 gw[4];                   /**< Gateway (all zero = none) */
+	__u32 ifindex;                 /**< Output interface (0 = none) */
+	__u32 flags;                   /**< Flags (RTNH_F_*) */
+	const struct nexthop_grp *grp; /**< Group members */
+	__u16 ngrp;                    /**< Number of group members */
+	__u16 grp_type;                /**< Group type (NEXTHOP_GRP_TYPE_*) */
+	__u16 buckets;                 /**< Resilient: number of buckets */
+	__u32 idle_timer;              /**< Resilient: idle timer */
+	__u32 unbalanced_timer;        /**< Resilient: unbalanced timer */
+	__u8 family;                   /**< Address family (AF_INET[6]) */
+	__u8 protocol;                 /**< Protocol (RTPROT_*) */
+	__u8 blackhole;                /**< Non-zero for a blackhole */
+};
+
+/**
+ * \def nl_nh_get_attr(m, t)
+ * \param m Netlink message buffer
+ * \param t NHA attribute type
+ *
+ * Convenience wrapper around nl_get_attr().
+ */
+#define nl_nh_get_attr(m, t) \
+	nl_get_attr((m), sizeof(struct nhmsg), (t))
+
+/**
+ * \def nl_nh_get_attrv(m, a)
+ * \param m Netlink message buffer
+ * \param a Array of \a struct nlattr *
+ *
+ * Convenience wrapper around nl_get_attrv().
+ */
+#define nl_nh_get_attrv(m, a)\
+	nl_get_attrv((m), sizeof(struct nhmsg), (a), \
+	             ((sizeof((a)) / sizeof(struct nlattr *)) - 1))
+
+/**
+ * \brief Create a netlink nexthop request
+ * \param[in] m        Netlink message buffer
+ * \param[in] pid      Destination netlink port
+ * \param[in] type     One of: RTM_GETNEXTHOP, RTM_NEWNEXTHOP,
+ *                     RTM_DELNEXTHOP
+ * \param[in] family   Address family (AF_INET[6], or AF_UNSPEC)
+ * \param[in] protocol Protocol (RTPROT_*)
+ * \param[in] flags    Flags (RTNH_F_*)
+ * \relates nl_request
+ *
+ * RTM_NEWNEXTHOP requests are flagged with NLM_F_CREATE.
+ */
+void nl_nh_request(struct nlmsghdr *m, __u32 pid, __u8 type, __u8 family,
+                   __u8 protocol, unsigned int flags);
+
+/**
+ * \brief Get a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] id Nexthop ID
+ */
+void nl_nh_get(struct nlmsghdr *m, __u32 id);
+
+/**
+ * \brief Delete a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] id Nexthop ID
+ *
+ * Routes using the nexthop are deleted along with it, and it's
+ * removed from any group it's a member of.
+ */
+void nl_nh_del(struct nlmsghdr *m, __u32 id);
+
+/**
+ * \brief Dump nexthops
+ * \param[in] m       Netlink message buffer
+ * \param[in] family  Address family (or AF_UNSPEC for all)
+ * \param[in] ifindex Only nexthops using this interface (or 0)
+ * \param[in] master  Only nexthops whose interface has this master
+ *                    (or 0)
+ * \param[in] groups  Non-zero to only dump groups
+ */
+void nl_nh_dump(struct nlmsghdr *m, __u8 family, __u32 ifindex,
+                __u32 master, int groups);
+
+/**
+ * \brief Create a request to add (or replace) a nexthop
+ * \param[in] m  Netlink message buffer
+ * \param[in] nh Nexthop
+ *
+ * If \a nh->id is set, the request is flagged with NLM_F_REPLACE, so
+ * that an existing nexthop with the same ID is replaced. (The kernel
+ * refuses to replace a nexthop without its ID.) Replacing a group (or a
+ * member of it) moves every route using it at once, without touching
+ * the routes. For instance, if nexthop 2 goes down, this leaves group
+ * 100 with only nexthop 1:
+ *
+ * \code{.c}
+ * struct nexthop_grp g[2] = { { 1, 0, 0, 0 }, { 2, 0, 0, 0 } };
+ * struct nl_nh nh;
+ *
+ * memset(&nh, 0, sizeof nh);
+ * nh.id   = 100;
+ * nh.grp  = g;
+ * nh.ngrp = 1;
+ * nl_nh_new(req, &nh);
+ * \endcode
+ */
+void nl_nh_new(struct nlmsghdr *m, const struct nl_nh *nh);
+
+/**
+ * \brief Decode a nexthop
+ * \param[in]  m  Netlink message buffer (RTM_NEWNEXTHOP / RTM_DELNEXTHOP)
+ * \param[out] nh Nexthop
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The group members aren't copied: \a nh->grp points into \a m.
+ */
+int nl_nh_parse(struct nlmsghdr *m, struct nl_nh *nh);
+
+#endif /* NL_NEXTHOP_H */
@@ -11,6 +11,7 @@
 #define NL_NF_H
 
 #include <sys/types.h>
+#include <linux/version.h>
 #include <linux/netlink.h>
 #include <linux/netfilter/nfnetlink.h>
 
@@ -50,5 +51,84 @@
 void nl_nf_request(struct nlmsghdr *m, __u32 pid, __u8 subsys, __u8 type,
                     __u8 family, __u16 res_id);
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0)
+/**
+ * \brief Returned by nl_nf_batch_ack() for an error affecting the whole
+ *        batch
+ */
+#define NL_NF_BATCH_ALL (-2)
+
+/**
+ * \brief Get the buffer for the next message in a nfnetlink batch
+ * \param[in] b   Batch
+ * \param[in] len Maximum length of the message (in bytes)
+ * \return Buffer for the message, or NULL if the message wouldn't leave
+ *         room for the NFNL_MSG_BATCH_END message.
+ */
+#define nl_nf_batch_next(b, len) \
+	nl_batch_next((b), (len) + NLMSG_SPACE(sizeof(struct nfgenmsg)))
+
+/**
+ * \brief Begin a nfnetlink batch
+ * \param[in] b      Batch (empty)
+ * \param[in] subsys Netfilter subsystem (i.e. NFNL_SUBSYS_NFTABLES)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * Subsystems such as nf_tables only accept changes as part of a batch,
+ * which the kernel applies atomically: either every message in it
+ * succeeds, or none of them do. The batch is delimited by
+ * NFNL_MSG_BATCH_BEGIN and NFNL_MSG_BATCH_END messages:
+ *
+ * \code{.c}
+ * nl_batch_init(&b, buf, sizeof buf, seq);
+ * nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES);
+ * while (n && (m = nl_nf_batch_next(&b, NLMSG_GOODSIZE >> 4))) {
+ * 	build_request(m, &rules[--n]);
+ * 	nl_batch_add(&b);
+ * }
+ *
+ * nl_nf_batch_end(&b);
+ * nl_batch_send(fd, 0, &b);
+ * \endcode
+ *
+ * The kernel sends an ACK or error for each message between the two.
+ * Use nl_nf_batch_ack() to match these to the messages.
+ *
+ * This function will set \a errno to EINVAL if the batch isn't empty,
+ * or E2BIG if there isn't room for the message.
+ */
+int nl_nf_batch_begin(struct nl_batch *b, __u16 subsys);
+
+/**
+ * \brief End a nfnetlink batch
+ * \param[in] b Batch
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * This function will set \a errno to EINVAL if the batch wasn't begun
+ * with nl_nf_batch_begin(), or E2BIG if there isn't room for the
+ * message.
+ */
+int nl_nf_batch_end(struct nl_batch *b);
+
+/**
+ * \brief Match a reply to a message in a nfnetlink batch
+ * \param[in]  b   Batch
+ * \param[in]  m   Received message
+ * \param[out] err The error (0 for an ACK, or a negative \a errno value)
+ * \return The index of the message (0 being the first message after
+ *         NFNL_MSG_BATCH_BEGIN), NL_NF_BATCH_ALL if \a m is an error
+ *         for the whole batch, or -1 if \a m isn't an ACK / error for
+ *         a message in the batch.
+ *
+ * Errors for the whole batch (i.e. -EOPNOTSUPP for a subsystem the
+ * kernel doesn't support, or -ERESTART if the ruleset changed while
+ * the batch was being applied) are reported against the
+ * NFNL_MSG_BATCH_BEGIN or NFNL_MSG_BATCH_END message. None of the
+ * messages in the batch were applied, and no other replies follow.
+ */
+long nl_nf_batch_ack(const struct nl_batch *b, const struct nlmsghdr *m,
+                     int *err);
+#endif /* Linux >= 3.13.0 */
+
 #endif /* NL_NF_H */
 
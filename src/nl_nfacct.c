@@ -0,0 +1,146 @@
+/**
+ * nanonl: Netlink Netfilter Accounting Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "nl.h"
+#include "nl_nfacct.h"
+
+/**
+ * Make a request for the object \a name
+ */
+static void acct_cmd(struct nlmsghdr *m, __u8 type, const char *name)
+{
+	nl_nfacct_request(m, 0, type);
+	if (name) nl_add_attr(m, NFACCT_NAME, name, strlen(name) + 1);
+}
+
+/**
+ * \brief Create an accounting object
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Object name.
+ */
+void nl_nfacct_create(struct nlmsghdr *m, const char *name)
+{
+	if (!m || !name) return;
+	acct_cmd(m, NFNL_MSG_ACCT_NEW, name);
+	m->nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+}
+
+/**
+ * \brief Get an accounting object
+ * \param[in] m       Netlink message buffer.
+ * \param[in] name    Object name.
+ * \param[in] ctrzero If non-zero, zero the counters
+ */
+void nl_nfacct_get(struct nlmsghdr *m, const char *name, int ctrzero)
+{
+	if (!m || !name) return;
+	acct_cmd(m, ctrzero ? NFNL_MSG_ACCT_GET_CTRZERO : NFNL_MSG_ACCT_GET,
+	         name);
+}
+
+/**
+ * \brief Request a dump of all accounting objects
+ * \param[in] m       Netlink message buffer.
+ * \param[in] ctrzero If non-zero, zero the counters
+ *
+ * With \a ctrzero set, the counters are read and zeroed atomically, so
+ * that polling them yields the traffic since the previous poll.
+ */
+void nl_nfacct_dump(struct nlmsghdr *m, int ctrzero)
+{
+	if (!m) return;
+	acct_cmd(m, ctrzero ? NFNL_MSG_ACCT_GET_CTRZERO : NFNL_MSG_ACCT_GET,
+	         NULL);
+	m->nlmsg_flags |= NLM_F_DUMP;
+}
+
+/**
+ * \brief Delete an accounting object (or all unused objects.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Object name (or NULL.)
+ */
+void nl_nfacct_delete(struct nlmsghdr *m, const char *name)
+{
+	if (!m) return;
+	acct_cmd(m, NFNL_MSG_ACCT_DEL, name);
+}
+
+/**
+ * \brief Decode an accounting object
+ * \param[in]  m Netlink message buffer.
+ * \param[out] a Decoded object.
+ * \return 0 on success, non-zero on error (with \a errno set to EINVAL.)
+ */
+int nl_nfacct_parse(struct nlmsghdr *m, struct nl_nfacct *a)
+{
+	size_t len;
+	struct nlattr *nla;
+
+	if (!m || !a || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_type != (NFNL_SUBSYS_ACCT << 8 | NFNL_MSG_ACCT_NEW) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof(struct nfgenmsg)))
+		goto inval;
+
+	memset(a, 0, sizeof *a);
+	nla = BYTE_OFF(NLMSG_DATA(m), NLMSG_ALIGN(sizeof(struct nfgenmsg)));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+		len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case NFACCT_NAME:
+			if (len > sizeof a->name - 1) len = sizeof a->name - 1;
+			memcpy(a->name, NLA_DATA(nla), len);
+			break;
+		case NFACCT_PKTS:  a->pkts  = nla_u64_be(nla); break;
+		case NFACCT_BYTES: a->bytes = nla_u64_be(nla); break;
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	if (*a->name) return 0;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Collect dumped accounting objects (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg List to collect the objects into (nl_nfacct_list.)
+ * \return 0
+ *
+ * This decodes every object dumped by nl_nfacct_dump() into a single
+ * array, with one system call per datagram:
+ *
+ * \code{.c}
+ * struct nl_nfacct a[1024];
+ * struct nl_nfacct_list l = { a, 1024, 0 };
+ *
+ * nl_nfacct_dump(req, 1);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_nfacct_collect, &l) < 0)
+ * 	goto err;
+ * \endcode
+ */
+int nl_nfacct_collect(struct nlmsghdr *m, void *arg)
+{
+	struct nl_nfacct_list *l = arg;
+
+	if (!l) return 0;
+	if (!m) l->count = 0;
+	else if (l->count >= l->n) ++l->count;
+	else if (!nl_nfacct_parse(m, l->a + l->count)) ++l->count;
+	return 0;
+}
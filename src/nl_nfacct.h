@@ -0,0 +1,112 @@
+/**
+ * \file nl_nfacct.h
+ *
+ * nanonl: Netlink Netfilter accounting functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NFACCT_H
+#define NL_NFACCT_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink_acct.h>
+
+#include "nl_nf.h"
+
+/**
+ * \brief Accounting object
+ */
+struct nl_nfacct {
+	char  name[NFACCT_NAME_MAX]; /**< Name */
+	__u64 pkts;                  /**< Packet count */
+	__u64 bytes;                 /**< Byte count */
+};
+
+/**
+ * \brief Accounting objects collected from a dump
+ *
+ * The first \a n objects dumped are stored in \a a. \a count is the
+ * number of objects dumped, which may be more than \a n, if \a a was
+ * too small to hold them all.
+ */
+struct nl_nfacct_list {
+	struct nl_nfacct *a; /**< Array of \a n objects */
+	size_t n;            /**< Size of \a a */
+	size_t count;        /**< Number of objects dumped */
+};
+
+/**
+ * \brief Create a netlink_acct request.
+ * \param[in] m    Netlink message buffer.
+ * \param[in] pid  Destination netlink port.
+ * \param[in] type message type (NFNL_MSG_ACCT_*).
+ * \relates nl_request
+ */
+#define nl_nfacct_request(m, pid, type) \
+	nl_nf_request((m), (pid), NFNL_SUBSYS_ACCT, (type), NFPROTO_UNSPEC, 0)
+
+/**
+ * \brief Create an accounting object
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Object name.
+ */
+void nl_nfacct_create(struct nlmsghdr *m, const char *name);
+
+/**
+ * \brief Get an accounting object
+ * \param[in] m       Netlink message buffer.
+ * \param[in] name    Object name.
+ * \param[in] ctrzero If non-zero, zero the counters
+ */
+void nl_nfacct_get(struct nlmsghdr *m, const char *name, int ctrzero);
+
+/**
+ * \brief Request a dump of all accounting objects
+ * \param[in] m       Netlink message buffer.
+ * \param[in] ctrzero If non-zero, zero the counters
+ *
+ * With \a ctrzero set, the counters are read and zeroed atomically, so
+ * that polling them yields the traffic since the previous poll.
+ */
+void nl_nfacct_dump(struct nlmsghdr *m, int ctrzero);
+
+/**
+ * \brief Delete an accounting object (or all unused objects.)
+ * \param[in] m    Netlink message buffer.
+ * \param[in] name Object name (or NULL.)
+ */
+void nl_nfacct_delete(struct nlmsghdr *m, const char *name);
+
+/**
+ * \brief Decode an accounting object
+ * \param[in]  m Netlink message buffer.
+ * \param[out] a Decoded object.
+ * \return 0 on success, non-zero on error (with \a errno set to EINVAL.)
+ */
+int nl_nfacct_parse(struct nlmsghdr *m, struct nl_nfacct *a);
+
+/**
+ * \brief Collect dumped accounting objects (a nl_dump_cb)
+ * \param[in] m   Dumped message (or NULL, if the dump is restarted.)
+ * \param[in] arg List to collect the objects into (nl_nfacct_list.)
+ * \return 0
+ *
+ * This decodes every object dumped by nl_nfacct_dump() into a single
+ * array, with one system call per datagram:
+ *
+ * \code{.c}
+ * struct nl_nfacct a[1024];
+ * struct nl_nfacct_list l = { a, 1024, 0 };
+ *
+ * nl_nfacct_dump(req, 1);
+ * if (nl_dump(fd, req, buf, sizeof buf, 3, nl_nfacct_collect, &l) < 0)
+ * 	goto err;
+ * \endcode
+ */
+int nl_nfacct_collect(struct nlmsghdr *m, void *arg);
+
+#endif /* NL_NFACCT_H */
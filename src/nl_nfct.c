@@ -6,11 +6,93 @@
  * See the LICENSE file for details.
  */
 
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "nl.h"
 #include "nl_nfct.h"
 
+#define NL_NFCT_F_ICMP  (NL_NFCT_F_ICMP_TYPE | NL_NFCT_F_ICMP_CODE | \
+                         NL_NFCT_F_ICMP_ID)
+#define NL_NFCT_F_PROTO (NL_NFCT_F_PROTO_NUM | NL_NFCT_F_SPORT | \
+                         NL_NFCT_F_DPORT | NL_NFCT_F_ICMP)
+#define NL_NFCT_F_ALL   (NL_NFCT_F_IP_SRC | NL_NFCT_F_IP_DST | \
+                         NL_NFCT_F_ZONE | NL_NFCT_F_PROTO)
+
+/* Upper bound on the size of a delete request for one tuple */
+#define DELETE_MAXLEN 256
+
+/**
+ * Add the fields of \a t selected by \a flags as a tuple of the
+ * given \a type.
+ */
+static void add_tuple(struct nlmsghdr *m, __u16 type,
+                      const struct nl_nfct_tuple *t, __u32 flags, __u16 zone)
+{
+	__u16 v;
+	size_t alen = sizeof(__u32);
+	struct nlattr *tuple, *nest;
+	__u16 src = CTA_IP_V4_SRC, dst = CTA_IP_V4_DST;
+	__u16 id = CTA_PROTO_ICMP_ID, itype = CTA_PROTO_ICMP_TYPE;
+	__u16 icode = CTA_PROTO_ICMP_CODE;
+
+	if (t->l3proto == NFPROTO_IPV6) {
+		src  = CTA_IP_V6_SRC;
+		dst  = CTA_IP_V6_DST;
+		alen = sizeof t->src;
+	}
+
+	if (t->l4proto == IPPROTO_ICMPV6) {
+		id    = CTA_PROTO_ICMPV6_ID;
+		itype = CTA_PROTO_ICMPV6_TYPE;
+		icode = CTA_PROTO_ICMPV6_CODE;
+	}
+
+	tuple = nla_start(m, type);
+	if (flags & (NL_NFCT_F_IP_SRC | NL_NFCT_F_IP_DST)) {
+		nest = nla_nest_start(tuple, CTA_TUPLE_IP);
+		if (flags & NL_NFCT_F_IP_SRC)
+			nla_add_attr(nest, src, t->src, alen);
+		if (flags & NL_NFCT_F_IP_DST)
+			nla_add_attr(nest, dst, t->dst, alen);
+		nla_nest_end(tuple, nest);
+	}
+
+	if (flags & NL_NFCT_F_PROTO) {
+		nest = nla_nest_start(tuple, CTA_TUPLE_PROTO);
+		nla_add_attr(nest, CTA_PROTO_NUM, &t->l4proto, sizeof(__u8));
+		v = htons(t->sport);
+		if (t->l4proto == IPPROTO_ICMP || t->l4proto == IPPROTO_ICMPV6) {
+			if (flags & NL_NFCT_F_ICMP_ID)
+				nla_add_attr(nest, id, &v, sizeof v);
+			if (flags & NL_NFCT_F_ICMP_TYPE)
+				nla_add_attr(nest, itype, &t->icmp_type, 1);
+			if (flags & NL_NFCT_F_ICMP_CODE)
+				nla_add_attr(nest, icode, &t->icmp_code, 1);
+		} else {
+			if (flags & NL_NFCT_F_SPORT)
+				nla_add_attr(nest, CTA_PROTO_SRC_PORT, &v, sizeof v);
+			v = htons(t->dport);
+			if (flags & NL_NFCT_F_DPORT)
+				nla_add_attr(nest, CTA_PROTO_DST_PORT, &v, sizeof v);
+		}
+		nla_nest_end(tuple, nest);
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
+	if (flags & NL_NFCT_F_ZONE) {
+		v = htons(zone);
+		nla_add_attr(tuple, CTA_TUPLE_ZONE, &v, sizeof v);
+	}
+#else
+	(void)zone;
+#endif /* Linux < 4.6.0 */
+
+	nla_end(m, tuple);
+}
+
 /**
  * \brief Request a dump of all conntrack entries
  * \param[in] m       Netlink message buffer
@@ -27,6 +109,222 @@ void nl_nfct_dump(struct nlmsghdr *m, __u8 l3proto, int ctrzero)
 	m->nlmsg_flags |= NLM_F_DUMP;
 }
 
+/**
+ * Copy an address from \a nla into \a addr (4 or 16 bytes.)
+ */
+static void parse_addr(struct nlattr *nla, __u32 *addr, size_t len)
+{
+	if (nla->nla_len >= NLA_HDRLEN + len)
+		memcpy(addr, NLA_DATA(nla), len);
+}
+
+/**
+ * Decode the addresses of a tuple (CTA_TUPLE_IP) into \a t.
+ */
+static void parse_tuple_ip(struct nlattr *ip, struct nl_nfct_tuple *t)
+{
+	struct nlattr *n;
+
+	nla_each(n, ip) {
+		switch (n->nla_type & NLA_TYPE_MASK) {
+		case CTA_IP_V4_SRC: parse_addr(n, t->src, 4);  break;
+		case CTA_IP_V4_DST: parse_addr(n, t->dst, 4);  break;
+		case CTA_IP_V6_SRC: parse_addr(n, t->src, 16); break;
+		case CTA_IP_V6_DST: parse_addr(n, t->dst, 16); break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * Decode the protocol of a tuple (CTA_TUPLE_PROTO) into \a t.
+ */
+static void parse_tuple_proto(struct nlattr *proto, struct nl_nfct_tuple *t)
+{
+	struct nlattr *n;
+
+	nla_each(n, proto) {
+		switch (n->nla_type & NLA_TYPE_MASK) {
+		case CTA_PROTO_NUM:      t->l4proto = nla_u8(n);  break;
+		case CTA_PROTO_DST_PORT: t->dport   = nla_u16_be(n); break;
+		case CTA_PROTO_SRC_PORT:
+		case CTA_PROTO_ICMP_ID:
+		case CTA_PROTO_ICMPV6_ID:
+			t->sport = nla_u16_be(n);
+			break;
+		case CTA_PROTO_ICMP_TYPE:
+		case CTA_PROTO_ICMPV6_TYPE:
+			t->icmp_type = nla_u8(n);
+			break;
+		case CTA_PROTO_ICMP_CODE:
+		case CTA_PROTO_ICMPV6_CODE:
+			t->icmp_code = nla_u8(n);
+			break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * Decode a tuple (CTA_TUPLE_*) into \a t.
+ */
+static void parse_tuple(struct nlattr *tuple, struct nl_nfct_tuple *t,
+                        __u8 family)
+{
+	struct nlattr *nla;
+
+	t->l3proto = family;
+	nla_each(nla, tuple) {
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case CTA_TUPLE_IP:    parse_tuple_ip(nla, t);    break;
+		case CTA_TUPLE_PROTO: parse_tuple_proto(nla, t); break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * Decode a set of counters (CTA_COUNTERS_*.)
+ */
+static void parse_counters(struct nlattr *nla, __u64 *packets, __u64 *bytes)
+{
+	struct nlattr *n;
+
+	nla_each(n, nla) {
+		switch (n->nla_type & NLA_TYPE_MASK) {
+		case CTA_COUNTERS_PACKETS:   *packets = nla_u64_be(n); break;
+		case CTA_COUNTERS_BYTES:     *bytes   = nla_u64_be(n); break;
+		case CTA_COUNTERS32_PACKETS: *packets = nla_u32_be(n); break;
+		case CTA_COUNTERS32_BYTES:   *bytes   = nla_u32_be(n); break;
+		default: break;
+		}
+	}
+}
+
+/**
+ * Decode the conntrack attributes from \a nla up to \a end.
+ */
+static int parse_attrs(struct nlattr *nla, const char *end,
+                       struct nl_nfct_flow *f, __u8 family)
+{
+	int ret = -1;
+	struct nlattr *n;
+
+	memset(f, 0, sizeof *f);
+	f->family = family;
+	while ((size_t)(end - (char *)nla) >= NLA_HDRLEN) {
+		if (nla->nla_len < NLA_HDRLEN ||
+		    (size_t)(end - (char *)nla) < nla->nla_len)
+			break;
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case CTA_TUPLE_ORIG:
+			parse_tuple(nla, &f->orig, family);
+			ret = 0;
+			break;
+		case CTA_TUPLE_REPLY:
+			parse_tuple(nla, &f->reply, family);
+			break;
+		case CTA_ID:      f->id      = nla_u32_be(nla); break;
+		case CTA_MARK:    f->mark    = nla_u32_be(nla); break;
+		case CTA_STATUS:  f->status  = nla_u32_be(nla); break;
+		case CTA_TIMEOUT: f->timeout = nla_u32_be(nla); break;
+		case CTA_ZONE:    f->zone    = nla_u16_be(nla); break;
+		case CTA_COUNTERS_ORIG:
+			parse_counters(nla, &f->orig_packets, &f->orig_bytes);
+			break;
+		case CTA_COUNTERS_REPLY:
+			parse_counters(nla, &f->reply_packets, &f->reply_bytes);
+			break;
+		case CTA_TIMESTAMP:
+			nla_each(n, nla) {
+				switch (n->nla_type & NLA_TYPE_MASK) {
+				case CTA_TIMESTAMP_START:
+					f->start = nla_u64_be(n);
+					break;
+				case CTA_TIMESTAMP_STOP:
+					f->stop = nla_u64_be(n);
+					break;
+				default: break;
+				}
+			}
+			break;
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	if (ret) errno = EINVAL;
+	return ret;
+}
+
+/**
+ * \brief Request a filtered dump of conntrack entries
+ * \param[in] m       Netlink message buffer
+ * \param[in] l3proto Layer 3 protocol (NFPROTO_*)
+ * \param[in] ctrzero If non-zero, zero the counters
+ * \param[in] f       Filter
+ *
+ * The filtering is done by the kernel, so only the matching entries
+ * are returned. Matching on the status requires Linux 5.19, and
+ * matching on the tuple requires Linux 5.8. Otherwise, only the mark
+ * will be matched. Matching on a port or ICMP field implies matching
+ * on the layer 4 protocol.
+ */
+void nl_nfct_dump_filter(struct nlmsghdr *m, __u8 l3proto, int ctrzero,
+                         const struct nl_nfct_filter *f)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+	__u32 fl;
+	struct nlattr *nla;
+	struct nl_nfct_tuple t;
+#endif /* Linux >= 5.8.0 */
+
+	if (!m || !f) return;
+	nl_nfct_dump(m, l3proto, ctrzero);
+	if (f->mark_mask) nl_nfct_mark(m, f->mark, f->mark_mask);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+	if (f->status_mask) {
+		fl = htonl(f->status_mask);
+		nl_nfct_status(m, f->status);
+		nl_add_attr(m, CTA_STATUS_MASK, &fl, sizeof fl);
+	}
+#endif /* Linux >= 5.19.0 */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+	if (!(fl = f->flags & NL_NFCT_F_ALL)) return;
+	t = f->tuple;
+	t.l3proto = l3proto;
+	if (fl & NL_NFCT_F_PROTO) fl |= NL_NFCT_F_PROTO_NUM;
+	add_tuple(m, CTA_TUPLE_ORIG, &t, fl, f->zone);
+
+	/* The ICMPv6 flags follow the ICMP flags */
+	if (t.l4proto == IPPROTO_ICMPV6)
+		fl = (fl & ~(__u32)NL_NFCT_F_ICMP) | (fl & NL_NFCT_F_ICMP) << 3;
+
+	nla = nla_start(m, CTA_FILTER);
+	nla_add_attr(nla, CTA_FILTER_ORIG_FLAGS, &fl, sizeof fl);
+	fl = 0;
+	nla_add_attr(nla, CTA_FILTER_REPLY_FLAGS, &fl, sizeof fl);
+	nla_end(m, nla);
+#endif /* Linux >= 5.8.0 */
+}
+
+/**
+ * \brief Request a dump of the per-CPU conntrack statistics
+ * \param[in] m Netlink message buffer
+ *
+ * There's one reply per CPU, decoded by nl_nfct_stats_parse().
+ */
+void nl_nfct_stats_cpu(struct nlmsghdr *m)
+{
+	if (!m) return;
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_GET_STATS_CPU, NFPROTO_UNSPEC);
+	m->nlmsg_flags |= NLM_F_DUMP;
+}
+
 /**
  * \brief Create a new conntrack entry
  * \param[in] m       Netlink message buffer
@@ -55,3 +353,428 @@ void nl_nfct_update(struct nlmsghdr *m, __u8 l3proto)
 	m->nlmsg_flags = (__u16)(m->nlmsg_flags & ~NLM_F_CREATE);
 }
 
+/**
+ * \brief Fill in an IPv4 tuple
+ * \param[out] t       Tuple
+ * \param[in]  l4proto Layer 4 protocol (IPPROTO_*)
+ * \param[in]  src     Source address (in network byte order)
+ * \param[in]  dst     Destination address (in network byte order)
+ * \param[in]  sport   Source port (or ICMP id)
+ * \param[in]  dport   Destination port
+ */
+void nl_nfct_tuple_v4(struct nl_nfct_tuple *t, __u8 l4proto, __u32 src,
+                      __u32 dst, __u16 sport, __u16 dport)
+{
+	if (!t) return;
+	memset(t, 0, sizeof *t);
+	t->src[0]  = src;
+	t->dst[0]  = dst;
+	t->sport   = sport;
+	t->dport   = dport;
+	t->l3proto = NFPROTO_IPV4;
+	t->l4proto = l4proto;
+}
+
+/**
+ * \brief Fill in an IPv6 tuple
+ * \param[out] t       Tuple
+ * \param[in]  l4proto Layer 4 protocol (IPPROTO_*)
+ * \param[in]  src     Source address (16 bytes, in network byte order)
+ * \param[in]  dst     Destination address (16 bytes, in network byte order)
+ * \param[in]  sport   Source port (or ICMPv6 id)
+ * \param[in]  dport   Destination port
+ */
+void nl_nfct_tuple_v6(struct nl_nfct_tuple *t, __u8 l4proto,
+                      const void *src, const void *dst, __u16 sport,
+                      __u16 dport)
+{
+	if (!t) return;
+	memset(t, 0, sizeof *t);
+	if (src) memcpy(t->src, src, sizeof t->src);
+	if (dst) memcpy(t->dst, dst, sizeof t->dst);
+	t->sport   = sport;
+	t->dport   = dport;
+	t->l3proto = NFPROTO_IPV6;
+	t->l4proto = l4proto;
+}
+
+/**
+ * \brief Add a tuple to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] type Tuple type (CTA_TUPLE_ORIG, CTA_TUPLE_REPLY, etc.)
+ * \param[in] t    Tuple
+ *
+ * For ICMP(v6), the id, type and code are added rather than the ports.
+ */
+void nl_nfct_add_tuple(struct nlmsghdr *m, __u16 type,
+                       const struct nl_nfct_tuple *t)
+{
+	if (!m || !t) return;
+	add_tuple(m, type, t, NL_NFCT_F_ALL & ~(__u32)NL_NFCT_F_ZONE, 0);
+}
+
+/**
+ * \brief Decode a tuple
+ * \param[in]  nla    Tuple attribute (CTA_TUPLE_ORIG, CTA_EXPECT_MASK, etc.)
+ * \param[in]  family Layer 3 protocol (NFPROTO_*)
+ * \param[out] t      Tuple
+ */
+void nl_nfct_parse_tuple(struct nlattr *nla, __u8 family,
+                         struct nl_nfct_tuple *t)
+{
+	if (!nla || !t) return;
+	memset(t, 0, sizeof *t);
+	parse_tuple(nla, t, family);
+}
+
+/**
+ * \brief Add a mark (and mask) to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] mark Mark
+ * \param[in] mask Mark mask (only added if non-zero)
+ */
+void nl_nfct_mark(struct nlmsghdr *m, __u32 mark, __u32 mask)
+{
+	mark = htonl(mark);
+	nl_add_attr(m, CTA_MARK, &mark, sizeof mark);
+
+	if (mask) {
+		mask = htonl(mask);
+		nl_add_attr(m, CTA_MARK_MASK, &mask, sizeof mask);
+	}
+}
+
+/**
+ * \brief Add a zone to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] zone Zone
+ */
+void nl_nfct_zone(struct nlmsghdr *m, __u16 zone)
+{
+	zone = htons(zone);
+	nl_add_attr(m, CTA_ZONE, &zone, sizeof zone);
+}
+
+/**
+ * \brief Add labels (and a mask) to a conntrack message
+ * \param[in] m      Netlink message buffer
+ * \param[in] labels Label bits
+ * \param[in] mask   Label mask (may be NULL)
+ * \param[in] len    Length of \a labels (and \a mask) in bytes
+ *
+ * \a len must be a multiple of 4.
+ */
+void nl_nfct_labels(struct nlmsghdr *m, const void *labels,
+                    const void *mask, size_t len)
+{
+	if (!labels || !len || len & 3) return;
+	nl_add_attr(m, CTA_LABELS, labels, len);
+	if (mask) nl_add_attr(m, CTA_LABELS_MASK, mask, len);
+}
+
+/**
+ * \brief Add the status to a conntrack message
+ * \param[in] m      Netlink message buffer
+ * \param[in] status Status bits (IPS_*)
+ */
+void nl_nfct_status(struct nlmsghdr *m, __u32 status)
+{
+	status = htonl(status);
+	nl_add_attr(m, CTA_STATUS, &status, sizeof status);
+}
+
+/**
+ * \brief Add a timeout to a conntrack message
+ * \param[in] m       Netlink message buffer
+ * \param[in] timeout Timeout (in seconds)
+ */
+void nl_nfct_timeout(struct nlmsghdr *m, __u32 timeout)
+{
+	timeout = htonl(timeout);
+	nl_add_attr(m, CTA_TIMEOUT, &timeout, sizeof timeout);
+}
+
+/**
+ * \brief Decode a conntrack message
+ * \param[in]  m Netlink message buffer
+ * \param[out] f Decoded conntrack entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This decodes a conntrack message (i.e. a dump reply or an event) in a
+ * single pass over its attributes. The message must have an original
+ * tuple.
+ */
+int nl_nfct_parse(struct nlmsghdr *m, struct nl_nfct_flow *f)
+{
+	int ret = -1;
+	struct nfgenmsg *nf;
+
+	if (!m || !f || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *nf))
+		goto inval;
+
+	nf  = NLMSG_DATA(m);
+	ret = parse_attrs(BYTE_OFF(nf, NLMSG_ALIGN(sizeof *nf)),
+	                  (char *)m + m->nlmsg_len, f, nf->nfgen_family);
+	f->type = (__u8)(m->nlmsg_type & 0xff);
+	goto ret;
+
+inval:
+	errno = EINVAL;
+
+ret:
+	return ret;
+}
+
+/**
+ * \brief Decode a nested conntrack entry
+ * \param[in]  nla    Nested conntrack attribute (e.g. NFQA_CT)
+ * \param[in]  family Layer 3 protocol (NFPROTO_*)
+ * \param[out] f      Decoded conntrack entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This works like nl_nfct_parse(), for conntrack entries embedded
+ * in other messages, such as the NFQA_CT attribute of queued packets.
+ */
+int nl_nfct_parse_nla(struct nlattr *nla, __u8 family,
+                      struct nl_nfct_flow *f)
+{
+	if (!nla || !f || nla->nla_len < NLA_HDRLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return parse_attrs(NLA_DATA(nla), (char *)nla + nla->nla_len, f,
+	                   family);
+}
+
+/**
+ * \brief Flush the conntrack entries with a given mark
+ * \param[in] m    Netlink message buffer
+ * \param[in] mark Mark
+ * \param[in] mask Mark mask (if zero, the whole mark is matched)
+ *
+ * The kernel deletes all matching entries in response to this single
+ * message. This requires Linux 3.18 or higher, or else all entries
+ * will be flushed.
+ */
+void nl_nfct_flush_mark(struct nlmsghdr *m, __u32 mark, __u32 mask)
+{
+	nl_nfct_delete(m, NFPROTO_UNSPEC);
+	nl_nfct_mark(m, mark, mask ? mask : 0xffffffff);
+}
+
+/**
+ * \brief Delete many conntrack entries
+ * \param[in]  fd    Netlink socket file descriptor (blocking)
+ * \param[in]  b     Batch (with an empty buffer)
+ * \param[in]  t     Original tuples of the entries to delete
+ * \param[in]  n     Number of tuples
+ * \param[in]  zone  Zone
+ * \param[out] errs  Result for each tuple (0, or a negative \a errno
+ *                   value such as -ENOENT.) May be NULL.
+ * \return The number of entries deleted, or -1 on error (with \a errno
+ *         set.)
+ *
+ * As many delete requests as fit in the batch's buffer are sent with
+ * each \a sendmsg(2) call, and the ACKs for them are collected before
+ * sending the next batch. The buffer should be no larger than the
+ * socket's send buffer, and the receive buffer should be large enough
+ * to hold an error for each request in a batch.
+ *
+ * To delete the entries in a zone, dump them with nl_nfct_dump_filter()
+ * (matching on NL_NFCT_F_ZONE) and delete their tuples.
+ */
+long nl_nfct_delete_bulk(int fd, struct nl_batch *b,
+                         const struct nl_nfct_tuple *t, size_t n,
+                         __u16 zone, int *errs)
+{
+	int err;
+	long i, deleted = 0;
+	ssize_t ret;
+	size_t next = 0, base;
+	__u32 acked, rbuf[NLMSG_GOODSIZE / sizeof(__u32)];
+	struct nlmsghdr *m, *r = (struct nlmsghdr *)(void *)rbuf;
+
+	if (!b || (!t && n)) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	while (next < n) {
+		base = next;
+		nl_batch_reset(b);
+		while (next < n && (m = nl_batch_next(b, DELETE_MAXLEN))) {
+			nl_nfct_delete(m, t[next].l3proto);
+			nl_nfct_add_tuple(m, CTA_TUPLE_ORIG, &t[next]);
+			if (zone) nl_nfct_zone(m, zone);
+			if (nl_batch_add(b) < 0) goto err;
+			++next;
+		}
+
+		if (!b->count) {
+			errno = E2BIG;
+			goto err;
+		}
+
+		if (nl_batch_send(fd, 0, b) != (ssize_t)b->len)
+			goto err;
+
+		/* Collect the ACKs, errors are reported as negative errno */
+		for (acked = 0; acked < b->count; ) {
+			errno = 0;
+			ret   = nl_recv(fd, r, sizeof rbuf, NULL);
+			if (ret <= 0 && errno >= 0) {
+				if (!errno) errno = EIO;
+				goto err;
+			}
+
+			if ((i = nl_batch_ack(b, r, &err)) < 0)
+				continue;
+			if (errs) errs[base + (size_t)i] = err;
+			if (!err) ++deleted;
+			++acked;
+		}
+	}
+
+	nl_batch_reset(b);
+	return deleted;
+
+err:
+	return -1;
+}
+
+/**
+ * \brief Decode per-CPU conntrack statistics
+ * \param[in]  m Netlink message buffer
+ * \param[out] s Statistics, indexed by CPU
+ * \param[in]  n Number of elements in \a s
+ * \return The CPU the statistics are for, or -1 on error (with \a errno
+ *         set.)
+ *
+ * \a EINVAL - \a m isn't a per-CPU statistics message.
+ * \a ERANGE - The CPU number is \a n or higher.
+ */
+int nl_nfct_stats_parse(struct nlmsghdr *m, struct nl_nfct_stats *s,
+                        size_t n)
+{
+	int cpu = -1;
+	struct nlattr *nla;
+	struct nfgenmsg *nf;
+	struct nl_nfct_stats *st;
+
+	if (!m || !s || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *nf) ||
+	    m->nlmsg_type != (NFNL_SUBSYS_CTNETLINK << 8 |
+	                      IPCTNL_MSG_CT_GET_STATS_CPU)) {
+		errno = EINVAL;
+		goto ret;
+	}
+
+	nf = NLMSG_DATA(m);
+	if ((size_t)ntohs(nf->res_id) >= n) {
+		errno = ERANGE;
+		goto ret;
+	}
+
+	cpu = ntohs(nf->res_id);
+	st  = &s[cpu];
+	memset(st, 0, sizeof *st);
+	nla = BYTE_OFF(nf, NLMSG_ALIGN(sizeof *nf));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case CTA_STATS_FOUND:   st->found   = nla_u32_be(nla); break;
+		case CTA_STATS_INVALID: st->invalid = nla_u32_be(nla); break;
+		case CTA_STATS_IGNORE:  st->ignore  = nla_u32_be(nla); break;
+		case CTA_STATS_INSERT:  st->insert  = nla_u32_be(nla); break;
+		case CTA_STATS_INSERT_FAILED:
+			st->insert_failed = nla_u32_be(nla);
+			break;
+		case CTA_STATS_DROP:
+			st->drop = nla_u32_be(nla);
+			break;
+		case CTA_STATS_EARLY_DROP:
+			st->early_drop = nla_u32_be(nla);
+			break;
+		case CTA_STATS_ERROR:
+			st->error = nla_u32_be(nla);
+			break;
+		case CTA_STATS_SEARCH_RESTART:
+			st->search_restart = nla_u32_be(nla);
+			break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+		case CTA_STATS_CLASH_RESOLVE:
+			st->clash_resolve = nla_u32_be(nla);
+			break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,0)
+		case CTA_STATS_CHAIN_TOOLONG:
+			st->chain_toolong = nla_u32_be(nla);
+			break;
+#endif
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+ret:
+	return cpu;
+}
+
+/**
+ * \brief Decode the global conntrack statistics
+ * \param[in]  m Netlink message buffer
+ * \param[out] s Statistics
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_nfct_stats_global_parse(struct nlmsghdr *m,
+                               struct nl_nfct_stats_global *s)
+{
+	struct nlattr *nla;
+
+	if (!m || !s || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_type != (NFNL_SUBSYS_CTNETLINK << 8 |
+	                      IPCTNL_MSG_CT_GET_STATS)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	s->entries = s->max_entries = 0;
+	if ((nla = nl_nf_get_attr(m, CTA_STATS_GLOBAL_ENTRIES)))
+		s->entries = nla_u32_be(nla);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,0,0)
+	if ((nla = nl_nf_get_attr(m, CTA_STATS_GLOBAL_MAX_ENTRIES)))
+		s->max_entries = nla_u32_be(nla);
+#endif
+	return 0;
+}
+
+/**
+ * \brief Compute the change in per-CPU conntrack statistics
+ * \param[in]  prev Earlier statistics
+ * \param[in]  cur  Current statistics
+ * \param[out] diff Difference (\a cur - \a prev)
+ * \param[in]  n    Number of elements in each array
+ *
+ * \a diff may be the same as \a prev or \a cur.
+ */
+void nl_nfct_stats_diff(const struct nl_nfct_stats *prev,
+                        const struct nl_nfct_stats *cur,
+                        struct nl_nfct_stats *diff, size_t n)
+{
+	size_t i, j;
+	const __u32 *a, *b;
+	__u32 *d;
+
+	if (!prev || !cur || !diff) return;
+	for (i = 0; i < n; i++) {
+		a = (const __u32 *)(const void *)&prev[i];
+		b = (const __u32 *)(const void *)&cur[i];
+		d = (__u32 *)(void *)&diff[i];
+		for (j = 0; j < sizeof *diff / sizeof *d; j++)
+			d[j] = b[j] - a[j];
+	}
+}
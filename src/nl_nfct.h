@@ -11,12 +11,124 @@
 #define NL_NFCT_H
 
 #include <sys/types.h>
+#include <linux/version.h>
 #include <linux/netlink.h>
 #include <linux/netfilter.h>
 #include <linux/netfilter/nfnetlink_conntrack.h>
 
 #include "nl_nf.h"
 
+/**
+ * \name Filter flags
+ *
+ * Tuple fields to match in a filtered dump (see: nl_nfct_dump_filter().)
+ * These mirror the kernel's CTA_FILTER_F_* flags, which aren't exported
+ * to userspace. For ICMPv6 tuples, the ICMP flags are translated
+ * automatically.
+ * @{
+ */
+#define NL_NFCT_F_IP_SRC    (1 << 0) /**< Source address */
+#define NL_NFCT_F_IP_DST    (1 << 1) /**< Destination address */
+#define NL_NFCT_F_ZONE      (1 << 2) /**< Conntrack zone */
+#define NL_NFCT_F_PROTO_NUM (1 << 3) /**< Layer 4 protocol */
+#define NL_NFCT_F_SPORT     (1 << 4) /**< Source port */
+#define NL_NFCT_F_DPORT     (1 << 5) /**< Destination port */
+#define NL_NFCT_F_ICMP_TYPE (1 << 6) /**< ICMP type */
+#define NL_NFCT_F_ICMP_CODE (1 << 7) /**< ICMP code */
+#define NL_NFCT_F_ICMP_ID   (1 << 8) /**< ICMP id */
+/** @} */
+
+/**
+ * \brief Conntrack tuple
+ *
+ * Addresses are in network byte order, everything else is in host
+ * byte order. For ICMP(v6), \a sport holds the ICMP id.
+ */
+struct nl_nfct_tuple {
+	__u32 src[4];   /**< Source address */
+	__u32 dst[4];   /**< Destination address */
+	__u16 sport;    /**< Source port (or ICMP id) */
+	__u16 dport;    /**< Destination port */
+	__u8 l3proto;   /**< Layer 3 protocol (NFPROTO_IPV4 or NFPROTO_IPV6) */
+	__u8 l4proto;   /**< Layer 4 protocol (IPPROTO_*) */
+	__u8 icmp_type; /**< ICMP type */
+	__u8 icmp_code; /**< ICMP code */
+};
+
+/**
+ * \brief Decoded conntrack entry
+ *
+ * Filled by nl_nfct_parse(). Addresses are in network byte order,
+ * everything else is in host byte order. Attributes absent from the
+ * message are zero. The counters are only present if conntrack
+ * accounting is enabled (net.netfilter.nf_conntrack_acct), and the
+ * timestamps only if conntrack timestamping is enabled
+ * (net.netfilter.nf_conntrack_timestamp.)
+ */
+struct nl_nfct_flow {
+	struct nl_nfct_tuple orig;  /**< Original tuple */
+	struct nl_nfct_tuple reply; /**< Reply tuple */
+	__u64 orig_packets;         /**< Packets (original direction) */
+	__u64 orig_bytes;           /**< Bytes (original direction) */
+	__u64 reply_packets;        /**< Packets (reply direction) */
+	__u64 reply_bytes;          /**< Bytes (reply direction) */
+	__u64 start;                /**< Start timestamp (ns) */
+	__u64 stop;                 /**< Stop timestamp (ns) */
+	__u32 id;                   /**< Conntrack ID */
+	__u32 mark;                 /**< Mark */
+	__u32 status;               /**< Status (IPS_*) */
+	__u32 timeout;              /**< Timeout (in seconds) */
+	__u16 zone;                 /**< Zone */
+	__u8 type;                  /**< Message type (IPCTNL_MSG_CT_*) */
+	__u8 family;                /**< Layer 3 protocol (NFPROTO_*) */
+};
+
+/**
+ * \brief Per-CPU conntrack statistics
+ *
+ * Filled by nl_nfct_stats_parse(). The counters are in host byte order,
+ * and wrap around, so they should be diffed with nl_nfct_stats_diff().
+ */
+struct nl_nfct_stats {
+	__u32 found;          /**< Successful lookups */
+	__u32 invalid;        /**< Packets that couldn't be tracked */
+	__u32 ignore;         /**< Packets that were already tracked */
+	__u32 insert;         /**< Entries inserted */
+	__u32 insert_failed;  /**< Entries that failed to be inserted */
+	__u32 drop;           /**< Packets dropped due to a failure */
+	__u32 early_drop;     /**< Entries dropped to make room */
+	__u32 error;          /**< Packets with protocol errors */
+	__u32 search_restart; /**< Lookups restarted by a resize */
+	__u32 clash_resolve;  /**< Insertion clashes resolved */
+	__u32 chain_toolong;  /**< Hash chains too long */
+};
+
+/**
+ * \brief Global conntrack statistics
+ */
+struct nl_nfct_stats_global {
+	__u32 entries;     /**< Number of entries */
+	__u32 max_entries; /**< Maximum number of entries */
+};
+
+/**
+ * \brief Conntrack dump filter
+ *
+ * The mark is matched if \a mark_mask is non-zero, the status if
+ * \a status_mask is non-zero, and the fields of \a tuple (and \a zone)
+ * selected by \a flags (NL_NFCT_F_*) are matched against the original
+ * tuple of each entry.
+ */
+struct nl_nfct_filter {
+	__u32 flags;                /**< Tuple fields to match (NL_NFCT_F_*) */
+	__u32 mark;                 /**< Mark */
+	__u32 mark_mask;            /**< Mark mask */
+	__u32 status;               /**< Status (IPS_*) */
+	__u32 status_mask;          /**< Status mask */
+	__u16 zone;                 /**< Zone */
+	struct nl_nfct_tuple tuple; /**< Original tuple */
+};
+
 /**
  * \brief Create a netlink_conntrack request.
  * \param[in] m    Netlink message buffer.
@@ -66,6 +178,15 @@
 #define nl_nfct_delete(m, l3p) \
 	nl_nfct_request((m), 0, IPCTNL_MSG_CT_DELETE, (l3p))
 
+/**
+ * \brief Request the global conntrack statistics
+ * \param[in] m Netlink message buffer
+ *
+ * The reply is decoded by nl_nfct_stats_global_parse().
+ */
+#define nl_nfct_stats_global(m) \
+	nl_nfct_request((m), 0, IPCTNL_MSG_CT_GET_STATS, NFPROTO_UNSPEC)
+
 /**
  * \brief Request a dump of all conntrack entries
  * \param[in] m       Netlink message buffer
@@ -77,6 +198,14 @@
  */
 void nl_nfct_dump(struct nlmsghdr *m, __u8 l3proto, int ctrzero);
 
+/**
+ * \brief Request a dump of the per-CPU conntrack statistics
+ * \param[in] m Netlink message buffer
+ *
+ * There's one reply per CPU, decoded by nl_nfct_stats_parse().
+ */
+void nl_nfct_stats_cpu(struct nlmsghdr *m);
+
 /**
  * \brief Create a new conntrack entry
  * \param[in] m       Netlink message buffer
@@ -97,5 +226,205 @@ void nl_nfct_create(struct nlmsghdr *m, __u8 l3proto);
  */
 void nl_nfct_update(struct nlmsghdr *m, __u8 l3proto);
 
+/**
+ * \brief Request a filtered dump of conntrack entries
+ * \param[in] m       Netlink message buffer
+ * \param[in] l3proto Layer 3 protocol (NFPROTO_*)
+ * \param[in] ctrzero If non-zero, zero the counters
+ * \param[in] f       Filter
+ *
+ * The filtering is done by the kernel, so only the matching entries
+ * are returned. Matching on the status requires Linux 5.19, and
+ * matching on the tuple requires Linux 5.8. Otherwise, only the mark
+ * will be matched. Matching on a port or ICMP field implies matching
+ * on the layer 4 protocol.
+ */
+void nl_nfct_dump_filter(struct nlmsghdr *m, __u8 l3proto, int ctrzero,
+                         const struct nl_nfct_filter *f);
+
+/**
+ * \brief Fill in an IPv4 tuple
+ * \param[out] t       Tuple
+ * \param[in]  l4proto Layer 4 protocol (IPPROTO_*)
+ * \param[in]  src     Source address (in network byte order)
+ * \param[in]  dst     Destination address (in network byte order)
+ * \param[in]  sport   Source port (or ICMP id)
+ * \param[in]  dport   Destination port
+ */
+void nl_nfct_tuple_v4(struct nl_nfct_tuple *t, __u8 l4proto, __u32 src,
+                      __u32 dst, __u16 sport, __u16 dport);
+
+/**
+ * \brief Fill in an IPv6 tuple
+ * \param[out] t       Tuple
+ * \param[in]  l4proto Layer 4 protocol (IPPROTO_*)
+ * \param[in]  src     Source address (16 bytes, in network byte order)
+ * \param[in]  dst     Destination address (16 bytes, in network byte order)
+ * \param[in]  sport   Source port (or ICMPv6 id)
+ * \param[in]  dport   Destination port
+ */
+void nl_nfct_tuple_v6(struct nl_nfct_tuple *t, __u8 l4proto,
+                      const void *src, const void *dst, __u16 sport,
+                      __u16 dport);
+
+/**
+ * \brief Add a tuple to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] type Tuple type (CTA_TUPLE_ORIG, CTA_TUPLE_REPLY, etc.)
+ * \param[in] t    Tuple
+ *
+ * For ICMP(v6), the id, type and code are added rather than the ports.
+ */
+void nl_nfct_add_tuple(struct nlmsghdr *m, __u16 type,
+                       const struct nl_nfct_tuple *t);
+
+/**
+ * \brief Decode a tuple
+ * \param[in]  nla    Tuple attribute (CTA_TUPLE_ORIG, CTA_EXPECT_MASK, etc.)
+ * \param[in]  family Layer 3 protocol (NFPROTO_*)
+ * \param[out] t      Tuple
+ */
+void nl_nfct_parse_tuple(struct nlattr *nla, __u8 family,
+                         struct nl_nfct_tuple *t);
+
+/**
+ * \brief Add a mark (and mask) to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] mark Mark
+ * \param[in] mask Mark mask (only added if non-zero)
+ */
+void nl_nfct_mark(struct nlmsghdr *m, __u32 mark, __u32 mask);
+
+/**
+ * \brief Add a zone to a conntrack message
+ * \param[in] m    Netlink message buffer
+ * \param[in] zone Zone
+ */
+void nl_nfct_zone(struct nlmsghdr *m, __u16 zone);
+
+/**
+ * \brief Add labels (and a mask) to a conntrack message
+ * \param[in] m      Netlink message buffer
+ * \param[in] labels Label bits
+ * \param[in] mask   Label mask (may be NULL)
+ * \param[in] len    Length of \a labels (and \a mask) in bytes
+ *
+ * \a len must be a multiple of 4.
+ */
+void nl_nfct_labels(struct nlmsghdr *m, const void *labels,
+                    const void *mask, size_t len);
+
+/**
+ * \brief Add the status to a conntrack message
+ * \param[in] m      Netlink message buffer
+ * \param[in] status Status bits (IPS_*)
+ */
+void nl_nfct_status(struct nlmsghdr *m, __u32 status);
+
+/**
+ * \brief Add a timeout to a conntrack message
+ * \param[in] m       Netlink message buffer
+ * \param[in] timeout Timeout (in seconds)
+ */
+void nl_nfct_timeout(struct nlmsghdr *m, __u32 timeout);
+
+/**
+ * \brief Decode a conntrack message
+ * \param[in]  m Netlink message buffer
+ * \param[out] f Decoded conntrack entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This decodes a conntrack message (i.e. a dump reply or an event) in a
+ * single pass over its attributes. The message must have an original
+ * tuple.
+ */
+int nl_nfct_parse(struct nlmsghdr *m, struct nl_nfct_flow *f);
+
+/**
+ * \brief Decode a nested conntrack entry
+ * \param[in]  nla    Nested conntrack attribute (e.g. NFQA_CT)
+ * \param[in]  family Layer 3 protocol (NFPROTO_*)
+ * \param[out] f      Decoded conntrack entry
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This works like nl_nfct_parse(), for conntrack entries embedded
+ * in other messages, such as the NFQA_CT attribute of queued packets.
+ */
+int nl_nfct_parse_nla(struct nlattr *nla, __u8 family,
+                      struct nl_nfct_flow *f);
+
+/**
+ * \brief Flush the conntrack entries with a given mark
+ * \param[in] m    Netlink message buffer
+ * \param[in] mark Mark
+ * \param[in] mask Mark mask (if zero, the whole mark is matched)
+ *
+ * The kernel deletes all matching entries in response to this single
+ * message. This requires Linux 3.18 or higher, or else all entries
+ * will be flushed.
+ */
+void nl_nfct_flush_mark(struct nlmsghdr *m, __u32 mark, __u32 mask);
+
+/**
+ * \brief Delete many conntrack entries
+ * \param[in]  fd    Netlink socket file descriptor (blocking)
+ * \param[in]  b     Batch (with an empty buffer)
+ * \param[in]  t     Original tuples of the entries to delete
+ * \param[in]  n     Number of tuples
+ * \param[in]  zone  Zone
+ * \param[out] errs  Result for each tuple (0, or a negative \a errno
+ *                   value such as -ENOENT.) May be NULL.
+ * \return The number of entries deleted, or -1 on error (with \a errno
+ *         set.)
+ *
+ * As many delete requests as fit in the batch's buffer are sent with
+ * each \a sendmsg(2) call, and the ACKs for them are collected before
+ * sending the next batch. The buffer should be no larger than the
+ * socket's send buffer, and the receive buffer should be large enough
+ * to hold an error for each request in a batch.
+ *
+ * To delete the entries in a zone, dump them with nl_nfct_dump_filter()
+ * (matching on NL_NFCT_F_ZONE) and delete their tuples.
+ */
+long nl_nfct_delete_bulk(int fd, struct nl_batch *b,
+                         const struct nl_nfct_tuple *t, size_t n,
+                         __u16 zone, int *errs);
+
+/**
+ * \brief Decode per-CPU conntrack statistics
+ * \param[in]  m Netlink message buffer
+ * \param[out] s Statistics, indexed by CPU
+ * \param[in]  n Number of elements in \a s
+ * \return The CPU the statistics are for, or -1 on error (with \a errno
+ *         set.)
+ *
+ * \a EINVAL - \a m isn't a per-CPU statistics message.
+ * \a ERANGE - The CPU number is \a n or higher.
+ */
+int nl_nfct_stats_parse(struct nlmsghdr *m, struct nl_nfct_stats *s,
+                        size_t n);
+
+/**
+ * \brief Decode the global conntrack statistics
+ * \param[in]  m Netlink message buffer
+ * \param[out] s Statistics
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_nfct_stats_global_parse(struct nlmsghdr *m,
+                               struct nl_nfct_stats_global *s);
+
+/**
+ * \brief Compute the change in per-CPU conntrack statistics
+ * \param[in]  prev Earlier statistics
+ * \param[in]  cur  Current statistics
+ * \param[out] diff Difference (\a cur - \a prev)
+ * \param[in]  n    Number of elements in each array
+ *
+ * \a diff may be the same as \a prev or \a cur.
+ */
+void nl_nfct_stats_diff(const struct nl_nfct_stats *prev,
+                        const struct nl_nfct_stats *cur,
+                        struct nl_nfct_stats *diff, size_t n);
+
 #endif /* NL_NFCT_H */
 
@@ -0,0 +1,338 @@
+/**
+ * nanonl: Conntrack Mirror Table
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "nl.h"
+#include "nl_nfct_table.h"
+
+#define SLOT_EMPTY   0
+#define SLOT_DELETED 1
+
+/* Sequence counter / fence primitives */
+#define SEQ_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SEQ_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SEQ_RMB()       __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define SEQ_WMB()       __atomic_thread_fence(__ATOMIC_RELEASE)
+
+static __u32 hash_key(const struct nl_nfct_table *t,
+                      const struct nl_nfct_tuple *key, __u16 zone)
+{
+	size_t i;
+	__u32 h = t->seed ^ zone, w[3];
+
+	for (i = 0; i < 4; i++) {
+		h = (h ^ key->src[i]) * 0x9e3779b1U;
+		h = (h ^ key->dst[i]) * 0x9e3779b1U;
+		h ^= h >> 15;
+	}
+
+	w[0] = (__u32)key->sport << 16 | key->dport;
+	w[1] = (__u32)key->l3proto << 24 | (__u32)key->l4proto << 16;
+	w[2] = (__u32)key->icmp_type << 8 | key->icmp_code;
+	for (i = 0; i < 3; i++) {
+		h = (h ^ w[i]) * 0x85ebca6bU;
+		h ^= h >> 13;
+	}
+
+	/* 0 and 1 mark empty and deleted slots */
+	return h < 2 ? h + 2 : h;
+}
+
+static int key_eq(const struct nl_nfct_flow *f,
+                  const struct nl_nfct_tuple *key, __u16 zone)
+{
+	return f->zone == zone && !memcmp(&f->orig, key, sizeof *key);
+}
+
+/**
+ * Find the slot holding \a key (or NULL.)
+ */
+static struct nl_nfct_slot *find(const struct nl_nfct_table *t,
+                                 const struct nl_nfct_tuple *key,
+                                 __u16 zone, __u32 h)
+{
+	__u32 i, n, mask = t->size - 1;
+	struct nl_nfct_slot *s;
+
+	for (n = 0, i = h & mask; n < t->size; n++, i = (i + 1) & mask) {
+		s = &t->slots[i];
+		if (s->hash == SLOT_EMPTY) break;
+		if (s->hash == h && key_eq(&s->flow, key, zone))
+			return s;
+	}
+
+	return NULL;
+}
+
+static void write_begin(struct nl_nfct_slot *s)
+{
+	SEQ_STORE(&s->seq, s->seq + 1);
+	SEQ_WMB();
+}
+
+static void write_end(struct nl_nfct_slot *s)
+{
+	SEQ_STORE(&s->seq, s->seq + 1);
+}
+
+/**
+ * \brief Initialize a conntrack table
+ * \param[in] t     Table
+ * \param[in] slots Slot storage
+ * \param[in] n     Number of slots (must be a power of 2)
+ * \param[in] seed  Hash seed (should be random)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_nfct_table_init(struct nl_nfct_table *t, struct nl_nfct_slot *slots,
+                       __u32 n, __u32 seed)
+{
+	if (!t || !slots || !n || (n & (n - 1))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(slots, 0, n * sizeof *slots);
+	t->slots = slots;
+	t->size  = n;
+	t->count = 0;
+	t->gen   = 0;
+	t->seed  = seed;
+	return 0;
+}
+
+/**
+ * \brief Look up an entry
+ * \param[in]  t    Table
+ * \param[in]  key  Original tuple
+ * \param[in]  zone Zone
+ * \param[out] f    Copy of the entry (if found)
+ * \return 0 if found, or -1 otherwise (with \a errno set to ENOENT.)
+ *
+ * This may be called concurrently with modifications to the table.
+ */
+int nl_nfct_table_lookup(const struct nl_nfct_table *t,
+                         const struct nl_nfct_tuple *key, __u16 zone,
+                         struct nl_nfct_flow *f)
+{
+	int found;
+	__u32 h, i, n, mask, seq, sh;
+	struct nl_nfct_slot *s;
+
+	if (!t || !key || !f) goto noent;
+	h    = hash_key(t, key, zone);
+	mask = t->size - 1;
+
+	for (n = 0, i = h & mask; n < t->size; n++, i = (i + 1) & mask) {
+		s = &t->slots[i];
+retry:
+		if ((seq = SEQ_LOAD(&s->seq)) & 1) goto retry;
+		sh    = s->hash;
+		found = sh == h && key_eq(&s->flow, key, zone);
+		if (found) memcpy(f, &s->flow, sizeof *f);
+		SEQ_RMB();
+		if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq)
+			goto retry;
+
+		if (found) return 0;
+		if (sh == SLOT_EMPTY) break;
+	}
+
+noent:
+	errno = ENOENT;
+	return -1;
+}
+
+/**
+ * \brief Add or update an entry
+ * \param[in] t Table
+ * \param[in] f Conntrack entry
+ * \return 0 on success, or -1 if the table is full (with \a errno
+ *         set to ENOSPC.)
+ *
+ * Update events don't carry the counters or timestamps, so these are
+ * only replaced by non-zero values.
+ */
+int nl_nfct_table_update(struct nl_nfct_table *t,
+                         const struct nl_nfct_flow *f)
+{
+	__u32 h, i, n, mask;
+	struct nl_nfct_slot *s, *slot = NULL;
+	struct nl_nfct_flow *o;
+
+	if (!t || !f) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	h    = hash_key(t, &f->orig, f->zone);
+	mask = t->size - 1;
+	if ((s = find(t, &f->orig, f->zone, h))) {
+		o = &s->flow;
+		write_begin(s);
+		o->reply   = f->reply;
+		o->id      = f->id;
+		o->mark    = f->mark;
+		o->status  = f->status;
+		o->timeout = f->timeout;
+		o->type    = f->type;
+		if (f->orig_packets)  o->orig_packets  = f->orig_packets;
+		if (f->orig_bytes)    o->orig_bytes    = f->orig_bytes;
+		if (f->reply_packets) o->reply_packets = f->reply_packets;
+		if (f->reply_bytes)   o->reply_bytes   = f->reply_bytes;
+		if (f->start)         o->start         = f->start;
+		if (f->stop)          o->stop          = f->stop;
+		s->gen = t->gen;
+		write_end(s);
+		return 0;
+	}
+
+	/* Take the first free slot in the probe sequence */
+	for (n = 0, i = h & mask; n < t->size; n++, i = (i + 1) & mask) {
+		if (t->slots[i].hash < 2) {
+			slot = &t->slots[i];
+			break;
+		}
+	}
+
+	if (!slot) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	write_begin(slot);
+	slot->flow = *f;
+	slot->gen  = t->gen;
+	slot->hash = h;
+	write_end(slot);
+	++t->count;
+	return 0;
+}
+
+/**
+ * Delete the entry in slot \a s. If the next slot is empty, no probe
+ * sequence passes through this slot, or any deleted slots before it,
+ * so they may be marked empty. Likewise, if the table is now empty.
+ */
+static void delete_slot(struct nl_nfct_table *t, struct nl_nfct_slot *s)
+{
+	__u32 i, n, mask = t->size - 1;
+
+	i = (__u32)(s - t->slots);
+	write_begin(s);
+	s->hash = SLOT_DELETED;
+	write_end(s);
+
+	if (!--t->count) {
+		for (i = 0; i < t->size; i++)
+			t->slots[i].hash = SLOT_EMPTY;
+		return;
+	}
+
+	if (t->slots[(i + 1) & mask].hash != SLOT_EMPTY)
+		return;
+
+	for (n = 0; n < t->size && t->slots[i].hash == SLOT_DELETED; n++) {
+		s = &t->slots[i];
+		write_begin(s);
+		s->hash = SLOT_EMPTY;
+		write_end(s);
+		i = (i - 1) & mask;
+	}
+}
+
+/**
+ * \brief Delete an entry
+ * \param[in] t    Table
+ * \param[in] key  Original tuple
+ * \param[in] zone Zone
+ * \return 0 on success, or -1 if not found (with \a errno set to ENOENT.)
+ */
+int nl_nfct_table_delete(struct nl_nfct_table *t,
+                         const struct nl_nfct_tuple *key, __u16 zone)
+{
+	struct nl_nfct_slot *s;
+
+	if (!t || !key || !(s = find(t, key, zone, hash_key(t, key, zone)))) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	delete_slot(t, s);
+	return 0;
+}
+
+/**
+ * \brief Apply a conntrack message to the table
+ * \param[in] t Table
+ * \param[in] m Netlink message buffer (dump reply or event)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * IPCTNL_MSG_CT_NEW messages add or update an entry, and
+ * IPCTNL_MSG_CT_DELETE messages delete it. Other messages are ignored.
+ */
+int nl_nfct_table_apply(struct nl_nfct_table *t, struct nlmsghdr *m)
+{
+	struct nl_nfct_flow f;
+
+	if (!t || !m) goto inval;
+	if ((m->nlmsg_type >> 8) != NFNL_SUBSYS_CTNETLINK) return 0;
+	switch (m->nlmsg_type & 0xff) {
+	case IPCTNL_MSG_CT_NEW:
+		if (nl_nfct_parse(m, &f)) return -1;
+		return nl_nfct_table_update(t, &f);
+	case IPCTNL_MSG_CT_DELETE:
+		if (nl_nfct_parse(m, &f)) return -1;
+		nl_nfct_table_delete(t, &f.orig, f.zone);
+		return 0;
+	default: return 0;
+	}
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Begin resynchronizing the table
+ * \param[in] t Table
+ *
+ * Call this before dumping the conntrack table again (i.e. after
+ * the event socket overflows with ENOBUFS), and apply the dump (and
+ * any events received meanwhile) as usual.
+ */
+void nl_nfct_table_resync_begin(struct nl_nfct_table *t)
+{
+	if (t) ++t->gen;
+}
+
+/**
+ * \brief Finish resynchronizing the table
+ * \param[in] t Table
+ * \return The number of stale entries deleted.
+ *
+ * Deletes the entries that weren't seen since nl_nfct_table_resync_begin().
+ */
+__u32 nl_nfct_table_resync_end(struct nl_nfct_table *t)
+{
+	__u32 i, n = 0;
+	struct nl_nfct_slot *s;
+
+	if (!t) goto ret;
+	for (i = 0; i < t->size; i++) {
+		s = &t->slots[i];
+		if (s->hash > SLOT_DELETED && s->gen != t->gen) {
+			delete_slot(t, s);
+			++n;
+		}
+	}
+
+ret:
+	return n;
+}
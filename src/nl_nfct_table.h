@@ -0,0 +1,130 @@
+/**
+ * \file nl_nfct_table.h
+ *
+ * nanonl: Conntrack mirror table
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NFCT_TABLE_H
+#define NL_NFCT_TABLE_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+
+#include "nl_nfct.h"
+
+/**
+ * \brief Conntrack table slot
+ *
+ * Each slot is guarded by its own sequence counter, which is odd
+ * while the slot is being written.
+ */
+struct nl_nfct_slot {
+	__u32 seq;               /**< Sequence counter */
+	__u32 hash;              /**< Hash (0 = empty, 1 = deleted) */
+	__u32 gen;               /**< Generation the entry was last seen in */
+	struct nl_nfct_flow flow; /**< Conntrack entry */
+};
+
+/**
+ * \brief Conntrack table
+ *
+ * An open-addressing (linear probing) hash table of conntrack entries,
+ * keyed by the original tuple and zone, in caller-supplied storage.
+ *
+ * The table may be modified by one thread at a time, while any number
+ * of threads may look up entries concurrently without locking. Readers
+ * retry a slot if it changes while they're reading it.
+ *
+ * Lookups degrade as the table fills, so it should have at least twice
+ * as many slots as the expected number of entries.
+ */
+struct nl_nfct_table {
+	struct nl_nfct_slot *slots; /**< Slots */
+	__u32 size;                 /**< Number of slots (a power of 2) */
+	__u32 count;                /**< Number of entries */
+	__u32 gen;                  /**< Current generation */
+	__u32 seed;                 /**< Hash seed */
+};
+
+/**
+ * \brief Initialize a conntrack table
+ * \param[in] t     Table
+ * \param[in] slots Slot storage
+ * \param[in] n     Number of slots (must be a power of 2)
+ * \param[in] seed  Hash seed (should be random)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ */
+int nl_nfct_table_init(struct nl_nfct_table *t, struct nl_nfct_slot *slots,
+                       __u32 n, __u32 seed);
+
+/**
+ * \brief Look up an entry
+ * \param[in]  t    Table
+ * \param[in]  key  Original tuple
+ * \param[in]  zone Zone
+ * \param[out] f    Copy of the entry (if found)
+ * \return 0 if found, or -1 otherwise (with \a errno set to ENOENT.)
+ *
+ * This may be called concurrently with modifications to the table.
+ */
+int nl_nfct_table_lookup(const struct nl_nfct_table *t,
+                         const struct nl_nfct_tuple *key, __u16 zone,
+                         struct nl_nfct_flow *f);
+
+/**
+ * \brief Add or update an entry
+ * \param[in] t Table
+ * \param[in] f Conntrack entry
+ * \return 0 on success, or -1 if the table is full (with \a errno
+ *         set to ENOSPC.)
+ *
+ * Update events don't carry the counters or timestamps, so these are
+ * only replaced by non-zero values.
+ */
+int nl_nfct_table_update(struct nl_nfct_table *t,
+                         const struct nl_nfct_flow *f);
+
+/**
+ * \brief Delete an entry
+ * \param[in] t    Table
+ * \param[in] key  Original tuple
+ * \param[in] zone Zone
+ * \return 0 on success, or -1 if not found (with \a errno set to ENOENT.)
+ */
+int nl_nfct_table_delete(struct nl_nfct_table *t,
+                         const struct nl_nfct_tuple *key, __u16 zone);
+
+/**
+ * \brief Apply a conntrack message to the table
+ * \param[in] t Table
+ * \param[in] m Netlink message buffer (dump reply or event)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * IPCTNL_MSG_CT_NEW messages add or update an entry, and
+ * IPCTNL_MSG_CT_DELETE messages delete it. Other messages are ignored.
+ */
+int nl_nfct_table_apply(struct nl_nfct_table *t, struct nlmsghdr *m);
+
+/**
+ * \brief Begin resynchronizing the table
+ * \param[in] t Table
+ *
+ * Call this before dumping the conntrack table again (i.e. after
+ * the event socket overflows with ENOBUFS), and apply the dump (and
+ * any events received meanwhile) as usual.
+ */
+void nl_nfct_table_resync_begin(struct nl_nfct_table *t);
+
+/**
+ * \brief Finish resynchronizing the table
+ * \param[in] t Table
+ * \return The number of stale entries deleted.
+ *
+ * Deletes the entries that weren't seen since nl_nfct_table_resync_begin().
+ */
+__u32 nl_nfct_table_resync_end(struct nl_nfct_table *t);
+
+#endif /* NL_NFCT_TABLE_H */
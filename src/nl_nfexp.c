@@ -0,0 +1,175 @@
+/**
+ * nanonl: Netlink Conntrack Expectation Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "nl.h"
+#include "nl_nfexp.h"
+
+static void add_u32(struct nlmsghdr *m, __u16 type, __u32 v)
+{
+	v = htonl(v);
+	nl_add_attr(m, type, &v, sizeof v);
+}
+
+/**
+ * \brief Request a dump of all expectations
+ * \param[in] m       Netlink message buffer
+ * \param[in] l3proto Layer 3 protocol (NFPROTO_*)
+ */
+void nl_nfexp_dump(struct nlmsghdr *m, __u8 l3proto)
+{
+	if (!m) return;
+	nl_nfexp_get(m, l3proto);
+	m->nlmsg_flags |= NLM_F_DUMP;
+}
+
+/**
+ * \brief Create an expectation
+ * \param[in] m Netlink message buffer
+ * \param[in] e Expectation
+ *
+ * The master connection must exist, and have a helper attached, unless
+ * a timeout is given. The helper name is only added if set. Many
+ * expectations may be created at once by building them in a batch:
+ *
+ * \code{.c}
+ * while (n && (m = nl_batch_next(&b, NLMSG_GOODSIZE >> 4))) {
+ * 	nl_nfexp_create(m, &e[--n]);
+ * 	nl_batch_add(&b);
+ * }
+ * \endcode
+ */
+void nl_nfexp_create(struct nlmsghdr *m, const struct nl_nfexp *e)
+{
+	__u16 zone;
+	const char *end;
+
+	if (!m || !e) return;
+	nl_nfexp_request(m, 0, IPCTNL_MSG_EXP_NEW, e->tuple.l3proto);
+	m->nlmsg_flags |= NLM_F_CREATE;
+	nl_nfct_add_tuple(m, CTA_EXPECT_MASTER, &e->master);
+	nl_nfct_add_tuple(m, CTA_EXPECT_TUPLE,  &e->tuple);
+	nl_nfct_add_tuple(m, CTA_EXPECT_MASK,   &e->mask);
+	if (e->timeout) add_u32(m, CTA_EXPECT_TIMEOUT, e->timeout);
+	if (e->flags)   add_u32(m, CTA_EXPECT_FLAGS,   e->flags);
+	if (*e->helper) {
+		end = memchr(e->helper, 0, sizeof e->helper);
+		if (!end) end = e->helper + sizeof e->helper - 1;
+		nl_add_attr(m, CTA_EXPECT_HELP_NAME, e->helper,
+		            (size_t)(end - e->helper) + 1);
+	}
+
+	if (e->zone) {
+		zone = htons(e->zone);
+		nl_add_attr(m, CTA_EXPECT_ZONE, &zone, sizeof zone);
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
+	if (e->exp_class) add_u32(m, CTA_EXPECT_CLASS, e->exp_class);
+#endif
+}
+
+/**
+ * \brief Fill in a mask matching a tuple exactly
+ * \param[out] mask Mask
+ * \param[in]  t    Tuple to be masked
+ *
+ * Only the fields the tuple is encoded with are set. The layer 3 and 4
+ * protocols are copied from \a t, since the kernel uses them to decode
+ * the mask. Clear the source address or port in \a mask to match any
+ * source address or port.
+ */
+void nl_nfexp_mask_exact(struct nl_nfct_tuple *mask,
+                         const struct nl_nfct_tuple *t)
+{
+	size_t alen = sizeof(__u32);
+
+	if (!mask || !t) return;
+	if (t->l3proto == NFPROTO_IPV6) alen = sizeof t->src;
+	memset(mask, 0, sizeof *mask);
+	memset(mask->src, 0xff, alen);
+	memset(mask->dst, 0xff, alen);
+	mask->sport   = 0xffff;
+	mask->dport   = 0xffff;
+	mask->l3proto = t->l3proto;
+	mask->l4proto = t->l4proto;
+	if (t->l4proto == IPPROTO_ICMP || t->l4proto == IPPROTO_ICMPV6) {
+		mask->icmp_type = 0xff;
+		mask->icmp_code = 0xff;
+	}
+}
+
+/**
+ * \brief Decode an expectation message
+ * \param[in]  m Netlink message buffer
+ * \param[out] e Expectation
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This decodes an expectation message (i.e. a dump reply or an event)
+ * in a single pass over its attributes. The message must have an
+ * expected tuple.
+ */
+int nl_nfexp_parse(struct nlmsghdr *m, struct nl_nfexp *e)
+{
+	int ret = -1;
+	size_t len;
+	struct nlattr *nla;
+	struct nfgenmsg *nf;
+
+	if (!m || !e || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *nf))
+		goto inval;
+
+	memset(e, 0, sizeof *e);
+	nf        = NLMSG_DATA(m);
+	e->type   = (__u8)(m->nlmsg_type & 0xff);
+	e->family = nf->nfgen_family;
+	nla = BYTE_OFF(nf, NLMSG_ALIGN(sizeof *nf));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+		len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case CTA_EXPECT_MASTER:
+			nl_nfct_parse_tuple(nla, e->family, &e->master);
+			break;
+		case CTA_EXPECT_TUPLE:
+			nl_nfct_parse_tuple(nla, e->family, &e->tuple);
+			ret = 0;
+			break;
+		case CTA_EXPECT_MASK:
+			nl_nfct_parse_tuple(nla, e->family, &e->mask);
+			break;
+		case CTA_EXPECT_TIMEOUT: e->timeout = nla_u32_be(nla); break;
+		case CTA_EXPECT_ID:      e->id      = nla_u32_be(nla); break;
+		case CTA_EXPECT_FLAGS:   e->flags   = nla_u32_be(nla); break;
+		case CTA_EXPECT_ZONE:    e->zone    = nla_u16_be(nla); break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
+		case CTA_EXPECT_CLASS:   e->exp_class = nla_u32_be(nla); break;
+#endif
+		case CTA_EXPECT_HELP_NAME:
+			if (len >= sizeof e->helper) len = sizeof e->helper - 1;
+			memcpy(e->helper, NLA_DATA(nla), len);
+			break;
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	if (!ret) goto ret;
+
+inval:
+	errno = EINVAL;
+
+ret:
+	return ret;
+}
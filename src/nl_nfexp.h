@@ -0,0 +1,129 @@
+/**
+ * \file nl_nfexp.h
+ *
+ * nanonl: Netlink Conntrack Expectation functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NFEXP_H
+#define NL_NFEXP_H
+
+#include <sys/types.h>
+#include <linux/version.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+
+#include "nl_nfct.h"
+
+/**
+ * \brief Conntrack expectation
+ *
+ * A packet matches the expectation if its tuple matches \a tuple, with
+ * the source address and port compared only in the bits set in \a mask.
+ * The expected connection is then related to the \a master connection.
+ *
+ * Filled by nl_nfexp_parse(). Addresses are in network byte order,
+ * everything else is in host byte order.
+ */
+struct nl_nfexp {
+	struct nl_nfct_tuple master; /**< Original tuple of the master */
+	struct nl_nfct_tuple tuple;  /**< Expected tuple */
+	struct nl_nfct_tuple mask;   /**< Mask for \a tuple */
+	__u32 timeout;               /**< Timeout (in seconds) */
+	__u32 id;                    /**< Expectation ID */
+	__u32 flags;                 /**< Flags (NF_CT_EXPECT_*) */
+	__u32 exp_class;             /**< Helper expectation class */
+	__u16 zone;                  /**< Zone */
+	__u8 type;                   /**< Message type (IPCTNL_MSG_EXP_*) */
+	__u8 family;                 /**< Layer 3 protocol (NFPROTO_*) */
+	char helper[16];             /**< Helper name (NUL-terminated) */
+};
+
+/**
+ * \brief Create a netlink_conntrack expectation request.
+ * \param[in] m    Netlink message buffer.
+ * \param[in] pid  Destination netlink port.
+ * \param[in] type message type (IPCTNL_MSG_EXP_*).
+ * \param[in] l3p  Layer 3 protocol (NFPROTO_*).
+ * \relates nl_request
+ */
+#define nl_nfexp_request(m, pid, type, l3p) \
+	nl_nf_request((m), (pid), NFNL_SUBSYS_CTNETLINK_EXP, (type), (l3p), 0)
+
+/**
+ * \brief Get an expectation
+ * \param[in] m   Netlink message buffer
+ * \param[in] l3p Layer 3 protocol (NFPROTO_*)
+ *
+ * Note: The expected tuple (CTA_EXPECT_TUPLE) or the master tuple
+ * (CTA_EXPECT_MASTER) must be added to the message.
+ */
+#define nl_nfexp_get(m, l3p) \
+	nl_nfexp_request((m), 0, IPCTNL_MSG_EXP_GET, (l3p))
+
+/**
+ * \brief Delete one/all expectations
+ * \param[in] m   Netlink message buffer
+ * \param[in] l3p Layer 3 protocol (NFPROTO_*)
+ *
+ * Note: The expected tuple (CTA_EXPECT_TUPLE) or a helper name
+ * (CTA_EXPECT_HELP_NAME) may be added to the message to select the
+ * expectations to delete. Otherwise, all of them will be deleted.
+ */
+#define nl_nfexp_delete(m, l3p) \
+	nl_nfexp_request((m), 0, IPCTNL_MSG_EXP_DELETE, (l3p))
+
+/**
+ * \brief Request a dump of all expectations
+ * \param[in] m       Netlink message buffer
+ * \param[in] l3proto Layer 3 protocol (NFPROTO_*)
+ */
+void nl_nfexp_dump(struct nlmsghdr *m, __u8 l3proto);
+
+/**
+ * \brief Create an expectation
+ * \param[in] m Netlink message buffer
+ * \param[in] e Expectation
+ *
+ * The master connection must exist, and have a helper attached, unless
+ * a timeout is given. The helper name is only added if set. Many
+ * expectations may be created at once by building them in a batch:
+ *
+ * \code{.c}
+ * while (n && (m = nl_batch_next(&b, NLMSG_GOODSIZE >> 4))) {
+ * 	nl_nfexp_create(m, &e[--n]);
+ * 	nl_batch_add(&b);
+ * }
+ * \endcode
+ */
+void nl_nfexp_create(struct nlmsghdr *m, const struct nl_nfexp *e);
+
+/**
+ * \brief Fill in a mask matching a tuple exactly
+ * \param[out] mask Mask
+ * \param[in]  t    Tuple to be masked
+ *
+ * Only the fields the tuple is encoded with are set. The layer 3 and 4
+ * protocols are copied from \a t, since the kernel uses them to decode
+ * the mask. Clear the source address or port in \a mask to match any
+ * source address or port.
+ */
+void nl_nfexp_mask_exact(struct nl_nfct_tuple *mask,
+                         const struct nl_nfct_tuple *t);
+
+/**
+ * \brief Decode an expectation message
+ * \param[in]  m Netlink message buffer
+ * \param[out] e Expectation
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * This decodes an expectation message (i.e. a dump reply or an event)
+ * in a single pass over its attributes. The message must have an
+ * expected tuple.
+ */
+int nl_nfexp_parse(struct nlmsghdr *m, struct nl_nfexp *e);
+
+#endif /* NL_NFEXP_H */
@@ -0,0 +1,217 @@
+/**
+ * nanonl: Netlink Netfilter Log Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "nl.h"
+#include "nl_nflog.h"
+
+static void add_u32(struct nlmsghdr *m, __u16 type, __u32 v)
+{
+	v = htonl(v);
+	nl_add_attr(m, type, &v, sizeof v);
+}
+
+/**
+ * Add the given options to a config message
+ */
+static void add_opts(struct nlmsghdr *m, const struct nl_nflog_opts *o)
+{
+	__u16 fl;
+	struct nfulnl_msg_config_mode mode;
+
+	if (o->cmode) {
+		memset(&mode, 0, sizeof mode);
+		mode.copy_mode  = o->cmode;
+		mode.copy_range = htonl(o->crange);
+		nl_add_attr(m, NFULA_CFG_MODE, &mode, sizeof mode);
+	}
+
+	if (o->nlbufsiz) add_u32(m, NFULA_CFG_NLBUFSIZ, o->nlbufsiz);
+	if (o->timeout)  add_u32(m, NFULA_CFG_TIMEOUT,  o->timeout);
+	if (o->qthresh)  add_u32(m, NFULA_CFG_QTHRESH,  o->qthresh);
+	if (o->flags) {
+		fl = htons(o->flags);
+		nl_add_attr(m, NFULA_CFG_FLAGS, &fl, sizeof fl);
+	}
+}
+
+/**
+ * \brief Make a nflog config command message
+ * \param[in] m     Netlink message buffer.
+ * \param[in] cmd   Netlink nflog command (NFULNL_CFG_CMD_*).
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group Log group.
+ */
+void nl_nflog_cfg_cmd(struct nlmsghdr *m, __u8 cmd, __u16 pf, __u16 group)
+{
+	struct nfulnl_msg_config_cmd c;
+
+	if (!m) return;
+	c.command = cmd;
+	nl_nflog_request(m, 0, NFULNL_MSG_CONFIG, (__u8)pf, group);
+	nl_add_attr(m, NFULA_CFG_CMD, &c, sizeof c);
+}
+
+/**
+ * \brief Bind to a log group, with the given options
+ * \param[in] m     Netlink message buffer.
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group log group (as given to iptables.)
+ * \param[in] o     Binding options.
+ */
+void nl_nflog_bind_opts(struct nlmsghdr *m, __u16 pf, __u16 group,
+                        const struct nl_nflog_opts *o)
+{
+	if (!m || !o) return;
+	nl_nflog_cfg_cmd(m, NFULNL_CFG_CMD_BIND, pf, group);
+	add_opts(m, o);
+}
+
+/**
+ * \brief Change the options of a bound log group
+ * \param[in] m     Netlink message buffer.
+ * \param[in] group log group (as given to iptables.)
+ * \param[in] o     Options.
+ */
+void nl_nflog_set_opts(struct nlmsghdr *m, __u16 group,
+                       const struct nl_nflog_opts *o)
+{
+	if (!m || !o) return;
+	nl_nflog_request(m, 0, NFULNL_MSG_CONFIG, AF_UNSPEC, group);
+	add_opts(m, o);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+/**
+ * Decode the VLAN info (NFULA_VLAN)
+ */
+static void parse_vlan(struct nlattr *vlan, struct nl_nflog_pkt *p)
+{
+	struct nlattr *nla;
+
+	nla_each(nla, vlan) {
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case NFULA_VLAN_PROTO: p->vlan_proto = nla_u16_be(nla); break;
+		case NFULA_VLAN_TCI:   p->vlan_tci   = nla_u16_be(nla); break;
+		default: break;
+		}
+	}
+}
+#endif /* Linux >= 4.7.0 */
+
+/**
+ * \brief Decode a logged packet
+ * \param[in]  m Netlink message buffer.
+ * \param[out] p Decoded packet.
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This decodes every attribute of a NFULNL_MSG_PACKET message in a single
+ * pass. When the kernel batches packets, each datagram holds several
+ * such messages (flagged with NLM_F_MULTI, and followed by NLMSG_DONE),
+ * which should be decoded in turn:
+ *
+ * \code{.c}
+ * for (e = m; NLMSG_OK(e, len); e = NLMSG_NEXT(e, len)) {
+ * 	if (!nl_nflog_parse(e, &p))
+ * 		log_packet(&p);
+ * }
+ * \endcode
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or if \a m isn't a NFULNL_MSG_PACKET message.
+ */
+int nl_nflog_parse(struct nlmsghdr *m, struct nl_nflog_pkt *p)
+{
+	size_t len;
+	struct nlattr *nla;
+	struct nfulnl_msg_packet_hdr *ph;
+	struct nfulnl_msg_packet_hw *hw;
+	struct nfulnl_msg_packet_timestamp *ts;
+
+	if (!m || !p || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_type != (NFNL_SUBSYS_ULOG << 8 | NFULNL_MSG_PACKET) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof(struct nfgenmsg))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(p, 0, sizeof *p);
+	p->uid = p->gid = (__u32)-1;
+	nla = BYTE_OFF(NLMSG_DATA(m), NLMSG_ALIGN(sizeof(struct nfgenmsg)));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+		len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case NFULA_PACKET_HDR:
+			if (len < sizeof *ph) break;
+			ph             = NLA_DATA(nla);
+			p->hw_protocol = ntohs(ph->hw_protocol);
+			p->hook        = ph->hook;
+			break;
+		case NFULA_MARK:           p->mark   = nla_u32_be(nla); break;
+		case NFULA_IFINDEX_INDEV:  p->indev  = nla_u32_be(nla); break;
+		case NFULA_IFINDEX_OUTDEV: p->outdev = nla_u32_be(nla); break;
+		case NFULA_IFINDEX_PHYSINDEV:
+			p->physindev = nla_u32_be(nla);
+			break;
+		case NFULA_IFINDEX_PHYSOUTDEV:
+			p->physoutdev = nla_u32_be(nla);
+			break;
+		case NFULA_TIMESTAMP:
+			if (len < sizeof *ts) break;
+			ts         = NLA_DATA(nla);
+			p->ts_sec  = nl_be64_to_host(&ts->sec);
+			p->ts_usec = nl_be64_to_host(&ts->usec);
+			break;
+		case NFULA_HWADDR:
+			if (len < sizeof *hw) break;
+			hw = NLA_DATA(nla);
+			p->hwaddr     = hw->hw_addr;
+			p->hwaddr_len = (__u8)ntohs(hw->hw_addrlen);
+			if (p->hwaddr_len > sizeof hw->hw_addr)
+				p->hwaddr_len = sizeof hw->hw_addr;
+			break;
+		case NFULA_PAYLOAD:
+			p->payload     = NLA_DATA(nla);
+			p->payload_len = (__u32)len;
+			break;
+		case NFULA_PREFIX:
+			if (len) p->prefix = NLA_DATA(nla);
+			break;
+		case NFULA_UID:        p->uid        = nla_u32_be(nla); break;
+		case NFULA_GID:        p->gid        = nla_u32_be(nla); break;
+		case NFULA_SEQ:        p->seq        = nla_u32_be(nla); break;
+		case NFULA_SEQ_GLOBAL: p->seq_global = nla_u32_be(nla); break;
+		case NFULA_HWTYPE:     p->hw_type    = nla_u16_be(nla); break;
+		case NFULA_HWLEN:      p->hw_len     = nla_u16_be(nla); break;
+		case NFULA_HWHEADER:
+			if (len) p->hw_header = NLA_DATA(nla);
+			break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)
+		case NFULA_CT:      p->ct      = nla;          break;
+		case NFULA_CT_INFO: p->ct_info = nla_u32_be(nla); break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+		case NFULA_VLAN: parse_vlan(nla, p); break;
+		case NFULA_L2HDR:
+			p->l2hdr     = len ? NLA_DATA(nla) : NULL;
+			p->l2hdr_len = (__u32)len;
+			break;
+#endif
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	return 0;
+}
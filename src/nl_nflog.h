@@ -0,0 +1,192 @@
+/**
+ * \file nl_nflog.h
+ *
+ * nanonl: Netlink Netfilter Log functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NFLOG_H
+#define NL_NFLOG_H
+
+#include <sys/types.h>
+#include <linux/version.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink_log.h>
+
+#include "nl_nf.h"
+
+/**
+ * \brief Log group binding options
+ *
+ * The kernel holds logged packets until \a qthresh of them are queued,
+ * the buffer (\a nlbufsiz bytes) fills up, or \a timeout expires, and
+ * then sends all of them in a single datagram. Raising these reduces
+ * the number of datagrams (and system calls) per packet, at the cost
+ * of latency. The receive buffer must be at least \a nlbufsiz bytes.
+ *
+ * Options left as zero aren't sent, and keep the kernel's defaults
+ * (1 packet, 1 second, and 4096 bytes, respectively.) The copy mode
+ * (and range) is only sent with a non-zero \a cmode, so that it isn't
+ * changed to NFULNL_COPY_NONE by accident. NFULNL_COPY_META likewise
+ * copies no packet data.
+ *
+ * The flags (NFULNL_CFG_F_*) are:
+ *
+ * NFULNL_CFG_F_SEQ        - Send a per-group sequence number
+ * NFULNL_CFG_F_SEQ_GLOBAL - Send a global sequence number
+ * NFULNL_CFG_F_CONNTRACK  - Send conntrack info with each packet (4.1)
+ */
+struct nl_nflog_opts {
+	__u8  cmode;    /**< Metadata only, or whole packets (NFULNL_COPY_*) */
+	__u32 crange;   /**< Amount of packet data to copy (in bytes) */
+	__u32 qthresh;  /**< Packets to queue before sending them */
+	__u32 timeout;  /**< Time to queue packets for (in 1/100 s) */
+	__u32 nlbufsiz; /**< Size of the kernel's buffer (in bytes) */
+	__u16 flags;    /**< Flags (NFULNL_CFG_F_*) */
+};
+
+/**
+ * \brief Decoded view of a logged packet
+ *
+ * Filled by nl_nflog_parse(). Integers are in host byte order, and
+ * pointers refer directly to the message they were decoded from.
+ * Attributes absent from the message are zero (or NULL), except for
+ * \a uid and \a gid, which are (__u32)-1 if absent.
+ */
+struct nl_nflog_pkt {
+	__u16 hw_protocol;      /**< Hardware protocol (i.e. ETH_P_IP) */
+	__u16 hw_type;          /**< Hardware type (ARPHRD_*) */
+	__u16 hw_len;           /**< Length of \a hw_header */
+	__u16 vlan_proto;       /**< VLAN protocol (i.e. ETH_P_8021Q) */
+	__u16 vlan_tci;         /**< VLAN TCI */
+	__u8  hook;             /**< Netfilter hook (NF_INET_*) */
+	__u8  hwaddr_len;       /**< Length of \a hwaddr */
+	__u32 mark;             /**< Packet mark */
+	__u32 indev;            /**< Input interface index */
+	__u32 outdev;           /**< Output interface index */
+	__u32 physindev;        /**< Physical input interface index */
+	__u32 physoutdev;       /**< Physical output interface index */
+	__u32 uid;              /**< Socket UID */
+	__u32 gid;              /**< Socket GID */
+	__u32 seq;              /**< Per-group sequence number */
+	__u32 seq_global;       /**< Global sequence number */
+	__u32 ct_info;          /**< Conntrack state (enum ip_conntrack_info) */
+	__u32 payload_len;      /**< Length of \a payload */
+	__u32 l2hdr_len;        /**< Length of \a l2hdr */
+	__u64 ts_sec;           /**< Timestamp (seconds) */
+	__u64 ts_usec;          /**< Timestamp (microseconds) */
+	const __u8 *hwaddr;     /**< Source hardware address */
+	const void *hw_header;  /**< Hardware header */
+	const void *l2hdr;      /**< Full layer 2 header */
+	void *payload;          /**< Packet payload */
+	const char *prefix;     /**< Log prefix */
+	struct nlattr *ct;      /**< Conntrack info (NFULA_CT) */
+};
+
+/**
+ * \brief Create a netlink_nflog request.
+ * \param[in] m     Netlink message buffer.
+ * \param[in] pid   Destination netlink port.
+ * \param[in] type  message type (nfulnl_msg_types).
+ * \param[in] pf    address family for binding.
+ * \param[in] group log group (as given to iptables.)
+ * \relates nl_request
+ */
+#define nl_nflog_request(m, pid, type, pf, group) \
+	nl_nf_request((m), (pid), NFNL_SUBSYS_ULOG, (type), (pf), (group))
+
+/* These calls aren't needed on Linux >= 3.8 */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,8,0)
+/**
+ * \brief Bind to the given protocol family
+ * \param[in] m  Netlink message buffer.
+ * \param[in] pf Protocol family (i.e. PF_INET)
+ */
+#define nl_nflog_bind_pf(m, pf) \
+	nl_nflog_cfg_cmd((m), NFULNL_CFG_CMD_PF_BIND, (pf), 0)
+
+/**
+ * \brief Unbind from the given protocol family
+ * \param[in] m  Netlink message buffer.
+ * \param[in] pf Protocol family (i.e. PF_INET)
+ */
+#define nl_nflog_unbind_pf(m, pf) \
+	nl_nflog_cfg_cmd((m), NFULNL_CFG_CMD_PF_UNBIND, (pf), 0)
+#else
+#define nl_nflog_bind_pf(m, pf)
+#define nl_nflog_unbind_pf(m, pf)
+#endif /* Linux < 3.8.0 */
+
+/**
+ * \brief Bind to a log group, with the kernel's default options
+ * \param[in] m     Netlink message buffer.
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group log group (as given to iptables.)
+ */
+#define nl_nflog_bind(m, pf, group) \
+	nl_nflog_cfg_cmd((m), NFULNL_CFG_CMD_BIND, (pf), (group))
+
+/**
+ * \brief Unbind from a log group
+ * \param[in] m     Netlink message buffer.
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group log group (as given to iptables.)
+ */
+#define nl_nflog_unbind(m, pf, group) \
+	nl_nflog_cfg_cmd((m), NFULNL_CFG_CMD_UNBIND, (pf), (group))
+
+/**
+ * \brief Make a nflog config command message
+ * \param[in] m     Netlink message buffer.
+ * \param[in] cmd   Netlink nflog command (NFULNL_CFG_CMD_*).
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group Log group.
+ */
+void nl_nflog_cfg_cmd(struct nlmsghdr *m, __u8 cmd, __u16 pf, __u16 group);
+
+/**
+ * \brief Bind to a log group, with the given options
+ * \param[in] m     Netlink message buffer.
+ * \param[in] pf    Protocol family (i.e. PF_INET).
+ * \param[in] group log group (as given to iptables.)
+ * \param[in] o     Binding options.
+ */
+void nl_nflog_bind_opts(struct nlmsghdr *m, __u16 pf, __u16 group,
+                        const struct nl_nflog_opts *o);
+
+/**
+ * \brief Change the options of a bound log group
+ * \param[in] m     Netlink message buffer.
+ * \param[in] group log group (as given to iptables.)
+ * \param[in] o     Options.
+ */
+void nl_nflog_set_opts(struct nlmsghdr *m, __u16 group,
+                       const struct nl_nflog_opts *o);
+
+/**
+ * \brief Decode a logged packet
+ * \param[in]  m Netlink message buffer.
+ * \param[out] p Decoded packet.
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This decodes every attribute of a NFULNL_MSG_PACKET message in a single
+ * pass. When the kernel batches packets, each datagram holds several
+ * such messages (flagged with NLM_F_MULTI, and followed by NLMSG_DONE),
+ * which should be decoded in turn:
+ *
+ * \code{.c}
+ * for (e = m; NLMSG_OK(e, len); e = NLMSG_NEXT(e, len)) {
+ * 	if (!nl_nflog_parse(e, &p))
+ * 		log_packet(&p);
+ * }
+ * \endcode
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or if \a m isn't a NFULNL_MSG_PACKET message.
+ */
+int nl_nflog_parse(struct nlmsghdr *m, struct nl_nflog_pkt *p);
+
+#endif /* NL_NFLOG_H */
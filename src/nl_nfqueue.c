@@ -6,11 +6,16 @@
  * See the LICENSE file for details.
  */
 
+#include <string.h>
+#include <errno.h>
 #include <arpa/inet.h>
 
 #include "nl.h"
 #include "nl_nfqueue.h"
 
+/* Zero padding to align out-of-line payloads */
+static char nla_pad[NLA_ALIGNTO];
+
 /**
  * \brief Make a nfqueue config command message
  * \param[in] m   Netlink message buffer.
@@ -44,26 +49,60 @@ void nl_nfqueue_cfg_cmd(struct nlmsghdr *m, __u8 cmd, __u16 pf, __u16 qn)
  */
 void nl_nfqueue_bind(struct nlmsghdr *m, __u16 pf, __u16 queue_num,
                      __u8 cmode, __u32 crange, __u32 maxlen, int want_ct)
+{
+	struct nl_nfqueue_opts o;
+	o.cmode  = cmode;
+	o.crange = crange;
+	o.maxlen = maxlen;
+	o.flags  = 0;
+	o.mask   = 0;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0)
+	if (want_ct) o.flags = NFQA_CFG_F_CONNTRACK;
+#else
+	(void)want_ct;
+#endif /* Linux < 3.6.0 */
+
+	nl_nfqueue_bind_opts(m, pf, queue_num, &o);
+}
+
+/**
+ * \brief Bind to a packet queue, with the given options
+ * \param[in] m         Netlink message buffer.
+ * \param[in] pf        Protocol family (i.e. PF_INET).
+ * \param[in] queue_num queue number (as given to iptables.)
+ * \param[in] o         Binding options.
+ *
+ * The queue flags are only sent if \a flags or \a mask is non-zero, and
+ * are only available on Linux 3.6 or higher.
+ *
+ * When binding with NFQA_CFG_F_GSO, packets may be larger than the MTU,
+ * and may not have a valid checksum yet. Check nl_nfqueue_skb_info()
+ * for NFQA_SKB_GSO and NFQA_SKB_CSUMNOTREADY before mangling them.
+ */
+void nl_nfqueue_bind_opts(struct nlmsghdr *m, __u16 pf, __u16 queue_num,
+                          const struct nl_nfqueue_opts *o)
 {
 	__u32 fl;
 	struct nfqnl_msg_config_params params;
-	params.copy_mode  = cmode;
-	params.copy_range = htonl(crange);
+
+	if (!m || !o) return;
+	params.copy_mode  = o->cmode;
+	params.copy_range = htonl(o->crange);
 	nl_nfqueue_cfg_cmd(m, NFQNL_CFG_CMD_BIND, pf, queue_num);
 	nl_add_attr(m, NFQA_CFG_PARAMS, &params, sizeof params);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0)
-	if (want_ct) {
-		fl = htonl(NFQA_CFG_F_CONNTRACK);
+	if (o->flags || o->mask) {
+		fl = htonl(o->flags);
 		nl_add_attr(m, NFQA_CFG_FLAGS, &fl, sizeof fl);
+		fl = htonl(o->mask ? o->mask : o->flags);
 		nl_add_attr(m, NFQA_CFG_MASK,  &fl, sizeof fl);
 	}
-#else
-	(void)want_ct;
 #endif /* Linux < 3.6.0 */
 
-	if (maxlen) {
-		fl = htonl(maxlen);
+	if (o->maxlen) {
+		fl = htonl(o->maxlen);
 		nl_add_attr(m, NFQA_CFG_QUEUE_MAXLEN, &fl, sizeof fl);
 	}
 }
@@ -89,6 +128,161 @@ void nl_nfqueue_verdict(struct nlmsghdr *m, __u16 queue_num,
 	nl_add_attr(m, NFQA_VERDICT_HDR, &v, sizeof v);
 }
 
+/**
+ * \brief Create a batch verdict message
+ * \param[in] m          Netlink message buffer.
+ * \param[in] queue_num  queue number (as given to iptables.)
+ * \param[in] packet_id  ID of the last packet to adjudicate.
+ * \param[in] verdict    Verdict for the packets (see: linux/netfilter.h)
+ *
+ * The verdict is applied to every packet still in the queue with an ID
+ * less than or equal to \a packet_id. Marks may be added to the message,
+ * and are applied to each packet.
+ */
+void nl_nfqueue_verdict_batch(struct nlmsghdr *m, __u16 queue_num,
+                              __u32 packet_id, __u32 verdict)
+{
+	nl_nfqueue_verdict(m, queue_num, packet_id, verdict);
+	m->nlmsg_type = (NFNL_SUBSYS_QUEUE << 8) | NFQNL_MSG_VERDICT_BATCH;
+}
+
+/**
+ * \brief Initialize a verdict accumulator
+ * \param[in] b           Verdict accumulator.
+ * \param[in] queue_num   queue number (as given to iptables.)
+ * \param[in] max_pending Flush after this many accepted packets (0: never.)
+ * \param[in] max_age     Flush once the oldest accepted packet has been
+ *                        pending this long (0: never.)
+ *
+ * \a max_age is in whatever unit the caller passes as \a now to the
+ * other nl_nfqueue_vbatch_*() functions (i.e. milliseconds.)
+ */
+void nl_nfqueue_vbatch_init(struct nl_nfqueue_vbatch *b, __u16 queue_num,
+                            __u32 max_pending, unsigned long max_age)
+{
+	if (!b) return;
+	b->queue_num   = queue_num;
+	b->last_id     = 0;
+	b->pending     = 0;
+	b->max_pending = max_pending;
+	b->first       = 0;
+	b->max_age     = max_age;
+}
+
+/**
+ * \brief Accept a packet via a verdict accumulator
+ * \param[in] b         Verdict accumulator.
+ * \param[in] m         Netlink message buffer.
+ * \param[in] packet_id Packet ID.
+ * \param[in] now       Current time.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ *
+ * Consecutive accepted packets are coalesced, and a batch verdict
+ * accepting all of them is written to \a m once either threshold is
+ * reached. The caller must send \a m whenever 1 is returned.
+ *
+ * Since a batch verdict applies to every queued packet with a lower ID,
+ * packets must be accepted in the order received, and any pending
+ * packets must be flushed (with nl_nfqueue_vbatch_flush()) before a
+ * different verdict is sent for a later packet.
+ */
+int nl_nfqueue_vbatch_accept(struct nl_nfqueue_vbatch *b,
+                             struct nlmsghdr *m, __u32 packet_id,
+                             unsigned long now)
+{
+	if (!b || !m) return 0;
+	if (!b->pending++) b->first = now;
+	b->last_id = packet_id;
+
+	if (b->max_pending && b->pending >= b->max_pending)
+		return nl_nfqueue_vbatch_flush(b, m);
+	return nl_nfqueue_vbatch_expire(b, m, now);
+}
+
+/**
+ * \brief Flush a verdict accumulator
+ * \param[in] b Verdict accumulator.
+ * \param[in] m Netlink message buffer.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ */
+int nl_nfqueue_vbatch_flush(struct nl_nfqueue_vbatch *b, struct nlmsghdr *m)
+{
+	if (!b || !m || !b->pending) return 0;
+	nl_nfqueue_verdict_batch(m, b->queue_num, b->last_id, NF_ACCEPT);
+	b->pending = 0;
+	return 1;
+}
+
+/**
+ * \brief Flush a verdict accumulator if its time threshold was reached
+ * \param[in] b   Verdict accumulator.
+ * \param[in] m   Netlink message buffer.
+ * \param[in] now Current time.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ *
+ * Call this periodically while idle, so that accepted packets aren't
+ * held longer than \a max_age when no further packets arrive.
+ */
+int nl_nfqueue_vbatch_expire(struct nl_nfqueue_vbatch *b, struct nlmsghdr *m,
+                             unsigned long now)
+{
+	if (!b || !b->pending || !b->max_age || now - b->first < b->max_age)
+		return 0;
+	return nl_nfqueue_vbatch_flush(b, m);
+}
+
+/**
+ * \brief Attach a packet payload to a verdict message, by reference
+ * \param[in]  m       Netlink message buffer.
+ * \param[out] iov     Array of 3 buffers to pass to nl_sendv().
+ * \param[in]  payload Packet payload.
+ * \param[in]  len     Length of \a payload (in bytes.)
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This adds the NFQA_PAYLOAD attribute header to \a m, and fills \a iov
+ * such that the payload is sent straight from \a payload, rather than
+ * being copied into \a m. Thus, \a m only needs to be large enough for
+ * the verdict itself, and modified packets may be reinjected in place
+ * from the receive buffer. This must be the last attribute added to
+ * \a m, and \a payload must remain valid until the message is sent.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments
+ * are passed, or E2BIG if \a len is too large for an attribute.
+ */
+int nl_nfqueue_verdict_payload(struct nlmsghdr *m, struct iovec iov[3],
+                               void *payload, size_t len)
+{
+	int ret = -1;
+	struct nlattr *nla;
+
+	if (!m || !iov || (!payload && len)) {
+		errno = EINVAL;
+		goto ret;
+	}
+
+	if (len > 0xffff - NLA_HDRLEN) {
+		errno = E2BIG;
+		goto ret;
+	}
+
+	m->nlmsg_len  = NLMSG_ALIGN(m->nlmsg_len);
+	nla           = BYTE_OFF(m, m->nlmsg_len);
+	nla->nla_type = NFQA_PAYLOAD;
+	nla->nla_len  = (__u16)(NLA_HDRLEN + len);
+
+	iov[0].iov_base = m;
+	iov[0].iov_len  = m->nlmsg_len + NLA_HDRLEN;
+	iov[1].iov_base = payload;
+	iov[1].iov_len  = len;
+	iov[2].iov_base = nla_pad;
+	iov[2].iov_len  = NLA_ALIGN(len) - len;
+	m->nlmsg_len   += NLA_ALIGN(NLA_HDRLEN + len);
+	ret = 0;
+
+ret:
+	return ret;
+}
+
 /**
  * \brief Add a packet mark to a verdict message
  * \param[in] m    Netlink message buffer.
@@ -103,6 +297,132 @@ void nl_nfqueue_verdict_mark(struct nlmsghdr *m, __u32 mark)
 	nl_add_attr(m, NFQA_MARK, &mark, sizeof mark);
 }
 
+/**
+ * \brief Decode a queued packet
+ * \param[in]  m Netlink message buffer.
+ * \param[out] p Decoded packet.
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This decodes every attribute of a NFQNL_MSG_PACKET message in a single
+ * pass, rather than searching the message for each one in turn. The
+ * conntrack info (\a ct and \a ct_info) is only present when the queue
+ * was bound with NFQA_CFG_F_CONNTRACK.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or if \a m doesn't contain a packet header.
+ */
+int nl_nfqueue_parse(struct nlmsghdr *m, struct nl_nfqueue_pkt *p)
+{
+	int ret = -1;
+	size_t len;
+	struct nlattr *nla;
+	struct nfqnl_msg_packet_hdr *ph;
+	struct nfqnl_msg_packet_hw *hw;
+
+	if (!m || !p || !NLMSG_OK(m, m->nlmsg_len))
+		goto inval;
+
+	memset(p, 0, sizeof *p);
+	p->uid = p->gid = (__u32)-1;
+	nla = BYTE_OFF(NLMSG_DATA(m), NLMSG_ALIGN(sizeof(struct nfgenmsg)));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+		len = (size_t)(nla->nla_len - NLA_HDRLEN);
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case NFQA_PACKET_HDR:
+			if (len < sizeof *ph) break;
+			ph             = NLA_DATA(nla);
+			p->id          = ntohl(ph->packet_id);
+			p->hw_protocol = ntohs(ph->hw_protocol);
+			p->hook        = ph->hook;
+			ret            = 0;
+			break;
+		case NFQA_MARK:           p->mark   = nla_u32_be(nla); break;
+		case NFQA_IFINDEX_INDEV:  p->indev  = nla_u32_be(nla); break;
+		case NFQA_IFINDEX_OUTDEV: p->outdev = nla_u32_be(nla); break;
+		case NFQA_IFINDEX_PHYSINDEV:
+			p->physindev = nla_u32_be(nla);
+			break;
+		case NFQA_IFINDEX_PHYSOUTDEV:
+			p->physoutdev = nla_u32_be(nla);
+			break;
+		case NFQA_TIMESTAMP:
+			/* Only 4-byte aligned, so not read as a struct */
+			if (len < sizeof(struct nfqnl_msg_packet_timestamp))
+				break;
+			p->ts_sec  = nl_be64_to_host(NLA_DATA(nla));
+			p->ts_usec = nl_be64_to_host((char *)NLA_DATA(nla) + 8);
+			break;
+		case NFQA_HWADDR:
+			if (len < sizeof *hw) break;
+			hw = NLA_DATA(nla);
+			p->hwaddr     = hw->hw_addr;
+			p->hwaddr_len = (__u8)ntohs(hw->hw_addrlen);
+			if (p->hwaddr_len > sizeof hw->hw_addr)
+				p->hwaddr_len = sizeof hw->hw_addr;
+			break;
+		case NFQA_PAYLOAD:
+			p->payload     = NLA_DATA(nla);
+			p->payload_len = (__u32)len;
+			break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0)
+		case NFQA_CT:      p->ct      = nla;          break;
+		case NFQA_CT_INFO: p->ct_info = nla_u32_be(nla); break;
+		case NFQA_CAP_LEN: p->cap_len = nla_u32_be(nla); break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,10,0)
+		case NFQA_SKB_INFO: p->skb_info = nla_u32_be(nla); break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,0,0)
+		case NFQA_UID: p->uid = nla_u32_be(nla); break;
+		case NFQA_GID: p->gid = nla_u32_be(nla); break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+		case NFQA_SECCTX:
+			if (!len) break;
+			p->secctx     = NLA_DATA(nla);
+			p->secctx_len = (__u32)len;
+			break;
+#endif
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	if (!ret) goto ret;
+
+inval:
+	errno = EINVAL;
+
+ret:
+	return ret;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,10,0)
+/**
+ * \brief Get the skb info flags from a queued packet
+ * \param[in] m Netlink message buffer.
+ * \return The NFQA_SKB_* flags for the packet (in host byte order.)
+ *
+ * NFQA_SKB_GSO              - The packet is a GSO super-packet.
+ * NFQA_SKB_CSUMNOTREADY     - The checksum hasn't been computed yet.
+ * NFQA_SKB_CSUM_NOTVERIFIED - The checksum hasn't been verified yet.
+ *
+ * This requires Linux >= 3.10.
+ */
+__u32 nl_nfqueue_skb_info(struct nlmsghdr *m)
+{
+	struct nlattr *nla;
+
+	if (!(nla = nl_nf_get_attr(m, NFQA_SKB_INFO)) ||
+	    nla->nla_len < NLA_HDRLEN + sizeof(__u32))
+		return 0;
+	return ntohl(*(__u32 *)NLA_DATA(nla));
+}
+#endif
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0)
 /**
  * \brief Add a connmark to a verdict message
@@ -19,6 +19,73 @@
 
 #include "nl_nf.h"
 
+/**
+ * \brief Queue binding options
+ *
+ * The flags (NFQA_CFG_F_*) and the Linux versions they require are:
+ *
+ * NFQA_CFG_F_FAIL_OPEN - Accept packets when the queue is full (3.6)
+ * NFQA_CFG_F_CONNTRACK - Send conntrack info with each packet (3.6)
+ * NFQA_CFG_F_GSO       - Don't segment GSO packets before queueing (3.10)
+ * NFQA_CFG_F_UID_GID   - Send the socket UID / GID with each packet (4.0)
+ * NFQA_CFG_F_SECCTX    - Send the security context with each packet (4.4)
+ */
+struct nl_nfqueue_opts {
+	__u8  cmode;  /**< Metadata only, or the whole packet (NFQNL_COPY_*) */
+	__u32 crange; /**< Amount of packet data to copy (in bytes) */
+	__u32 maxlen; /**< If non-zero, the maximum queue length */
+	__u32 flags;  /**< Queue flags to set (NFQA_CFG_F_*) */
+	__u32 mask;   /**< Queue flags to change (if zero, \a flags is used) */
+};
+
+/**
+ * \brief Decoded view of a queued packet
+ *
+ * Filled by nl_nfqueue_parse(). Integers are in host byte order, and
+ * pointers refer directly to the message they were decoded from.
+ * Attributes absent from the message are zero (or NULL), except for
+ * \a uid and \a gid, which are (__u32)-1 if absent.
+ */
+struct nl_nfqueue_pkt {
+	__u32 id;               /**< Packet ID */
+	__u16 hw_protocol;      /**< Hardware protocol (i.e. ETH_P_IP) */
+	__u8  hook;             /**< Netfilter hook (NF_INET_*) */
+	__u8  hwaddr_len;       /**< Length of \a hwaddr */
+	__u32 mark;             /**< Packet mark */
+	__u32 indev;            /**< Input interface index */
+	__u32 outdev;           /**< Output interface index */
+	__u32 physindev;        /**< Physical input interface index */
+	__u32 physoutdev;       /**< Physical output interface index */
+	__u32 cap_len;          /**< Original length (if truncated) */
+	__u32 skb_info;         /**< skb info flags (NFQA_SKB_*) */
+	__u32 ct_info;          /**< Conntrack state (enum ip_conntrack_info) */
+	__u32 uid;              /**< Socket UID */
+	__u32 gid;              /**< Socket GID */
+	__u32 payload_len;      /**< Length of \a payload */
+	__u32 secctx_len;       /**< Length of \a secctx */
+	__u64 ts_sec;           /**< Timestamp (seconds) */
+	__u64 ts_usec;          /**< Timestamp (microseconds) */
+	const __u8 *hwaddr;     /**< Source hardware address */
+	void *payload;          /**< Packet payload */
+	struct nlattr *ct;      /**< Conntrack info (NFQA_CT) */
+	const char *secctx;     /**< Security context (not NUL-terminated) */
+};
+
+/**
+ * \brief Verdict accumulator
+ *
+ * Coalesces runs of accepted packets into a single NFQNL_MSG_VERDICT_BATCH
+ * message, rather than sending one verdict per packet.
+ */
+struct nl_nfqueue_vbatch {
+	__u16 queue_num;       /**< Queue number */
+	__u32 last_id;         /**< ID of the last pending packet */
+	__u32 pending;         /**< Number of pending packets */
+	__u32 max_pending;     /**< Count threshold */
+	unsigned long first;   /**< Time the first pending packet was added */
+	unsigned long max_age; /**< Time threshold */
+};
+
 /**
  * \brief Create a netlink_nfqueue request.
  * \param[in] m    Netlink message buffer.
@@ -88,6 +155,23 @@ void nl_nfqueue_cfg_cmd(struct nlmsghdr *m, __u8 cmd, __u16 pf, __u16 qn);
 void nl_nfqueue_bind(struct nlmsghdr *m, __u16 pf, __u16 queue_num,
                      __u8 cmode, __u32 crange, __u32 maxlen, int want_ct);
 
+/**
+ * \brief Bind to a packet queue, with the given options
+ * \param[in] m         Netlink message buffer.
+ * \param[in] pf        Protocol family (i.e. PF_INET).
+ * \param[in] queue_num queue number (as given to iptables.)
+ * \param[in] o         Binding options.
+ *
+ * The queue flags are only sent if \a flags or \a mask is non-zero, and
+ * are only available on Linux 3.6 or higher.
+ *
+ * When binding with NFQA_CFG_F_GSO, packets may be larger than the MTU,
+ * and may not have a valid checksum yet. Check nl_nfqueue_skb_info()
+ * for NFQA_SKB_GSO and NFQA_SKB_CSUMNOTREADY before mangling them.
+ */
+void nl_nfqueue_bind_opts(struct nlmsghdr *m, __u16 pf, __u16 queue_num,
+                          const struct nl_nfqueue_opts *o);
+
 /**
  * \brief Create a packet verdict message
  * \param[in] m          Netlink message buffer.
@@ -102,6 +186,105 @@ void nl_nfqueue_bind(struct nlmsghdr *m, __u16 pf, __u16 queue_num,
 void nl_nfqueue_verdict(struct nlmsghdr *m, __u16 queue_num,
                         __u32 packet_id, __u32 verdict);
 
+/**
+ * \brief Create a batch verdict message
+ * \param[in] m          Netlink message buffer.
+ * \param[in] queue_num  queue number (as given to iptables.)
+ * \param[in] packet_id  ID of the last packet to adjudicate.
+ * \param[in] verdict    Verdict for the packets (see: linux/netfilter.h)
+ *
+ * The verdict is applied to every packet still in the queue with an ID
+ * less than or equal to \a packet_id. Marks may be added to the message,
+ * and are applied to each packet.
+ */
+void nl_nfqueue_verdict_batch(struct nlmsghdr *m, __u16 queue_num,
+                              __u32 packet_id, __u32 verdict);
+
+/**
+ * \brief Initialize a verdict accumulator
+ * \param[in] b           Verdict accumulator.
+ * \param[in] queue_num   queue number (as given to iptables.)
+ * \param[in] max_pending Flush after this many accepted packets (0: never.)
+ * \param[in] max_age     Flush once the oldest accepted packet has been
+ *                        pending this long (0: never.)
+ *
+ * \a max_age is in whatever unit the caller passes as \a now to the
+ * other nl_nfqueue_vbatch_*() functions (i.e. milliseconds.)
+ */
+void nl_nfqueue_vbatch_init(struct nl_nfqueue_vbatch *b, __u16 queue_num,
+                            __u32 max_pending, unsigned long max_age);
+
+/**
+ * \brief Accept a packet via a verdict accumulator
+ * \param[in] b         Verdict accumulator.
+ * \param[in] m         Netlink message buffer.
+ * \param[in] packet_id Packet ID.
+ * \param[in] now       Current time.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ *
+ * Consecutive accepted packets are coalesced, and a batch verdict
+ * accepting all of them is written to \a m once either threshold is
+ * reached. The caller must send \a m whenever 1 is returned.
+ *
+ * Since a batch verdict applies to every queued packet with a lower ID,
+ * packets must be accepted in the order received, and any pending
+ * packets must be flushed (with nl_nfqueue_vbatch_flush()) before a
+ * different verdict is sent for a later packet.
+ */
+int nl_nfqueue_vbatch_accept(struct nl_nfqueue_vbatch *b,
+                             struct nlmsghdr *m, __u32 packet_id,
+                             unsigned long now);
+
+/**
+ * \brief Flush a verdict accumulator
+ * \param[in] b Verdict accumulator.
+ * \param[in] m Netlink message buffer.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ */
+int nl_nfqueue_vbatch_flush(struct nl_nfqueue_vbatch *b, struct nlmsghdr *m);
+
+/**
+ * \brief Flush a verdict accumulator if its time threshold was reached
+ * \param[in] b   Verdict accumulator.
+ * \param[in] m   Netlink message buffer.
+ * \param[in] now Current time.
+ * \return 1 if a batch verdict was written to \a m, 0 otherwise.
+ *
+ * Call this periodically while idle, so that accepted packets aren't
+ * held longer than \a max_age when no further packets arrive.
+ */
+int nl_nfqueue_vbatch_expire(struct nl_nfqueue_vbatch *b, struct nlmsghdr *m,
+                             unsigned long now);
+
+/**
+ * \brief Attach a packet payload to a verdict message, by reference
+ * \param[in]  m       Netlink message buffer.
+ * \param[out] iov     Array of 3 buffers to pass to nl_sendv().
+ * \param[in]  payload Packet payload.
+ * \param[in]  len     Length of \a payload (in bytes.)
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This adds the NFQA_PAYLOAD attribute header to \a m, and fills \a iov
+ * such that the payload is sent straight from \a payload, rather than
+ * being copied into \a m. Thus, \a m only needs to be large enough for
+ * the verdict itself, and modified packets may be reinjected in place
+ * from the receive buffer. This must be the last attribute added to
+ * \a m, and \a payload must remain valid until the message is sent.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments
+ * are passed, or E2BIG if \a len is too large for an attribute.
+ *
+ * \code{.c}
+ * struct iovec iov[3];
+ *
+ * nl_nfqueue_verdict(m, qn, id, NF_ACCEPT);
+ * if (!nl_nfqueue_verdict_payload(m, iov, payload, len))
+ * 	nl_sendv(fd, 0, iov, 3);
+ * \endcode
+ */
+int nl_nfqueue_verdict_payload(struct nlmsghdr *m, struct iovec iov[3],
+                               void *payload, size_t len);
+
 /**
  * \brief Add a packet mark to a verdict message
  * \param[in] m    Netlink message buffer.
@@ -112,6 +295,39 @@ void nl_nfqueue_verdict(struct nlmsghdr *m, __u16 queue_num,
  */
 void nl_nfqueue_verdict_mark(struct nlmsghdr *m, __u32 mark);
 
+/**
+ * \brief Decode a queued packet
+ * \param[in]  m Netlink message buffer.
+ * \param[out] p Decoded packet.
+ * \return 0 on success, non-zero on error (with \a errno set)
+ *
+ * This decodes every attribute of a NFQNL_MSG_PACKET message in a single
+ * pass, rather than searching the message for each one in turn. The
+ * conntrack info (\a ct and \a ct_info) is only present when the queue
+ * was bound with NFQA_CFG_F_CONNTRACK.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or if \a m doesn't contain a packet header.
+ */
+int nl_nfqueue_parse(struct nlmsghdr *m, struct nl_nfqueue_pkt *p);
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,10,0)
+#define nl_nfqueue_skb_info(m) 0
+#else
+/**
+ * \brief Get the skb info flags from a queued packet
+ * \param[in] m Netlink message buffer.
+ * \return The NFQA_SKB_* flags for the packet (in host byte order.)
+ *
+ * NFQA_SKB_GSO              - The packet is a GSO super-packet.
+ * NFQA_SKB_CSUMNOTREADY     - The checksum hasn't been computed yet.
+ * NFQA_SKB_CSUM_NOTVERIFIED - The checksum hasn't been verified yet.
+ *
+ * This requires Linux >= 3.10.
+ */
+__u32 nl_nfqueue_skb_info(struct nlmsghdr *m);
+#endif /* Linux < 3.10 */
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,6,0)
 #define nl_nfqueue_verdict_ctmark(m, mark)
 #else
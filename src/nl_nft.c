@@ -0,0 +1,208 @@
+/**
+ * nanonl: Netlink nf_tables Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "nl.h"
+#include "nl_nft.h"
+
+/* Length of an element holding a key of \a klen bytes */
+#define ELEM_LEN(klen) (3 * NLA_HDRLEN + NLA_ALIGN(klen))
+
+/**
+ * \brief Begin a set element message
+ * \param[in] m      Netlink message buffer.
+ * \param[in] type   NFT_MSG_NEWSETELEM or NFT_MSG_DELSETELEM.
+ * \param[in] family Table family (NFPROTO_*).
+ * \param[in] table  Table name.
+ * \param[in] set    Set name.
+ * \return The element list, to pass to nl_nft_setelem_add() and
+ *         nl_nft_setelem_end(), or NULL on error.
+ */
+struct nlattr *nl_nft_setelem_begin(struct nlmsghdr *m, __u8 type,
+                                    __u8 family, const char *table,
+                                    const char *set)
+{
+	if (!m || !table || !set) return NULL;
+	nl_nft_request(m, 0, type, family);
+	if (type == NFT_MSG_NEWSETELEM)
+		m->nlmsg_flags |= NLM_F_CREATE;
+	nl_add_attr(m, NFTA_SET_ELEM_LIST_TABLE, table, strlen(table) + 1);
+	nl_add_attr(m, NFTA_SET_ELEM_LIST_SET, set, strlen(set) + 1);
+	return nla_start(m, NFTA_SET_ELEM_LIST_ELEMENTS);
+}
+
+/**
+ * \brief Add an element to a set element message
+ * \param[in] m    Netlink message buffer.
+ * \param[in] list Element list (from nl_nft_setelem_begin())
+ * \param[in] key  Key (i.e. an IPv4 address, in network byte order.)
+ * \param[in] klen Length of \a key (in bytes.)
+ * \param[in] size Size of the buffer holding \a m (in bytes.)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if the element doesn't fit in \a size bytes, or
+ * in the element list.
+ */
+int nl_nft_setelem_add(struct nlmsghdr *m, struct nlattr *list,
+                       const void *key, __u32 klen, size_t size)
+{
+	struct nlattr *elem, *data;
+
+	if (!m || !list || !key || !klen || klen > 0xffff) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((size_t)list->nla_len + ELEM_LEN(klen) > 0xffff ||
+	    (size_t)m->nlmsg_len + list->nla_len + ELEM_LEN(klen) > size) {
+		errno = E2BIG;
+		return -1;
+	}
+
+	elem = nla_nest_start(list, NFTA_LIST_ELEM);
+	data = nla_nest_start(elem, NFTA_SET_ELEM_KEY);
+	nla_add_attr(data, NFTA_DATA_VALUE, key, klen);
+	nla_nest_end(elem, data);
+	nla_nest_end(list, elem);
+	return 0;
+}
+
+/**
+ * \brief Add set elements to a nfnetlink batch, in bulk
+ * \param[in] b    Batch (begun with nl_nf_batch_begin())
+ * \param[in] k    Set to update
+ * \param[in] keys Array of \a n keys, each \a k->klen bytes long.
+ * \param[in] n    Number of keys
+ * \return The number of keys added to the batch, or 0 on error (with
+ *         \a errno set.)
+ *
+ * Each message is packed with as many elements as fit in \a k->msglen
+ * bytes. If fewer than \a n keys were added, the batch is full, and
+ * should be ended and sent before adding the rest to the next batch.
+ *
+ * The kernel applies the batch atomically, and reports an error for
+ * each message that failed (i.e. with ENOENT when deleting elements
+ * that don't exist.) Use nl_nft_setelem_range() to find the elements
+ * in a failed message.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if not even one element fits.
+ */
+size_t nl_nft_setelem_bulk(struct nl_batch *b, struct nl_nft_bulk *k,
+                           const void *keys, size_t n)
+{
+	size_t i = 0, j;
+	struct nlmsghdr *m;
+	struct nlattr *list;
+	const char *key = keys;
+
+	if (!b || !b->count || !k || !k->table || !k->set || !keys ||
+	    !k->klen) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	k->first   = (long)b->count - 1;
+	k->per_msg = 0;
+	k->count   = 0;
+	while (i < n && (m = nl_nf_batch_next(b, k->msglen))) {
+		list = nl_nft_setelem_begin(m, k->type, k->family, k->table,
+		                            k->set);
+		for (j = i; j < n; j++) {
+			if (nl_nft_setelem_add(m, list, key + j * k->klen,
+			                       k->klen, k->msglen))
+				break;
+		}
+
+		if (j == i) {
+			errno = E2BIG;
+			break;
+		}
+
+		nl_nft_setelem_end(m, list);
+		if (nl_batch_add(b) < 0) break;
+		if (!k->per_msg) k->per_msg = j - i;
+		i = j;
+	}
+
+	k->count = i;
+	return i;
+}
+
+/**
+ * \brief Get the elements carried by a message from nl_nft_setelem_bulk()
+ * \param[in]  k     Set updated
+ * \param[in]  i     Message index (from nl_nf_batch_ack())
+ * \param[out] first Index of the first key in the message
+ * \return The number of keys in the message (0 if it isn't one of the
+ *         messages added by nl_nft_setelem_bulk().)
+ */
+size_t nl_nft_setelem_range(const struct nl_nft_bulk *k, long i,
+                            size_t *first)
+{
+	size_t f;
+
+	if (!k || !k->per_msg || i < k->first) return 0;
+	f = (size_t)(i - k->first) * k->per_msg;
+	if (f >= k->count) return 0;
+	if (first) *first = f;
+	return k->count - f < k->per_msg ? k->count - f : k->per_msg;
+}
+
+/**
+ * \brief Compute the changes between two sets of keys
+ * \param[in]  old  Current keys (sorted)
+ * \param[in]  nold Number of keys in \a old
+ * \param[in]  cur  New keys (sorted)
+ * \param[in]  ncur Number of keys in \a cur
+ * \param[in]  klen Key length (in bytes.)
+ * \param[out] add  Keys to add (room for \a ncur keys)
+ * \param[out] nadd Number of keys to add
+ * \param[out] del  Keys to delete (room for \a nold keys)
+ * \param[out] ndel Number of keys to delete
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Both arrays must be sorted in \a memcmp(3) order, without duplicates.
+ * Only the keys in \a add and \a del then need to be sent, with
+ * NFT_MSG_NEWSETELEM and NFT_MSG_DELSETELEM respectively.
+ */
+int nl_nft_diff(const void *old, size_t nold, const void *cur, size_t ncur,
+                __u32 klen, void *add, size_t *nadd, void *del,
+                size_t *ndel)
+{
+	int c;
+	size_t i = 0, j = 0;
+	const char *o = old, *n = cur;
+	char *a = add, *d = del;
+
+	if (!klen || !nadd || !ndel || (nold && (!old || !del)) ||
+	    (ncur && (!cur || !add))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*nadd = *ndel = 0;
+	while (i < nold || j < ncur) {
+		if (i == nold) c = 1;
+		else if (j == ncur) c = -1;
+		else c = memcmp(o + i * klen, n + j * klen, klen);
+
+		if (c < 0) {
+			memcpy(d + *ndel * klen, o + i++ * klen, klen);
+			++*ndel;
+		} else if (c > 0) {
+			memcpy(a + *nadd * klen, n + j++ * klen, klen);
+			++*nadd;
+		} else ++i, ++j;
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * \file nl_nft.h
+ *
+ * nanonl: Netlink nf_tables functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_NFT_H
+#define NL_NFT_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include "nl_nf.h"
+
+/**
+ * \brief Bulk set element update
+ *
+ * Describes the set to be updated by nl_nft_setelem_bulk(), which
+ * fills in the remaining fields so that the reply to each message
+ * can be mapped back to the elements it carried, with
+ * nl_nft_setelem_range().
+ */
+struct nl_nft_bulk {
+	const char *table; /**< Table name */
+	const char *set;   /**< Set name */
+	__u8  family;      /**< Table family (NFPROTO_*) */
+	__u8  type;        /**< NFT_MSG_NEWSETELEM or NFT_MSG_DELSETELEM */
+	__u32 klen;        /**< Key length (in bytes) */
+	size_t msglen;     /**< Maximum length of each message (in bytes) */
+	long first;        /**< Index of the first message in the batch */
+	size_t per_msg;    /**< Elements per message */
+	size_t count;      /**< Elements added to the batch */
+};
+
+/**
+ * \brief Create a netlink_nftables request.
+ * \param[in] m      Netlink message buffer.
+ * \param[in] pid    Destination netlink port.
+ * \param[in] type   message type (NFT_MSG_*).
+ * \param[in] family Table family (NFPROTO_*).
+ * \relates nl_request
+ */
+#define nl_nft_request(m, pid, type, family) \
+	nl_nf_request((m), (pid), NFNL_SUBSYS_NFTABLES, (type), (family), 0)
+
+/**
+ * \brief Begin a set element message
+ * \param[in] m      Netlink message buffer.
+ * \param[in] type   NFT_MSG_NEWSETELEM or NFT_MSG_DELSETELEM.
+ * \param[in] family Table family (NFPROTO_*).
+ * \param[in] table  Table name.
+ * \param[in] set    Set name.
+ * \return The element list, to pass to nl_nft_setelem_add() and
+ *         nl_nft_setelem_end(), or NULL on error.
+ */
+struct nlattr *nl_nft_setelem_begin(struct nlmsghdr *m, __u8 type,
+                                    __u8 family, const char *table,
+                                    const char *set);
+
+/**
+ * \brief Add an element to a set element message
+ * \param[in] m    Netlink message buffer.
+ * \param[in] list Element list (from nl_nft_setelem_begin())
+ * \param[in] key  Key (i.e. an IPv4 address, in network byte order.)
+ * \param[in] klen Length of \a key (in bytes.)
+ * \param[in] size Size of the buffer holding \a m (in bytes.)
+ * \return 0 on success, or -1 on error (with \a errno set.)
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if the element doesn't fit in \a size bytes, or
+ * in the element list.
+ */
+int nl_nft_setelem_add(struct nlmsghdr *m, struct nlattr *list,
+                       const void *key, __u32 klen, size_t size);
+
+/**
+ * \brief Finish a set element message
+ * \param[in] m    Netlink message buffer.
+ * \param[in] list Element list (from nl_nft_setelem_begin())
+ */
+#define nl_nft_setelem_end(m, list) nla_end((m), (list))
+
+/**
+ * \brief Add set elements to a nfnetlink batch, in bulk
+ * \param[in] b    Batch (begun with nl_nf_batch_begin())
+ * \param[in] k    Set to update
+ * \param[in] keys Array of \a n keys, each \a k->klen bytes long.
+ * \param[in] n    Number of keys
+ * \return The number of keys added to the batch, or 0 on error (with
+ *         \a errno set.)
+ *
+ * Each message is packed with as many elements as fit in \a k->msglen
+ * bytes. If fewer than \a n keys were added, the batch is full, and
+ * should be ended and sent before adding the rest to the next batch.
+ *
+ * The kernel applies the batch atomically, and reports an error for
+ * each message that failed (i.e. with ENOENT when deleting elements
+ * that don't exist.) Use nl_nft_setelem_range() to find the elements
+ * in a failed message.
+ *
+ * This function will set \a errno to EINVAL if invalid arguments are
+ * passed, or E2BIG if not even one element fits.
+ */
+size_t nl_nft_setelem_bulk(struct nl_batch *b, struct nl_nft_bulk *k,
+                           const void *keys, size_t n);
+
+/**
+ * \brief Get the elements carried by a message from nl_nft_setelem_bulk()
+ * \param[in]  k     Set updated
+ * \param[in]  i     Message index (from nl_nf_batch_ack())
+ * \param[out] first Index of the first key in the message
+ * \return The number of keys in the message (0 if it isn't one of the
+ *         messages added by nl_nft_setelem_bulk().)
+ */
+size_t nl_nft_setelem_range(const struct nl_nft_bulk *k, long i,
+                            size_t *first);
+
+/**
+ * \brief Compute the changes between two sets of keys
+ * \param[in]  old  Current keys (sorted)
+ * \param[in]  nold Number of keys in \a old
+ * \param[in]  cur  New keys (sorted)
+ * \param[in]  ncur Number of keys in \a cur
+ * \param[in]  klen Key length (in bytes.)
+ * \param[out] add  Keys to add (room for \a ncur keys)
+ * \param[out] nadd Number of keys to add
+ * \param[out] del  Keys to delete (room for \a nold keys)
+ * \param[out] ndel Number of keys to delete
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Both arrays must be sorted in \a memcmp(3) order, without duplicates.
+ * Only the keys in \a add and \a del then need to be sent, with
+ * NFT_MSG_NEWSETELEM and NFT_MSG_DELSETELEM respectively.
+ */
+int nl_nft_diff(const void *old, size_t nold, const void *cur, size_t ncur,
+                __u32 klen, void *add, size_t *nadd, void *del,
+                size_t *ndel);
+
+#endif /* NL_NFT_H */
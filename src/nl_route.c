@@ -0,0 +1,406 @@
+/**
+ * nanonl: Netlink Route Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include "nl.h"
+#include "nl_route.h"
+
+/* Length of an address attribute */
+#define ADDR_LEN(family) ((family) == AF_INET6 ? 16U : 4U)
+
+/* Length of a next hop (struct rtnexthop), without its attributes */
+#define NH_HDRLEN NLA_ALIGN(sizeof(struct rtnexthop))
+
+/* Maximum length of a route message, with \a nnh next hops */
+#define ROUTE_MAXLEN(nnh) \
+	(NLMSG_SPACE(sizeof(struct rtmsg)) + 5 * (NLA_HDRLEN + 16) + \
+	 NLA_HDRLEN + RTAX_MAX * (NLA_HDRLEN + 4) + NLA_HDRLEN + \
+	 (size_t)(nnh) * (sizeof(struct rtnexthop) + NLA_HDRLEN + 16))
+
+/**
+ * \brief Create a netlink route request
+ * \param[in] m        Netlink message buffer
+ * \param[in] pid      Destination netlink port
+ * \param[in] type     One of: RTM_GETROUTE, RTM_NEWROUTE, RTM_DELROUTE
+ * \param[in] family   Address family (AF_INET[6])
+ * \param[in] dst_len  Destination prefix length
+ * \param[in] table    Table (RT_TABLE_*)
+ * \param[in] protocol Protocol (RTPROT_*)
+ * \param[in] scope    Scope (RT_SCOPE_*)
+ * \param[in] rtype    Route type (RTN_*)
+ * \relates nl_request
+ *
+ * Tables above 255 are given by the RTA_TABLE attribute. RTM_NEWROUTE
+ * requests are flagged with NLM_F_CREATE, and RTM_GETROUTE requests
+ * with NLM_F_DUMP.
+ */
+void nl_rt_request(struct nlmsghdr *m, __u32 pid, __u8 type, __u8 family,
+                   __u8 dst_len, __u32 table, __u8 protocol, __u8 scope,
+                   __u8 rtype)
+{
+	struct rtmsg *rtm = BYTE_OFF(m, sizeof *m);
+	if (!m) return;
+	nl_request(m, type, pid, sizeof *rtm);
+	rtm->rtm_family   = family;
+	rtm->rtm_dst_len  = dst_len;
+	rtm->rtm_src_len  = 0;
+	rtm->rtm_tos      = 0;
+	rtm->rtm_table    = table < 256 ? (__u8)table : RT_TABLE_UNSPEC;
+	rtm->rtm_protocol = protocol;
+	rtm->rtm_scope    = scope;
+	rtm->rtm_type     = rtype;
+	rtm->rtm_flags    = 0;
+	if (table > 255) nl_add_attr(m, RTA_TABLE, &table, sizeof table);
+	if (type == RTM_NEWROUTE) m->nlmsg_flags |= NLM_F_CREATE;
+	if (type == RTM_GETROUTE) m->nlmsg_flags |= NLM_F_DUMP;
+}
+
+/**
+ * \brief Add an address attribute (i.e. RTA_DST or RTA_GATEWAY)
+ * \param[in] m      Netlink message buffer
+ * \param[in] type   Attribute type
+ * \param[in] family Address family (AF_INET[6])
+ * \param[in] addr   Address (network byte order)
+ */
+void nl_rt_add_addr(struct nlmsghdr *m, __u16 type, __u8 family,
+                    const void *addr)
+{
+	if (!m || !addr) return;
+	nl_add_attr(m, type, addr, ADDR_LEN(family));
+}
+
+/**
+ * \brief Add metrics (RTA_METRICS)
+ * \param[in] m       Netlink message buffer
+ * \param[in] metrics Metrics, indexed by RTAX_* (RTAX_MAX + 1 of them)
+ *
+ * Metrics that are zero aren't added.
+ */
+void nl_rt_add_metrics(struct nlmsghdr *m, const __u32 *metrics)
+{
+	__u16 i;
+	struct nlattr *mx;
+
+	if (!m || !metrics) return;
+	for (i = 1; i <= RTAX_MAX && !metrics[i]; i++);
+	if (i > RTAX_MAX) return;
+
+	mx = nla_start(m, RTA_METRICS);
+	for (; i <= RTAX_MAX; i++) {
+		if (metrics[i])
+			nla_add_attr(mx, i, &metrics[i], sizeof *metrics);
+	}
+
+	nla_end(m, mx);
+}
+
+/**
+ * Check whether a next hop has a gateway
+ */
+static int has_gw(const struct nl_rt_nexthop *nh)
+{
+	return nh->gw[0] || nh->gw[1] || nh->gw[2] || nh->gw[3];
+}
+
+/**
+ * \brief Add a next hop to a multipath route
+ * \param[in] mp     Next hops (from nl_rt_mp_begin())
+ * \param[in] family Address family (AF_INET[6])
+ * \param[in] nh     Next hop
+ */
+void nl_rt_mp_add(struct nlattr *mp, __u8 family,
+                  const struct nl_rt_nexthop *nh)
+{
+	struct nlattr *gw;
+	struct rtnexthop *rtnh;
+
+	if (!mp || !nh) return;
+	rtnh = BYTE_OFF(mp, NLA_ALIGN(mp->nla_len));
+	rtnh->rtnh_len     = sizeof *rtnh;
+	rtnh->rtnh_flags   = nh->flags;
+	rtnh->rtnh_hops    = nh->weight ? (__u8)(nh->weight - 1) : 0;
+	rtnh->rtnh_ifindex = nh->ifindex;
+
+	if (has_gw(nh)) {
+		gw = BYTE_OFF(rtnh, NH_HDRLEN);
+		gw->nla_type = RTA_GATEWAY;
+		gw->nla_len  = (__u16)(NLA_HDRLEN + ADDR_LEN(family));
+		memcpy(NLA_DATA(gw), nh->gw, ADDR_LEN(family));
+		rtnh->rtnh_len = (unsigned short)(rtnh->rtnh_len +
+		                                  NLA_ALIGN(gw->nla_len));
+	}
+
+	mp->nla_len = (__u16)(NLA_ALIGN(mp->nla_len) +
+	                      NLA_ALIGN(rtnh->rtnh_len));
+}
+
+/**
+ * \brief Create a request to add (or replace) or delete a route
+ * \param[in] m    Netlink message buffer
+ * \param[in] type RTM_NEWROUTE or RTM_DELROUTE
+ * \param[in] r    Route
+ *
+ * RTM_NEWROUTE requests are flagged with NLM_F_REPLACE, so that an
+ * existing route to the same destination (with the same priority) is
+ * replaced.
+ */
+void nl_rt_route(struct nlmsghdr *m, __u8 type, const struct nl_rt_route *r)
+{
+	__u8 i;
+	struct nlattr *mp;
+	__u32 table;
+
+	if (!m || !r) return;
+	table = r->table ? r->table : RT_TABLE_MAIN;
+	if (type != RTM_NEWROUTE) {
+		nl_rt_request(m, 0, type, r->family, r->dst_len, table,
+		              r->protocol, RT_SCOPE_NOWHERE, 0);
+	} else {
+		nl_rt_request(m, 0, type, r->family, r->dst_len, table,
+		              r->protocol, r->scope,
+		              r->type ? r->type : RTN_UNICAST);
+		m->nlmsg_flags |= NLM_F_REPLACE;
+	}
+
+	if (r->dst_len) nl_rt_add_addr(m, RTA_DST, r->family, r->dst);
+	if (r->priority)
+		nl_add_attr(m, RTA_PRIORITY, &r->priority, sizeof r->priority);
+	if (type != RTM_NEWROUTE) return;
+	nl_rt_add_metrics(m, r->metrics);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,3,0)
+	if (r->nh_id) {
+		nl_add_attr(m, RTA_NH_ID, &r->nh_id, sizeof r->nh_id);
+		return;
+	}
+#endif
+
+	if (r->nnh == 1 && r->nh) {
+		if (has_gw(r->nh))
+			nl_rt_add_addr(m, RTA_GATEWAY, r->family, r->nh->gw);
+		if (r->nh->ifindex) {
+			nl_add_attr(m, RTA_OIF, &r->nh->ifindex,
+			            sizeof r->nh->ifindex);
+		}
+	} else if (r->nnh > 1 && r->nh) {
+		mp = nl_rt_mp_begin(m);
+		for (i = 0; i < r->nnh; i++)
+			nl_rt_mp_add(mp, r->family, &r->nh[i]);
+		nl_rt_mp_end(m, mp);
+	}
+}
+
+/**
+ * \brief Add, replace or delete many routes
+ * \param[in]  fd   Netlink socket file descriptor (blocking)
+ * \param[in]  b    Batch (with an empty buffer)
+ * \param[in]  type RTM_NEWROUTE or RTM_DELROUTE
+ * \param[in]  r    Routes
+ * \param[in]  n    Number of routes
+ * \param[out] errs Result for each route (0, or a negative \a errno
+ *                  value such as -ESRCH.) May be NULL.
+ * \return The number of routes added / deleted, or -1 on error (with
+ *         \a errno set.)
+ *
+ * As many requests as fit in the batch's buffer are sent with each
+ * \a sendmsg(2) call, and the ACKs for them are collected before
+ * sending the next batch. The buffer should be no larger than the
+ * socket's send buffer, and the receive buffer should be large enough
+ * to hold an error for each request in a batch.
+ */
+long nl_rt_bulk(int fd, struct nl_batch *b, __u8 type,
+                const struct nl_rt_route *r, size_t n, int *errs)
+{
+	int err;
+	long i, done = 0;
+	ssize_t ret;
+	size_t next = 0, base;
+	__u32 acked, rbuf[NLMSG_GOODSIZE / sizeof(__u32)];
+	struct nlmsghdr *m, *rm = (struct nlmsghdr *)(void *)rbuf;
+
+	if (!b || (!r && n) ||
+	    (type != RTM_NEWROUTE && type != RTM_DELROUTE)) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	while (next < n) {
+		base = next;
+		nl_batch_reset(b);
+		while (next < n &&
+		       (m = nl_batch_next(b, ROUTE_MAXLEN(r[next].nnh)))) {
+			nl_rt_route(m, type, &r[next]);
+			if (nl_batch_add(b) < 0) goto err;
+			++next;
+		}
+
+		if (!b->count) {
+			errno = E2BIG;
+			goto err;
+		}
+
+		if (nl_batch_send(fd, 0, b) != (ssize_t)b->len)
+			goto err;
+
+		/* Collect the ACKs, errors are reported as negative errno */
+		for (acked = 0; acked < b->count; ) {
+			errno = 0;
+			ret   = nl_recv(fd, rm, sizeof rbuf, NULL);
+			if (ret <= 0 && errno >= 0) {
+				if (!errno) errno = EIO;
+				goto err;
+			}
+
+			if ((i = nl_batch_ack(b, rm, &err)) < 0)
+				continue;
+			if (errs) errs[base + (size_t)i] = err;
+			if (!err) ++done;
+			++acked;
+		}
+	}
+
+	nl_batch_reset(b);
+	return done;
+
+err:
+	return -1;
+}
+
+/**
+ * Decode the attributes of a next hop
+ */
+static void parse_nh_attrs(struct nlattr *nla, size_t len, __u8 family,
+                           struct nl_rt_nexthop *nh)
+{
+	while (len >= NLA_HDRLEN && nla->nla_len >= NLA_HDRLEN &&
+	       nla->nla_len <= len) {
+		if ((nla->nla_type & NLA_TYPE_MASK) == RTA_GATEWAY &&
+		    nla->nla_len >= NLA_HDRLEN + ADDR_LEN(family))
+			memcpy(nh->gw, NLA_DATA(nla), ADDR_LEN(family));
+		if (NLA_ALIGN(nla->nla_len) >= len) break;
+		len -= NLA_ALIGN(nla->nla_len);
+		nla  = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+}
+
+/**
+ * Decode the next hops of a multipath route (RTA_MULTIPATH)
+ */
+static __u8 parse_mp(struct nlattr *mp, __u8 family,
+                     struct nl_rt_nexthop *nh, __u8 nnh)
+{
+	__u8 n = 0;
+	struct rtnexthop *rtnh = NLA_DATA(mp);
+	size_t len = (size_t)(mp->nla_len - NLA_HDRLEN);
+
+	while (n < nnh && len >= sizeof *rtnh &&
+	       rtnh->rtnh_len >= sizeof *rtnh && rtnh->rtnh_len <= len) {
+		memset(&nh[n], 0, sizeof *nh);
+		nh[n].ifindex = rtnh->rtnh_ifindex;
+		nh[n].flags   = rtnh->rtnh_flags;
+		nh[n].weight  = (__u8)(rtnh->rtnh_hops + 1);
+		parse_nh_attrs(BYTE_OFF(rtnh, NH_HDRLEN),
+		               rtnh->rtnh_len - NH_HDRLEN, family, &nh[n]);
+		++n;
+
+		if (NLA_ALIGN(rtnh->rtnh_len) >= len) break;
+		len -= NLA_ALIGN(rtnh->rtnh_len);
+		rtnh = BYTE_OFF(rtnh, NLA_ALIGN(rtnh->rtnh_len));
+	}
+
+	return n;
+}
+
+/**
+ * \brief Decode a route
+ * \param[in]  m   Netlink message buffer (RTM_NEWROUTE / RTM_DELROUTE)
+ * \param[out] r   Route
+ * \param[out] nh  Next hops
+ * \param[in]  nnh Number of elements in \a nh
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Only the first \a nnh next hops are decoded, and \a r->nh is set to
+ * \a nh. Metrics aren't decoded (\a r->metrics is NULL.) Routes using
+ * a nexthop object have \a r->nh_id set.
+ */
+int nl_rt_parse(struct nlmsghdr *m, struct nl_rt_route *r,
+                struct nl_rt_nexthop *nh, __u8 nnh)
+{
+	struct rtmsg *rtm;
+	struct nlattr *nla;
+	size_t alen;
+
+	if (!m || !r || (nnh && !nh) || !NLMSG_OK(m, m->nlmsg_len) ||
+	    (m->nlmsg_type != RTM_NEWROUTE && m->nlmsg_type != RTM_DELROUTE) ||
+	    m->nlmsg_len < NLMSG_LENGTH(sizeof *rtm))
+		goto inval;
+
+	rtm = NLMSG_DATA(m);
+	memset(r, 0, sizeof *r);
+	if (nnh) memset(nh, 0, sizeof *nh);
+	r->nh       = nh;
+	r->family   = rtm->rtm_family;
+	r->dst_len  = rtm->rtm_dst_len;
+	r->protocol = rtm->rtm_protocol;
+	r->scope    = rtm->rtm_scope;
+	r->type     = rtm->rtm_type;
+	r->table    = rtm->rtm_table;
+	alen        = ADDR_LEN(r->family);
+
+	nla = BYTE_OFF(rtm, NLMSG_ALIGN(sizeof *rtm));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case RTA_DST:
+			if (nla->nla_len >= NLA_HDRLEN + alen)
+				memcpy(r->dst, NLA_DATA(nla), alen);
+			break;
+		case RTA_TABLE:
+			if (nla->nla_len >= NLA_HDRLEN + sizeof(__u32))
+				r->table = *(__u32 *)NLA_DATA(nla);
+			break;
+		case RTA_PRIORITY:
+			if (nla->nla_len >= NLA_HDRLEN + sizeof(__u32))
+				r->priority = *(__u32 *)NLA_DATA(nla);
+			break;
+		case RTA_OIF:
+			if (!nnh || nla->nla_len < NLA_HDRLEN + sizeof(__s32))
+				break;
+			nh->ifindex = *(__s32 *)NLA_DATA(nla);
+			r->nnh = 1;
+			break;
+		case RTA_GATEWAY:
+			if (!nnh || nla->nla_len < NLA_HDRLEN + alen) break;
+			memcpy(nh->gw, NLA_DATA(nla), alen);
+			r->nnh = 1;
+			break;
+		case RTA_MULTIPATH:
+			r->nnh = parse_mp(nla, r->family, nh, nnh);
+			break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,3,0)
+		case RTA_NH_ID:
+			if (nla->nla_len >= NLA_HDRLEN + sizeof(__u32))
+				r->nh_id = *(__u32 *)NLA_DATA(nla);
+			break;
+#endif
+		default: break;
+		}
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	return 0;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
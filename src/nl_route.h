@@ -0,0 +1,229 @@
+/**
+ * \file nl_route.h
+ *
+ * nanonl: Netlink Route functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_ROUTE_H
+#define NL_ROUTE_H
+
+#include <sys/types.h>
+#include <linux/version.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "nl.h"
+
+/**
+ * \brief Next hop
+ */
+struct nl_rt_nexthop {
+	__u32 gw[4];   /**< Gateway (network byte order, all zero = none) */
+	__s32 ifindex; /**< Output interface (0 = none) */
+	__u8 weight;   /**< Weight (multipath only, 0 = 1) */
+	__u8 flags;    /**< Flags (RTNH_F_*) */
+};
+
+/**
+ * \brief Route
+ *
+ * Addresses are in network byte order, everything else is in host
+ * byte order. A route with more than one next hop is a multipath
+ * route. A route may use a nexthop object (see nl_nexthop.h) instead
+ * of its own next hops, in which case \a nh is ignored.
+ */
+struct nl_rt_route {
+	__u32 dst[4];                   /**< Destination */
+	__u32 table;                    /**< Table (RT_TABLE_*, 0 = main) */
+	__u32 priority;                 /**< Priority (metric) */
+	__u32 nh_id;                    /**< Nexthop object ID (or 0) */
+	const __u32 *metrics;           /**< Metrics, indexed by RTAX_* */
+	const struct nl_rt_nexthop *nh; /**< Next hops */
+	__u8 nnh;                       /**< Number of next hops */
+	__u8 family;                    /**< Address family (AF_INET[6]) */
+	__u8 dst_len;                   /**< Destination prefix length */
+	__u8 protocol;                  /**< Protocol (RTPROT_*) */
+	__u8 scope;                     /**< Scope (RT_SCOPE_*) */
+	__u8 type;                      /**< Type (RTN_*, 0 = unicast) */
+};
+
+/**
+ * \def nl_rt_get_attr(m, t)
+ * \param m Netlink message buffer
+ * \param t RTA attribute type
+ *
+ * Convenience wrapper around nl_get_attr().
+ */
+#define nl_rt_get_attr(m, t) \
+	nl_get_attr((m), sizeof(struct rtmsg), (t))
+
+/**
+ * \def nl_rt_get_attrv(m, a)
+ * \param m Netlink message buffer
+ * \param a Array of \a struct nlattr *
+ *
+ * Convenience wrapper around nl_get_attrv().
+ */
+#define nl_rt_get_attrv(m, a)\
+	nl_get_attrv((m), sizeof(struct rtmsg), (a), \
+	             ((sizeof((a)) / sizeof(struct nlattr *)) - 1))
+
+/**
+ * \def nl_rt_get_routes(m, family)
+ * \param m      Netlink message buffer
+ * \param family Address family
+ *
+ * Construct a request to get a dump of every route (in every table)
+ * for the given address family.
+ */
+#define nl_rt_get_routes(m, family) \
+	nl_rt_request((m), 0, RTM_GETROUTE, (family), 0, 0, 0, 0, 0)
+
+/**
+ * \def nl_rt_new_route(m, family, dst_len, table, protocol)
+ * \param m        Netlink message buffer
+ * \param family   Address family
+ * \param dst_len  Destination prefix length
+ * \param table    Table (RT_TABLE_*)
+ * \param protocol Protocol (RTPROT_*)
+ *
+ * Construct a request to add a unicast route. The destination and
+ * next hop(s) must be specified by adding their respective attributes
+ * to the message.
+ */
+#define nl_rt_new_route(m, family, dst_len, table, protocol) \
+	nl_rt_request((m), 0, RTM_NEWROUTE, (family), (dst_len), (table), \
+	              (protocol), RT_SCOPE_UNIVERSE, RTN_UNICAST)
+
+/**
+ * \def nl_rt_del_route(m, family, dst_len, table)
+ * \param m       Netlink message buffer
+ * \param family  Address family
+ * \param dst_len Destination prefix length
+ * \param table   Table (RT_TABLE_*)
+ *
+ * Construct a request to delete a route. The destination must be
+ * specified by adding its attribute to the message.
+ */
+#define nl_rt_del_route(m, family, dst_len, table) \
+	nl_rt_request((m), 0, RTM_DELROUTE, (family), (dst_len), (table), \
+	              0, RT_SCOPE_NOWHERE, 0)
+
+/**
+ * \brief Create a netlink route request
+ * \param[in] m        Netlink message buffer
+ * \param[in] pid      Destination netlink port
+ * \param[in] type     One of: RTM_GETROUTE, RTM_NEWROUTE, RTM_DELROUTE
+ * \param[in] family   Address family (AF_INET[6])
+ * \param[in] dst_len  Destination prefix length
+ * \param[in] table    Table (RT_TABLE_*)
+ * \param[in] protocol Protocol (RTPROT_*)
+ * \param[in] scope    Scope (RT_SCOPE_*)
+ * \param[in] rtype    Route type (RTN_*)
+ * \relates nl_request
+ *
+ * Tables above 255 are given by the RTA_TABLE attribute. RTM_NEWROUTE
+ * requests are flagged with NLM_F_CREATE, and RTM_GETROUTE requests
+ * with NLM_F_DUMP.
+ */
+void nl_rt_request(struct nlmsghdr *m, __u32 pid, __u8 type, __u8 family,
+                   __u8 dst_len, __u32 table, __u8 protocol, __u8 scope,
+                   __u8 rtype);
+
+/**
+ * \brief Add an address attribute (i.e. RTA_DST or RTA_GATEWAY)
+ * \param[in] m      Netlink message buffer
+ * \param[in] type   Attribute type
+ * \param[in] family Address family (AF_INET[6])
+ * \param[in] addr   Address (network byte order)
+ */
+void nl_rt_add_addr(struct nlmsghdr *m, __u16 type, __u8 family,
+                    const void *addr);
+
+/**
+ * \brief Add metrics (RTA_METRICS)
+ * \param[in] m       Netlink message buffer
+ * \param[in] metrics Metrics, indexed by RTAX_* (RTAX_MAX + 1 of them)
+ *
+ * Metrics that are zero aren't added.
+ */
+void nl_rt_add_metrics(struct nlmsghdr *m, const __u32 *metrics);
+
+/**
+ * \def nl_rt_mp_begin(m)
+ * \param m Netlink message buffer
+ *
+ * Begin adding the next hops of a multipath route (RTA_MULTIPATH.)
+ */
+#define nl_rt_mp_begin(m) nla_start((m), RTA_MULTIPATH)
+
+/**
+ * \brief Add a next hop to a multipath route
+ * \param[in] mp     Next hops (from nl_rt_mp_begin())
+ * \param[in] family Address family (AF_INET[6])
+ * \param[in] nh     Next hop
+ */
+void nl_rt_mp_add(struct nlattr *mp, __u8 family,
+                  const struct nl_rt_nexthop *nh);
+
+/**
+ * \def nl_rt_mp_end(m, mp)
+ * \param m  Netlink message buffer
+ * \param mp Next hops (from nl_rt_mp_begin())
+ *
+ * Finish adding the next hops of a multipath route.
+ */
+#define nl_rt_mp_end(m, mp) nla_end((m), (mp))
+
+/**
+ * \brief Create a request to add (or replace) or delete a route
+ * \param[in] m    Netlink message buffer
+ * \param[in] type RTM_NEWROUTE or RTM_DELROUTE
+ * \param[in] r    Route
+ *
+ * RTM_NEWROUTE requests are flagged with NLM_F_REPLACE, so that an
+ * existing route to the same destination (with the same priority) is
+ * replaced.
+ */
+void nl_rt_route(struct nlmsghdr *m, __u8 type, const struct nl_rt_route *r);
+
+/**
+ * \brief Add, replace or delete many routes
+ * \param[in]  fd   Netlink socket file descriptor (blocking)
+ * \param[in]  b    Batch (with an empty buffer)
+ * \param[in]  type RTM_NEWROUTE or RTM_DELROUTE
+ * \param[in]  r    Routes
+ * \param[in]  n    Number of routes
+ * \param[out] errs Result for each route (0, or a negative \a errno
+ *                  value such as -ESRCH.) May be NULL.
+ * \return The number of routes added / deleted, or -1 on error (with
+ *         \a errno set.)
+ *
+ * As many requests as fit in the batch's buffer are sent with each
+ * \a sendmsg(2) call, and the ACKs for them are collected before
+ * sending the next batch. The buffer should be no larger than the
+ * socket's send buffer, and the receive buffer should be large enough
+ * to hold an error for each request in a batch.
+ */
+long nl_rt_bulk(int fd, struct nl_batch *b, __u8 type,
+                const struct nl_rt_route *r, size_t n, int *errs);
+
+/**
+ * \brief Decode a route
+ * \param[in]  m   Netlink message buffer (RTM_NEWROUTE / RTM_DELROUTE)
+ * \param[out] r   Route
+ * \param[out] nh  Next hops
+ * \param[in]  nnh Number of elements in \a nh
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * Only the first \a nnh next hops are decoded, and \a r->nh is set to
+ * \a nh. Metrics aren't decoded (\a r->metrics is NULL.) Routes using
+ * a nexthop object have \a r->nh_id set.
+ */
+int nl_rt_parse(struct nlmsghdr *m, struct nl_rt_route *r,
+                struct nl_rt_nexthop *nh, __u8 nnh);
+
+#endif /* NL_ROUTE_H */
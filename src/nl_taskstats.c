@@ -0,0 +1,187 @@
+/**
+ * nanonl: Netlink taskstats Functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "nl.h"
+#include "nl_taskstats.h"
+
+/* Every version of struct taskstats has the fields up to ac_comm */
+#define STATS_MINLEN offsetof(struct taskstats, ac_comm)
+
+/**
+ * \brief Get the statistics of a task or thread group
+ * \param[in] m      Netlink message buffer.
+ * \param[in] family taskstats family ID
+ * \param[in] type   TASKSTATS_CMD_ATTR_PID or TASKSTATS_CMD_ATTR_TGID
+ * \param[in] id     PID (or TGID)
+ */
+void nl_taskstats_get(struct nlmsghdr *m, __u16 family, __u16 type,
+                      __u32 id)
+{
+	if (!m) return;
+	nl_gen_request(m, 0, family, TASKSTATS_CMD_GET, TASKSTATS_GENL_VERSION);
+	nl_add_attr(m, type, &id, sizeof id);
+}
+
+/**
+ * \brief Register for (or deregister from) exit notifications
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  taskstats family ID
+ * \param[in] type    TASKSTATS_CMD_ATTR_REGISTER_CPUMASK or
+ *                    TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK
+ * \param[in] cpumask CPUs (i.e. "0-3,8")
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The statistics of each task exiting on the given CPUs are then sent
+ * to the socket this request is sent on, so it must be sent on the
+ * socket that will receive them.
+ */
+int nl_taskstats_cpumask(struct nlmsghdr *m, __u16 family, __u16 type,
+                         const char *cpumask)
+{
+	size_t len;
+
+	if (!m || !cpumask || !(len = strlen(cpumask)) || len > 0xfff0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	nl_gen_request(m, 0, family, TASKSTATS_CMD_GET, TASKSTATS_GENL_VERSION);
+	nl_add_attr(m, type, cpumask, len + 1);
+	return 0;
+}
+
+/**
+ * \brief Make the CPU mask of a shard of the CPUs
+ * \param[out] mask    CPU mask
+ * \param[in]  ncpus   Number of CPUs
+ * \param[in]  nshards Number of shards
+ * \param[in]  shard   Shard (0 ... \a nshards - 1)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The CPUs are split into \a nshards contiguous ranges of (nearly)
+ * equal size, so that the exit notifications can be spread over one
+ * socket (and thread) per shard:
+ *
+ * \code{.c}
+ * char mask[NL_TASKSTATS_CPUMASK_LEN];
+ *
+ * for (i = 0; i < nshards; i++) {
+ * 	if (nl_taskstats_shard(mask, ncpus, nshards, i) ||
+ * 	    nl_taskstats_register(req, family, mask) ||
+ * 	    nl_transact(fd[i], req, sizeof buf, NULL) < 0)
+ * 		goto err;
+ * }
+ * \endcode
+ */
+int nl_taskstats_shard(char mask[NL_TASKSTATS_CPUMASK_LEN], unsigned ncpus,
+                       unsigned nshards, unsigned shard)
+{
+	unsigned long first, end;
+
+	if (!mask || !nshards || shard >= nshards || ncpus < nshards) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	first = (unsigned long)shard * ncpus / nshards;
+	end   = ((unsigned long)shard + 1) * ncpus / nshards;
+	sprintf(mask, "%lu-%lu", first, end - 1);
+	return 0;
+}
+
+/**
+ * Decode a record (TASKSTATS_TYPE_AGGR_PID / TASKSTATS_TYPE_AGGR_TGID)
+ */
+static int parse_aggr(struct nlattr *aggr, struct nl_taskstats_rec *r)
+{
+	struct nlattr *nla;
+
+	memset(r, 0, sizeof *r);
+	r->tgid = (aggr->nla_type & NLA_TYPE_MASK) == TASKSTATS_TYPE_AGGR_TGID;
+	nla_each(nla, aggr) {
+		switch (nla->nla_type & NLA_TYPE_MASK) {
+		case TASKSTATS_TYPE_PID:
+		case TASKSTATS_TYPE_TGID:
+			if (nla->nla_len >= NLA_HDRLEN + sizeof(__u32))
+				r->id = *(__u32 *)NLA_DATA(nla);
+			break;
+		case TASKSTATS_TYPE_STATS:
+			r->stats = NLA_DATA(nla);
+			r->len   = (__u32)(nla->nla_len - NLA_HDRLEN);
+			break;
+		default: break;
+		}
+	}
+
+	return r->id && r->stats && r->len >= STATS_MINLEN ? 0 : -1;
+}
+
+/**
+ * \brief Decode the statistics in a taskstats message
+ * \param[in]  m Netlink message buffer.
+ * \param[out] r Statistics
+ * \return The number of records decoded, or -1 on error (with \a errno
+ *         set to EINVAL.)
+ *
+ * Nothing is copied: \a r points into \a m. When the last thread of a
+ * thread group exits, the kernel sends the statistics of both the
+ * thread (r[0]) and the group (r[1]) in the same message.
+ */
+int nl_taskstats_parse(struct nlmsghdr *m, struct nl_taskstats_rec r[2])
+{
+	int n = 0;
+	__u16 type;
+	struct nlattr *nla;
+
+	if (!m || !r || !NLMSG_OK(m, m->nlmsg_len) ||
+	    m->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN) ||
+	    ((struct genlmsghdr *)NLMSG_DATA(m))->cmd != TASKSTATS_CMD_NEW)
+		goto inval;
+
+	nla = BYTE_OFF(NLMSG_DATA(m), NLMSG_ALIGN(GENL_HDRLEN));
+	while ((size_t)((char *)nla - (char *)m) + NLA_HDRLEN <= m->nlmsg_len) {
+		if (nla->nla_len < NLA_HDRLEN) break;
+
+		type = (__u16)(nla->nla_type & NLA_TYPE_MASK);
+		if ((type == TASKSTATS_TYPE_AGGR_PID ||
+		     type == TASKSTATS_TYPE_AGGR_TGID) && n < 2 &&
+		    parse_aggr(nla, &r[n++]))
+			goto inval;
+
+		nla = BYTE_OFF(nla, NLA_ALIGN(nla->nla_len));
+	}
+
+	if (n) return n;
+
+inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * \brief Copy the statistics of a record
+ * \param[in]  r  Record (from nl_taskstats_parse())
+ * \param[out] ts Statistics
+ *
+ * The fields the kernel didn't send (past \a r->len) are zeroed.
+ */
+void nl_taskstats_copy(const struct nl_taskstats_rec *r,
+                       struct taskstats *ts)
+{
+	size_t len;
+
+	if (!r || !ts) return;
+	len = r->len < sizeof *ts ? r->len : sizeof *ts;
+	memset(ts, 0, sizeof *ts);
+	if (r->stats) memcpy(ts, r->stats, len);
+}
@@ -0,0 +1,154 @@
+/**
+ * \file nl_taskstats.h
+ *
+ * nanonl: Netlink taskstats functions
+ * Copyright (C) 2015 - 2025 Tim Hentenaar.
+ *
+ * This code is Licensed under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NL_TASKSTATS_H
+#define NL_TASKSTATS_H
+
+#include <sys/types.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+
+#include "nl_gen.h"
+
+/**
+ * \brief Length of the CPU masks made by nl_taskstats_shard()
+ */
+#define NL_TASKSTATS_CPUMASK_LEN 24
+
+/**
+ * \brief Statistics of a task (or a thread group)
+ *
+ * \a stats points to a struct taskstats in the message it was decoded
+ * from, and is only valid as long as the message is. The kernel only
+ * pads it to 8 bytes (within an 8-byte aligned buffer) on architectures
+ * without efficient unaligned access, so elsewhere (i.e. x86) it may
+ * be 4-byte aligned. Its fields must be read with \a memcpy(3), or
+ * from a copy made by nl_taskstats_copy():
+ *
+ * \code{.c}
+ * __u64 cpu;
+ *
+ * memcpy(&cpu, (const char *)r.stats +
+ *        offsetof(struct taskstats, cpu_run_real_total), sizeof cpu);
+ * \endcode
+ *
+ * \a len may differ from sizeof(struct taskstats), if the kernel's
+ * version of the structure (its \a version field) differs: fields past
+ * \a len weren't sent.
+ */
+struct nl_taskstats_rec {
+	const void *stats; /**< Statistics (within the message) */
+	__u32 len;         /**< Length of \a stats */
+	__u32 id;          /**< PID (or TGID) */
+	__u8 tgid;         /**< Non-zero if \a id is a TGID */
+};
+
+/**
+ * \brief Look up the ID of the taskstats family
+ * \param[in] m Netlink message buffer.
+ */
+#define nl_taskstats_find_family(m) \
+	nl_gen_find_family((m), TASKSTATS_GENL_NAME)
+
+/**
+ * \brief Get the statistics of a task or thread group
+ * \param[in] m      Netlink message buffer.
+ * \param[in] family taskstats family ID
+ * \param[in] type   TASKSTATS_CMD_ATTR_PID or TASKSTATS_CMD_ATTR_TGID
+ * \param[in] id     PID (or TGID)
+ */
+void nl_taskstats_get(struct nlmsghdr *m, __u16 family, __u16 type,
+                      __u32 id);
+
+/**
+ * \brief Register for (or deregister from) exit notifications
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  taskstats family ID
+ * \param[in] type    TASKSTATS_CMD_ATTR_REGISTER_CPUMASK or
+ *                    TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK
+ * \param[in] cpumask CPUs (i.e. "0-3,8")
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The statistics of each task exiting on the given CPUs are then sent
+ * to the socket this request is sent on, so it must be sent on the
+ * socket that will receive them.
+ */
+int nl_taskstats_cpumask(struct nlmsghdr *m, __u16 family, __u16 type,
+                         const char *cpumask);
+
+/**
+ * \brief Register for exit notifications
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  taskstats family ID
+ * \param[in] cpumask CPUs (i.e. "0-3,8")
+ */
+#define nl_taskstats_register(m, family, cpumask) \
+	nl_taskstats_cpumask((m), (family), \
+	                     TASKSTATS_CMD_ATTR_REGISTER_CPUMASK, (cpumask))
+
+/**
+ * \brief Deregister from exit notifications
+ * \param[in] m       Netlink message buffer.
+ * \param[in] family  taskstats family ID
+ * \param[in] cpumask CPUs (i.e. "0-3,8")
+ */
+#define nl_taskstats_deregister(m, family, cpumask) \
+	nl_taskstats_cpumask((m), (family), \
+	                     TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK, (cpumask))
+
+/**
+ * \brief Make the CPU mask of a shard of the CPUs
+ * \param[out] mask    CPU mask
+ * \param[in]  ncpus   Number of CPUs
+ * \param[in]  nshards Number of shards
+ * \param[in]  shard   Shard (0 ... \a nshards - 1)
+ * \return 0 on success, or -1 on error (with \a errno set to EINVAL.)
+ *
+ * The CPUs are split into \a nshards contiguous ranges of (nearly)
+ * equal size, so that the exit notifications can be spread over one
+ * socket (and thread) per shard:
+ *
+ * \code{.c}
+ * char mask[NL_TASKSTATS_CPUMASK_LEN];
+ *
+ * for (i = 0; i < nshards; i++) {
+ * 	if (nl_taskstats_shard(mask, ncpus, nshards, i) ||
+ * 	    nl_taskstats_register(req, family, mask) ||
+ * 	    nl_transact(fd[i], req, sizeof buf, NULL) < 0)
+ * 		goto err;
+ * }
+ * \endcode
+ */
+int nl_taskstats_shard(char mask[NL_TASKSTATS_CPUMASK_LEN], unsigned ncpus,
+                       unsigned nshards, unsigned shard);
+
+/**
+ * \brief Decode the statistics in a taskstats message
+ * \param[in]  m Netlink message buffer.
+ * \param[out] r Statistics
+ * \return The number of records decoded, or -1 on error (with \a errno
+ *         set to EINVAL.)
+ *
+ * Nothing is copied: \a r points into \a m. When the last thread of a
+ * thread group exits, the kernel sends the statistics of both the
+ * thread (r[0]) and the group (r[1]) in the same message.
+ */
+int nl_taskstats_parse(struct nlmsghdr *m, struct nl_taskstats_rec r[2]);
+
+/**
+ * \brief Copy the statistics of a record
+ * \param[in]  r  Record (from nl_taskstats_parse())
+ * \param[out] ts Statistics
+ *
+ * The fields the kernel didn't send (past \a r->len) are zeroed.
+ */
+void nl_taskstats_copy(const struct nl_taskstats_rec *r,
+                       struct taskstats *ts);
+
+#endif /* NL_TASKSTATS_H */
@@ -0,0 +1,254 @@
+#include <string.h>
+#include <errno.h>
+#include <check.h>
+
+#include "ethtool.h"
+#include "../src/nl_ethtool.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+/* ethtool family ID */
+#define FAMILY 21
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+/**
+ * Make a reply, as sent by the kernel
+ */
+static struct nlattr *make_reply(__u8 cmd, __u16 hdr, __u32 ifindex)
+{
+	struct nlattr *nla;
+
+	nl_gen_request(m, 0, FAMILY, cmd, ETHTOOL_GENL_VERSION);
+	nla = nla_start(m, hdr);
+	nla_add_attr(nla, ETHTOOL_A_HEADER_DEV_INDEX, &ifindex, sizeof ifindex);
+	nla_end(m, nla);
+	return nla;
+}
+
+START_TEST(ethtool_requests)
+{
+	struct nlattr *hdr, *nla;
+	__u32 ids[2] = { ETH_SS_STATS_ETH_MAC, ETH_SS_STATS_RMON };
+
+	nl_ethtool_channels_get(m, FAMILY, 2);
+	ck_assert(m->nlmsg_type == FAMILY);
+	ck_assert(!(m->nlmsg_flags & NLM_F_DUMP));
+	ck_assert(((struct genlmsghdr *)NLMSG_DATA(m))->cmd ==
+	          ETHTOOL_MSG_CHANNELS_GET);
+	ck_assert((hdr = nl_gen_get_attr(m, ETHTOOL_A_CHANNELS_HEADER)));
+	ck_assert(hdr->nla_type & NLA_F_NESTED);
+	ck_assert((nla = nla_get_attr(hdr, ETHTOOL_A_HEADER_DEV_INDEX)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 2);
+
+	/* Every device, with an empty header */
+	nl_ethtool_rings_get(m, FAMILY, 0);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert((hdr = nl_gen_get_attr(m, ETHTOOL_A_RINGS_HEADER)));
+	ck_assert(hdr->nla_len == NLA_HDRLEN);
+
+	/* Global string sets aren't dumped */
+	nl_ethtool_strset_get(m, FAMILY, 0, ids, 2);
+	ck_assert(!(m->nlmsg_flags & NLM_F_DUMP));
+	ck_assert((hdr = nl_gen_get_attr(m, ETHTOOL_A_STRSET_HEADER)));
+	ck_assert(hdr->nla_len == NLA_HDRLEN);
+	ck_assert((hdr = nl_gen_get_attr(m, ETHTOOL_A_STRSET_STRINGSETS)));
+	ck_assert(hdr->nla_len == NLA_HDRLEN + 2 * (2 * NLA_HDRLEN + 4));
+	nla = NLA_DATA(hdr);
+	ck_assert(*(__u32 *)NLA_DATA(NLA_DATA(nla)) == ETH_SS_STATS_ETH_MAC);
+}
+END_TEST
+
+START_TEST(ethtool_strsets)
+{
+	__u32 v;
+	struct nlattr *sets, *set, *strs, *str;
+	char names[2][ETH_GSTRING_LEN];
+	struct nl_ethtool_strset ss[2];
+
+	make_reply(ETHTOOL_MSG_STRSET_GET_REPLY, ETHTOOL_A_STRSET_HEADER, 0);
+	sets = nla_start(m, ETHTOOL_A_STRSET_STRINGSETS);
+	set = nla_nest_start(sets, ETHTOOL_A_STRINGSETS_STRINGSET);
+	v = ETH_SS_STATS_RMON;
+	nla_add_attr(set, ETHTOOL_A_STRINGSET_ID, &v, sizeof v);
+	v = 3;
+	nla_add_attr(set, ETHTOOL_A_STRINGSET_COUNT, &v, sizeof v);
+	strs = nla_nest_start(set, ETHTOOL_A_STRINGSET_STRINGS);
+	for (v = 0; v < 3; v++) {
+		str = nla_nest_start(strs, ETHTOOL_A_STRINGS_STRING);
+		nla_add_attr(str, ETHTOOL_A_STRING_INDEX, &v, sizeof v);
+		nla_add_attr(str, ETHTOOL_A_STRING_VALUE, v ? "frag" : "jabber",
+		             v ? 5 : 7);
+		nla_nest_end(strs, str);
+	}
+	nla_nest_end(set, strs);
+	nla_nest_end(sets, set);
+	nla_end(m, sets);
+
+	/* Only the sets asked for, and as many strings as fit */
+	memset(ss, 0, sizeof ss);
+	memset(names, 'x', sizeof names);
+	ss[0].id = ETH_SS_STATS_ETH_MAC;
+	ss[1].id = ETH_SS_STATS_RMON, ss[1].size = 2, ss[1].str = names;
+	ck_assert(!nl_ethtool_parse_strsets(m, ss, 2));
+	ck_assert(!ss[0].count);
+	ck_assert(ss[1].count == 3);
+	ck_assert(!strcmp(names[0], "jabber"));
+	ck_assert(!strcmp(names[1], "frag"));
+
+	errno = 0;
+	make_reply(ETHTOOL_MSG_RINGS_GET_REPLY, ETHTOOL_A_RINGS_HEADER, 1);
+	ck_assert(nl_ethtool_parse_strsets(m, ss, 2) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(ethtool_parse)
+{
+	__u8 u8;
+	__u32 v;
+	struct nl_ethtool_channels c;
+	struct nl_ethtool_rings r;
+	struct nl_ethtool_linkmode l;
+
+	make_reply(ETHTOOL_MSG_CHANNELS_GET_REPLY, ETHTOOL_A_CHANNELS_HEADER,
+	           4);
+	v = 8;
+	nl_add_attr(m, ETHTOOL_A_CHANNELS_COMBINED_MAX, &v, sizeof v);
+	v = 4;
+	nl_add_attr(m, ETHTOOL_A_CHANNELS_COMBINED_COUNT, &v, sizeof v);
+	ck_assert(!nl_ethtool_parse_channels(m, &c));
+	ck_assert(c.ifindex == 4);
+	ck_assert(c.combined_max == 8 && c.combined_count == 4);
+	ck_assert(!c.rx_max && !c.rx_count);
+	ck_assert(nl_ethtool_parse_rings(m, &r) == -1);
+
+	make_reply(ETHTOOL_MSG_RINGS_GET_REPLY, ETHTOOL_A_RINGS_HEADER, 3);
+	v = 4096;
+	nl_add_attr(m, ETHTOOL_A_RINGS_RX_MAX, &v, sizeof v);
+	v = 512;
+	nl_add_attr(m, ETHTOOL_A_RINGS_RX, &v, sizeof v);
+	ck_assert(!nl_ethtool_parse_rings(m, &r));
+	ck_assert(r.ifindex == 3);
+	ck_assert(r.rx_max == 4096 && r.rx == 512);
+	ck_assert(!r.tx_max && !r.tx);
+
+	make_reply(ETHTOOL_MSG_LINKMODES_GET_REPLY, ETHTOOL_A_LINKMODES_HEADER,
+	           2);
+	v = 10000;
+	nl_add_attr(m, ETHTOOL_A_LINKMODES_SPEED, &v, sizeof v);
+	u8 = DUPLEX_FULL;
+	nl_add_attr(m, ETHTOOL_A_LINKMODES_DUPLEX, &u8, sizeof u8);
+	u8 = AUTONEG_ENABLE;
+	nl_add_attr(m, ETHTOOL_A_LINKMODES_AUTONEG, &u8, sizeof u8);
+	ck_assert(!nl_ethtool_parse_linkmode(m, &l));
+	ck_assert(l.ifindex == 2 && l.speed == 10000);
+	ck_assert(l.duplex == DUPLEX_FULL && l.autoneg == AUTONEG_ENABLE);
+	ck_assert(!l.lanes);
+}
+END_TEST
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+/**
+ * Add a group of counters (starting at \a first) to a statistics reply
+ */
+static void add_grp(__u32 id, __u16 first, __u16 n)
+{
+	__u64 v;
+	struct nlattr *grp, *stat;
+
+	grp = nla_start(m, ETHTOOL_A_STATS_GRP);
+	nla_add_attr(grp, ETHTOOL_A_STATS_GRP_ID, &id, sizeof id);
+	for (; n; first++, n--) {
+		v = 1000 * id + first;
+		stat = nla_nest_start(grp, ETHTOOL_A_STATS_GRP_STAT);
+		nla_add_attr(stat, first, &v, sizeof v);
+		nla_nest_end(grp, stat);
+	}
+	nla_end(m, grp);
+}
+
+START_TEST(ethtool_stats)
+{
+	struct nlattr *nla, *bits;
+	struct nl_ethtool_stats s;
+
+	nl_ethtool_stats_get(m, FAMILY, 0, 1 << ETHTOOL_STATS_ETH_MAC);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert((bits = nl_gen_get_attr(m, ETHTOOL_A_STATS_GROUPS)));
+	ck_assert(nla_get_attr(bits, ETHTOOL_A_BITSET_NOMASK));
+	ck_assert((nla = nla_get_attr(bits, ETHTOOL_A_BITSET_SIZE)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == __ETHTOOL_STATS_CNT);
+	ck_assert((nla = nla_get_attr(bits, ETHTOOL_A_BITSET_VALUE)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 1 << ETHTOOL_STATS_ETH_MAC);
+
+	make_reply(ETHTOOL_MSG_STATS_GET_REPLY, ETHTOOL_A_STATS_HEADER, 5);
+	add_grp(ETHTOOL_STATS_ETH_MAC, ETHTOOL_A_STATS_ETH_MAC_5_RX_PKT, 2);
+	add_grp(ETHTOOL_STATS_RMON, __ETHTOOL_A_STATS_RMON_CNT - 1, 2);
+	add_grp(ETHTOOL_STATS_RMON + 1, 0, 1);
+	add_grp(__ETHTOOL_STATS_CNT, 0, 1);
+	ck_assert(!nl_ethtool_parse_stats(m, &s));
+	ck_assert(s.ifindex == 5);
+
+	/* Groups newer than ETHTOOL_STATS_RMON are ignored */
+	ck_assert(s.groups == (1 << ETHTOOL_STATS_ETH_MAC |
+	                       1 << ETHTOOL_STATS_RMON));
+	ck_assert(!s.ctr[NL_ETHTOOL_STATS_MAC]);
+	ck_assert(s.ctr[NL_ETHTOOL_STATS_MAC +
+	                ETHTOOL_A_STATS_ETH_MAC_5_RX_PKT] == 1003);
+	ck_assert(s.ctr[NL_ETHTOOL_STATS_MAC +
+	                ETHTOOL_A_STATS_ETH_MAC_6_FCS_ERR] == 1004);
+
+	/* Counters past the end of a group are ignored */
+	ck_assert(s.ctr[NL_ETHTOOL_STATS_CNT - 1] ==
+	          3000 + __ETHTOOL_A_STATS_RMON_CNT - 1);
+}
+END_TEST
+
+START_TEST(ethtool_collect)
+{
+	struct nl_ethtool_stats s[2];
+	struct nl_ethtool_stats_list l;
+
+	l.s = s, l.n = 2, l.count = 0;
+	make_reply(ETHTOOL_MSG_STATS_GET_REPLY, ETHTOOL_A_STATS_HEADER, 1);
+	ck_assert(!nl_ethtool_stats_collect(m, &l));
+	ck_assert(!nl_ethtool_stats_collect(NULL, &l));
+	ck_assert(!l.count);
+
+	make_reply(ETHTOOL_MSG_STATS_GET_REPLY, ETHTOOL_A_STATS_HEADER, 2);
+	nl_ethtool_stats_collect(m, &l);
+	make_reply(ETHTOOL_MSG_STATS_GET_REPLY, ETHTOOL_A_STATS_HEADER, 3);
+	nl_ethtool_stats_collect(m, &l);
+	make_reply(ETHTOOL_MSG_STATS_GET_REPLY, ETHTOOL_A_STATS_HEADER, 4);
+	nl_ethtool_stats_collect(m, &l);
+	ck_assert(l.count == 3);
+	ck_assert(s[0].ifindex == 2 && s[1].ifindex == 3);
+}
+END_TEST
+#endif /* Linux >= 5.13.0 */
+
+Suite *ethtool_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netlink_Generic / ethtool Helpers");
+	t = tcase_create("ethtool");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, ethtool_requests);
+	tcase_add_test(t, ethtool_strsets);
+	tcase_add_test(t, ethtool_parse);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+	tcase_add_test(t, ethtool_stats);
+	tcase_add_test(t, ethtool_collect);
+#endif /* Linux >= 5.13.0 */
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
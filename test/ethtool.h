@@ -0,0 +1,7 @@
+#ifndef ETHTOOL_SUITE_H
+#define ETHTOOL_SUITE_H
+#include <check.h>
+
+Suite *ethtool_suite(void);
+
+#endif /* ETHTOOL_SUITE_H */
@@ -0,0 +1,389 @@
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "fib.h"
+#include "../src/nl_fib.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static struct nl_fib f;
+static struct nl_fib_node nodes[64];
+static struct nl_fib_route routes[32];
+static struct nl_fib_dir dir[256];
+
+/* Changes applied by the writer thread (in fib_concurrent) */
+static __u32 changes[4][128];
+static int done;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+/**
+ * Create a route message
+ */
+static void build(__u8 type, __u8 family, const char *dst, __u8 dst_len,
+                  __u32 priority, const char *gw)
+{
+	struct nl_rt_route r;
+	struct nl_rt_nexthop nh;
+
+	memset(&r, 0, sizeof r);
+	memset(&nh, 0, sizeof nh);
+	r.family   = family;
+	r.dst_len  = dst_len;
+	r.priority = priority;
+	r.nh       = &nh;
+	r.nnh      = 1;
+	nh.ifindex = 1;
+	inet_pton(family, dst, r.dst);
+	if (gw) inet_pton(family, gw, nh.gw);
+	nl_rt_route(m, type, &r);
+}
+
+/**
+ * Apply a route to (or from) \a f
+ */
+static int route(__u8 type, __u8 family, const char *dst, __u8 dst_len,
+                 __u32 priority, const char *gw)
+{
+	build(type, family, dst, dst_len, priority, gw);
+	return nl_fib_apply(&f, m);
+}
+
+/**
+ * Look up \a addr in \a f, and get the prefix length matched
+ */
+static int lookup(__u8 family, const char *addr)
+{
+	__u32 a[4];
+	struct nl_fib_route rt;
+
+	inet_pton(family, addr, a);
+	if (nl_fib_lookup(&f, a, &rt)) return -1;
+	return rt.dst_len;
+}
+
+START_TEST(fib_init)
+{
+	__u32 a = 0;
+	struct nl_fib_route rt;
+
+	errno = 0;
+	ck_assert(nl_fib_init(NULL, AF_INET, RT_TABLE_MAIN, nodes, 64,
+	                      routes, 32) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 0,
+	                      routes, 32) == -1);
+	ck_assert(nl_fib_init(&f, AF_UNSPEC, RT_TABLE_MAIN, nodes, 64,
+	                      routes, 32) == -1);
+	ck_assert(!nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64,
+	                       routes, 32));
+	ck_assert(!f.count);
+
+	errno = 0;
+	ck_assert(nl_fib_lookup(&f, &a, &rt) == -1);
+	ck_assert(errno == ENOENT);
+	ck_assert(nl_fib_lookup(&f, &a, NULL) == -1);
+}
+END_TEST
+
+START_TEST(fib_lpm_v4)
+{
+	struct nl_fib_route rt;
+	__u32 a, n;
+
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 32);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.2.0", 24, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.2.3", 32, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.0.0", 16, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.3.0", 24, 0, NULL));
+	ck_assert(f.count == 5);
+
+	ck_assert(lookup(AF_INET, "192.0.2.1") == -1);
+	ck_assert(lookup(AF_INET, "10.9.9.9") == 8);
+	ck_assert(lookup(AF_INET, "10.1.9.9") == 16);
+	ck_assert(lookup(AF_INET, "10.1.2.9") == 24);
+	ck_assert(lookup(AF_INET, "10.1.3.9") == 24);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 32);
+
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "0.0.0.0", 0, 0,
+	                 "192.0.2.1"));
+	ck_assert(lookup(AF_INET, "192.0.2.1") == 0);
+	inet_pton(AF_INET, "192.0.2.1", &a);
+	ck_assert(!nl_fib_lookup(&f, &a, &rt));
+	ck_assert(rt.gw[0] == a && rt.ifindex == 1);
+	ck_assert(rt.type == RTN_UNICAST);
+
+	/* Removing a prefix leaves the longer and shorter ones */
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.0.0", 16, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.1.9.9") == 8);
+	ck_assert(lookup(AF_INET, "10.1.2.9") == 24);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 32);
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.2.3", 32, 0, NULL));
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.2.0", 24, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 8);
+	ck_assert(lookup(AF_INET, "10.1.3.3") == 24);
+
+	/* Unknown routes are ignored */
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.2.0", 24, 0, NULL));
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.3.0", 24, 5, NULL));
+	ck_assert(f.count == 3);
+
+	/* Each node is returned when the routes are removed */
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.1.3.0", 24, 0, NULL));
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "0.0.0.0", 0, 0, NULL));
+	ck_assert(!f.count);
+	ck_assert(!nodes[0].child[0] && !nodes[0].child[1]);
+	for (a = 0, n = f.free_node; n; a++) n = nodes[n].child[0];
+	ck_assert(a == 63);
+}
+END_TEST
+
+START_TEST(fib_priority)
+{
+	struct nl_fib_route rt;
+	__u32 a;
+
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 32);
+	inet_pton(AF_INET, "10.0.0.1", &a);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 20,
+	                 "192.0.2.20"));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 10,
+	                 "192.0.2.10"));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 30,
+	                 "192.0.2.30"));
+	ck_assert(!nl_fib_lookup(&f, &a, &rt) && rt.priority == 10);
+
+	/* Replaced */
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 10,
+	                 "192.0.2.11"));
+	ck_assert(f.count == 3);
+	ck_assert(!nl_fib_lookup(&f, &a, &rt) && rt.priority == 10);
+	ck_assert(rt.gw[0] == inet_addr("192.0.2.11"));
+
+	/* Appended next hops are ignored */
+	build(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 10, "192.0.2.12");
+	m->nlmsg_flags |= NLM_F_APPEND;
+	ck_assert(!nl_fib_apply(&f, m));
+	ck_assert(!nl_fib_lookup(&f, &a, &rt));
+	ck_assert(rt.gw[0] == inet_addr("192.0.2.11"));
+
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.0.0.0", 8, 10, NULL));
+	ck_assert(!nl_fib_lookup(&f, &a, &rt) && rt.priority == 20);
+	ck_assert(rt.gw[0] == inet_addr("192.0.2.20"));
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.0.0.0", 8, 30, NULL));
+	ck_assert(!nl_fib_lookup(&f, &a, &rt) && rt.priority == 20);
+	ck_assert(f.count == 1);
+}
+END_TEST
+
+START_TEST(fib_filter)
+{
+	struct nl_rt_route r;
+
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 32);
+
+	/* Other tables and families are ignored */
+	memset(&r, 0, sizeof r);
+	r.family  = AF_INET;
+	r.table   = 1000;
+	r.dst_len = 8;
+	nl_rt_route(m, RTM_NEWROUTE, &r);
+	ck_assert(!nl_fib_apply(&f, m));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET6, "2001:db8::", 32, 0, NULL));
+	ck_assert(!f.count);
+
+	/* As are other messages */
+	nl_rt_get_routes(m, AF_INET);
+	ck_assert(!nl_fib_apply(&f, m));
+
+	errno = 0;
+	ck_assert(nl_fib_apply(&f, NULL) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(fib_full)
+{
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 2);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.0.0", 16, 0, NULL));
+	errno = 0;
+	ck_assert(route(RTM_NEWROUTE, AF_INET, "10.2.0.0", 16, 0, NULL) == -1);
+	ck_assert(errno == ENOSPC);
+
+	/* The root and a leaf, but no room to split */
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 2, routes, 32);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "0.0.0.0", 0, 0, NULL));
+	errno = 0;
+	ck_assert(route(RTM_NEWROUTE, AF_INET, "11.0.0.0", 8, 0, NULL) == -1);
+	ck_assert(errno == ENOSPC);
+	ck_assert(lookup(AF_INET, "11.0.0.1") == 0);
+	ck_assert(f.count == 2);
+
+	/* A restarted dump starts over */
+	ck_assert(!nl_fib_collect(NULL, &f));
+	ck_assert(!f.count);
+	ck_assert(lookup(AF_INET, "10.0.0.1") == -1);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "11.0.0.0", 8, 0, NULL));
+}
+END_TEST
+
+START_TEST(fib_lpm_v6)
+{
+	nl_fib_init(&f, AF_INET6, RT_TABLE_MAIN, nodes, 64, routes, 32);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET6, "2001:db8::", 32, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET6, "2001:db8:0:1::", 64, 0,
+	                 NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET6, "2001:db8:0:1::80", 121, 0,
+	                 NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET6, "2001:db8:0:1::1", 128, 0,
+	                 NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(f.count == 4);
+
+	ck_assert(lookup(AF_INET6, "2001:db9::1") == -1);
+	ck_assert(lookup(AF_INET6, "2001:db8:1::1") == 32);
+	ck_assert(lookup(AF_INET6, "2001:db8:0:1::2") == 64);
+	ck_assert(lookup(AF_INET6, "2001:db8:0:1::81") == 121);
+	ck_assert(lookup(AF_INET6, "2001:db8:0:1::1") == 128);
+	ck_assert(!route(RTM_DELROUTE, AF_INET6, "2001:db8:0:1::", 64, 0,
+	                 NULL));
+	ck_assert(lookup(AF_INET6, "2001:db8:0:1::2") == 32);
+	ck_assert(lookup(AF_INET6, "2001:db8:0:1::1") == 128);
+}
+END_TEST
+
+START_TEST(fib_index)
+{
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 32);
+	errno = 0;
+	ck_assert(nl_fib_index(&f, dir, 0) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(nl_fib_index(&f, dir, 25) == -1);
+	ck_assert(!nl_fib_index(&f, NULL, 0));
+	ck_assert(!f.dir);
+
+	/* Indexing an existing table */
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.0.0", 16, 0, NULL));
+	ck_assert(!nl_fib_index(&f, dir, 8));
+	ck_assert(dir[10].route != NL_FIB_NONE);
+	ck_assert(dir[11].route == NL_FIB_NONE);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+	ck_assert(lookup(AF_INET, "10.2.2.3") == 8);
+	ck_assert(lookup(AF_INET, "11.2.2.3") == -1);
+
+	/* Prefixes shorter than the index */
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "0.0.0.0", 0, 0, NULL));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "8.0.0.0", 6, 0, NULL));
+	ck_assert(lookup(AF_INET, "11.2.2.3") == 6);
+	ck_assert(lookup(AF_INET, "12.2.2.3") == 0);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "10.0.0.0", 8, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.2.2.3") == 6);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "8.0.0.0", 6, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.2.2.3") == 0);
+	ck_assert(!route(RTM_DELROUTE, AF_INET, "0.0.0.0", 0, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.2.2.3") == -1);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+
+	/* Clearing the mirror clears the index */
+	nl_fib_clear(&f);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == -1);
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.0.0", 16, 0, NULL));
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+}
+END_TEST
+
+/**
+ * Apply \a changes to \a f, over and over
+ */
+static void *writer(void *arg)
+{
+	int i;
+
+	for (i = 0; i < 200000; i++) {
+		if (nl_fib_apply(&f, (struct nlmsghdr *)changes[i & 3]))
+			break;
+	}
+
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	return arg;
+}
+
+START_TEST(fib_concurrent)
+{
+	int ok = 1;
+	__u32 a, x, y, z;
+	pthread_t t;
+	struct nl_fib_route rt;
+
+	nl_fib_init(&f, AF_INET, RT_TABLE_MAIN, nodes, 64, routes, 32);
+	ck_assert(!nl_fib_index(&f, dir, 8));
+	ck_assert(!route(RTM_NEWROUTE, AF_INET, "10.1.0.0", 16, 0,
+	                 "192.0.2.16"));
+
+	/* The /24 and /20 take turns in the same route slot */
+	build(RTM_NEWROUTE, AF_INET, "10.1.2.0", 24, 0, "192.0.2.24");
+	memcpy(changes[0], m, m->nlmsg_len);
+	build(RTM_DELROUTE, AF_INET, "10.1.2.0", 24, 0, NULL);
+	memcpy(changes[1], m, m->nlmsg_len);
+	build(RTM_NEWROUTE, AF_INET, "10.1.0.0", 20, 0, "192.0.2.20");
+	memcpy(changes[2], m, m->nlmsg_len);
+	build(RTM_DELROUTE, AF_INET, "10.1.0.0", 20, 0, NULL);
+	memcpy(changes[3], m, m->nlmsg_len);
+
+	inet_pton(AF_INET, "10.1.2.3", &a);
+	x = inet_addr("192.0.2.16");
+	y = inet_addr("192.0.2.20");
+	z = inet_addr("192.0.2.24");
+	done = 0;
+	ck_assert(!pthread_create(&t, NULL, writer, NULL));
+
+	/* Each route found is one of them, and never a mix */
+	while (ok && !__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		ok = !nl_fib_lookup(&f, &a, &rt) &&
+		     ((rt.dst_len == 16 && rt.gw[0] == x) ||
+		      (rt.dst_len == 20 && rt.gw[0] == y) ||
+		      (rt.dst_len == 24 && rt.gw[0] == z));
+	}
+
+	pthread_join(t, NULL);
+	ck_assert(ok);
+	ck_assert(f.count == 1);
+	ck_assert(lookup(AF_INET, "10.1.2.3") == 16);
+}
+END_TEST
+
+Suite *fib_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netlink Routing Table Mirror");
+	t = tcase_create("fib");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, fib_init);
+	tcase_add_test(t, fib_lpm_v4);
+	tcase_add_test(t, fib_priority);
+	tcase_add_test(t, fib_filter);
+	tcase_add_test(t, fib_full);
+	tcase_add_test(t, fib_lpm_v6);
+	tcase_add_test(t, fib_index);
+	tcase_add_test(t, fib_concurrent);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
@@ -0,0 +1,7 @@
+#ifndef FIB_SUITE_H
+#define FIB_SUITE_H
+#include <check.h>
+
+Suite *fib_suite(void);
+
+#endif /* FIB_SUITE_H */
@@ -4,6 +4,7 @@
 
 #include "gen.h"
 #include "../src/nl_gen.c"
+#include "../src/nl_gen_cache.c"
 
 extern struct nlmsghdr *m;
 
@@ -40,6 +41,220 @@ START_TEST(gen_find_family)
 }
 END_TEST
 
+/**
+ * Make a nlctrl family message, as sent by the kernel
+ */
+static void make_family(__u8 cmd, const char *name, __u16 id,
+                        const char *grp, __u32 grp_id)
+{
+	__u32 v = 2;
+	struct nlattr *nla, *n;
+
+	nl_gen_request(m, 0, GENL_ID_CTRL, cmd, 2);
+	nl_add_attr(m, CTRL_ATTR_FAMILY_NAME, name, strlen(name) + 1);
+	nl_add_attr(m, CTRL_ATTR_FAMILY_ID, &id, sizeof id);
+	nl_add_attr(m, CTRL_ATTR_VERSION, &v, sizeof v);
+	nla = nla_start(m, CTRL_ATTR_OPS);
+	n = nla_nest_start(nla, 1);
+	v = 3;
+	nla_add_attr(n, CTRL_ATTR_OP_ID, &v, sizeof v);
+	nla_nest_end(nla, n);
+	nla_end(m, nla);
+
+	if (!grp) return;
+	nla = nla_start(m, CTRL_ATTR_MCAST_GROUPS);
+	n = nla_nest_start(nla, 1);
+	nla_add_attr(n, CTRL_ATTR_MCAST_GRP_NAME, grp, strlen(grp) + 1);
+	nla_add_attr(n, CTRL_ATTR_MCAST_GRP_ID, &grp_id, sizeof grp_id);
+	nla_nest_end(nla, n);
+	nla_end(m, nla);
+}
+
+START_TEST(gen_cache)
+{
+	struct nl_gen_cache c;
+	struct nl_gen_family f[4];
+	const struct nl_gen_family *e;
+
+	ck_assert(nl_gen_cache_init(&c, f, 3) == -1);
+	ck_assert(!nl_gen_cache_init(&c, f, 4));
+
+	nl_gen_cache_dump(m);
+	ck_assert(m->nlmsg_type == GENL_ID_CTRL);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+
+	make_family(CTRL_CMD_NEWFAMILY, "nlctrl", GENL_ID_CTRL, "notify", 16);
+	ck_assert(!nl_gen_cache_collect(m, &c));
+	make_family(CTRL_CMD_NEWFAMILY, "ethtool", 20, "monitor", 5);
+	ck_assert(!nl_gen_cache_collect(m, &c));
+	ck_assert(c.count == 2);
+
+	ck_assert(!!(e = nl_gen_cache_find(&c, "ethtool")));
+	ck_assert(e->id == 20 && e->version == 2 && e->ngrps == 1);
+	ck_assert(nl_gen_family_has_op(e, 3));
+	ck_assert(!nl_gen_family_has_op(e, 4));
+	ck_assert(nl_gen_cache_group(&c, "nlctrl", "notify") == 16);
+	errno = 0;
+	ck_assert(nl_gen_cache_group(&c, "nlctrl", "monitor") == -1);
+	ck_assert(errno == ENOENT);
+
+	/* Notifications */
+	make_family(CTRL_CMD_NEWMCAST_GRP, "ethtool", 20, "other", 6);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	ck_assert(nl_gen_cache_group(&c, "ethtool", "other") == 6);
+	make_family(CTRL_CMD_DELMCAST_GRP, "ethtool", 20, "monitor", 5);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	ck_assert(nl_gen_cache_group(&c, "ethtool", "monitor") == -1);
+	ck_assert(nl_gen_cache_group(&c, "ethtool", "other") == 6);
+
+	make_family(CTRL_CMD_DELFAMILY, "ethtool", 20, NULL, 0);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	ck_assert(c.count == 1);
+	errno = 0;
+	ck_assert(!nl_gen_cache_find(&c, "ethtool"));
+	ck_assert(errno == ENOENT);
+	ck_assert(!!nl_gen_cache_find(&c, "nlctrl"));
+
+	/* The cache is emptied when the dump is restarted */
+	ck_assert(!nl_gen_cache_collect(NULL, &c));
+	ck_assert(!c.count && !nl_gen_cache_find(&c, "nlctrl"));
+}
+END_TEST
+
+START_TEST(gen_cache_full)
+{
+	struct nl_gen_cache c;
+	struct nl_gen_family f[2];
+
+	nl_gen_cache_init(&c, f, 2);
+	make_family(CTRL_CMD_NEWFAMILY, "a", 20, NULL, 0);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	make_family(CTRL_CMD_NEWFAMILY, "b", 21, NULL, 0);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	make_family(CTRL_CMD_NEWFAMILY, "b", 22, NULL, 0);
+	ck_assert(!nl_gen_cache_apply(&c, m));
+	ck_assert(nl_gen_cache_find(&c, "b")->id == 22);
+
+	errno = 0;
+	make_family(CTRL_CMD_NEWFAMILY, "c", 23, NULL, 0);
+	ck_assert(nl_gen_cache_apply(&c, m) == -1);
+	ck_assert(errno == ENOSPC);
+	ck_assert(nl_gen_cache_collect(m, &c));
+}
+END_TEST
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+/**
+ * Make a CTRL_CMD_GETPOLICY reply, holding the policy of an attribute
+ */
+static void make_policy(__u16 idx, __u16 attr, __u32 type, __u64 max)
+{
+	__u16 fam = 20;
+	struct nlattr *nla, *p, *a;
+
+	nl_gen_request(m, 0, GENL_ID_CTRL, CTRL_CMD_GETPOLICY, 1);
+	nl_add_attr(m, CTRL_ATTR_FAMILY_ID, &fam, sizeof fam);
+	nla = nla_start(m, CTRL_ATTR_POLICY);
+	p   = nla_nest_start(nla, idx);
+	a   = nla_nest_start(p, attr);
+	nla_add_attr(a, NL_POLICY_TYPE_ATTR_TYPE, &type, sizeof type);
+	if (type == NL_ATTR_TYPE_NESTED) {
+		type = (__u32)max;
+		nla_add_attr(a, NL_POLICY_TYPE_ATTR_POLICY_IDX, &type,
+		             sizeof type);
+	} else if (type == NL_ATTR_TYPE_NUL_STRING) {
+		type = (__u32)max;
+		nla_add_attr(a, NL_POLICY_TYPE_ATTR_MAX_LENGTH, &type,
+		             sizeof type);
+	} else if (max) {
+		nla_add_attr(a, NL_POLICY_TYPE_ATTR_MAX_VALUE_U, &max,
+		             sizeof max);
+		max = 1;
+		nla_add_attr(a, NL_POLICY_TYPE_ATTR_MIN_VALUE_U, &max,
+		             sizeof max);
+	}
+
+	nla_nest_end(p, a);
+	nla_nest_end(nla, p);
+	nla_end(m, nla);
+}
+
+START_TEST(gen_policy)
+{
+	__u8 v8 = 5;
+	__u16 fam = 20;
+	__u32 v = 4;
+	struct nlattr *nla, *n, *bad;
+	struct nl_gen_policy p[2 * 4];
+	struct nl_gen_policies ps;
+
+	ck_assert(nl_gen_policy_init(&ps, p, 0, 4, 20, 3) == -1);
+	ck_assert(!nl_gen_policy_init(&ps, p, 2, 4, 20, 3));
+	nl_gen_get_policy(m, 20, 3);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(!!(nla = nl_gen_get_attr(m, CTRL_ATTR_FAMILY_ID)));
+	ck_assert(nla->nla_len == NLA_HDRLEN + sizeof fam);
+
+	/* The reply */
+	nl_gen_request(m, 0, GENL_ID_CTRL, CTRL_CMD_GETPOLICY, 1);
+	nl_add_attr(m, CTRL_ATTR_FAMILY_ID, &fam, sizeof fam);
+	nla = nla_start(m, CTRL_ATTR_OP_POLICY);
+	n = nla_nest_start(nla, 3);
+	v = 0;
+	nla_add_attr(n, CTRL_ATTR_POLICY_DO, &v, sizeof v);
+	nla_nest_end(nla, n);
+	nla_end(m, nla);
+	ck_assert(!nl_gen_policy_collect(m, &ps));
+	ck_assert(!ps.do_idx && ps.dump_idx == (__u32)-1);
+
+	make_policy(0, 1, NL_ATTR_TYPE_U8, 10);
+	ck_assert(!nl_gen_policy_collect(m, &ps));
+	make_policy(0, 2, NL_ATTR_TYPE_NESTED, 1);
+	ck_assert(!nl_gen_policy_collect(m, &ps));
+	make_policy(1, 1, NL_ATTR_TYPE_NUL_STRING, 3);
+	ck_assert(!nl_gen_policy_collect(m, &ps));
+	ck_assert(nl_gen_policy(&ps, 0, 1)->type == NL_ATTR_TYPE_U8);
+	ck_assert(nl_gen_policy(&ps, 0, 1)->umax == 10);
+	ck_assert(nl_gen_policy(&ps, 0, 2)->nested == 1);
+	ck_assert(nl_gen_policy(&ps, 1, 1)->max_len == 3);
+	ck_assert(nl_gen_policy_maxtype(&ps, 0) == 2);
+	ck_assert(nl_gen_policy_maxtype(&ps, 1) == 1);
+
+	/* Policies that don't fit */
+	make_policy(0, 4, NL_ATTR_TYPE_U8, 0);
+	errno = 0;
+	ck_assert(nl_gen_policy_collect(m, &ps));
+	ck_assert(errno == E2BIG);
+
+	/* Validation */
+	nl_gen_request(m, 0, fam, 3, 1);
+	nl_add_attr(m, 1, &v8, sizeof v8);
+	nla = nla_start(m, 2);
+	nla_add_attr(nla, 1, "abc", 4);
+	nla_end(m, nla);
+	ck_assert(!nl_gen_validate(&ps, ps.do_idx, m, NULL));
+
+	v8 = 11;
+	nl_gen_request(m, 0, fam, 3, 1);
+	nl_add_attr(m, 1, &v8, sizeof v8);
+	errno = 0;
+	ck_assert(nl_gen_validate(&ps, ps.do_idx, m, &bad) == -1);
+	ck_assert(errno == ERANGE);
+	ck_assert(bad == nl_gen_get_attr(m, 1));
+
+	nl_gen_request(m, 0, fam, 3, 1);
+	nla = nla_start(m, 2);
+	n = BYTE_OFF(nla, NLA_HDRLEN);
+	nla_add_attr(nla, 1, "abcd", 5);
+	nla_end(m, nla);
+	errno = 0;
+	ck_assert(nl_gen_validate(&ps, ps.do_idx, m, &bad) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(bad == n);
+}
+END_TEST
+#endif /* Linux >= 5.10.0 */
+
 Suite *gen_suite(void)
 {
 	Suite *s;
@@ -52,6 +267,21 @@ Suite *gen_suite(void)
 	tcase_add_test(t, gen_find_family);
 	tcase_set_timeout(t, 1);
 	suite_add_tcase(s, t);
+
+	t = tcase_create("family cache");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, gen_cache);
+	tcase_add_test(t, gen_cache_full);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+	t = tcase_create("policies");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, gen_policy);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+#endif
 	return s;
 }
 
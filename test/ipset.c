@@ -0,0 +1,141 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "ipset.h"
+#include "../src/nl_ipset.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+START_TEST(ipset_create)
+{
+	struct nlattr *nla, *data;
+	struct nl_ipset_opts o;
+
+	memset(&o, 0, sizeof o);
+	o.maxelem = 1048576;
+	nl_ipset_create(m, "block", "hash:ip", 4, NFPROTO_IPV4, &o);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_IPSET << 8 | IPSET_CMD_CREATE));
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(!!(nla = nl_nf_get_attr(m, IPSET_ATTR_PROTOCOL)));
+	ck_assert(*(__u8 *)NLA_DATA(nla) == IPSET_PROTOCOL);
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m, IPSET_ATTR_SETNAME)),
+	                  "block"));
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m, IPSET_ATTR_TYPENAME)),
+	                  "hash:ip"));
+	ck_assert(!!(data = nl_nf_get_attr(m, IPSET_ATTR_DATA)));
+	ck_assert(data->nla_type & NLA_F_NESTED);
+	ck_assert(!nla_get_attr(data, IPSET_ATTR_HASHSIZE));
+	ck_assert(!!(nla = nla_get_attr(data, IPSET_ATTR_MAXELEM)));
+	ck_assert(nla->nla_type & NLA_F_NET_BYTEORDER);
+	ck_assert(nla_u32_be(nla) == 1048576);
+}
+END_TEST
+
+START_TEST(ipset_swap)
+{
+	nl_ipset_swap(m, "block", "block-new");
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_IPSET << 8 | IPSET_CMD_SWAP));
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m, IPSET_ATTR_SETNAME)),
+	                  "block"));
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m, IPSET_ATTR_SETNAME2)),
+	                  "block-new"));
+
+	nl_ipset_list(m, NULL);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(!nl_nf_get_attr(m, IPSET_ATTR_SETNAME));
+}
+END_TEST
+
+START_TEST(ipset_entry)
+{
+	struct nl_ipset_entry e, d;
+
+	memset(&e, 0, sizeof e);
+	e.family  = NFPROTO_IPV6;
+	e.addr[0] = htonl(0x20010db8);
+	e.addr[3] = htonl(1);
+	e.cidr    = 64;
+	e.timeout = 600;
+
+	nl_ipset_entry(m, IPSET_CMD_TEST, "block6", &e, 0);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_IPSET << 8 | IPSET_CMD_TEST));
+	ck_assert(!(m->nlmsg_flags & NLM_F_EXCL));
+	ck_assert(!nl_ipset_parse_entry(nl_nf_get_attr(m, IPSET_ATTR_DATA),
+	                                &d));
+	ck_assert(!memcmp(&e, &d, sizeof e));
+
+	errno = 0;
+	ck_assert(nl_ipset_parse_entry(nl_nf_get_attr(m, IPSET_ATTR_SETNAME),
+	                               &d) == -1);
+	ck_assert(errno == EINVAL);
+
+	/* Adding an entry that's already there fails, unless asked not to */
+	nl_ipset_entry(m, IPSET_CMD_ADD, "block6", &e, 0);
+	ck_assert(m->nlmsg_flags & NLM_F_EXCL);
+	nl_ipset_entry(m, IPSET_CMD_DEL, "block6", &e, IPSET_FLAG_EXIST);
+	ck_assert(!(m->nlmsg_flags & NLM_F_EXCL));
+}
+END_TEST
+
+START_TEST(ipset_adt)
+{
+	int n = 0;
+	struct nlattr *adt, *data;
+	struct nl_ipset_entry e, d;
+
+	memset(&e, 0, sizeof e);
+	e.family = NFPROTO_IPV4;
+	ck_assert(!!(adt = nl_ipset_adt_begin(m, IPSET_CMD_ADD, NFPROTO_IPV4,
+	                                      "block", IPSET_FLAG_EXIST)));
+	do e.addr[0] = htonl(0x0a000000 | (__u32)n++);
+	while (!nl_ipset_adt_add(m, adt, &e, NLMSG_GOODSIZE));
+	ck_assert(errno == E2BIG);
+	nl_ipset_adt_end(m, adt);
+	ck_assert(m->nlmsg_len <= NLMSG_GOODSIZE);
+	ck_assert(!(m->nlmsg_flags & NLM_F_EXCL));
+	ck_assert(!nl_nf_get_attr(m, IPSET_ATTR_FLAGS));
+
+	n = 0;
+	nla_each(data, adt) {
+		ck_assert((data->nla_type & NLA_TYPE_MASK) == IPSET_ATTR_DATA);
+		ck_assert(!nl_ipset_parse_entry(data, &d));
+		ck_assert(d.family == NFPROTO_IPV4 && !d.cidr && !d.timeout);
+		ck_assert(d.addr[0] == htonl(0x0a000000 | (__u32)n));
+		++n;
+	}
+
+	ck_assert(n > 400);
+	nl_ipset_adt_begin(m, IPSET_CMD_DEL, NFPROTO_IPV4, "block", 0);
+	ck_assert(m->nlmsg_flags & NLM_F_EXCL);
+
+	errno = 0;
+	ck_assert(nl_ipset_adt_add(m, NULL, &e, NLMSG_GOODSIZE) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+Suite *ipset_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter / ipset Helpers");
+	t = tcase_create("sets");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, ipset_create);
+	tcase_add_test(t, ipset_swap);
+	tcase_add_test(t, ipset_entry);
+	tcase_add_test(t, ipset_adt);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
@@ -0,0 +1,7 @@
+#ifndef IPSET_SUITE_H
+#define IPSET_SUITE_H
+#include <check.h>
+
+Suite *ipset_suite(void);
+
+#endif /* IPSET_SUITE_H */
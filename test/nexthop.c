@@ -0,0 +1,154 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "nexthop.h"
+#include "../src/nl_nexthop.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+START_TEST(nexthop_requests)
+{
+	struct nhmsg *nhm;
+	struct nlattr *nla;
+
+	nl_nh_get(m, 7);
+	nhm = NLMSG_DATA(m);
+	ck_assert(m->nlmsg_type == RTM_GETNEXTHOP);
+	ck_assert(!(m->nlmsg_flags & NLM_F_DUMP));
+	ck_assert(nhm->nh_family == AF_UNSPEC);
+	ck_assert((nla = nl_nh_get_attr(m, NHA_ID)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 7);
+
+	nl_nh_del(m, 7);
+	ck_assert(m->nlmsg_type == RTM_DELNEXTHOP);
+	ck_assert(nl_nh_get_attr(m, NHA_ID));
+
+	nl_nh_dump(m, AF_INET, 0, 0, 0);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(nhm->nh_family == AF_INET);
+	ck_assert(m->nlmsg_len == NLMSG_LENGTH(sizeof *nhm));
+
+	nl_nh_dump(m, AF_UNSPEC, 2, 3, 1);
+	ck_assert((nla = nl_nh_get_attr(m, NHA_OIF)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 2);
+	ck_assert((nla = nl_nh_get_attr(m, NHA_MASTER)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 3);
+	ck_assert((nla = nl_nh_get_attr(m, NHA_GROUPS)));
+	ck_assert(nla->nla_len == NLA_HDRLEN);
+}
+END_TEST
+
+START_TEST(nexthop_parse)
+{
+	struct nl_nh nh, p;
+
+	memset(&nh, 0, sizeof nh);
+	nh.id       = 1;
+	nh.family   = AF_INET;
+	nh.protocol = RTPROT_BGP;
+	nh.ifindex  = 2;
+	nh.flags    = RTNH_F_ONLINK;
+	nh.gw[0]    = inet_addr("192.0.2.1");
+
+	nl_nh_new(m, &nh);
+	ck_assert(m->nlmsg_type == RTM_NEWNEXTHOP);
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(m->nlmsg_flags & NLM_F_REPLACE);
+	ck_assert(!nl_nh_parse(m, &p));
+	ck_assert(p.id == 1 && p.family == AF_INET);
+	ck_assert(p.protocol == RTPROT_BGP && p.flags == RTNH_F_ONLINK);
+	ck_assert(p.ifindex == 2 && p.gw[0] == nh.gw[0]);
+	ck_assert(!p.blackhole && !p.ngrp && !p.grp);
+
+	/* Blackholes have no interface or gateway */
+	nh.blackhole = 1;
+	nl_nh_new(m, &nh);
+	ck_assert(!nl_nh_parse(m, &p));
+	ck_assert(p.blackhole && !p.ifindex && !p.gw[0]);
+
+	/* Nexthops with an ID assigned by the kernel can't be replaced */
+	nh.id = 0;
+	nl_nh_new(m, &nh);
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(!(m->nlmsg_flags & NLM_F_REPLACE));
+	ck_assert(!nl_nh_get_attr(m, NHA_ID));
+
+	errno = 0;
+	nl_nh_get(m, 1);
+	ck_assert(nl_nh_parse(m, &p) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(nexthop_group)
+{
+	struct nl_nh nh, p;
+	struct nlattr *nla;
+	struct nexthop_grp g[2];
+
+	memset(g, 0, sizeof g);
+	memset(&nh, 0, sizeof nh);
+	g[0].id     = 1;
+	g[1].id     = 2;
+	g[1].weight = 2;
+	nh.id       = 100;
+	nh.family   = AF_INET;
+	nh.ifindex  = 2;
+	nh.grp      = g;
+	nh.ngrp     = 2;
+
+	/* Groups have no family or interface */
+	nl_nh_new(m, &nh);
+	ck_assert(!nl_nh_get_attr(m, NHA_OIF));
+	ck_assert(!nl_nh_get_attr(m, NHA_GROUP_TYPE));
+	ck_assert(!nl_nh_parse(m, &p));
+	ck_assert(p.id == 100 && p.family == AF_UNSPEC && !p.ifindex);
+	ck_assert(p.ngrp == 2 && p.grp);
+	ck_assert(p.grp[0].id == 1 && !p.grp[0].weight);
+	ck_assert(p.grp[1].id == 2 && p.grp[1].weight == 2);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0)
+	nh.grp_type   = NEXTHOP_GRP_TYPE_RES;
+	nh.buckets    = 64;
+	nh.idle_timer = 1000;
+	nl_nh_new(m, &nh);
+
+	/* u16 attributes must have their exact length */
+	ck_assert((nla = nl_nh_get_attr(m, NHA_GROUP_TYPE)));
+	ck_assert(nla->nla_len == NLA_HDRLEN + sizeof(__u16));
+	ck_assert((nla = nl_nh_get_attr(m, NHA_RES_GROUP)));
+	ck_assert((nla = nla_get_attr(nla, NHA_RES_GROUP_BUCKETS)));
+	ck_assert(nla->nla_len == NLA_HDRLEN + sizeof(__u16));
+
+	ck_assert(!nl_nh_parse(m, &p));
+	ck_assert(p.grp_type == NEXTHOP_GRP_TYPE_RES && p.ngrp == 2);
+	ck_assert(p.buckets == 64 && p.idle_timer == 1000);
+	ck_assert(!p.unbalanced_timer);
+#endif
+}
+END_TEST
+
+Suite *nexthop_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netlink Nexthop Helpers");
+	t = tcase_create("nexthops");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nexthop_requests);
+	tcase_add_test(t, nexthop_parse);
+	tcase_add_test(t, nexthop_group);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
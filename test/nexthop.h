@@ -0,0 +1,7 @@
+#ifndef NEXTHOP_SUITE_H
+#define NEXTHOP_SUITE_H
+#include <check.h>
+
+Suite *nexthop_suite(void);
+
+#endif /* NEXTHOP_SUITE_H */
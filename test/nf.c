@@ -0,0 +1,145 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "nf.h"
+#include "../src/nl_nf.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+START_TEST(nf_request)
+{
+	struct nfgenmsg *nf = NLMSG_DATA(m);
+
+	nl_nf_request(m, 0, NFNL_SUBSYS_QUEUE, 2, AF_INET6, 0x1234);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_QUEUE << 8 | 2));
+	ck_assert(m->nlmsg_len == NLMSG_LENGTH(sizeof *nf));
+	ck_assert(nf->nfgen_family == AF_INET6);
+	ck_assert(nf->version == NFNETLINK_V0);
+	ck_assert(nf->res_id == htons(0x1234));
+}
+END_TEST
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0)
+START_TEST(nf_batch_works)
+{
+	int i;
+	struct nl_batch b;
+	struct nlmsghdr *n;
+	struct nfgenmsg *nf;
+
+	nl_batch_init(&b, buf, sizeof buf, 10);
+	errno = 0;
+	ck_assert(nl_nf_batch_end(&b) == -1 && errno == EINVAL);
+	ck_assert(!nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES));
+	errno = 0;
+	ck_assert(nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES) == -1);
+	ck_assert(errno == EINVAL);
+
+	n  = b.buf;
+	nf = NLMSG_DATA(n);
+	ck_assert(n->nlmsg_type == NFNL_MSG_BATCH_BEGIN);
+	ck_assert(!(n->nlmsg_flags & NLM_F_ACK) && n->nlmsg_seq == 10);
+	ck_assert(nf->res_id == htons(NFNL_SUBSYS_NFTABLES));
+
+	for (i = 0; i < 2; i++) {
+		ck_assert(!!(n = nl_nf_batch_next(&b, NLMSG_GOODSIZE >> 4)));
+		nl_nf_request(n, 0, NFNL_SUBSYS_NFTABLES, 0, AF_INET, 0);
+		ck_assert(nl_batch_add(&b) == i + 1);
+	}
+
+	ck_assert(!nl_nf_batch_end(&b));
+	ck_assert(b.count == 4);
+	n = BYTE_OFF(b.buf, b.len - NLMSG_SPACE(sizeof *nf));
+	nf = NLMSG_DATA(n);
+	ck_assert(n->nlmsg_type == NFNL_MSG_BATCH_END);
+	ck_assert(!(n->nlmsg_flags & NLM_F_ACK) && n->nlmsg_seq == 13);
+	ck_assert(nf->res_id == htons(NFNL_SUBSYS_NFTABLES));
+}
+END_TEST
+
+START_TEST(nf_batch_no_room)
+{
+	struct nl_batch b;
+	struct nlmsghdr *n;
+
+	/* Room for BATCH_BEGIN, and one message, but not BATCH_END */
+	nl_batch_init(&b, buf, 2 * NLMSG_SPACE(sizeof(struct nfgenmsg)), 1);
+	ck_assert(!nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES));
+	ck_assert(!nl_nf_batch_next(&b, NLMSG_SPACE(sizeof(struct nfgenmsg))));
+	ck_assert(!!(n = nl_batch_next(&b, NLMSG_HDRLEN)));
+	nl_nf_request(n, 0, NFNL_SUBSYS_NFTABLES, 0, AF_INET, 0);
+	ck_assert(nl_batch_add(&b) == 1);
+	errno = 0;
+	ck_assert(nl_nf_batch_end(&b) == -1 && errno == E2BIG);
+}
+END_TEST
+
+START_TEST(nf_batch_ack_works)
+{
+	int err = 1;
+	struct nl_batch b;
+	struct nlmsghdr *n;
+	struct nlmsgerr *e;
+
+	nl_batch_init(&b, buf, NLMSG_GOODSIZE >> 1, 20);
+	ck_assert(!nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES));
+	n = nl_nf_batch_next(&b, NLMSG_GOODSIZE >> 4);
+	nl_nf_request(n, 0, NFNL_SUBSYS_NFTABLES, 0, AF_INET, 0);
+	nl_batch_add(&b);
+	ck_assert(!nl_nf_batch_end(&b));
+
+	n = BYTE_OFF(buf, NLMSG_GOODSIZE >> 1);
+	nl_msg(n, NLMSG_ERROR, 0, 0, sizeof *e);
+	e = NLMSG_DATA(n);
+	e->error = -EEXIST;
+	e->msg.nlmsg_seq = 21;
+	ck_assert(!nl_nf_batch_ack(&b, n, &err) && err == -EEXIST);
+	e->msg.nlmsg_seq = 23;
+	ck_assert(nl_nf_batch_ack(&b, n, &err) == -1);
+
+	/* Errors for the whole batch are reported against BEGIN / END */
+	e->error = -EOPNOTSUPP;
+	e->msg.nlmsg_seq  = 20;
+	e->msg.nlmsg_type = NFNL_MSG_BATCH_BEGIN;
+	ck_assert(nl_nf_batch_ack(&b, n, &err) == NL_NF_BATCH_ALL);
+	ck_assert(err == -EOPNOTSUPP);
+	e->error = -ERESTART;
+	e->msg.nlmsg_seq  = 22;
+	e->msg.nlmsg_type = NFNL_MSG_BATCH_END;
+	ck_assert(nl_nf_batch_ack(&b, n, &err) == NL_NF_BATCH_ALL);
+	ck_assert(err == -ERESTART);
+}
+END_TEST
+#endif /* Linux >= 3.13.0 */
+
+Suite *nf_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter Helpers");
+	t = tcase_create("requests");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nf_request);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0)
+	t = tcase_create("batches");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nf_batch_works);
+	tcase_add_test(t, nf_batch_no_room);
+	tcase_add_test(t, nf_batch_ack_works);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+#endif
+	return s;
+}
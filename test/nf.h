@@ -0,0 +1,7 @@
+#ifndef NF_SUITE_H
+#define NF_SUITE_H
+#include <check.h>
+
+Suite *nf_suite(void);
+
+#endif /* NF_SUITE_H */
@@ -0,0 +1,108 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "nfacct.h"
+#include "../src/nl_nfacct.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+/**
+ * Make an accounting object message, as sent by the kernel
+ */
+static void make_obj(const char *name, __u32 pkts, __u32 bytes)
+{
+	__u32 v[2];
+
+	nl_nfacct_request(m, 0, NFNL_MSG_ACCT_NEW);
+	nl_add_attr(m, NFACCT_NAME, name, strlen(name) + 1);
+	v[0] = 0, v[1] = htonl(pkts);
+	nl_add_attr(m, NFACCT_PKTS, v, sizeof v);
+	v[0] = htonl(1), v[1] = htonl(bytes);
+	nl_add_attr(m, NFACCT_BYTES, v, sizeof v);
+}
+
+START_TEST(nfacct_requests)
+{
+	nl_nfacct_create(m, "cust1");
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_ACCT << 8 |
+	                            NFNL_MSG_ACCT_NEW));
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m, NFACCT_NAME)), "cust1"));
+
+	nl_nfacct_get(m, "cust1", 1);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_ACCT << 8 |
+	                            NFNL_MSG_ACCT_GET_CTRZERO));
+	ck_assert(!(m->nlmsg_flags & NLM_F_DUMP));
+
+	nl_nfacct_dump(m, 0);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_ACCT << 8 |
+	                            NFNL_MSG_ACCT_GET));
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(!nl_nf_get_attr(m, NFACCT_NAME));
+}
+END_TEST
+
+START_TEST(nfacct_parse)
+{
+	struct nl_nfacct a;
+
+	make_obj("cust1", 10, 1500);
+	ck_assert(!nl_nfacct_parse(m, &a));
+	ck_assert(!strcmp(a.name, "cust1"));
+	ck_assert(a.pkts == 10);
+	ck_assert(a.bytes == ((__u64)1 << 32 | 1500));
+
+	errno = 0;
+	nl_nfacct_dump(m, 0);
+	ck_assert(nl_nfacct_parse(m, &a) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(nfacct_collect)
+{
+	struct nl_nfacct a[2];
+	struct nl_nfacct_list l;
+
+	l.a = a, l.n = 2, l.count = 0;
+	make_obj("cust1", 1, 1);
+	ck_assert(!nl_nfacct_collect(m, &l));
+	ck_assert(!nl_nfacct_collect(NULL, &l));
+	ck_assert(!l.count);
+
+	make_obj("cust2", 2, 2);
+	nl_nfacct_collect(m, &l);
+	make_obj("cust3", 3, 3);
+	nl_nfacct_collect(m, &l);
+	make_obj("cust4", 4, 4);
+	nl_nfacct_collect(m, &l);
+	ck_assert(l.count == 3);
+	ck_assert(!strcmp(a[0].name, "cust2") && a[0].pkts == 2);
+	ck_assert(!strcmp(a[1].name, "cust3") && a[1].pkts == 3);
+}
+END_TEST
+
+Suite *nfacct_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter / Accounting Helpers");
+	t = tcase_create("objects");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfacct_requests);
+	tcase_add_test(t, nfacct_parse);
+	tcase_add_test(t, nfacct_collect);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
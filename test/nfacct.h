@@ -0,0 +1,7 @@
+#ifndef NFACCT_SUITE_H
+#define NFACCT_SUITE_H
+#include <check.h>
+
+Suite *nfacct_suite(void);
+
+#endif /* NFACCT_SUITE_H */
@@ -0,0 +1,643 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <linux/netfilter/nf_conntrack_common.h>
+#include <check.h>
+
+#include "nfct.h"
+#include "../src/nl_nfct.c"
+#include "../src/nl_nfct_table.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+static __u32 nla_get_u32(struct nlattr *nla)
+{
+	return nla ? *(__u32 *)NLA_DATA(nla) : 0xdeadbeef;
+}
+
+static __u16 nla_get_u16(struct nlattr *nla)
+{
+	return nla ? *(__u16 *)NLA_DATA(nla) : 0xdead;
+}
+
+static __u8 nla_get_u8(struct nlattr *nla)
+{
+	return nla ? *(__u8 *)NLA_DATA(nla) : 0xde;
+}
+
+START_TEST(nfct_tuple_v4)
+{
+	struct nl_nfct_tuple t;
+	struct nlattr *tuple, *ip, *proto;
+
+	nl_nfct_tuple_v4(&t, IPPROTO_TCP, htonl(0x0a000001),
+	                 htonl(0x0a000002), 1234, 80);
+	nl_nfct_get(m, NFPROTO_IPV4);
+	nl_nfct_add_tuple(m, CTA_TUPLE_ORIG, &t);
+	ck_assert(!!(tuple = nl_nf_get_attr(m, CTA_TUPLE_ORIG)));
+	ck_assert(tuple && tuple->nla_type & NLA_F_NESTED);
+	ck_assert(!!(ip = nla_get_attr(tuple, CTA_TUPLE_IP)));
+	ck_assert(nla_get_u32(nla_get_attr(ip, CTA_IP_V4_SRC)) ==
+	          htonl(0x0a000001));
+	ck_assert(nla_get_u32(nla_get_attr(ip, CTA_IP_V4_DST)) ==
+	          htonl(0x0a000002));
+	ck_assert(!nla_get_attr(ip, CTA_IP_V6_SRC));
+	ck_assert(!!(proto = nla_get_attr(tuple, CTA_TUPLE_PROTO)));
+	ck_assert(nla_get_u8(nla_get_attr(proto, CTA_PROTO_NUM)) ==
+	          IPPROTO_TCP);
+	ck_assert(nla_get_u16(nla_get_attr(proto, CTA_PROTO_SRC_PORT)) ==
+	          htons(1234));
+	ck_assert(nla_get_u16(nla_get_attr(proto, CTA_PROTO_DST_PORT)) ==
+	          htons(80));
+	ck_assert(!nla_get_attr(proto, CTA_PROTO_ICMP_ID));
+	ck_assert(!nla_get_attr(tuple, CTA_TUPLE_ZONE));
+	ck_assert(m->nlmsg_len == NLMSG_HDRLEN + sizeof(struct nfgenmsg) +
+	          tuple->nla_len);
+}
+END_TEST
+
+START_TEST(nfct_tuple_v6_icmp)
+{
+	struct nl_nfct_tuple t;
+	struct nlattr *tuple, *ip, *proto, *nla;
+	__u8 src[16], dst[16];
+
+	memset(src, 0x11, sizeof src);
+	memset(dst, 0x22, sizeof dst);
+	nl_nfct_tuple_v6(&t, IPPROTO_ICMPV6, src, dst, 42, 0);
+	t.icmp_type = 128;
+	t.icmp_code = 0;
+	nl_nfct_get(m, NFPROTO_IPV6);
+	nl_nfct_add_tuple(m, CTA_TUPLE_REPLY, &t);
+	ck_assert(!!(tuple = nl_nf_get_attr(m, CTA_TUPLE_REPLY)));
+	ck_assert(!!(ip = nla_get_attr(tuple, CTA_TUPLE_IP)));
+	ck_assert(!!(nla = nla_get_attr(ip, CTA_IP_V6_SRC)));
+	ck_assert(nla && nla->nla_len == NLA_HDRLEN + 16);
+	ck_assert(nla && !memcmp(NLA_DATA(nla), src, 16));
+	ck_assert(!!(nla = nla_get_attr(ip, CTA_IP_V6_DST)));
+	ck_assert(nla && !memcmp(NLA_DATA(nla), dst, 16));
+	ck_assert(!!(proto = nla_get_attr(tuple, CTA_TUPLE_PROTO)));
+	ck_assert(nla_get_u8(nla_get_attr(proto, CTA_PROTO_NUM)) ==
+	          IPPROTO_ICMPV6);
+	ck_assert(nla_get_u16(nla_get_attr(proto, CTA_PROTO_ICMPV6_ID)) ==
+	          htons(42));
+	ck_assert(nla_get_u8(nla_get_attr(proto, CTA_PROTO_ICMPV6_TYPE)) ==
+	          128);
+	ck_assert(!!nla_get_attr(proto, CTA_PROTO_ICMPV6_CODE));
+	ck_assert(!nla_get_attr(proto, CTA_PROTO_SRC_PORT));
+}
+END_TEST
+
+START_TEST(nfct_attrs)
+{
+	__u32 labels[4] = { 1, 2, 3, 4 }, mask[4] = { 5, 6, 7, 8 };
+	struct nlattr *nla;
+
+	nl_nfct_update(m, NFPROTO_IPV4);
+	nl_nfct_mark(m, 0x1234, 0);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK)) == htonl(0x1234));
+	ck_assert(!nl_nf_get_attr(m, CTA_MARK_MASK));
+	nl_nfct_update(m, NFPROTO_IPV4);
+	nl_nfct_mark(m, 0x1234, 0xff00);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK_MASK)) ==
+	          htonl(0xff00));
+	nl_nfct_zone(m, 7);
+	ck_assert(nla_get_u16(nl_nf_get_attr(m, CTA_ZONE)) == htons(7));
+	nl_nfct_status(m, IPS_ASSURED);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_STATUS)) ==
+	          htonl(IPS_ASSURED));
+	nl_nfct_timeout(m, 300);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_TIMEOUT)) == htonl(300));
+	nl_nfct_labels(m, labels, mask, 3);
+	ck_assert(!nl_nf_get_attr(m, CTA_LABELS));
+	nl_nfct_labels(m, labels, mask, sizeof labels);
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_LABELS)));
+	ck_assert(nla && !memcmp(NLA_DATA(nla), labels, sizeof labels));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_LABELS_MASK)));
+	ck_assert(nla && !memcmp(NLA_DATA(nla), mask, sizeof mask));
+}
+END_TEST
+
+START_TEST(nfct_flush_mark)
+{
+	nl_nfct_flush_mark(m, 0x100, 0);
+	ck_assert((m->nlmsg_type & 0xff) == IPCTNL_MSG_CT_DELETE);
+	ck_assert(!(m->nlmsg_flags & NLM_F_DUMP));
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK)) == htonl(0x100));
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK_MASK)) == 0xffffffff);
+	ck_assert(!nl_nf_get_attr(m, CTA_TUPLE_ORIG));
+}
+END_TEST
+
+START_TEST(nfct_delete_bulk_invalid)
+{
+	struct nl_batch b;
+	struct nl_nfct_tuple t;
+	__u32 small[16];
+
+	errno = 0;
+	ck_assert(nl_nfct_delete_bulk(-1, NULL, &t, 1, 0, NULL) == -1);
+	ck_assert(errno == EINVAL);
+	nl_batch_init(&b, buf, sizeof buf, 0);
+	ck_assert(nl_nfct_delete_bulk(-1, &b, NULL, 1, 0, NULL) == -1);
+	ck_assert(!nl_nfct_delete_bulk(-1, &b, NULL, 0, 0, NULL));
+
+	/* The buffer must hold at least one request */
+	errno = 0;
+	nl_nfct_tuple_v4(&t, IPPROTO_TCP, 1, 2, 3, 4);
+	nl_batch_init(&b, small, sizeof small, 0);
+	ck_assert(nl_nfct_delete_bulk(-1, &b, &t, 1, 0, NULL) == -1);
+	ck_assert(errno == E2BIG);
+}
+END_TEST
+
+START_TEST(nfct_dump_filter_mark)
+{
+	struct nl_nfct_filter f;
+
+	memset(&f, 0, sizeof f);
+	nl_nfct_dump_filter(m, NFPROTO_IPV4, 0, NULL);
+	ck_assert(!m->nlmsg_len);
+	nl_nfct_dump_filter(m, NFPROTO_IPV4, 0, &f);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(m->nlmsg_len == NLMSG_HDRLEN + sizeof(struct nfgenmsg));
+	f.mark      = 0x10;
+	f.mark_mask = 0xf0;
+	nl_nfct_dump_filter(m, NFPROTO_IPV4, 1, &f);
+	ck_assert((m->nlmsg_type & 0xff) == IPCTNL_MSG_CT_GET_CTRZERO);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK)) == htonl(0x10));
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_MARK_MASK)) == htonl(0xf0));
+	ck_assert(!nl_nf_get_attr(m, CTA_FILTER));
+	ck_assert(!nl_nf_get_attr(m, CTA_TUPLE_ORIG));
+}
+END_TEST
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+START_TEST(nfct_dump_filter_tuple)
+{
+	struct nl_nfct_filter f;
+	struct nlattr *tuple, *proto, *nla;
+
+	memset(&f, 0, sizeof f);
+	nl_nfct_tuple_v4(&f.tuple, IPPROTO_UDP, 0, htonl(0x7f000001), 0, 53);
+	f.flags = NL_NFCT_F_IP_DST | NL_NFCT_F_DPORT | NL_NFCT_F_ZONE;
+	f.zone  = 3;
+	nl_nfct_dump_filter(m, NFPROTO_IPV4, 0, &f);
+	ck_assert(!!(tuple = nl_nf_get_attr(m, CTA_TUPLE_ORIG)));
+	ck_assert(!!(nla = nla_get_attr(tuple, CTA_TUPLE_IP)));
+	ck_assert(!nla_get_attr(nla, CTA_IP_V4_SRC));
+	ck_assert(nla_get_u32(nla_get_attr(nla, CTA_IP_V4_DST)) ==
+	          htonl(0x7f000001));
+	ck_assert(!!(proto = nla_get_attr(tuple, CTA_TUPLE_PROTO)));
+	ck_assert(nla_get_u8(nla_get_attr(proto, CTA_PROTO_NUM)) ==
+	          IPPROTO_UDP);
+	ck_assert(!nla_get_attr(proto, CTA_PROTO_SRC_PORT));
+	ck_assert(nla_get_u16(nla_get_attr(proto, CTA_PROTO_DST_PORT)) ==
+	          htons(53));
+	ck_assert(nla_get_u16(nla_get_attr(tuple, CTA_TUPLE_ZONE)) == htons(3));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_FILTER)));
+	ck_assert(nla_get_u32(nla_get_attr(nla, CTA_FILTER_ORIG_FLAGS)) ==
+	          (NL_NFCT_F_IP_DST | NL_NFCT_F_DPORT | NL_NFCT_F_ZONE |
+	           NL_NFCT_F_PROTO_NUM));
+	ck_assert(!nla_get_u32(nla_get_attr(nla, CTA_FILTER_REPLY_FLAGS)));
+}
+END_TEST
+
+START_TEST(nfct_dump_filter_icmpv6)
+{
+	struct nl_nfct_filter f;
+	struct nlattr *nla;
+
+	memset(&f, 0, sizeof f);
+	f.tuple.l4proto   = IPPROTO_ICMPV6;
+	f.tuple.icmp_type = 129;
+	f.flags = NL_NFCT_F_ICMP_TYPE;
+	nl_nfct_dump_filter(m, NFPROTO_IPV6, 0, &f);
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_FILTER)));
+	ck_assert(nla_get_u32(nla_get_attr(nla, CTA_FILTER_ORIG_FLAGS)) ==
+	          (NL_NFCT_F_PROTO_NUM | NL_NFCT_F_ICMP_TYPE << 3));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_TUPLE_ORIG)));
+	ck_assert(!nla_get_attr(nla, CTA_TUPLE_IP));
+	ck_assert(!!(nla = nla_get_attr(nla, CTA_TUPLE_PROTO)));
+	ck_assert(nla_get_u8(nla_get_attr(nla, CTA_PROTO_ICMPV6_TYPE)) == 129);
+	ck_assert(!nla_get_attr(nla, CTA_PROTO_ICMPV6_ID));
+}
+END_TEST
+#endif /* Linux >= 5.8.0 */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+START_TEST(nfct_dump_filter_status)
+{
+	struct nl_nfct_filter f;
+
+	memset(&f, 0, sizeof f);
+	f.status      = IPS_SEEN_REPLY;
+	f.status_mask = IPS_SEEN_REPLY | IPS_ASSURED;
+	nl_nfct_dump_filter(m, NFPROTO_IPV4, 0, &f);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_STATUS)) ==
+	          htonl(IPS_SEEN_REPLY));
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, CTA_STATUS_MASK)) ==
+	          htonl(IPS_SEEN_REPLY | IPS_ASSURED));
+	ck_assert(!nl_nf_get_attr(m, CTA_FILTER));
+}
+END_TEST
+#endif /* Linux >= 5.19.0 */
+
+START_TEST(nfct_parse)
+{
+	__u32 v;
+	__u8 pkts[8]  = { 0, 0, 0, 0, 0, 0, 0, 0x10 };
+	__u8 bytes[8] = { 0, 0, 0, 1, 0, 0, 0, 0x02 };
+	struct nlattr *nla;
+	struct nl_nfct_flow f;
+	struct nl_nfct_tuple t;
+
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_DELETE, NFPROTO_IPV4);
+	nl_nfct_tuple_v4(&t, IPPROTO_TCP, htonl(0x0a000001),
+	                 htonl(0x0a000002), 1234, 80);
+	nl_nfct_add_tuple(m, CTA_TUPLE_ORIG, &t);
+	nl_nfct_tuple_v4(&t, IPPROTO_TCP, htonl(0x0a000002),
+	                 htonl(0x0a000001), 80, 1234);
+	nl_nfct_add_tuple(m, CTA_TUPLE_REPLY, &t);
+	nl_nfct_mark(m, 0xabcd, 0);
+	nl_nfct_zone(m, 9);
+	nl_nfct_status(m, IPS_ASSURED);
+	v = htonl(0x1337);
+	nl_add_attr(m, CTA_ID, &v, sizeof v);
+
+	nla = nla_start(m, CTA_COUNTERS_REPLY);
+	nla_add_attr(nla, CTA_COUNTERS_PACKETS, pkts,  sizeof pkts);
+	nla_add_attr(nla, CTA_COUNTERS_BYTES,   bytes, sizeof bytes);
+	nla_end(m, nla);
+
+	memset(&f, 0xff, sizeof f);
+	ck_assert(!nl_nfct_parse(m, &f));
+	ck_assert(f.type == IPCTNL_MSG_CT_DELETE);
+	ck_assert(f.family == NFPROTO_IPV4);
+	ck_assert(f.orig.l3proto == NFPROTO_IPV4);
+	ck_assert(f.orig.l4proto == IPPROTO_TCP);
+	ck_assert(f.orig.src[0] == htonl(0x0a000001));
+	ck_assert(f.orig.dst[0] == htonl(0x0a000002));
+	ck_assert(!f.orig.src[1] && !f.orig.dst[3]);
+	ck_assert(f.orig.sport == 1234 && f.orig.dport == 80);
+	ck_assert(f.reply.src[0] == htonl(0x0a000002));
+	ck_assert(f.reply.sport == 80 && f.reply.dport == 1234);
+	ck_assert(f.mark == 0xabcd);
+	ck_assert(f.zone == 9);
+	ck_assert(f.status == IPS_ASSURED);
+	ck_assert(f.id == 0x1337);
+	ck_assert(!f.orig_packets && !f.orig_bytes);
+	ck_assert(f.reply_packets == 0x10);
+	ck_assert(f.reply_bytes == ((__u64)1 << 32 | 2));
+	ck_assert(!f.start && !f.stop && !f.timeout);
+}
+END_TEST
+
+START_TEST(nfct_parse_nla)
+{
+	struct nlattr *ct;
+	struct nl_nfct_flow f;
+	struct nl_nfct_tuple t;
+
+	/* Without an original tuple, this is invalid */
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_NEW, NFPROTO_IPV4);
+	nl_nfct_mark(m, 77, 0);
+	ct = NLMSG_DATA(m);
+	ct->nla_type = 11 | NLA_F_NESTED; /* NFQA_CT */
+	ct->nla_len  = (__u16)(m->nlmsg_len - NLMSG_HDRLEN);
+	errno = 0;
+	ck_assert(nl_nfct_parse_nla(ct, NFPROTO_IPV4, &f) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(f.mark == 77);
+
+	/**
+	 * struct nfgenmsg is the size of an NLA header, so we can turn
+	 * the message into a nested attribute in place.
+	 */
+	nl_nfct_tuple_v4(&t, IPPROTO_ICMP, htonl(1), htonl(2), 42, 0);
+	t.icmp_type = 8;
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_NEW, NFPROTO_IPV4);
+	nl_nfct_add_tuple(m, CTA_TUPLE_ORIG, &t);
+	ct->nla_type = 11 | NLA_F_NESTED;
+	ct->nla_len  = (__u16)(m->nlmsg_len - NLMSG_HDRLEN);
+	ck_assert(!nl_nfct_parse_nla(ct, NFPROTO_IPV4, &f));
+	ck_assert(f.family == NFPROTO_IPV4 && !f.type);
+	ck_assert(f.orig.l4proto == IPPROTO_ICMP);
+	ck_assert(f.orig.src[0] == htonl(1) && f.orig.dst[0] == htonl(2));
+	ck_assert(f.orig.sport == 42 && f.orig.icmp_type == 8);
+	ck_assert(!f.orig.icmp_code && !f.orig.dport);
+	ck_assert(!f.mark);
+}
+END_TEST
+
+START_TEST(nfct_parse_invalid)
+{
+	struct nl_nfct_flow f;
+
+	errno = 0;
+	ck_assert(nl_nfct_parse(NULL, &f) == -1 && errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_nfct_parse(m, NULL) == -1 && errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_nfct_parse_nla(NULL, 0, &f) == -1 && errno == EINVAL);
+
+	errno = 0;
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_NEW, NFPROTO_IPV4);
+	nl_nfct_mark(m, 1, 0);
+	ck_assert(nl_nfct_parse(m, &f) == -1 && errno == EINVAL);
+	ck_assert(f.mark == 1);
+
+	/* Truncated attribute */
+	errno = 0;
+	m->nlmsg_len -= 2;
+	ck_assert(nl_nfct_parse(m, &f) == -1 && errno == EINVAL);
+	ck_assert(!f.mark);
+}
+END_TEST
+
+START_TEST(nfct_stats)
+{
+	__u32 v;
+	struct nfgenmsg *nf;
+	struct nl_nfct_stats st[2];
+	struct nl_nfct_stats_global g;
+
+	nl_nfct_stats_cpu(m);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_CTNETLINK << 8 |
+	                            IPCTNL_MSG_CT_GET_STATS_CPU));
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+
+	/* Reply for CPU 1 */
+	nf = NLMSG_DATA(m);
+	nf->res_id = htons(1);
+	v = htonl(10);
+	nl_add_attr(m, CTA_STATS_FOUND, &v, sizeof v);
+	v = htonl(3);
+	nl_add_attr(m, CTA_STATS_EARLY_DROP, &v, sizeof v);
+	v = htonl(7);
+	nl_add_attr(m, CTA_STATS_SEARCH_RESTART, &v, sizeof v);
+	memset(st, 0xff, sizeof st);
+	ck_assert(nl_nfct_stats_parse(m, st, 2) == 1);
+	ck_assert(st[1].found == 10 && st[1].early_drop == 3);
+	ck_assert(st[1].search_restart == 7 && !st[1].invalid);
+	ck_assert(st[0].found == 0xffffffff);
+	errno = 0;
+	ck_assert(nl_nfct_stats_parse(m, st, 1) == -1 && errno == ERANGE);
+
+	nl_nfct_stats_global(m);
+	errno = 0;
+	ck_assert(nl_nfct_stats_parse(m, st, 2) == -1 && errno == EINVAL);
+	v = htonl(1234);
+	nl_add_attr(m, CTA_STATS_GLOBAL_ENTRIES, &v, sizeof v);
+	ck_assert(!nl_nfct_stats_global_parse(m, &g));
+	ck_assert(g.entries == 1234 && !g.max_entries);
+	nl_nfct_stats_cpu(m);
+	ck_assert(nl_nfct_stats_global_parse(m, &g) == -1);
+}
+END_TEST
+
+START_TEST(nfct_stats_diff)
+{
+	struct nl_nfct_stats a[2], b[2];
+
+	memset(a, 0, sizeof a);
+	memset(b, 0, sizeof b);
+	a[0].found         = 0xfffffff0;
+	b[0].found         = 0x10;
+	a[1].chain_toolong = 5;
+	b[1].chain_toolong = 9;
+	b[1].insert        = 2;
+	nl_nfct_stats_diff(a, b, a, 2);
+	ck_assert(a[0].found == 0x20);
+	ck_assert(a[1].chain_toolong == 4 && a[1].insert == 2);
+	ck_assert(!a[1].found && !a[0].drop);
+}
+END_TEST
+
+static struct nl_nfct_slot slots[8];
+
+static void flow(struct nl_nfct_flow *f, __u16 sport, __u32 mark)
+{
+	memset(f, 0, sizeof *f);
+	f->family = NFPROTO_IPV4;
+	f->mark   = mark;
+	nl_nfct_tuple_v4(&f->orig, IPPROTO_TCP, htonl(1), htonl(2), sport, 80);
+	nl_nfct_tuple_v4(&f->reply, IPPROTO_TCP, htonl(2), htonl(1), 80, sport);
+}
+
+START_TEST(nfct_table_init)
+{
+	struct nl_nfct_table t;
+
+	errno = 0;
+	ck_assert(nl_nfct_table_init(NULL, slots, 8, 0) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(nl_nfct_table_init(&t, NULL, 8, 0) == -1);
+	ck_assert(nl_nfct_table_init(&t, slots, 0, 0) == -1);
+	ck_assert(nl_nfct_table_init(&t, slots, 6, 0) == -1);
+	ck_assert(!nl_nfct_table_init(&t, slots, 8, 0));
+	ck_assert(t.size == 8 && !t.count && t.slots == slots);
+}
+END_TEST
+
+START_TEST(nfct_table_update)
+{
+	__u16 i;
+	struct nl_nfct_table t;
+	struct nl_nfct_flow f, r;
+
+	nl_nfct_table_init(&t, slots, 8, 0x1234);
+	for (i = 0; i < 8; i++) {
+		flow(&f, (__u16)(1000 + i), i);
+		f.orig_bytes = 100;
+		ck_assert(!nl_nfct_table_update(&t, &f));
+	}
+
+	ck_assert(t.count == 8);
+	flow(&f, 2000, 0);
+	errno = 0;
+	ck_assert(nl_nfct_table_update(&t, &f) == -1 && errno == ENOSPC);
+	errno = 0;
+	ck_assert(nl_nfct_table_lookup(&t, &f.orig, 0, &r) == -1);
+	ck_assert(errno == ENOENT);
+
+	/* Counters are kept if the update doesn't have them */
+	flow(&f, 1003, 0xff);
+	ck_assert(!nl_nfct_table_update(&t, &f));
+	ck_assert(t.count == 8);
+	ck_assert(!nl_nfct_table_lookup(&t, &f.orig, 0, &r));
+	ck_assert(r.mark == 0xff && r.orig_bytes == 100);
+	ck_assert(r.orig.sport == 1003 && r.reply.dport == 1003);
+	ck_assert(nl_nfct_table_lookup(&t, &f.orig, 1, &r) == -1);
+
+	for (i = 0; i < 8; i++) {
+		flow(&f, (__u16)(1000 + i), 0);
+		ck_assert(!nl_nfct_table_lookup(&t, &f.orig, 0, &r));
+		ck_assert(r.mark == (i == 3 ? 0xff : i));
+	}
+}
+END_TEST
+
+START_TEST(nfct_table_delete)
+{
+	__u16 i;
+	struct nl_nfct_table t;
+	struct nl_nfct_flow f, r;
+
+	nl_nfct_table_init(&t, slots, 8, 0);
+	for (i = 0; i < 6; i++) {
+		flow(&f, (__u16)(1000 + i), i);
+		ck_assert(!nl_nfct_table_update(&t, &f));
+	}
+
+	for (i = 0; i < 6; i += 2) {
+		flow(&f, (__u16)(1000 + i), 0);
+		ck_assert(!nl_nfct_table_delete(&t, &f.orig, 0));
+		errno = 0;
+		ck_assert(nl_nfct_table_delete(&t, &f.orig, 0) == -1);
+		ck_assert(errno == ENOENT);
+	}
+
+	ck_assert(t.count == 3);
+	for (i = 0; i < 6; i++) {
+		flow(&f, (__u16)(1000 + i), 0);
+		ck_assert((i & 1) == !nl_nfct_table_lookup(&t, &f.orig, 0, &r));
+		if (i & 1) ck_assert(r.mark == i);
+	}
+
+	/* Deleted slots are reused */
+	for (i = 0; i < 5; i++) {
+		flow(&f, (__u16)(3000 + i), 0);
+		ck_assert(!nl_nfct_table_update(&t, &f));
+	}
+	ck_assert(t.count == 8);
+
+	/* Deleting everything leaves no deleted slots behind */
+	for (i = 0; i < 8; i++) {
+		flow(&f, (__u16)(i < 5 ? 3000 + i : 1001 + (i - 5) * 2), 0);
+		ck_assert(!nl_nfct_table_delete(&t, &f.orig, 0));
+	}
+
+	ck_assert(!t.count);
+	for (i = 0; i < 8; i++)
+		ck_assert(slots[i].hash == SLOT_EMPTY);
+}
+END_TEST
+
+START_TEST(nfct_table_apply)
+{
+	struct nl_nfct_table t;
+	struct nl_nfct_flow f;
+	struct nl_nfct_tuple k;
+
+	nl_nfct_table_init(&t, slots, 8, 0);
+	nl_nfct_tuple_v4(&k, IPPROTO_UDP, htonl(5), htonl(6), 53, 53);
+	nl_nfct_request(m, 0, IPCTNL_MSG_CT_NEW, NFPROTO_IPV4);
+	nl_nfct_add_tuple(m, CTA_TUPLE_ORIG, &k);
+	nl_nfct_mark(m, 42, 0);
+	nl_nfct_zone(m, 2);
+	ck_assert(!nl_nfct_table_apply(&t, m));
+	ck_assert(!nl_nfct_table_lookup(&t, &k, 2, &f));
+	ck_assert(f.mark == 42);
+
+	/* Other subsystems are ignored */
+	m->nlmsg_type = (NFNL_SUBSYS_CTNETLINK_EXP << 8) | IPCTNL_MSG_CT_DELETE;
+	ck_assert(!nl_nfct_table_apply(&t, m));
+	ck_assert(t.count == 1);
+
+	m->nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_DELETE;
+	ck_assert(!nl_nfct_table_apply(&t, m));
+	ck_assert(!t.count);
+	ck_assert(nl_nfct_table_lookup(&t, &k, 2, &f) == -1);
+	ck_assert(nl_nfct_table_apply(NULL, m) == -1);
+}
+END_TEST
+
+START_TEST(nfct_table_resync)
+{
+	__u16 i;
+	struct nl_nfct_table t;
+	struct nl_nfct_flow f, r;
+
+	nl_nfct_table_init(&t, slots, 8, 0);
+	for (i = 0; i < 4; i++) {
+		flow(&f, (__u16)(1000 + i), i);
+		ck_assert(!nl_nfct_table_update(&t, &f));
+	}
+
+	/* Only the odd entries are still present */
+	nl_nfct_table_resync_begin(&t);
+	for (i = 1; i < 4; i += 2) {
+		flow(&f, (__u16)(1000 + i), i);
+		ck_assert(!nl_nfct_table_update(&t, &f));
+	}
+
+	ck_assert(nl_nfct_table_resync_end(&t) == 2);
+	ck_assert(t.count == 2);
+	for (i = 0; i < 4; i++) {
+		flow(&f, (__u16)(1000 + i), 0);
+		ck_assert((i & 1) == !nl_nfct_table_lookup(&t, &f.orig, 0, &r));
+	}
+
+	ck_assert(!nl_nfct_table_resync_end(&t));
+	ck_assert(!nl_nfct_table_resync_end(NULL));
+}
+END_TEST
+
+Suite *nfct_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter / Conntrack Helpers");
+	t = tcase_create("attributes");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfct_tuple_v4);
+	tcase_add_test(t, nfct_tuple_v6_icmp);
+	tcase_add_test(t, nfct_attrs);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("parse");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfct_parse);
+	tcase_add_test(t, nfct_parse_nla);
+	tcase_add_test(t, nfct_parse_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("stats");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfct_stats);
+	tcase_add_test(t, nfct_stats_diff);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("table");
+	tcase_add_test(t, nfct_table_init);
+	tcase_add_test(t, nfct_table_update);
+	tcase_add_test(t, nfct_table_delete);
+	tcase_add_test(t, nfct_table_apply);
+	tcase_add_test(t, nfct_table_resync);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("dump");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfct_dump_filter_mark);
+	tcase_add_test(t, nfct_flush_mark);
+	tcase_add_test(t, nfct_delete_bulk_invalid);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+	tcase_add_test(t, nfct_dump_filter_tuple);
+	tcase_add_test(t, nfct_dump_filter_icmpv6);
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+	tcase_add_test(t, nfct_dump_filter_status);
+#endif
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
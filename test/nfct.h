@@ -0,0 +1,7 @@
+#ifndef NFCT_SUITE_H
+#define NFCT_SUITE_H
+#include <check.h>
+
+Suite *nfct_suite(void);
+
+#endif /* NFCT_SUITE_H */
@@ -0,0 +1,135 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <linux/netfilter/nf_conntrack_common.h>
+#include <check.h>
+
+#include "nfexp.h"
+#include "../src/nl_nfexp.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+static void fill(struct nl_nfexp *e)
+{
+	memset(e, 0, sizeof *e);
+	nl_nfct_tuple_v4(&e->master, IPPROTO_TCP, htonl(0x0a000001),
+	                 htonl(0x0a000002), 40000, 21);
+	nl_nfct_tuple_v4(&e->tuple, IPPROTO_TCP, htonl(0x0a000001),
+	                 htonl(0x0a000002), 0, 50000);
+	nl_nfexp_mask_exact(&e->mask, &e->tuple);
+	e->mask.sport = 0;
+	e->timeout    = 30;
+	e->flags      = NF_CT_EXPECT_PERMANENT;
+	e->zone       = 3;
+	strcpy(e->helper, "ftp");
+}
+
+START_TEST(nfexp_dump)
+{
+	struct nfgenmsg *nf;
+
+	nl_nfexp_dump(m, NFPROTO_IPV4);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_CTNETLINK_EXP << 8 |
+	                            IPCTNL_MSG_EXP_GET));
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	nf = NLMSG_DATA(m);
+	ck_assert(nf->nfgen_family == NFPROTO_IPV4);
+}
+END_TEST
+
+START_TEST(nfexp_mask_exact)
+{
+	struct nl_nfct_tuple t, mask;
+
+	nl_nfct_tuple_v4(&t, IPPROTO_UDP, 1, 2, 3, 4);
+	nl_nfexp_mask_exact(&mask, &t);
+	ck_assert(mask.src[0] == 0xffffffff && mask.dst[0] == 0xffffffff);
+	ck_assert(!mask.src[1] && !mask.dst[3] && !mask.icmp_type);
+	ck_assert(mask.sport == 0xffff && mask.dport == 0xffff);
+	ck_assert(mask.l3proto == t.l3proto);
+	ck_assert(mask.l4proto == IPPROTO_UDP);
+}
+END_TEST
+
+START_TEST(nfexp_create)
+{
+	struct nl_nfexp e;
+	struct nlattr *nla;
+
+	fill(&e);
+	nl_nfexp_create(m, &e);
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_CTNETLINK_EXP << 8 |
+	                            IPCTNL_MSG_EXP_NEW));
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(!!nl_nf_get_attr(m, CTA_EXPECT_MASTER));
+	ck_assert(!!nl_nf_get_attr(m, CTA_EXPECT_TUPLE));
+	ck_assert(!!nl_nf_get_attr(m, CTA_EXPECT_MASK));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_EXPECT_TIMEOUT)));
+	ck_assert(nla && *(__u32 *)NLA_DATA(nla) == htonl(30));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_EXPECT_HELP_NAME)));
+	ck_assert(nla && !strcmp(NLA_DATA(nla), "ftp"));
+	ck_assert(!!(nla = nl_nf_get_attr(m, CTA_EXPECT_ZONE)));
+	ck_assert(nla && *(__u16 *)NLA_DATA(nla) == htons(3));
+	ck_assert(!nl_nf_get_attr(m, CTA_EXPECT_ID));
+}
+END_TEST
+
+START_TEST(nfexp_parse)
+{
+	struct nl_nfexp e, d;
+
+	fill(&e);
+	nl_nfexp_create(m, &e);
+	ck_assert(!nl_nfexp_parse(m, &d));
+	ck_assert(d.type == IPCTNL_MSG_EXP_NEW);
+	ck_assert(d.family == NFPROTO_IPV4);
+	ck_assert(!memcmp(&d.master, &e.master, sizeof d.master));
+	ck_assert(!memcmp(&d.tuple,  &e.tuple,  sizeof d.tuple));
+	ck_assert(!memcmp(&d.mask,   &e.mask,   sizeof d.mask));
+	ck_assert(d.timeout == 30);
+	ck_assert(d.flags == NF_CT_EXPECT_PERMANENT);
+	ck_assert(d.zone == 3);
+	ck_assert(!strcmp(d.helper, "ftp"));
+}
+END_TEST
+
+START_TEST(nfexp_parse_invalid)
+{
+	struct nl_nfexp e;
+
+	errno = 0;
+	ck_assert(nl_nfexp_parse(NULL, &e) == -1 && errno == EINVAL);
+	nl_nfexp_dump(m, NFPROTO_IPV4);
+	errno = 0;
+	ck_assert(nl_nfexp_parse(m, &e) == -1 && errno == EINVAL);
+}
+END_TEST
+
+Suite *nfexp_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Conntrack expectations");
+	t = tcase_create("builders");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfexp_dump);
+	tcase_add_test(t, nfexp_mask_exact);
+	tcase_add_test(t, nfexp_create);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("parse");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfexp_parse);
+	tcase_add_test(t, nfexp_parse_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
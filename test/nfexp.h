@@ -0,0 +1,7 @@
+#ifndef NFEXP_SUITE_H
+#define NFEXP_SUITE_H
+#include <check.h>
+
+Suite *nfexp_suite(void);
+
+#endif /* NFEXP_SUITE_H */
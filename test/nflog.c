@@ -0,0 +1,166 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "nflog.h"
+#include "../src/nl_nflog.c"
+
+/* So that we don't overrun the line where we need this... */
+#define NLMSG_TYPE_LOG_CFG \
+	((NFNL_SUBSYS_ULOG << 8) | NFULNL_MSG_CONFIG)
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+static __u32 nla_get_u32(struct nlattr *nla)
+{
+	return nla ? ntohl(*(__u32 *)NLA_DATA(nla)) : 0xdeadbeef;
+}
+
+START_TEST(nflog_bind)
+{
+	struct nlattr *nla;
+	struct nfgenmsg *nf = NLMSG_DATA(m);
+	struct nfulnl_msg_config_cmd *c = NULL;
+
+	nl_nflog_bind(m, PF_INET, 5);
+	ck_assert(m->nlmsg_type == NLMSG_TYPE_LOG_CFG);
+	ck_assert(m->nlmsg_flags & NLM_F_REQUEST);
+	ck_assert(nf->nfgen_family == PF_INET);
+	ck_assert(nf->res_id == htons(5));
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFULA_CFG_CMD)));
+	ck_assert(nla && (c = NLA_DATA(nla)));
+	ck_assert(c && c->command == NFULNL_CFG_CMD_BIND);
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_MODE));
+
+	nl_nflog_unbind(m, PF_INET, 5);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFULA_CFG_CMD)));
+	ck_assert(nla && (c = NLA_DATA(nla)));
+	ck_assert(c && c->command == NFULNL_CFG_CMD_UNBIND);
+}
+END_TEST
+
+START_TEST(nflog_bind_opts)
+{
+	__u16 fl;
+	struct nlattr *nla;
+	struct nl_nflog_opts o;
+	struct nfulnl_msg_config_mode *mode = NULL;
+
+	memset(&o, 0, sizeof o);
+	o.cmode    = NFULNL_COPY_PACKET;
+	o.crange   = 128;
+	o.qthresh  = 64;
+	o.timeout  = 10;
+	o.nlbufsiz = 131072;
+	o.flags    = NFULNL_CFG_F_SEQ;
+	nl_nflog_bind_opts(m, PF_INET, 5, &o);
+	ck_assert(!!nl_nf_get_attr(m, NFULA_CFG_CMD));
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFULA_CFG_MODE)));
+	ck_assert(nla && (mode = NLA_DATA(nla)));
+	ck_assert(mode && mode->copy_mode == NFULNL_COPY_PACKET);
+	ck_assert(mode && mode->copy_range == htonl(128));
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, NFULA_CFG_QTHRESH)) == 64);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, NFULA_CFG_TIMEOUT)) == 10);
+	ck_assert(nla_get_u32(nl_nf_get_attr(m, NFULA_CFG_NLBUFSIZ)) ==
+	          131072);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFULA_CFG_FLAGS)));
+	fl = nla ? *(__u16 *)NLA_DATA(nla) : 0;
+	ck_assert(fl == htons(NFULNL_CFG_F_SEQ));
+
+	/* Unset options aren't sent */
+	memset(&o, 0, sizeof o);
+	nl_nflog_set_opts(m, 5, &o);
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_CMD));
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_MODE));
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_QTHRESH));
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_TIMEOUT));
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_NLBUFSIZ));
+	ck_assert(!nl_nf_get_attr(m, NFULA_CFG_FLAGS));
+}
+END_TEST
+
+START_TEST(nflog_parse)
+{
+	__u32 v;
+	struct nl_nflog_pkt p;
+	struct nfulnl_msg_packet_hdr ph;
+	struct nfulnl_msg_packet_hw hw;
+
+	memset(&ph, 0, sizeof ph);
+	memset(&hw, 0, sizeof hw);
+	ph.hw_protocol = htons(0x0800);
+	ph.hook        = 1;
+	hw.hw_addrlen  = htons(6);
+	memcpy(hw.hw_addr, "\x01\x02\x03\x04\x05\x06", 6);
+
+	nl_nflog_request(m, 0, NFULNL_MSG_PACKET, PF_INET, 5);
+	nl_add_attr(m, NFULA_PACKET_HDR, &ph, sizeof ph);
+	v = htonl(0xbeef);
+	nl_add_attr(m, NFULA_MARK, &v, sizeof v);
+	v = htonl(3);
+	nl_add_attr(m, NFULA_IFINDEX_OUTDEV, &v, sizeof v);
+	nl_add_attr(m, NFULA_HWADDR, &hw, sizeof hw);
+	nl_add_attr(m, NFULA_PREFIX, "dropped: ", 10);
+	v = htonl(77);
+	nl_add_attr(m, NFULA_SEQ, &v, sizeof v);
+	nl_add_attr(m, NFULA_PAYLOAD, "abcdefgh", 8);
+
+	ck_assert(!nl_nflog_parse(m, &p));
+	ck_assert(p.hw_protocol == 0x0800);
+	ck_assert(p.hook == 1);
+	ck_assert(p.mark == 0xbeef);
+	ck_assert(p.outdev == 3 && !p.indev);
+	ck_assert(p.hwaddr_len == 6 && p.hwaddr && p.hwaddr[5] == 6);
+	ck_assert(p.prefix && !strcmp(p.prefix, "dropped: "));
+	ck_assert(p.seq == 77 && !p.seq_global);
+	ck_assert(p.uid == (__u32)-1 && p.gid == (__u32)-1);
+	ck_assert(p.payload_len == 8);
+	ck_assert(p.payload && !memcmp(p.payload, "abcdefgh", 8));
+	ck_assert(!p.ct && !p.l2hdr);
+}
+END_TEST
+
+START_TEST(nflog_parse_invalid)
+{
+	struct nl_nflog_pkt p;
+
+	errno = 0;
+	ck_assert(nl_nflog_parse(NULL, &p) == -1);
+	ck_assert(errno == EINVAL);
+
+	/* Not a packet */
+	errno = 0;
+	nl_msg(m, NLMSG_DONE, NLM_F_MULTI, 0, 0);
+	ck_assert(nl_nflog_parse(m, &p) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+Suite *nflog_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter / Nflog Helpers");
+	t = tcase_create("config");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nflog_bind);
+	tcase_add_test(t, nflog_bind_opts);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("parse");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nflog_parse);
+	tcase_add_test(t, nflog_parse_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
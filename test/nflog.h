@@ -0,0 +1,7 @@
+#ifndef NFLOG_SUITE_H
+#define NFLOG_SUITE_H
+#include <check.h>
+
+Suite *nflog_suite(void);
+
+#endif /* NFLOG_SUITE_H */
@@ -1,9 +1,9 @@
 #include <string.h>
+#include <errno.h>
 #include <arpa/inet.h>
 #include <check.h>
 
 #include "nfqueue.h"
-#include "../src/nl_nf.c"
 #include "../src/nl_nfqueue.c"
 
 /* So that we don't overrun the line where we need this... */
@@ -90,6 +90,44 @@ START_TEST(nfqueue_bind_maxlen)
 }
 END_TEST
 
+START_TEST(nfqueue_bind_opts)
+{
+	__u32 *fl = NULL;
+	struct nlattr *nla = NULL;
+	struct nfqnl_msg_config_params *p = NULL;
+	struct nl_nfqueue_opts o;
+
+	o.cmode  = NFQNL_COPY_META;
+	o.crange = 0;
+	o.maxlen = 0;
+	o.flags  = NFQA_CFG_F_GSO | NFQA_CFG_F_FAIL_OPEN;
+	o.mask   = o.flags | NFQA_CFG_F_CONNTRACK;
+	nl_nfqueue_bind_opts(m, PF_INET6, 7, &o);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_CFG_PARAMS)));
+	ck_assert(nla && !!(p = NLA_DATA(nla)));
+	ck_assert(p && p->copy_mode == NFQNL_COPY_META);
+	ck_assert(!nl_nf_get_attr(m, NFQA_CFG_QUEUE_MAXLEN));
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_CFG_FLAGS)));
+	ck_assert(nla && (fl = NLA_DATA(nla)));
+	ck_assert(fl && *fl == htonl(NFQA_CFG_F_GSO | NFQA_CFG_F_FAIL_OPEN));
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_CFG_MASK)));
+	ck_assert(nla && (fl = NLA_DATA(nla)));
+	ck_assert(fl && *fl == htonl(NFQA_CFG_F_GSO | NFQA_CFG_F_FAIL_OPEN |
+	                             NFQA_CFG_F_CONNTRACK));
+}
+END_TEST
+
+START_TEST(nfqueue_skb_info)
+{
+	__u32 info = htonl(NFQA_SKB_GSO | NFQA_SKB_CSUMNOTREADY);
+
+	nl_nfqueue_request(m, 0, NFQNL_MSG_PACKET, PF_INET, 0);
+	ck_assert(!nl_nfqueue_skb_info(m));
+	nl_add_attr(m, NFQA_SKB_INFO, &info, sizeof info);
+	ck_assert(nl_nfqueue_skb_info(m) ==
+	          (NFQA_SKB_GSO | NFQA_SKB_CSUMNOTREADY));
+}
+END_TEST
 
 START_TEST(nfqueue_verdict)
 {
@@ -126,6 +164,200 @@ START_TEST(nfqueue_verdict_ctmark)
 }
 END_TEST
 
+START_TEST(nfqueue_verdict_batch)
+{
+	struct nlattr *nla = NULL;
+	struct nfqnl_msg_verdict_hdr *v = NULL;
+
+	nl_nfqueue_verdict_batch(m, 3, 1234, NF_DROP);
+	ck_assert((m->nlmsg_type >> 8) == NFNL_SUBSYS_QUEUE);
+	ck_assert((m->nlmsg_type & 0xff) == NFQNL_MSG_VERDICT_BATCH);
+	ck_assert(((struct nfgenmsg *)NLMSG_DATA(m))->res_id == htons(3));
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_VERDICT_HDR)));
+	ck_assert(nla && (v = NLA_DATA(nla)));
+	ck_assert(nla && v && v->verdict == htonl(NF_DROP));
+	ck_assert(nla && v && v->id == htonl(1234));
+}
+END_TEST
+
+START_TEST(nfqueue_vbatch_count)
+{
+	struct nl_nfqueue_vbatch b;
+	struct nlattr *nla = NULL;
+	struct nfqnl_msg_verdict_hdr *v = NULL;
+
+	nl_nfqueue_vbatch_init(&b, 3, 3, 0);
+	ck_assert(!nl_nfqueue_vbatch_accept(&b, m, 10, 0));
+	ck_assert(!nl_nfqueue_vbatch_accept(&b, m, 11, 0));
+	ck_assert(!*buf);
+	ck_assert(nl_nfqueue_vbatch_accept(&b, m, 12, 0) == 1);
+	ck_assert((m->nlmsg_type & 0xff) == NFQNL_MSG_VERDICT_BATCH);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_VERDICT_HDR)));
+	ck_assert(nla && (v = NLA_DATA(nla)));
+	ck_assert(nla && v && v->verdict == htonl(NF_ACCEPT));
+	ck_assert(nla && v && v->id == htonl(12));
+	ck_assert(!b.pending);
+	ck_assert(!nl_nfqueue_vbatch_flush(&b, m));
+}
+END_TEST
+
+START_TEST(nfqueue_vbatch_age)
+{
+	struct nl_nfqueue_vbatch b;
+	struct nlattr *nla = NULL;
+
+	nl_nfqueue_vbatch_init(&b, 0, 0, 5);
+	ck_assert(!nl_nfqueue_vbatch_expire(&b, m, 100));
+	ck_assert(!nl_nfqueue_vbatch_accept(&b, m, 1, 100));
+	ck_assert(!nl_nfqueue_vbatch_accept(&b, m, 2, 104));
+	ck_assert(!nl_nfqueue_vbatch_expire(&b, m, 104));
+	ck_assert(nl_nfqueue_vbatch_expire(&b, m, 105) == 1);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_VERDICT_HDR)));
+	ck_assert(nla && ((struct nfqnl_msg_verdict_hdr *)NLA_DATA(nla))->id
+	                 == htonl(2));
+	ck_assert(!nl_nfqueue_vbatch_expire(&b, m, 200));
+}
+END_TEST
+
+START_TEST(nfqueue_vbatch_flush)
+{
+	struct nl_nfqueue_vbatch b;
+	struct nlattr *nla = NULL;
+
+	nl_nfqueue_vbatch_init(&b, 0, 0, 0);
+	ck_assert(!nl_nfqueue_vbatch_flush(&b, m));
+	ck_assert(!nl_nfqueue_vbatch_accept(&b, m, 7, 0));
+	ck_assert(!nl_nfqueue_vbatch_expire(&b, m, 1000));
+	ck_assert(nl_nfqueue_vbatch_flush(&b, m) == 1);
+	ck_assert(!!(nla = nl_nf_get_attr(m, NFQA_VERDICT_HDR)));
+	ck_assert(nla && ((struct nfqnl_msg_verdict_hdr *)NLA_DATA(nla))->id
+	                 == htonl(7));
+}
+END_TEST
+
+START_TEST(nfqueue_verdict_payload)
+{
+	__u32 len;
+	struct iovec iov[3];
+	struct nlattr *nla;
+	char payload[] = "abcdefghi";
+
+	nl_nfqueue_verdict(m, 0, 1234, NF_ACCEPT);
+	len = m->nlmsg_len;
+	ck_assert(!nl_nfqueue_verdict_payload(m, iov, payload, 9));
+	ck_assert(m->nlmsg_len == len + NLA_ALIGN(NLA_HDRLEN + 9));
+	ck_assert(iov[0].iov_base == m);
+	ck_assert(iov[0].iov_len  == len + NLA_HDRLEN);
+	ck_assert(iov[1].iov_base == payload && iov[1].iov_len == 9);
+	ck_assert(iov[2].iov_len  == 3);
+	ck_assert(iov[0].iov_len + iov[1].iov_len + iov[2].iov_len ==
+	          m->nlmsg_len);
+
+	/* The attribute header is in the message, the data isn't */
+	nla = BYTE_OFF(m, len);
+	ck_assert((nla->nla_type & NLA_TYPE_MASK) == NFQA_PAYLOAD);
+	ck_assert(nla->nla_len == NLA_HDRLEN + 9);
+}
+END_TEST
+
+START_TEST(nfqueue_verdict_payload_invalid)
+{
+	struct iovec iov[3];
+
+	errno = 0;
+	ck_assert(nl_nfqueue_verdict_payload(NULL, iov, buf, 1) == -1);
+	ck_assert(errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_nfqueue_verdict_payload(m, iov, NULL, 1) == -1);
+	ck_assert(errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_nfqueue_verdict_payload(m, iov, buf, 0xffff) == -1);
+	ck_assert(errno == E2BIG);
+}
+END_TEST
+
+START_TEST(nfqueue_parse)
+{
+	__u32 v;
+	struct nlattr *nla;
+	struct nl_nfqueue_pkt p;
+	struct nfqnl_msg_packet_hdr ph;
+	struct nfqnl_msg_packet_hw hw;
+	struct nfqnl_msg_packet_timestamp ts;
+
+	memset(&hw, 0, sizeof hw);
+	memset(&ts, 0, sizeof ts);
+	ph.packet_id   = htonl(42);
+	ph.hw_protocol = htons(0x0800);
+	ph.hook        = 1;
+	hw.hw_addrlen  = htons(6);
+	memcpy(hw.hw_addr, "\x01\x02\x03\x04\x05\x06", 6);
+	((__u32 *)(void *)&ts.sec)[1]  = htonl(1000);
+	((__u32 *)(void *)&ts.usec)[1] = htonl(500);
+
+	nl_nfqueue_request(m, 0, NFQNL_MSG_PACKET, PF_INET, 0);
+	nl_add_attr(m, NFQA_PACKET_HDR, &ph, sizeof ph);
+	v = htonl(0xbeef);
+	nl_add_attr(m, NFQA_MARK, &v, sizeof v);
+	v = htonl(3);
+	nl_add_attr(m, NFQA_IFINDEX_INDEV, &v, sizeof v);
+	nl_add_attr(m, NFQA_HWADDR, &hw, sizeof hw);
+	nl_add_attr(m, NFQA_TIMESTAMP, &ts, sizeof ts);
+	v = htonl(NFQA_SKB_GSO);
+	nl_add_attr(m, NFQA_SKB_INFO, &v, sizeof v);
+	v = htonl(1500);
+	nl_add_attr(m, NFQA_CAP_LEN, &v, sizeof v);
+	v = htonl(1000);
+	nl_add_attr(m, NFQA_UID, &v, sizeof v);
+	nla = nla_start(m, NFQA_CT);
+	v = htonl(0xf00d);
+	nla_add_attr(nla, CTA_MARK, &v, sizeof v);
+	nla_end(m, nla);
+	nl_add_attr(m, NFQA_PAYLOAD, "abcdefgh", 8);
+
+	ck_assert(!nl_nfqueue_parse(m, &p));
+	ck_assert(p.id == 42);
+	ck_assert(p.hw_protocol == 0x0800);
+	ck_assert(p.hook == 1);
+	ck_assert(p.mark == 0xbeef);
+	ck_assert(p.indev == 3 && !p.outdev);
+	ck_assert(p.hwaddr_len == 6 && p.hwaddr && p.hwaddr[5] == 6);
+	ck_assert(p.ts_sec == 1000 && p.ts_usec == 500);
+	ck_assert(p.skb_info == NFQA_SKB_GSO);
+	ck_assert(p.cap_len == 1500);
+	ck_assert(p.uid == 1000 && p.gid == (__u32)-1);
+	ck_assert(p.ct == nla);
+	ck_assert(p.payload_len == 8);
+	ck_assert(p.payload && !memcmp(p.payload, "abcdefgh", 8));
+	ck_assert(!p.secctx && !p.secctx_len);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+	/* The security context is not NUL-terminated */
+	nl_add_attr(m, NFQA_SECCTX, "system_u", 8);
+	ck_assert(!nl_nfqueue_parse(m, &p));
+	ck_assert(p.secctx_len == 8);
+	ck_assert(p.secctx && !memcmp(p.secctx, "system_u", 8));
+#endif
+}
+END_TEST
+
+START_TEST(nfqueue_parse_invalid)
+{
+	struct nl_nfqueue_pkt p;
+
+	errno = 0;
+	ck_assert(nl_nfqueue_parse(NULL, &p) == -1);
+	ck_assert(errno == EINVAL);
+
+	/* No packet header */
+	errno = 0;
+	nl_nfqueue_request(m, 0, NFQNL_MSG_PACKET, PF_INET, 0);
+	nl_add_attr(m, NFQA_PAYLOAD, "abcde", 5);
+	ck_assert(nl_nfqueue_parse(m, &p) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
 Suite *nfqueue_suite(void)
 {
 	Suite *s;
@@ -142,6 +374,14 @@ Suite *nfqueue_suite(void)
 	tcase_add_checked_fixture(t, setup, NULL);
 	tcase_add_test(t, nfqueue_bind);
 	tcase_add_test(t, nfqueue_bind_maxlen);
+	tcase_add_test(t, nfqueue_bind_opts);
+	tcase_add_test(t, nfqueue_skb_info);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("parse");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfqueue_parse);
+	tcase_add_test(t, nfqueue_parse_invalid);
 	tcase_set_timeout(t, 1);
 	suite_add_tcase(s, t);
 	t = tcase_create("verdict");
@@ -149,6 +389,16 @@ Suite *nfqueue_suite(void)
 	tcase_add_test(t, nfqueue_verdict);
 	tcase_add_test(t, nfqueue_verdict_mark);
 	tcase_add_test(t, nfqueue_verdict_ctmark);
+	tcase_add_test(t, nfqueue_verdict_payload);
+	tcase_add_test(t, nfqueue_verdict_payload_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	t = tcase_create("verdict_batch");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nfqueue_verdict_batch);
+	tcase_add_test(t, nfqueue_vbatch_count);
+	tcase_add_test(t, nfqueue_vbatch_age);
+	tcase_add_test(t, nfqueue_vbatch_flush);
 	tcase_set_timeout(t, 1);
 	suite_add_tcase(s, t);
 	return s;
@@ -0,0 +1,165 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "nft.h"
+#include "../src/nl_nft.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static __u32 keys[512];
+
+static void setup(void)
+{
+	__u32 i;
+
+	memset(buf, 0, NLMSG_GOODSIZE);
+	for (i = 0; i < 512; i++)
+		keys[i] = htonl(0x0a000000 | i);
+}
+
+START_TEST(nft_setelem)
+{
+	int n = 0;
+	struct nlattr *list, *elem, *key, *val;
+
+	ck_assert(!!(list = nl_nft_setelem_begin(m, NFT_MSG_NEWSETELEM,
+	                                         NFPROTO_IPV4, "filter",
+	                                         "block")));
+	ck_assert(m->nlmsg_type == (NFNL_SUBSYS_NFTABLES << 8 |
+	                            NFT_MSG_NEWSETELEM));
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(!nl_nft_setelem_add(m, list, &keys[0], 4, NLMSG_GOODSIZE));
+	ck_assert(!nl_nft_setelem_add(m, list, &keys[1], 4, NLMSG_GOODSIZE));
+	nl_nft_setelem_end(m, list);
+
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m,
+	                  NFTA_SET_ELEM_LIST_TABLE)), "filter"));
+	ck_assert(!strcmp(NLA_DATA(nl_nf_get_attr(m,
+	                  NFTA_SET_ELEM_LIST_SET)), "block"));
+	ck_assert(nl_nf_get_attr(m, NFTA_SET_ELEM_LIST_ELEMENTS) == list);
+	nla_each(elem, list) {
+		ck_assert((elem->nla_type & NLA_TYPE_MASK) == NFTA_LIST_ELEM);
+		ck_assert(!!(key = nla_get_attr(elem, NFTA_SET_ELEM_KEY)));
+		ck_assert(!!(val = nla_get_attr(key, NFTA_DATA_VALUE)));
+		ck_assert(val && *(__u32 *)NLA_DATA(val) == keys[n]);
+		++n;
+	}
+
+	ck_assert(n == 2);
+}
+END_TEST
+
+START_TEST(nft_setelem_full)
+{
+	struct nlattr *list;
+
+	list = nl_nft_setelem_begin(m, NFT_MSG_DELSETELEM, NFPROTO_IPV4,
+	                            "filter", "block");
+	ck_assert(!(m->nlmsg_flags & NLM_F_CREATE));
+	errno = 0;
+	ck_assert(nl_nft_setelem_add(m, list, keys, 4, m->nlmsg_len) == -1);
+	ck_assert(errno == E2BIG);
+	errno = 0;
+	ck_assert(nl_nft_setelem_add(m, list, keys, 0, NLMSG_GOODSIZE) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(nft_setelem_bulk)
+{
+	int err;
+	long i;
+	size_t n, first = 0;
+	struct nl_batch b;
+	struct nl_nft_bulk k;
+	struct nlmsghdr *e;
+	struct nlmsgerr *ne;
+
+	memset(&k, 0, sizeof k);
+	k.table  = "filter";
+	k.set    = "block";
+	k.family = NFPROTO_IPV4;
+	k.type   = NFT_MSG_NEWSETELEM;
+	k.klen   = 4;
+	k.msglen = 1024;
+
+	nl_batch_init(&b, buf, NLMSG_GOODSIZE >> 1, 1);
+	errno = 0;
+	ck_assert(!nl_nft_setelem_bulk(&b, &k, keys, 512) && errno == EINVAL);
+	ck_assert(!nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES));
+	n = nl_nft_setelem_bulk(&b, &k, keys, 512);
+	ck_assert(n > 0 && n < 512 && n == k.count);
+	ck_assert(k.first == 0 && k.per_msg > 1);
+	ck_assert(b.count == 1 + (n + k.per_msg - 1) / k.per_msg);
+	ck_assert(!nl_nf_batch_end(&b));
+
+	/* Every message fits */
+	for (e = BYTE_OFF(buf, NLMSG_SPACE(sizeof(struct nfgenmsg)));
+	     e->nlmsg_type != NFNL_MSG_BATCH_END;
+	     e = BYTE_OFF(e, NLMSG_ALIGN(e->nlmsg_len)))
+		ck_assert(e->nlmsg_len <= 1024);
+
+	/* Map an error back to its elements */
+	e = BYTE_OFF(buf, NLMSG_GOODSIZE >> 1);
+	nl_msg(e, NLMSG_ERROR, 0, 0, sizeof *ne);
+	ne = NLMSG_DATA(e);
+	ne->error = -ENOENT;
+	ne->msg.nlmsg_seq = 3;
+	ck_assert((i = nl_nf_batch_ack(&b, e, &err)) == 1 && err == -ENOENT);
+	ck_assert(nl_nft_setelem_range(&k, i, &first) == k.per_msg);
+	ck_assert(first == k.per_msg);
+	ck_assert(nl_nft_setelem_range(&k, (long)(b.count - 3), &first) ==
+	          n - first);
+	ck_assert(!nl_nft_setelem_range(&k, (long)b.count, &first));
+
+	/* Nothing fits */
+	nl_batch_reset(&b);
+	ck_assert(!nl_nf_batch_begin(&b, NFNL_SUBSYS_NFTABLES));
+	k.msglen = 32;
+	errno = 0;
+	ck_assert(!nl_nft_setelem_bulk(&b, &k, keys, 512) && errno == E2BIG);
+}
+END_TEST
+
+START_TEST(nft_diff)
+{
+	__u32 add[4], del[4];
+	size_t nadd, ndel;
+	static const __u32 old[4] = { 1, 2, 4, 6 };
+	static const __u32 cur[4] = { 2, 3, 6, 7 };
+
+	ck_assert(!nl_nft_diff(old, 4, cur, 4, 4, add, &nadd, del, &ndel));
+	ck_assert(nadd == 2 && ndel == 2);
+	ck_assert(add[0] == 3 && add[1] == 7);
+	ck_assert(del[0] == 1 && del[1] == 4);
+
+	ck_assert(!nl_nft_diff(old, 4, NULL, 0, 4, NULL, &nadd, del, &ndel));
+	ck_assert(!nadd && ndel == 4 && !memcmp(del, old, sizeof old));
+	ck_assert(!nl_nft_diff(old, 4, old, 4, 4, add, &nadd, del, &ndel));
+	ck_assert(!nadd && !ndel);
+	errno = 0;
+	ck_assert(nl_nft_diff(old, 4, cur, 4, 4, NULL, &nadd, del, &ndel));
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+Suite *nft_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netfilter / nf_tables Helpers");
+	t = tcase_create("set elements");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nft_setelem);
+	tcase_add_test(t, nft_setelem_full);
+	tcase_add_test(t, nft_setelem_bulk);
+	tcase_add_test(t, nft_diff);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
@@ -0,0 +1,7 @@
+#ifndef NFT_SUITE_H
+#define NFT_SUITE_H
+#include <check.h>
+
+Suite *nft_suite(void);
+
+#endif /* NFT_SUITE_H */
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <errno.h>
 #include <check.h>
 
 #include "nl.h"
@@ -235,6 +236,32 @@ START_TEST(nla_end_works)
 }
 END_TEST
 
+START_TEST(nla_nest_works)
+{
+	__u32 len;
+	struct nlattr *nla, *nest, *a;
+	len = m->nlmsg_len;
+	nla = nla_start(m, 0x3ace);
+	ck_assert(!nla_nest_start(NULL, 0x1bad));
+	nest = nla_nest_start(nla, 0x1bad);
+	ck_assert(nest == NLA_DATA(nla));
+	ck_assert(nest->nla_type == (0x1bad | NLA_F_NESTED));
+	nla_add_attr(nest, 0x2bef, "aaa", 3);
+	nla_nest_end(nla, nest);
+	nla_add_attr(nla, 0x2bee, "bbbb", 4);
+	nla_end(m, nla);
+	ck_assert(nest->nla_len == NLA_HDRLEN + NLA_ALIGN(NLA_HDRLEN + 3));
+	ck_assert(nla->nla_len == NLA_HDRLEN + nest->nla_len +
+	                          NLA_ALIGN(NLA_HDRLEN + 4));
+	ck_assert(m->nlmsg_len == len + NLMSG_ALIGN(nla->nla_len));
+	ck_assert(!!(a = nla_get_attr(nla, 0x1bad)) && a == nest);
+	ck_assert(!!(a = nla_get_attr(nest, 0x2bef)));
+	ck_assert(a && !memcmp(NLA_DATA(a), "aaa", 3));
+	ck_assert(!!(a = nla_get_attr(nla, 0x2bee)));
+	ck_assert(a && !memcmp(NLA_DATA(a), "bbbb", 4));
+}
+END_TEST
+
 START_TEST(nla_get_attr_ignores_null)
 {
 	ck_assert(!nla_get_attr(NULL, 0x3ace));
@@ -298,6 +325,186 @@ START_TEST(nla_get_attrv_works)
 }
 END_TEST
 
+START_TEST(nl_sendv_invalid)
+{
+	struct iovec iov[2];
+
+	errno = 0;
+	ck_assert(nl_sendv(-1, 0, NULL, 1) == -1);
+	ck_assert(errno == EINVAL);
+
+	errno = 0;
+	nl_msg(m, 0xdead, 0, 0, 8);
+	iov[0].iov_base = m;
+	iov[0].iov_len  = m->nlmsg_len;
+	ck_assert(nl_sendv(-1, 0, iov, 0) == -1);
+	ck_assert(errno == EINVAL);
+
+	/* nlmsg_len must cover every buffer */
+	errno = 0;
+	iov[1].iov_base = buf;
+	iov[1].iov_len  = 4;
+	ck_assert(nl_sendv(-1, 0, iov, 2) == -1);
+	ck_assert(errno == EINVAL);
+
+	errno = 0;
+	iov[0].iov_len = 4;
+	ck_assert(nl_sendv(-1, 0, iov, 1) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(nl_batch_works)
+{
+	long i;
+	struct nl_batch b;
+	struct nlmsghdr *n;
+	__u32 bbuf[28];
+
+	nl_batch_init(&b, bbuf, sizeof bbuf, 100);
+	ck_assert(!nl_batch_next(&b, sizeof bbuf + 1));
+	ck_assert(!nl_batch_next(&b, 1));
+	for (i = 0; i < 3; i++) {
+		ck_assert(!!(n = nl_batch_next(&b, NLMSG_LENGTH(16))));
+		ck_assert(n == (void *)((char *)bbuf + i * NLMSG_LENGTH(16)));
+		nl_msg(n, 0x1234, NLM_F_REQUEST, 0, 13);
+		ck_assert(nl_batch_add(&b) == i);
+		ck_assert(n->nlmsg_seq == (__u32)(100 + i));
+		ck_assert(n->nlmsg_flags == (NLM_F_REQUEST | NLM_F_ACK));
+	}
+
+	ck_assert(b.count == 3 && b.len == 3 * NLMSG_LENGTH(16));
+	ck_assert(!nl_batch_next(&b, NLMSG_LENGTH(16)));
+	ck_assert(!!(n = nl_batch_next(&b, NLMSG_HDRLEN)));
+
+	/* The message must fit */
+	errno = 0;
+	nl_msg(n, 0x1234, NLM_F_REQUEST, 0, 4);
+	ck_assert(nl_batch_add(&b) == -1 && errno == E2BIG);
+	errno = 0;
+	n->nlmsg_len = 0;
+	ck_assert(nl_batch_add(&b) == -1 && errno == EINVAL);
+	ck_assert(b.count == 3);
+
+	nl_batch_reset(&b);
+	ck_assert(!b.count && !b.len && b.seq == 103);
+	errno = 0;
+	ck_assert(nl_batch_send(-1, 0, &b) == -1 && errno == EINVAL);
+}
+END_TEST
+
+START_TEST(nl_batch_ack_works)
+{
+	int err = 1;
+	struct nl_batch b;
+	struct nlmsgerr *e;
+
+	nl_batch_init(&b, buf, 64, 10);
+	b.count = 4;
+	nl_msg(m, NLMSG_ERROR, 0, 0, sizeof *e);
+	e = NLMSG_DATA(m);
+	e->error = 0;
+	e->msg.nlmsg_seq = 12;
+	ck_assert(nl_batch_ack(&b, m, &err) == 2 && !err);
+	e->error = -ENOENT;
+	e->msg.nlmsg_seq = 13;
+	ck_assert(nl_batch_ack(&b, m, &err) == 3 && err == -ENOENT);
+	e->msg.nlmsg_seq = 14;
+	ck_assert(nl_batch_ack(&b, m, &err) == -1);
+	e->msg.nlmsg_seq = 9;
+	ck_assert(nl_batch_ack(&b, m, &err) == -1);
+	e->msg.nlmsg_seq = 10;
+	m->nlmsg_type = NLMSG_DONE;
+	ck_assert(nl_batch_ack(&b, m, &err) == -1);
+	ck_assert(nl_batch_ack(NULL, m, &err) == -1);
+}
+END_TEST
+
+static int dump_count(struct nlmsghdr *msg, void *arg)
+{
+	if (!msg) return 1;
+	return ++*(int *)arg >= 2;
+}
+
+static int dump_full(struct nlmsghdr *msg, void *arg)
+{
+	(void)msg;
+	(void)arg;
+	errno = E2BIG;
+	return 1;
+}
+
+START_TEST(nl_dump_msgs_works)
+{
+	int n = 0, state = 0, stop = 0;
+	struct nlmsghdr *e;
+	size_t len = 0;
+
+	/* Two messages, one with another sequence number, then DONE */
+	e = m;
+	nl_msg(e, 0x10, NLM_F_MULTI, 0, 0);
+	e->nlmsg_seq = 5;
+	len += NLMSG_ALIGN(e->nlmsg_len);
+	e = BYTE_OFF(m, len);
+	nl_msg(e, 0x10, NLM_F_MULTI, 0, 0);
+	e->nlmsg_seq = 4;
+	len += NLMSG_ALIGN(e->nlmsg_len);
+	e = BYTE_OFF(m, len);
+	nl_msg(e, 0x10, NLM_F_MULTI | NLM_F_DUMP_INTR, 0, 0);
+	e->nlmsg_seq = 5;
+	len += NLMSG_ALIGN(e->nlmsg_len);
+	ck_assert(!dump_msgs(m, len, 5, &state, &stop, dump_count, &n));
+	ck_assert(n == 2 && state == (DUMP_INTR | DUMP_STOP));
+	ck_assert(stop == ECANCELED);
+
+	/* The callback isn't called again once stopped */
+	e = BYTE_OFF(m, len);
+	nl_msg(e, NLMSG_DONE, NLM_F_MULTI, 0, 0);
+	e->nlmsg_seq = 5;
+	len += NLMSG_ALIGN(e->nlmsg_len);
+	ck_assert(dump_msgs(m, len, 5, &state, &stop, dump_count, &n) == 1);
+	ck_assert(n == 2);
+
+	/* The error the callback stopped with is kept */
+	state = 0;
+	ck_assert(dump_msgs(m, len, 5, &state, &stop, dump_full, NULL) == 1);
+	ck_assert(state == (DUMP_INTR | DUMP_STOP) && stop == E2BIG);
+}
+END_TEST
+
+START_TEST(nl_dump_msgs_error)
+{
+	int n = 0, state = 0, stop = 0;
+	struct nlmsgerr *e;
+
+	nl_msg(m, NLMSG_ERROR, 0, 0, sizeof *e);
+	m->nlmsg_seq = 1;
+	e = NLMSG_DATA(m);
+	e->error = 0;
+	ck_assert(!dump_msgs(m, m->nlmsg_len, 1, &state, &stop, dump_count,
+	                     &n));
+	e->error = -EPERM;
+	errno = 0;
+	ck_assert(dump_msgs(m, m->nlmsg_len, 1, &state, &stop, dump_count,
+	                    &n) == -1);
+	ck_assert(errno == -EPERM && !n && !state && !stop);
+}
+END_TEST
+
+START_TEST(nl_dump_invalid)
+{
+	errno = 0;
+	ck_assert(nl_dump(-1, NULL, buf, 64, 0, dump_count, NULL) == -1);
+	ck_assert(errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_dump(-1, m, buf, 4, 0, dump_count, NULL) == -1);
+	ck_assert(errno == EINVAL);
+	errno = 0;
+	ck_assert(nl_dump(-1, m, buf, 64, 0, NULL, NULL) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
 Suite *nl_suite(void)
 {
 	Suite *s;
@@ -311,6 +518,27 @@ Suite *nl_suite(void)
 	tcase_set_timeout(t, 1);
 	suite_add_tcase(s, t);
 
+	t = tcase_create("message sending");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nl_sendv_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+
+	t = tcase_create("message batching");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nl_batch_works);
+	tcase_add_test(t, nl_batch_ack_works);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+
+	t = tcase_create("dumps");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, nl_dump_msgs_works);
+	tcase_add_test(t, nl_dump_msgs_error);
+	tcase_add_test(t, nl_dump_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+
 	t = tcase_create("attribute construction");
 	tcase_add_checked_fixture(t, nla_setup, NULL);
 	tcase_add_test(t, nl_add_attr_no_data);
@@ -345,6 +573,7 @@ Suite *nl_suite(void)
 	tcase_add_test(t, nla_add_attr_no_len);
 	tcase_add_test(t, nla_add_attr_data);
 	tcase_add_test(t, nla_end_works);
+	tcase_add_test(t, nla_nest_works);
 	tcase_add_test(t, nla_get_attr_ignores_null);
 	tcase_add_test(t, nla_get_attr_ignores_non_nested);
 	tcase_add_test(t, nla_get_attr_works);
@@ -0,0 +1,162 @@
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <check.h>
+
+#include "route.h"
+#include "../src/nl_route.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+START_TEST(route_requests)
+{
+	__u32 mx[RTAX_MAX + 1];
+	struct rtmsg *rtm;
+	struct nlattr *nla;
+
+	nl_rt_get_routes(m, AF_INET6);
+	rtm = NLMSG_DATA(m);
+	ck_assert(m->nlmsg_type == RTM_GETROUTE);
+	ck_assert(m->nlmsg_flags & NLM_F_DUMP);
+	ck_assert(rtm->rtm_family == AF_INET6);
+
+	nl_rt_new_route(m, AF_INET, 24, 1000, RTPROT_BGP);
+	ck_assert(m->nlmsg_flags & NLM_F_CREATE);
+	ck_assert(rtm->rtm_table == RT_TABLE_UNSPEC);
+	ck_assert(rtm->rtm_type == RTN_UNICAST);
+	ck_assert((nla = nl_rt_get_attr(m, RTA_TABLE)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 1000);
+
+	nl_rt_del_route(m, AF_INET, 24, RT_TABLE_MAIN);
+	ck_assert(!(m->nlmsg_flags & NLM_F_CREATE));
+	ck_assert(rtm->rtm_table == RT_TABLE_MAIN);
+	ck_assert(rtm->rtm_scope == RT_SCOPE_NOWHERE);
+	ck_assert(!nl_rt_get_attr(m, RTA_TABLE));
+
+	/* Only the metrics that are set */
+	memset(mx, 0, sizeof mx);
+	nl_rt_add_metrics(m, mx);
+	ck_assert(!nl_rt_get_attr(m, RTA_METRICS));
+	mx[RTAX_MTU] = 1400;
+	nl_rt_add_metrics(m, mx);
+	ck_assert((nla = nl_rt_get_attr(m, RTA_METRICS)));
+	ck_assert(nla->nla_len == 2 * NLA_HDRLEN + 4);
+	ck_assert(*(__u32 *)NLA_DATA(nla_get_attr(nla, RTAX_MTU)) == 1400);
+}
+END_TEST
+
+START_TEST(route_parse)
+{
+	__u32 mx[RTAX_MAX + 1];
+	struct nl_rt_route r, p;
+	struct nl_rt_nexthop nh[3], pnh[2];
+
+	memset(mx, 0, sizeof mx);
+	memset(&r, 0, sizeof r);
+	memset(nh, 0, sizeof nh);
+	mx[RTAX_MTU]    = 1400;
+	r.family        = AF_INET;
+	r.dst[0]        = inet_addr("198.51.100.0");
+	r.dst_len       = 24;
+	r.table         = 1000;
+	r.priority      = 20;
+	r.protocol      = RTPROT_BGP;
+	r.metrics       = mx;
+	r.nh            = nh;
+	r.nnh           = 1;
+	nh[0].gw[0]     = inet_addr("192.0.2.1");
+	nh[0].ifindex   = 2;
+
+	nl_rt_route(m, RTM_NEWROUTE, &r);
+	ck_assert(m->nlmsg_flags & NLM_F_REPLACE);
+	ck_assert(!nl_rt_get_attr(m, RTA_MULTIPATH));
+	ck_assert(!nl_rt_parse(m, &p, pnh, 2));
+	ck_assert(p.family == AF_INET && p.dst_len == 24);
+	ck_assert(p.dst[0] == r.dst[0]);
+	ck_assert(p.table == 1000 && p.priority == 20);
+	ck_assert(p.protocol == RTPROT_BGP && p.type == RTN_UNICAST);
+	ck_assert(p.nh == pnh && p.nnh == 1);
+	ck_assert(pnh[0].gw[0] == nh[0].gw[0] && pnh[0].ifindex == 2);
+	ck_assert(!p.metrics);
+
+	/* Multipath, with more next hops than fit */
+	nh[1].gw[0]   = inet_addr("192.0.2.2");
+	nh[1].ifindex = 3;
+	nh[1].weight  = 5;
+	nh[2].ifindex = 4;
+	r.nnh         = 3;
+	nl_rt_route(m, RTM_NEWROUTE, &r);
+	ck_assert(nl_rt_get_attr(m, RTA_MULTIPATH));
+	ck_assert(!nl_rt_get_attr(m, RTA_GATEWAY));
+	ck_assert(!nl_rt_parse(m, &p, pnh, 2));
+	ck_assert(p.nnh == 2);
+	ck_assert(pnh[0].gw[0] == nh[0].gw[0] && pnh[0].ifindex == 2);
+	ck_assert(pnh[0].weight == 1);
+	ck_assert(pnh[1].gw[0] == nh[1].gw[0] && pnh[1].ifindex == 3);
+	ck_assert(pnh[1].weight == 5);
+
+	/* Deletes only have the destination */
+	nl_rt_route(m, RTM_DELROUTE, &r);
+	ck_assert(!nl_rt_parse(m, &p, pnh, 2));
+	ck_assert(p.dst[0] == r.dst[0] && !p.nnh);
+	ck_assert(!nl_rt_get_attr(m, RTA_METRICS));
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,3,0)
+	/* A nexthop object replaces the next hops */
+	r.nh_id = 100;
+	nl_rt_route(m, RTM_NEWROUTE, &r);
+	ck_assert(!nl_rt_get_attr(m, RTA_MULTIPATH));
+	ck_assert(!nl_rt_parse(m, &p, pnh, 2));
+	ck_assert(p.nh_id == 100 && !p.nnh);
+#endif
+
+	errno = 0;
+	nl_rt_get_routes(m, AF_INET);
+	ck_assert(nl_rt_parse(m, &p, pnh, 2) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(route_bulk_invalid)
+{
+	struct nl_batch b;
+	struct nl_rt_route r;
+	__u32 bbuf[64];
+
+	memset(&r, 0, sizeof r);
+	nl_batch_init(&b, bbuf, sizeof bbuf, 1);
+	errno = 0;
+	ck_assert(nl_rt_bulk(-1, NULL, RTM_NEWROUTE, &r, 1, NULL) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(nl_rt_bulk(-1, &b, RTM_GETROUTE, &r, 1, NULL) == -1);
+	ck_assert(!nl_rt_bulk(-1, &b, RTM_NEWROUTE, NULL, 0, NULL));
+
+	/* Not even one route fits */
+	errno = 0;
+	ck_assert(nl_rt_bulk(-1, &b, RTM_NEWROUTE, &r, 1, NULL) == -1);
+	ck_assert(errno == E2BIG);
+}
+END_TEST
+
+Suite *route_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netlink Route Helpers");
+	t = tcase_create("routes");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, route_requests);
+	tcase_add_test(t, route_parse);
+	tcase_add_test(t, route_bulk_invalid);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
@@ -0,0 +1,7 @@
+#ifndef ROUTE_SUITE_H
+#define ROUTE_SUITE_H
+#include <check.h>
+
+Suite *route_suite(void);
+
+#endif /* ROUTE_SUITE_H */
@@ -0,0 +1,143 @@
+#include <string.h>
+#include <errno.h>
+#include <check.h>
+
+#include "taskstats.h"
+#include "../src/nl_taskstats.c"
+
+/* 8k is the maximum netlink packet size (from nl.c) */
+extern char buf[NLMSG_GOODSIZE];
+extern struct nlmsghdr *m;
+
+/* taskstats family ID */
+#define FAMILY 31
+
+static void setup(void)
+{
+	memset(buf, 0, NLMSG_GOODSIZE);
+}
+
+/**
+ * Add a record, as sent by the kernel
+ */
+static void add_aggr(__u16 type, __u32 id, size_t len)
+{
+	struct taskstats ts;
+	struct nlattr *aggr;
+
+	memset(&ts, 0, sizeof ts);
+	ts.version = TASKSTATS_VERSION;
+	ts.ac_exitcode = id;
+	aggr = nla_start(m, type);
+	nla_add_attr(aggr, type == TASKSTATS_TYPE_AGGR_PID ?
+	             TASKSTATS_TYPE_PID : TASKSTATS_TYPE_TGID, &id, sizeof id);
+	nla_add_attr(aggr, TASKSTATS_TYPE_STATS, &ts, len);
+	nla_end(m, aggr);
+}
+
+START_TEST(taskstats_requests)
+{
+	struct nlattr *nla;
+
+	nl_taskstats_get(m, FAMILY, TASKSTATS_CMD_ATTR_TGID, 42);
+	ck_assert(m->nlmsg_type == FAMILY);
+	ck_assert(((struct genlmsghdr *)NLMSG_DATA(m))->cmd ==
+	          TASKSTATS_CMD_GET);
+	ck_assert((nla = nl_gen_get_attr(m, TASKSTATS_CMD_ATTR_TGID)));
+	ck_assert(*(__u32 *)NLA_DATA(nla) == 42);
+
+	ck_assert(!nl_taskstats_register(m, FAMILY, "0-3"));
+	ck_assert((nla = nl_gen_get_attr(m,
+	                                 TASKSTATS_CMD_ATTR_REGISTER_CPUMASK)));
+	ck_assert(!strcmp(NLA_DATA(nla), "0-3"));
+	ck_assert(!nl_taskstats_deregister(m, FAMILY, "4"));
+	ck_assert(nl_gen_get_attr(m, TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK));
+
+	errno = 0;
+	ck_assert(nl_taskstats_register(m, FAMILY, "") == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+START_TEST(taskstats_shard)
+{
+	char mask[NL_TASKSTATS_CPUMASK_LEN];
+
+	ck_assert(!nl_taskstats_shard(mask, 10, 3, 0));
+	ck_assert(!strcmp(mask, "0-2"));
+	ck_assert(!nl_taskstats_shard(mask, 10, 3, 1));
+	ck_assert(!strcmp(mask, "3-5"));
+	ck_assert(!nl_taskstats_shard(mask, 10, 3, 2));
+	ck_assert(!strcmp(mask, "6-9"));
+	ck_assert(!nl_taskstats_shard(mask, 1, 1, 0));
+	ck_assert(!strcmp(mask, "0-0"));
+
+	errno = 0;
+	ck_assert(nl_taskstats_shard(mask, 2, 3, 0) == -1);
+	ck_assert(errno == EINVAL);
+	ck_assert(nl_taskstats_shard(mask, 4, 2, 2) == -1);
+	ck_assert(nl_taskstats_shard(mask, 4, 0, 0) == -1);
+}
+END_TEST
+
+START_TEST(taskstats_parse)
+{
+	__u16 version;
+	__u32 code;
+	struct taskstats ts;
+	struct nl_taskstats_rec r[2];
+
+	/* The exit of the last thread of a group */
+	nl_gen_request(m, 0, FAMILY, TASKSTATS_CMD_NEW, TASKSTATS_GENL_VERSION);
+	add_aggr(TASKSTATS_TYPE_AGGR_PID, 101, sizeof(struct taskstats));
+	add_aggr(TASKSTATS_TYPE_AGGR_TGID, 100, STATS_MINLEN);
+	ck_assert(nl_taskstats_parse(m, r) == 2);
+	ck_assert(r[0].id == 101 && !r[0].tgid);
+	ck_assert(r[0].len == sizeof(struct taskstats));
+	memcpy(&version, r[0].stats, sizeof version);
+	ck_assert(version == TASKSTATS_VERSION);
+	memcpy(&code, (const char *)r[0].stats +
+	       offsetof(struct taskstats, ac_exitcode), sizeof code);
+	ck_assert(code == 101);
+	ck_assert((const char *)r[0].stats > buf &&
+	          (const char *)r[0].stats < buf + m->nlmsg_len);
+	ck_assert(r[1].id == 100 && r[1].tgid);
+	ck_assert(r[1].len == STATS_MINLEN);
+
+	/* Copies are zero-filled past what the kernel sent */
+	memset(&ts, 0xff, sizeof ts);
+	nl_taskstats_copy(&r[1], &ts);
+	ck_assert(ts.version == TASKSTATS_VERSION);
+	ck_assert(ts.ac_exitcode == 100);
+	ck_assert(!ts.ac_comm[0] && !ts.cpu_run_real_total);
+
+	/* Truncated statistics */
+	errno = 0;
+	nl_gen_request(m, 0, FAMILY, TASKSTATS_CMD_NEW, TASKSTATS_GENL_VERSION);
+	add_aggr(TASKSTATS_TYPE_AGGR_PID, 101, STATS_MINLEN - 8);
+	ck_assert(nl_taskstats_parse(m, r) == -1);
+	ck_assert(errno == EINVAL);
+
+	/* No records */
+	errno = 0;
+	nl_taskstats_get(m, FAMILY, TASKSTATS_CMD_ATTR_PID, 1);
+	ck_assert(nl_taskstats_parse(m, r) == -1);
+	ck_assert(errno == EINVAL);
+}
+END_TEST
+
+Suite *taskstats_suite(void)
+{
+	Suite *s;
+	TCase *t;
+
+	s = suite_create("Netlink_Generic / taskstats Helpers");
+	t = tcase_create("taskstats");
+	tcase_add_checked_fixture(t, setup, NULL);
+	tcase_add_test(t, taskstats_requests);
+	tcase_add_test(t, taskstats_shard);
+	tcase_add_test(t, taskstats_parse);
+	tcase_set_timeout(t, 1);
+	suite_add_tcase(s, t);
+	return s;
+}
@@ -0,0 +1,7 @@
+#ifndef TASKSTATS_SUITE_H
+#define TASKSTATS_SUITE_H
+#include <check.h>
+
+Suite *taskstats_suite(void);
+
+#endif /* TASKSTATS_SUITE_H */
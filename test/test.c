@@ -3,7 +3,19 @@
 
 #include "nl.h"
 #include "gen.h"
+#include "nf.h"
 #include "nfqueue.h"
+#include "nfct.h"
+#include "nfexp.h"
+#include "nft.h"
+#include "nflog.h"
+#include "ipset.h"
+#include "nfacct.h"
+#include "ethtool.h"
+#include "taskstats.h"
+#include "route.h"
+#include "nexthop.h"
+#include "fib.h"
 
 int main(void)
 {
@@ -13,8 +25,20 @@ int main(void)
 	/* Add test suites */
 	sr = srunner_create(NULL);
 	srunner_add_suite(sr, nl_suite());
+	srunner_add_suite(sr, nf_suite());
 	srunner_add_suite(sr, nfqueue_suite());
+	srunner_add_suite(sr, nfct_suite());
+	srunner_add_suite(sr, nfexp_suite());
+	srunner_add_suite(sr, nflog_suite());
+	srunner_add_suite(sr, nft_suite());
+	srunner_add_suite(sr, ipset_suite());
+	srunner_add_suite(sr, nfacct_suite());
 	srunner_add_suite(sr, gen_suite());
+	srunner_add_suite(sr, ethtool_suite());
+	srunner_add_suite(sr, taskstats_suite());
+	srunner_add_suite(sr, route_suite());
+	srunner_add_suite(sr, nexthop_suite());
+	srunner_add_suite(sr, fib_suite());
 
 	/* Run them, and check for failure */
 	srunner_run_all(sr, CK_ENV);